@@ -16,10 +16,12 @@
 #include <utility>
 #include <queue>
 #include <unistd.h>
+#include <time.h>
 #include <cinttypes>
 #include <camera/NdkCameraManager.h>
 #include "camera_manager.h"
 #include "util_debug.h"
+#include "util_pmeter.h"
 #include "camera_utils.h"
 
 
@@ -524,6 +526,42 @@ ImageReaderHelper::GetNativeWindow()
 }
 
 
+/*
+ *  convert the sensor timestamp into pmeter_get_time_ms() time.
+ *  the timestamp base is CLOCK_BOOTTIME (TIMESTAMP_SOURCE_REALTIME) or
+ *  device dependent (TIMESTAMP_SOURCE_UNKNOWN, usually CLOCK_MONOTONIC).
+ *  fall back to the acquire time when neither of them gives a sane age.
+ */
+static double
+get_capture_time_ms (AImage *aimage)
+{
+    double now_ms = pmeter_get_time_ms ();
+
+    int64_t timestamp_ns;
+    if (AImage_getTimestamp (aimage, &timestamp_ns) != AMEDIA_OK)
+        return now_ms;
+
+    double ts_ms = timestamp_ns / 1000000.0;
+    struct timespec tv;
+    clock_gettime (CLOCK_BOOTTIME, &tv);
+    double boot_ms = tv.tv_sec * 1000.0 + tv.tv_nsec / 1000000.0;
+
+    double age_ms = boot_ms - ts_ms;
+    if (age_ms < 0 || age_ms > 1000)
+        age_ms = now_ms - ts_ms;
+    if (age_ms < 0 || age_ms > 1000)
+        age_ms = 0;
+
+    return now_ms - age_ms;
+}
+
+double
+ImageReaderHelper::GetCaptureTimeMs ()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCaptureTimeMs;
+}
+
 int
 ImageReaderHelper::GetCurrentHWBuffer (AHardwareBuffer **outBuffer)
 {
@@ -544,6 +582,7 @@ ImageReaderHelper::GetCurrentHWBuffer (AHardwareBuffer **outBuffer)
         {
             // Any exisitng in mAcquiredImage will be deleted and released automatically.
             mAcquiredImage.reset (aimage);
+            mCaptureTimeMs = get_capture_time_ms (aimage);
         }
     }
 
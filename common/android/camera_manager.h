@@ -116,6 +116,7 @@ public:
     void    HandleImageAvailable ();
 
     int     GetCurrentHWBuffer (AHardwareBuffer** outBuffer);
+    double  GetCaptureTimeMs ();    /* capture time of the current buffer (pmeter_get_time_ms() time) */
     int     GetBufferDimension (int *width, int *height);
     ANativeWindow *GetNativeWindow ();
 
@@ -127,6 +128,7 @@ private:
 
     size_t          mAvailableImages{0};
     ImagePtr        mAcquiredImage {nullptr, AImage_delete};
+    double          mCaptureTimeMs {0};
 
     AImageReader    *mImgReader {nullptr};
     ANativeWindow   *mImgReaderNativeWin {nullptr};
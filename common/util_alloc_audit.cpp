@@ -0,0 +1,128 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include "util_alloc_audit.h"
+#include "util_debug.h"
+
+#if defined (USE_ALLOC_AUDIT)
+
+static std::atomic<uint64_t>    s_total_count;
+static thread_local uint64_t    t_thread_count;
+
+/* the frame is bracketed on the thread which renders it; allocations of
+ * other threads (camera callbacks, pipeline stages, the GL driver) are not
+ * charged to it. */
+static thread_local uint64_t    t_frame_start;
+static thread_local int         t_num_frames;
+static int                      s_strict = -1;      /* -1: from the environment */
+
+#if defined (USE_ALLOC_AUDIT_MALLOC)
+/* -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc */
+extern "C" void *__real_malloc  (size_t size);
+extern "C" void *__real_calloc  (size_t num, size_t size);
+extern "C" void *__real_realloc (void *ptr, size_t size);
+#define raw_malloc  __real_malloc
+#else
+#define raw_malloc  malloc
+#endif
+
+static inline void
+count_alloc (void)
+{
+    t_thread_count ++;
+    s_total_count.fetch_add (1, std::memory_order_relaxed);
+}
+
+static void *
+audit_new (size_t size)
+{
+    count_alloc ();
+
+    void *ptr = raw_malloc (size ? size : 1);
+    if (ptr == NULL)
+        throw std::bad_alloc ();
+    return ptr;
+}
+
+void *operator new   (size_t size)                          { return audit_new (size); }
+void *operator new[] (size_t size)                          { return audit_new (size); }
+void *operator new   (size_t size, const std::nothrow_t &) noexcept { count_alloc (); return raw_malloc (size ? size : 1); }
+void *operator new[] (size_t size, const std::nothrow_t &) noexcept { count_alloc (); return raw_malloc (size ? size : 1); }
+void  operator delete   (void *ptr) noexcept                          { free (ptr); }
+void  operator delete[] (void *ptr) noexcept                          { free (ptr); }
+void  operator delete   (void *ptr, const std::nothrow_t &) noexcept  { free (ptr); }
+void  operator delete[] (void *ptr, const std::nothrow_t &) noexcept  { free (ptr); }
+
+
+#if defined (USE_ALLOC_AUDIT_MALLOC)
+extern "C" void *__wrap_malloc  (size_t size)            { count_alloc (); return __real_malloc (size); }
+extern "C" void *__wrap_calloc  (size_t num, size_t size) { count_alloc (); return __real_calloc (num, size); }
+extern "C" void *__wrap_realloc (void *ptr, size_t size)  { count_alloc (); return __real_realloc (ptr, size); }
+#endif
+
+
+void
+alloc_audit_set_strict (int strict)
+{
+    s_strict = strict;
+}
+
+static int
+is_strict (void)
+{
+    if (s_strict < 0)
+    {
+        const char *env = getenv ("ALLOC_AUDIT_STRICT");
+        s_strict = (env && atoi (env)) ? 1 : 0;
+    }
+    return s_strict;
+}
+
+void
+alloc_audit_frame_begin (void)
+{
+    t_frame_start = t_thread_count;
+}
+
+int
+alloc_audit_frame_end (const char *name)
+{
+    int num_allocs = (int)(t_thread_count - t_frame_start);
+
+    t_num_frames ++;
+    if (t_num_frames > ALLOC_AUDIT_WARMUP_FRAMES && num_allocs > 0)
+    {
+        DBG_LOGE ("ALLOC_AUDIT: %s: frame %d allocated %d time(s) after the warm-up\n",
+                  name, t_num_frames, num_allocs);
+        if (is_strict ())
+            abort ();
+    }
+    return num_allocs;
+}
+
+uint64_t
+alloc_audit_get_thread_count (void)
+{
+    return t_thread_count;
+}
+
+uint64_t
+alloc_audit_get_total_count (void)
+{
+    return s_total_count.load (std::memory_order_relaxed);
+}
+
+#else /* USE_ALLOC_AUDIT */
+
+void     alloc_audit_set_strict (int strict) {}
+void     alloc_audit_frame_begin (void) {}
+int      alloc_audit_frame_end (const char *name) { return 0; }
+uint64_t alloc_audit_get_thread_count (void) { return 0; }
+uint64_t alloc_audit_get_total_count (void) { return 0; }
+
+#endif /* USE_ALLOC_AUDIT */
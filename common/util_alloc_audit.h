@@ -0,0 +1,49 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_ALLOC_AUDIT_H_
+#define _UTIL_ALLOC_AUDIT_H_
+
+#include <stdint.h>
+
+#define ALLOC_AUDIT_WARMUP_FRAMES   30  /* allocations are expected until then */
+
+/*
+ *  Steady-state allocation audit.
+ *
+ *  Build with -DUSE_ALLOC_AUDIT to count every operator new / new[] of the
+ *  app (per thread, and in total over all threads, e.g. pipeline stages).
+ *  With -DUSE_ALLOC_AUDIT_MALLOC and the linker option
+ *  -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc the C allocations of the
+ *  app code are counted too.
+ *
+ *  Bracket every frame with alloc_audit_frame_begin() / _end() on the thread
+ *  which runs it. Only the allocations of that thread are charged to the
+ *  frame. After the warm-up, a frame which allocated is logged; in strict mode (or with
+ *  ALLOC_AUDIT_STRICT=1 in the environment) the app aborts, so a test run
+ *  fails on the first allocation in the steady state.
+ *
+ *  Without USE_ALLOC_AUDIT every function is a no-op which returns 0.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void     alloc_audit_set_strict (int strict);
+
+void     alloc_audit_frame_begin (void);
+
+/* returns the number of allocations of the calling thread since alloc_audit_frame_begin(). */
+int      alloc_audit_frame_end (const char *name);
+
+/* allocations so far: of the calling thread / of all threads */
+uint64_t alloc_audit_get_thread_count (void);
+uint64_t alloc_audit_get_total_count (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_ALLOC_AUDIT_H_ */
@@ -0,0 +1,180 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_ANCHOR_H_
+#define _UTIL_ANCHOR_H_
+
+#include <stdlib.h>
+
+/*
+ *  SSD style anchor centers of grid feature maps (C++ only).
+ *
+ *  The anchors of a known model input are generated at compile time into a
+ *  static SoA table (make_anchor_table ()); other inputs fill a table at run
+ *  time (anchor_set_build ()) with the same formulas. Either way a decoder
+ *  reads the centers of anchor i from x[i] and y[i].
+ *
+ *  anchors are ordered layer by layer, then (y, x, anchor) in each layer.
+ */
+typedef struct _anchor_layer_t
+{
+    int grid_w;
+    int grid_h;
+    int num;            /* anchors per cell */
+    int stride;
+    int normalized;     /* 0: center in pixels (stride * (x + 0.5))      */
+                        /* 1: center in [0, 1] ((x + 0.5) / grid_w)       */
+} anchor_layer_t;
+
+template <int N>
+struct anchor_table_t
+{
+    alignas(16) float x[N];
+    alignas(16) float y[N];
+};
+
+typedef struct _anchor_set_t
+{
+    int         num;
+    const float *x;
+    const float *y;
+    float       *buf;   /* run time table (NULL for a static one) */
+} anchor_set_t;
+
+
+/* -------------------------------------------------- *
+ *  per anchor formulas (usable at compile and run time)
+ * -------------------------------------------------- */
+constexpr int
+anchor_layer_size (const anchor_layer_t &l)
+{
+    return l.grid_w * l.grid_h * l.num;
+}
+
+constexpr int
+anchor_count (const anchor_layer_t *layers, int num_layers)
+{
+    return (num_layers == 0) ? 0 :
+           anchor_layer_size (layers[0]) + anchor_count (layers + 1, num_layers - 1);
+}
+
+constexpr float
+anchor_layer_x (const anchor_layer_t &l, int i)
+{
+    return l.normalized ? ((i / l.num) % l.grid_w + 0.5f) * 1.0f / l.grid_w
+                        : l.stride * ((i / l.num) % l.grid_w + 0.5f);
+}
+
+constexpr float
+anchor_layer_y (const anchor_layer_t &l, int i)
+{
+    return l.normalized ? ((i / l.num) / l.grid_w + 0.5f) * 1.0f / l.grid_h
+                        : l.stride * ((i / l.num) / l.grid_w + 0.5f);
+}
+
+constexpr float
+anchor_x (const anchor_layer_t *layers, int num_layers, int i)
+{
+    return (num_layers <= 1 || i < anchor_layer_size (layers[0])) ?
+           anchor_layer_x (layers[0], i) :
+           anchor_x (layers + 1, num_layers - 1, i - anchor_layer_size (layers[0]));
+}
+
+constexpr float
+anchor_y (const anchor_layer_t *layers, int num_layers, int i)
+{
+    return (num_layers <= 1 || i < anchor_layer_size (layers[0])) ?
+           anchor_layer_y (layers[0], i) :
+           anchor_y (layers + 1, num_layers - 1, i - anchor_layer_size (layers[0]));
+}
+
+
+/* -------------------------------------------------- *
+ *  compile time table
+ * -------------------------------------------------- */
+template <int... I>
+struct anchor_index_seq {};
+
+template <class A, class B>
+struct anchor_index_concat;
+
+template <int... A, int... B>
+struct anchor_index_concat<anchor_index_seq<A...>, anchor_index_seq<B...> >
+{
+    typedef anchor_index_seq<A..., (int)(sizeof... (A) + B)...> type;
+};
+
+/* 0, 1, ..., N-1 (halving keeps the template depth at log2(N)) */
+template <int N>
+struct make_anchor_index_seq
+{
+    typedef typename anchor_index_concat<typename make_anchor_index_seq<N / 2>::type,
+                                         typename make_anchor_index_seq<N - N / 2>::type>::type type;
+};
+
+template <> struct make_anchor_index_seq<0> { typedef anchor_index_seq<>  type; };
+template <> struct make_anchor_index_seq<1> { typedef anchor_index_seq<0> type; };
+
+template <int N, int... I>
+constexpr anchor_table_t<N>
+make_anchor_table_seq (const anchor_layer_t *layers, int num_layers, anchor_index_seq<I...>)
+{
+    return anchor_table_t<N> {{anchor_x (layers, num_layers, I)...},
+                              {anchor_y (layers, num_layers, I)...}};
+}
+
+template <int N>
+constexpr anchor_table_t<N>
+make_anchor_table (const anchor_layer_t *layers, int num_layers)
+{
+    return make_anchor_table_seq<N> (layers, num_layers, typename make_anchor_index_seq<N>::type ());
+}
+
+
+/* -------------------------------------------------- *
+ *  anchor set: the static table, or one built at run time
+ * -------------------------------------------------- */
+template <int N>
+static inline void
+anchor_set_static (anchor_set_t *set, const anchor_table_t<N> &table)
+{
+    set->num = N;
+    set->x   = table.x;
+    set->y   = table.y;
+    set->buf = NULL;
+}
+
+/* returns the number of anchors, or -1 */
+static inline int
+anchor_set_build (anchor_set_t *set, const anchor_layer_t *layers, int num_layers)
+{
+    int num = anchor_count (layers, num_layers);
+    float *buf = (float *)malloc (num * 2 * sizeof (float));
+    if (buf == NULL)
+        return -1;
+
+    for (int i = 0; i < num; i ++)
+    {
+        buf[i      ] = anchor_x (layers, num_layers, i);
+        buf[i + num] = anchor_y (layers, num_layers, i);
+    }
+
+    set->num = num;
+    set->x   = buf;
+    set->y   = buf + num;
+    set->buf = buf;
+    return num;
+}
+
+static inline void
+anchor_set_free (anchor_set_t *set)
+{
+    free (set->buf);
+    set->num = 0;
+    set->x   = NULL;
+    set->y   = NULL;
+    set->buf = NULL;
+}
+
+#endif /* _UTIL_ANCHOR_H_ */
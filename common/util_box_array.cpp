@@ -0,0 +1,248 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "util_box_array.h"
+#include "util_debug.h"
+
+
+int
+box_array_init (box_array_t *ba, int capacity)
+{
+    memset (ba, 0, sizeof (*ba));
+    if (capacity <= 0)
+    {
+        DBG_LOGE ("ERR: %s(%d): capacity=%d\n", __FILE__, __LINE__, capacity);
+        return -1;
+    }
+
+    ba->score = (float *)malloc (capacity * sizeof (float));
+    ba->x0    = (float *)malloc (capacity * sizeof (float));
+    ba->y0    = (float *)malloc (capacity * sizeof (float));
+    ba->x1    = (float *)malloc (capacity * sizeof (float));
+    ba->y1    = (float *)malloc (capacity * sizeof (float));
+    ba->id    = (int   *)malloc (capacity * sizeof (int));
+    ba->order = (int   *)malloc (capacity * sizeof (int));
+    if (!ba->score || !ba->x0 || !ba->y0 || !ba->x1 || !ba->y1 || !ba->id || !ba->order)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        box_array_free (ba);
+        return -1;
+    }
+
+    ba->capacity = capacity;
+    return 0;
+}
+
+void
+box_array_free (box_array_t *ba)
+{
+    free (ba->score);
+    free (ba->x0);
+    free (ba->y0);
+    free (ba->x1);
+    free (ba->y1);
+    free (ba->id);
+    free (ba->order);
+    memset (ba, 0, sizeof (*ba));
+}
+
+void
+box_array_clear (box_array_t *ba)
+{
+    ba->num     = 0;
+    ba->is_heap = 0;
+}
+
+
+/* -------------------------------------------------- *
+ *  bounded min-heap (used only once the array is full)
+ * -------------------------------------------------- */
+
+/* slot "a" ranks below slot "b" (smaller score, or same score and larger id) */
+static inline bool
+is_worse (box_array_t *ba, int a, int b)
+{
+    return (ba->score[a] < ba->score[b]) ||
+           (ba->score[a] == ba->score[b] && ba->id[a] > ba->id[b]);
+}
+
+static inline void
+swap_slot (box_array_t *ba, int a, int b)
+{
+    std::swap (ba->score[a], ba->score[b]);
+    std::swap (ba->x0[a], ba->x0[b]);
+    std::swap (ba->y0[a], ba->y0[b]);
+    std::swap (ba->x1[a], ba->x1[b]);
+    std::swap (ba->y1[a], ba->y1[b]);
+    std::swap (ba->id[a], ba->id[b]);
+}
+
+static void
+sift_down (box_array_t *ba, int pos)
+{
+    int num = ba->num;
+    for (;;)
+    {
+        int l = 2 * pos + 1;
+        int r = l + 1;
+        int worst = pos;
+
+        if (l < num && is_worse (ba, l, worst))
+            worst = l;
+        if (r < num && is_worse (ba, r, worst))
+            worst = r;
+        if (worst == pos)
+            return;
+
+        swap_slot (ba, pos, worst);
+        pos = worst;
+    }
+}
+
+static inline void
+set_slot (box_array_t *ba, int pos, float score, float x0, float y0, float x1, float y1, int id)
+{
+    ba->score[pos] = score;
+    ba->x0   [pos] = x0;
+    ba->y0   [pos] = y0;
+    ba->x1   [pos] = x1;
+    ba->y1   [pos] = y1;
+    ba->id   [pos] = id;
+}
+
+void
+box_array_push (box_array_t *ba, float score, float x0, float y0, float x1, float y1, int id)
+{
+    if (ba->num < ba->capacity)
+    {
+        set_slot (ba, ba->num, score, x0, y0, x1, y1, id);
+        ba->num ++;
+        return;
+    }
+
+    if (!ba->is_heap)
+    {
+        for (int i = ba->num / 2 - 1; i >= 0; i --)
+            sift_down (ba, i);
+        ba->is_heap = 1;
+    }
+
+    /* boxes are pushed in ascending id order, so a tie never replaces the root. */
+    if (score > ba->score[0])
+    {
+        set_slot (ba, 0, score, x0, y0, x1, y1, id);
+        sift_down (ba, 0);
+    }
+}
+
+
+/* -------------------------------------------------- *
+ *  sort / NMS
+ * -------------------------------------------------- */
+int
+box_array_sort (box_array_t *ba, int *sel, int max_sel)
+{
+    int *order = ba->order;
+    for (int i = 0; i < ba->num; i ++)
+        order[i] = i;
+
+    /* std::sort works in place: no allocation, unlike std::stable_sort */
+    std::sort (order, order + ba->num, [ba](int a, int b) {
+        return is_worse (ba, b, a);
+    });
+
+    int num_sel = std::min (ba->num, max_sel);
+    if (sel != order)
+        memcpy (sel, order, num_sel * sizeof (int));
+    return num_sel;
+}
+
+int
+box_array_list (box_array_t *ba, int *sel, int max_sel)
+{
+    int num_sel = std::min (ba->num, max_sel);
+    for (int i = 0; i < num_sel; i ++)
+        sel[i] = i;
+    return num_sel;
+}
+
+static float
+calc_intersection_over_union (box_array_t *ba, int a, int b)
+{
+    float xmin0 = std::min (ba->x0[a], ba->x1[a]);
+    float ymin0 = std::min (ba->y0[a], ba->y1[a]);
+    float xmax0 = std::max (ba->x0[a], ba->x1[a]);
+    float ymax0 = std::max (ba->y0[a], ba->y1[a]);
+    float xmin1 = std::min (ba->x0[b], ba->x1[b]);
+    float ymin1 = std::min (ba->y0[b], ba->y1[b]);
+    float xmax1 = std::max (ba->x0[b], ba->x1[b]);
+    float ymax1 = std::max (ba->y0[b], ba->y1[b]);
+
+    float area0 = (ymax0 - ymin0) * (xmax0 - xmin0);
+    float area1 = (ymax1 - ymin1) * (xmax1 - xmin1);
+    if (area0 <= 0 || area1 <= 0)
+        return 0.0f;
+
+    float intersect_xmin = std::max (xmin0, xmin1);
+    float intersect_ymin = std::max (ymin0, ymin1);
+    float intersect_xmax = std::min (xmax0, xmax1);
+    float intersect_ymax = std::min (ymax0, ymax1);
+
+    float intersect_area = std::max (intersect_ymax - intersect_ymin, 0.0f) *
+                           std::max (intersect_xmax - intersect_xmin, 0.0f);
+
+    return intersect_area / (area0 + area1 - intersect_area);
+}
+
+int
+box_array_nms (box_array_t *ba, float iou_thresh, int *sel, int max_sel)
+{
+    int num_cand = box_array_sort (ba, ba->order, ba->num);
+    int num_sel  = 0;
+
+    for (int i = 0; i < num_cand && num_sel < max_sel; i ++)
+    {
+        int cand = ba->order[i];
+
+        int ignore_candidate = false;
+        for (int j = num_sel - 1; j >= 0; j --)
+        {
+            if (calc_intersection_over_union (ba, cand, sel[j]) >= iou_thresh)
+            {
+                ignore_candidate = true;
+                break;
+            }
+        }
+
+        if (!ignore_candidate)
+            sel[num_sel ++] = cand;
+    }
+
+    return num_sel;
+}
+
+int
+box_array_overlaps (box_array_t *ba, float iou_thresh)
+{
+    for (int a = 0; a < ba->num; a ++)
+    {
+        for (int b = a + 1; b < ba->num; b ++)
+        {
+            /* disjoint boxes have IoU 0: no division needed for them */
+            int disjoint = std::max (ba->x0[a], ba->x1[a]) <= std::min (ba->x0[b], ba->x1[b]) ||
+                           std::max (ba->x0[b], ba->x1[b]) <= std::min (ba->x0[a], ba->x1[a]) ||
+                           std::max (ba->y0[a], ba->y1[a]) <= std::min (ba->y0[b], ba->y1[b]) ||
+                           std::max (ba->y0[b], ba->y1[b]) <= std::min (ba->y0[a], ba->y1[a]);
+            if (disjoint && iou_thresh > 0)
+                continue;
+
+            if (calc_intersection_over_union (ba, a, b) >= iou_thresh)
+                return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_BOX_ARRAY_H_
+#define _UTIL_BOX_ARRAY_H_
+
+/*
+ *  Fixed-capacity candidate boxes of a detector, stored as one array per
+ *  field (SoA). Only the box and the score are kept: "id" is the anchor (or
+ *  cell) index the box was decoded from, and the landmarks are decoded from
+ *  it for the few boxes that survive NMS.
+ *
+ *  All the storage is allocated by box_array_init (), so a frame never
+ *  allocates. Once "capacity" boxes are held, the array turns into a bounded
+ *  min-heap on score: a new box replaces the lowest scored one, or is dropped.
+ */
+typedef struct _box_array_t
+{
+    int     capacity;
+    int     num;
+    int     is_heap;    /* slots are in heap order (set when the array fills up) */
+
+    float   *score;
+    float   *x0;        /* top-left     */
+    float   *y0;
+    float   *x1;        /* bottom-right */
+    float   *y1;
+    int     *id;
+
+    int     *order;     /* work area of box_array_sort () */
+} box_array_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int  box_array_init  (box_array_t *ba, int capacity);
+void box_array_free  (box_array_t *ba);
+void box_array_clear (box_array_t *ba);
+
+void box_array_push  (box_array_t *ba, float score, float x0, float y0, float x1, float y1, int id);
+
+/*
+ *  Write the slot indices of the boxes in descending score order (ties in
+ *  ascending id, which matches a stable sort of boxes pushed in id order)
+ *  to "sel". Returns the number written (at most max_sel).
+ */
+int  box_array_sort  (box_array_t *ba, int *sel, int max_sel);
+
+/*
+ *  Write the slot indices in push order (anchor order) to "sel", without
+ *  sorting. Valid while the array has not filled up (capacity >= pushes).
+ *  Returns the number written (at most max_sel).
+ */
+int  box_array_list  (box_array_t *ba, int *sel, int max_sel);
+
+/*
+ *  Greedy NMS: walk the boxes in box_array_sort () order and keep the ones
+ *  whose IoU with every kept box is below iou_thresh. Returns the number of
+ *  slot indices written to "sel" (at most max_sel).
+ */
+int  box_array_nms   (box_array_t *ba, float iou_thresh, int *sel, int max_sel);
+
+/*
+ *  Returns 1 when some pair of boxes has IoU >= iou_thresh, i.e. when
+ *  box_array_nms () would drop a box. With 0, box_array_sort () gives the
+ *  same selection without NMS. Stops at the first overlapping pair.
+ */
+int  box_array_overlaps (box_array_t *ba, float iou_thresh);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_BOX_ARRAY_H_ */
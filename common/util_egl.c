@@ -54,7 +54,7 @@ find_egl_config (int r, int g, int b, int a, int d, int s, int ms, int sfc_type,
     config_attribs[ 9] = d; 
     config_attribs[11] = s; 
     config_attribs[13] = ms; 
-    config_attribs[15] = sfc_type; /* EGL_WINDOW_BIT/EGL_STREAM_BIT_KHR */
+    config_attribs[15] = sfc_type; /* EGL_WINDOW_BIT/EGL_PBUFFER_BIT/EGL_STREAM_BIT_KHR */
 
     switch (ver)
     {
@@ -156,8 +156,8 @@ egl_init_with_pbuffer_surface (int gles_version, int depth_size, int stencil_siz
         return -1;
     }
 
-    config = find_egl_config (8, 8, 8, 8, depth_size, stencil_size, sample_num, EGL_WINDOW_BIT, gles_version);
-    if (ret != EGL_TRUE)
+    config = find_egl_config (8, 8, 8, 8, depth_size, stencil_size, sample_num, EGL_PBUFFER_BIT, gles_version);
+    if (config == 0)
     {
         fprintf (stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
         return -1;
@@ -0,0 +1,120 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdlib.h>
+#include <string.h>
+#include "util_frame_diff.h"
+#include "util_debug.h"
+
+
+int
+frame_diff_init (frame_diff_t *fd, int grid_w, int grid_h, float threshold)
+{
+    memset (fd, 0, sizeof (*fd));
+
+    fd->grid_w    = grid_w;
+    fd->grid_h    = grid_h;
+    fd->threshold = threshold;
+    fd->ref = (uint8_t *)malloc (grid_w * grid_h);
+    fd->cur = (uint8_t *)malloc (grid_w * grid_h);
+    if (fd->ref == NULL || fd->cur == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        frame_diff_free (fd);
+        return -1;
+    }
+    return 0;
+}
+
+void
+frame_diff_free (frame_diff_t *fd)
+{
+    free (fd->ref);
+    free (fd->cur);
+    fd->ref = NULL;
+    fd->cur = NULL;
+    fd->ref_valid = 0;
+}
+
+void
+frame_diff_set_threshold (frame_diff_t *fd, float threshold)
+{
+    fd->threshold = threshold;
+}
+
+void
+frame_diff_reset (frame_diff_t *fd)
+{
+    fd->ref_valid = 0;
+}
+
+
+/* mean luma (BT.601, 8bit fixed point) of every grid cell */
+static void
+reduce_to_grid (frame_diff_t *fd, const uint8_t *rgba, int w, int h)
+{
+    int gw = fd->grid_w;
+    int gh = fd->grid_h;
+
+    for (int gy = 0; gy < gh; gy ++)
+    {
+        int y0 = gy * h / gh;
+        int y1 = (gy + 1) * h / gh;
+        for (int gx = 0; gx < gw; gx ++)
+        {
+            int x0 = gx * w / gw;
+            int x1 = (gx + 1) * w / gw;
+            uint32_t sum = 0;
+            int num = (x1 - x0) * (y1 - y0);
+
+            for (int y = y0; y < y1; y ++)
+            {
+                const uint8_t *p = rgba + (y * w + x0) * 4;
+                for (int x = x0; x < x1; x ++, p += 4)
+                    sum += (p[0] * 77 + p[1] * 150 + p[2] * 29) >> 8;
+            }
+            fd->cur[gy * gw + gx] = num ? (uint8_t)(sum / num) : 0;
+        }
+    }
+}
+
+int
+frame_diff_update (frame_diff_t *fd, const uint8_t *rgba, int w, int h)
+{
+    int num_cells = fd->grid_w * fd->grid_h;
+
+    if (fd->ref == NULL)
+        return 1;
+
+    reduce_to_grid (fd, rgba, w, h);
+
+    int changed = 1;
+    if (fd->ref_valid)
+    {
+        int max_diff = 0;
+        for (int i = 0; i < num_cells; i ++)
+        {
+            int diff = abs ((int)fd->cur[i] - (int)fd->ref[i]);
+            if (diff > max_diff)
+                max_diff = diff;
+        }
+
+        fd->last_diff = (float)max_diff;
+        changed = (max_diff > 0) && (fd->last_diff >= fd->threshold);
+    }
+
+    if (changed)
+    {
+        uint8_t *tmp = fd->ref;
+        fd->ref = fd->cur;
+        fd->cur = tmp;
+        fd->ref_valid   = 1;
+        fd->num_skipped = 0;
+    }
+    else
+    {
+        fd->num_skipped ++;
+    }
+    return changed;
+}
@@ -0,0 +1,55 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_FRAME_DIFF_H_
+#define _UTIL_FRAME_DIFF_H_
+
+#include <stdint.h>
+
+#define FRAME_DIFF_GRID     32      /* default grid: 32x32 cells */
+
+/*
+ *  Content change detector.
+ *
+ *  The input image (RGBA8888, already read back for the preprocessing) is
+ *  reduced to the mean luma of every grid cell, and compared with the
+ *  reference frame cell by cell. The largest cell difference decides: a
+ *  small moving object changes a few cells a lot and must not be averaged
+ *  away by the static rest of the frame. When every cell stays below the
+ *  threshold, the app can skip Invoke() and keep the last result. The
+ *  reference is replaced only by a changed frame, so a slow drift still adds
+ *  up to a change.
+ */
+typedef struct _frame_diff_t
+{
+    int     grid_w, grid_h;
+    float   threshold;      /* [0, 255] luma levels of a cell. 0: any difference is a change */
+    uint8_t *ref;           /* [grid_h][grid_w] cell luma of the reference frame */
+    uint8_t *cur;
+    int     ref_valid;
+    float   last_diff;      /* largest cell difference of the last frame */
+    int     num_skipped;    /* unchanged frames in a row */
+} frame_diff_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int  frame_diff_init (frame_diff_t *fd, int grid_w, int grid_h, float threshold);
+void frame_diff_free (frame_diff_t *fd);
+
+void frame_diff_set_threshold (frame_diff_t *fd, float threshold);
+
+/* treat the next frame as changed (e.g. after the model or the settings were switched). */
+void frame_diff_reset (frame_diff_t *fd);
+
+/* returns 1 when the frame changed (and becomes the new reference), 0 when not. */
+int  frame_diff_update (frame_diff_t *fd, const uint8_t *rgba, int w, int h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_FRAME_DIFF_H_ */
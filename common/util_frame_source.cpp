@@ -0,0 +1,171 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <thread>
+#include <chrono>
+#include "util_frame_source.h"
+#include "util_pmeter.h"
+#include "util_debug.h"
+
+struct _frame_source_t
+{
+    int         w, h;
+    double      period_ms;      /* 0: no pacing */
+    double      start_ms;
+    int         last_frame;
+
+    /* file source */
+    uint8_t     *file_buf;
+    int         num_file_frames;
+};
+
+
+static frame_source_t *
+create_source (int w, int h, float fps)
+{
+    frame_source_t *src = (frame_source_t *)calloc (1, sizeof (frame_source_t));
+    if (src == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return NULL;
+    }
+
+    src->w          = w;
+    src->h          = h;
+    src->period_ms  = (fps > 0) ? 1000.0 / fps : 0;
+    src->start_ms   = pmeter_get_time_ms ();
+    src->last_frame = -1;
+    return src;
+}
+
+frame_source_t *
+frame_source_create_synthetic (int w, int h, float fps)
+{
+    return create_source (w, h, fps);
+}
+
+frame_source_t *
+frame_source_create_file (const char *fname, int w, int h, float fps)
+{
+    FILE *fp = fopen (fname, "rb");
+    if (fp == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d): can't open \"%s\"\n", __FILE__, __LINE__, fname);
+        return NULL;
+    }
+
+    fseek (fp, 0, SEEK_END);
+    long fsize = ftell (fp);
+    fseek (fp, 0, SEEK_SET);
+
+    long frame_size = (long)w * h * 4;
+    int num_frames = (int)(fsize / frame_size);
+    if (num_frames <= 0)
+    {
+        DBG_LOGE ("ERR: %s(%d): \"%s\" is smaller than a frame\n", __FILE__, __LINE__, fname);
+        fclose (fp);
+        return NULL;
+    }
+
+    frame_source_t *src = create_source (w, h, fps);
+    if (src == NULL)
+    {
+        fclose (fp);
+        return NULL;
+    }
+
+    src->file_buf = (uint8_t *)malloc (frame_size * num_frames);
+    if (src->file_buf == NULL ||
+        fread (src->file_buf, frame_size, num_frames, fp) != (size_t)num_frames)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        fclose (fp);
+        frame_source_destroy (src);
+        return NULL;
+    }
+    fclose (fp);
+
+    src->num_file_frames = num_frames;
+    DBG_LOG ("frame_source: \"%s\" %d frames (%dx%d)\n", fname, num_frames, w, h);
+    return src;
+}
+
+void
+frame_source_destroy (frame_source_t *src)
+{
+    if (src == NULL)
+        return;
+
+    free (src->file_buf);
+    free (src);
+}
+
+
+static void
+render_synthetic_frame (frame_source_t *src, int frame_no, uint8_t *rgba)
+{
+    int w = src->w;
+    int h = src->h;
+
+    /* gradient scrolling to the right, and a box bouncing around */
+    int box_w = w / 4;
+    int box_h = h / 4;
+    int box_x = abs ((frame_no * 7) % (2 * (w - box_w)) - (w - box_w));
+    int box_y = abs ((frame_no * 5) % (2 * (h - box_h)) - (h - box_h));
+
+    for (int y = 0; y < h; y ++)
+    {
+        uint8_t *p = rgba + y * w * 4;
+        for (int x = 0; x < w; x ++)
+        {
+            bool in_box = (x >= box_x && x < box_x + box_w && y >= box_y && y < box_y + box_h);
+            p[0] = in_box ? 255 : (uint8_t)(x + frame_no * 4);
+            p[1] = in_box ? 255 : (uint8_t)(y);
+            p[2] = in_box ? 255 : (uint8_t)(frame_no);
+            p[3] = 255;
+            p += 4;
+        }
+    }
+}
+
+int
+frame_source_read (frame_source_t *src, uint8_t *rgba, double *capture_ms)
+{
+    int frame_no = src->last_frame + 1;
+
+    if (src->period_ms > 0)
+    {
+        /* frames which were due while nobody was reading are lost, like a camera */
+        double now = pmeter_get_time_ms ();
+        int due_frame = (int)((now - src->start_ms) / src->period_ms);
+        if (due_frame > frame_no)
+            frame_no = due_frame;
+
+        double due_ms = src->start_ms + frame_no * src->period_ms;
+        if (due_ms > now)
+            std::this_thread::sleep_for (std::chrono::microseconds ((long)((due_ms - now) * 1000)));
+    }
+
+    if (src->file_buf)
+    {
+        size_t frame_size = (size_t)src->w * src->h * 4;
+        memcpy (rgba, src->file_buf + (frame_no % src->num_file_frames) * frame_size, frame_size);
+    }
+    else
+    {
+        render_synthetic_frame (src, frame_no, rgba);
+    }
+
+    if (src->period_ms > 0)
+        *capture_ms = src->start_ms + frame_no * src->period_ms;
+    else
+        *capture_ms = pmeter_get_time_ms ();
+
+    src->last_frame = frame_no;
+    return frame_no;
+}
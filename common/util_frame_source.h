@@ -0,0 +1,53 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_FRAME_SOURCE_H_
+#define _UTIL_FRAME_SOURCE_H_
+
+#include <stdint.h>
+
+/*
+ *  Frame source without a camera, to drive util_pipeline on a Linux host and
+ *  load-test the latency budget policy (tools/pipeline_loadtest).
+ *
+ *  Frames are produced at a fixed rate like a camera: a consumer which is
+ *  late misses the frames it did not pick up in time, and the returned frame
+ *  number jumps accordingly. fps <= 0 returns a frame on every call.
+ *
+ *      frame_source_t *src = frame_source_create_synthetic (w, h, 30.0f);
+ *      for (;;) {
+ *          pipeline_frame_t *frame = pipeline_acquire (pl);
+ *          if (frame == NULL) { ... skip ... }
+ *          frame_source_read (src, rgba, &capture_ms);
+ *          pipeline_submit_at (pl, frame, capture_ms);
+ *          ...
+ *      }
+ */
+typedef struct _frame_source_t frame_source_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* moving gradient with a bouncing box */
+frame_source_t *frame_source_create_synthetic (int w, int h, float fps);
+
+/* raw RGBA8888 frames (w * h * 4 bytes each) stored back to back, played in a loop */
+frame_source_t *frame_source_create_file (const char *fname, int w, int h, float fps);
+
+void frame_source_destroy (frame_source_t *src);
+
+/*
+ *  wait for the next frame and copy it into rgba (w * h * 4 bytes).
+ *  capture_ms receives the capture time in pmeter_get_time_ms() time.
+ *  returns the frame number, or -1 on error.
+ */
+int  frame_source_read (frame_source_t *src, uint8_t *rgba, double *capture_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_FRAME_SOURCE_H_ */
@@ -0,0 +1,90 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <string.h>
+#include "util_governor.h"
+
+#define GOVERNOR_EMA_ALPHA      0.1f    /* smoothing of the inference time */
+#define GOVERNOR_HOLD_FRAMES    15      /* minimum frames between switches */
+#define GOVERNOR_PROBE_FRAMES   150     /* re-measure a better level after this */
+#define GOVERNOR_UP_MARGIN      0.8f    /* step up when the better level fits in 80% */
+
+
+void
+governor_init (governor_t *gov, int num_levels, float target_ms)
+{
+    memset (gov, 0, sizeof (*gov));
+
+    if (num_levels < 1)
+        num_levels = 1;
+    if (num_levels > GOVERNOR_MAX_LEVELS)
+        num_levels = GOVERNOR_MAX_LEVELS;
+
+    gov->num_levels = num_levels;
+    gov->target_ms  = target_ms;
+}
+
+void
+governor_set_target (governor_t *gov, float target_ms)
+{
+    gov->target_ms = target_ms;
+}
+
+static void
+switch_level (governor_t *gov, int level)
+{
+    gov->level       = level;
+    gov->stay_frames = 0;
+    gov->num_switches ++;
+}
+
+int
+governor_update (governor_t *gov, float invoke_ms)
+{
+    int   level  = gov->level;
+    float *cost  = gov->cost_ms;
+    float target = gov->target_ms;
+
+    /* the first frame after a switch carries the warm up cost. skip it. */
+    if (gov->stay_frames > 0)
+    {
+        if (cost[level] <= 0.0f)
+            cost[level] = invoke_ms;
+        else
+            cost[level] += GOVERNOR_EMA_ALPHA * (invoke_ms - cost[level]);
+    }
+
+    gov->stay_frames ++;
+    if (gov->stay_frames < GOVERNOR_HOLD_FRAMES || target <= 0.0f)
+        return gov->level;
+
+    /* missing the deadline: degrade */
+    if (cost[level] > target)
+    {
+        if (level < gov->num_levels - 1)
+            switch_level (gov, level + 1);
+        return gov->level;
+    }
+
+    /* enough headroom: try the better level */
+    if (level > 0 && cost[level] < target * GOVERNOR_UP_MARGIN)
+    {
+        float better = cost[level - 1];
+
+        /*
+         * a cost measured under contention may be stale. after a while,
+         * forget it and probe the better level again.
+         */
+        if (gov->stay_frames >= GOVERNOR_PROBE_FRAMES)
+            better = 0.0f;
+
+        if (better <= 0.0f || better < target * GOVERNOR_UP_MARGIN)
+        {
+            cost[level - 1] = better;
+            switch_level (gov, level - 1);
+        }
+    }
+
+    return gov->level;
+}
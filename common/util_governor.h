@@ -0,0 +1,46 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_GOVERNOR_H_
+#define _UTIL_GOVERNOR_H_
+
+#define GOVERNOR_MAX_LEVELS     8
+
+/*
+ *  Adaptive quality governor.
+ *
+ *  The app registers its model variants as quality levels, from the best
+ *  (level 0, slowest) to the cheapest, all of them loaded up front so that a
+ *  switch costs nothing. Feed the inference time of every frame; the governor
+ *  steps down a level when the current one misses the target and steps back
+ *  up only when the better level is known (or expected) to fit with margin.
+ *  A level is held for a minimum number of frames after every switch.
+ */
+typedef struct _governor_t
+{
+    int     num_levels;
+    int     level;                          /* level to use for the next frame */
+    float   target_ms;
+
+    float   cost_ms[GOVERNOR_MAX_LEVELS];   /* smoothed inference time. 0: not measured */
+    int     stay_frames;                    /* frames since the last switch */
+    int     num_switches;
+} governor_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void governor_init (governor_t *gov, int num_levels, float target_ms);
+void governor_set_target (governor_t *gov, float target_ms);
+
+/* record the inference time of the current level and return the level for the next frame. */
+int  governor_update (governor_t *gov, float invoke_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_GOVERNOR_H_ */
@@ -0,0 +1,344 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdlib.h>
+#include <string.h>
+#include <GLES2/gl2.h>
+#include "util_graph.h"
+#include "util_render2d.h"
+#include "util_thread_pool.h"
+#include "util_frame_diff.h"
+#include "util_pmeter.h"
+#include "util_debug.h"
+
+typedef struct _graph_node_t
+{
+    graph_node_desc_t   desc;
+    int                 parent;         /* node index. -1: root */
+    int                 depth;
+
+    int                 num_rois;
+    graph_roi_t         *rois;          /* [max_rois] */
+    uint8_t             **rgba;         /* [max_rois] crop buffers, allocated on first use */
+    uint8_t             *results;       /* [max_rois * result_size] */
+
+    double              crop_ms;
+    double              run_ms;
+} graph_node_t;
+
+struct _graph_t
+{
+    graph_node_t        nodes[GRAPH_MAX_NODES];
+    int                 num_nodes;
+    int                 max_depth;
+
+    /* nodes of the level being run */
+    int                 level_nodes[GRAPH_MAX_NODES];
+    int                 num_level_nodes;
+    thread_pool_t       *branch_pool;
+    int                 gl_thread_only;
+
+    int                 skip_unchanged;
+    frame_diff_t        frame_diff;     /* on the crop of the root node */
+};
+
+
+graph_t *
+graph_create (const graph_node_desc_t *nodes, int num_nodes)
+{
+    if (num_nodes <= 0 || num_nodes > GRAPH_MAX_NODES)
+    {
+        DBG_LOGE ("ERR: %s(%d): num_nodes=%d\n", __FILE__, __LINE__, num_nodes);
+        return NULL;
+    }
+
+    graph_t *g = (graph_t *)calloc (1, sizeof (graph_t));
+    if (g == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return NULL;
+    }
+
+    int level_width[GRAPH_MAX_NODES] = {0};
+    int max_width = 1;
+
+    for (int i = 0; i < num_nodes; i ++)
+    {
+        graph_node_t *node = &g->nodes[i];
+        node->desc   = nodes[i];
+        node->parent = -1;
+        g->num_nodes = i + 1;
+
+        if (nodes[i].parent)
+        {
+            for (int j = 0; j < i; j ++)
+            {
+                if (strcmp (nodes[j].name, nodes[i].parent) == 0)
+                    node->parent = j;
+            }
+            if (node->parent < 0 || nodes[i].gen_rois == NULL)
+            {
+                DBG_LOGE ("ERR: %s(%d): bad parent of \"%s\"\n", __FILE__, __LINE__, nodes[i].name);
+                graph_destroy (g);
+                return NULL;
+            }
+            node->depth = g->nodes[node->parent].depth + 1;
+        }
+        else
+        {
+            node->desc.max_rois = 1;    /* the whole frame */
+        }
+
+        int max_rois = node->desc.max_rois;
+        node->rois    = (graph_roi_t *)calloc (max_rois, sizeof (graph_roi_t));
+        node->rgba    = (uint8_t **)calloc (max_rois, sizeof (uint8_t *));
+        node->results = (uint8_t *)calloc (max_rois, node->desc.result_size);
+        if (node->rois == NULL || node->rgba == NULL || node->results == NULL)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            graph_destroy (g);
+            return NULL;
+        }
+
+        if (node->depth > g->max_depth)
+            g->max_depth = node->depth;
+
+        level_width[node->depth] ++;
+        if (level_width[node->depth] > max_width)
+            max_width = level_width[node->depth];
+    }
+
+    g->branch_pool = thread_pool_create (max_width);
+
+    return g;
+}
+
+void
+graph_destroy (graph_t *g)
+{
+    if (g == NULL)
+        return;
+
+    for (int i = 0; i < g->num_nodes; i ++)
+    {
+        graph_node_t *node = &g->nodes[i];
+        if (node->rgba)
+        {
+            for (int j = 0; j < node->desc.max_rois; j ++)
+                free (node->rgba[j]);
+        }
+        free (node->rgba);
+        free (node->rois);
+        free (node->results);
+    }
+
+    if (g->branch_pool)
+        thread_pool_destroy (g->branch_pool);
+    frame_diff_free (&g->frame_diff);
+    free (g);
+}
+
+void
+graph_set_gl_thread_only (graph_t *g, int enable)
+{
+    g->gl_thread_only = enable;
+}
+
+void
+graph_set_skip_threshold (graph_t *g, float threshold)
+{
+    if (threshold < 0)
+    {
+        g->skip_unchanged = 0;
+        return;
+    }
+
+    if (g->frame_diff.ref == NULL)
+    {
+        if (frame_diff_init (&g->frame_diff, FRAME_DIFF_GRID, FRAME_DIFF_GRID, threshold) < 0)
+            return;
+    }
+    frame_diff_set_threshold (&g->frame_diff, threshold);
+    frame_diff_reset (&g->frame_diff);
+    g->skip_unchanged = 1;
+}
+
+int
+graph_find_node (graph_t *g, const char *name)
+{
+    for (int i = 0; i < g->num_nodes; i ++)
+    {
+        if (strcmp (g->nodes[i].desc.name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+
+/* -------------------------------------------------- *
+ *  ROI generation and crop (GL thread)
+ * -------------------------------------------------- */
+static void
+gen_node_rois (graph_t *g, graph_node_t *node)
+{
+    if (node->parent < 0)
+    {
+        /* root: the whole frame */
+        graph_roi_t *roi = &node->rois[0];
+        roi->pos[0][0] = 0.0f;  roi->pos[0][1] = 0.0f;
+        roi->pos[1][0] = 1.0f;  roi->pos[1][1] = 0.0f;
+        roi->pos[2][0] = 1.0f;  roi->pos[2][1] = 1.0f;
+        roi->pos[3][0] = 0.0f;  roi->pos[3][1] = 1.0f;
+        roi->parent_roi = -1;
+        node->num_rois = 1;
+        return;
+    }
+
+    graph_node_t *parent = &g->nodes[node->parent];
+    size_t parent_size = parent->desc.result_size;
+    int num_rois = 0;
+
+    for (int i = 0; i < parent->num_rois; i ++)
+    {
+        int max_rois = node->desc.max_rois - num_rois;
+        if (max_rois <= 0)
+            break;
+
+        int n = node->desc.gen_rois (node->desc.ctx, &parent->rois[i], parent->results + i * parent_size,
+                                     &node->rois[num_rois], max_rois);
+        for (int j = 0; j < n; j ++)
+            node->rois[num_rois + j].parent_roi = i;
+
+        num_rois += n;
+    }
+    node->num_rois = num_rois;
+}
+
+static int
+crop_node_rois (graph_node_t *node, texture_2d_t *srctex, int win_w, int win_h)
+{
+    int w = node->desc.crop_w;
+    int h = node->desc.crop_h;
+
+    /* glReadPixels() of the part outside the framebuffer is undefined */
+    if (w > win_w || h > win_h)
+    {
+        DBG_LOGE ("ERR: %s(%d): crop of \"%s\" (%dx%d) exceeds the window (%dx%d)\n",
+                  __FILE__, __LINE__, node->desc.name, w, h, win_w, win_h);
+        return -1;
+    }
+
+    for (int i = 0; i < node->num_rois; i ++)
+    {
+        if (node->rgba[i] == NULL)
+        {
+            node->rgba[i] = (uint8_t *)malloc (w * h * 4);
+            if (node->rgba[i] == NULL)
+            {
+                DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+                return -1;
+            }
+        }
+
+        graph_roi_t *roi = &node->rois[i];
+        float texcoord[] = {
+            roi->pos[3][0], roi->pos[3][1],
+            roi->pos[0][0], roi->pos[0][1],
+            roi->pos[2][0], roi->pos[2][1],
+            roi->pos[1][0], roi->pos[1][1] };
+
+        draw_2d_texture_ex_texcoord (srctex, 0, win_h - h, w, h, texcoord);
+
+        glPixelStorei (GL_PACK_ALIGNMENT, 4);
+        glReadPixels (0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, node->rgba[i]);
+    }
+    return 0;
+}
+
+
+/* -------------------------------------------------- *
+ *  run (the nodes of a level in parallel)
+ * -------------------------------------------------- */
+static void
+run_node (void *arg, int task_id)
+{
+    graph_t *g = (graph_t *)arg;
+    graph_node_t *node = &g->nodes[g->level_nodes[task_id]];
+
+    double ttime0 = pmeter_get_time_ms ();
+    if (node->num_rois > 0)
+    {
+        node->desc.run (node->desc.ctx, node->num_rois, node->rgba,
+                        node->desc.crop_w, node->desc.crop_h, node->results);
+    }
+    node->run_ms = pmeter_get_time_ms () - ttime0;
+}
+
+int
+graph_run (graph_t *g, texture_2d_t *srctex, int win_w, int win_h)
+{
+    for (int depth = 0; depth <= g->max_depth; depth ++)
+    {
+        g->num_level_nodes = 0;
+
+        for (int i = 0; i < g->num_nodes; i ++)
+        {
+            graph_node_t *node = &g->nodes[i];
+            if (node->depth != depth)
+                continue;
+
+            double ttime0 = pmeter_get_time_ms ();
+            gen_node_rois (g, node);
+            if (crop_node_rois (node, srctex, win_w, win_h) < 0)
+                return -1;
+            node->crop_ms = pmeter_get_time_ms () - ttime0;
+
+            g->level_nodes[g->num_level_nodes ++] = i;
+
+            /* the root crop is the whole frame: skip everything when it did not change */
+            if (depth == 0 && g->num_level_nodes == 1 && g->skip_unchanged &&
+                frame_diff_update (&g->frame_diff, node->rgba[0], node->desc.crop_w, node->desc.crop_h) == 0)
+            {
+                for (int j = 0; j < g->num_nodes; j ++)
+                    g->nodes[j].run_ms = 0;
+                return 1;
+            }
+        }
+
+        if (g->gl_thread_only)
+        {
+            for (int i = 0; i < g->num_level_nodes; i ++)
+                run_node (g, i);
+        }
+        else
+        {
+            thread_pool_run (g->branch_pool, run_node, g, g->num_level_nodes);
+        }
+    }
+
+    return 0;
+}
+
+int
+graph_get_results (graph_t *g, int node_id, const graph_roi_t **rois, const void **results)
+{
+    graph_node_t *node = &g->nodes[node_id];
+
+    if (rois)
+        *rois = node->rois;
+    if (results)
+        *results = node->results;
+    return node->num_rois;
+}
+
+void
+graph_get_node_time (graph_t *g, int node_id, double *crop_ms, double *run_ms)
+{
+    graph_node_t *node = &g->nodes[node_id];
+
+    if (crop_ms)
+        *crop_ms = node->crop_ms;
+    if (run_ms)
+        *run_ms = node->run_ms;
+}
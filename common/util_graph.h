@@ -0,0 +1,113 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_GRAPH_H_
+#define _UTIL_GRAPH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "util_texture.h"
+
+#define GRAPH_MAX_NODES     8
+
+/*
+ *  Pipeline graph for detector -> crop -> landmark chains.
+ *
+ *  The app declares its stages as a table of nodes. Every node names its
+ *  parent, and the root node (parent NULL) sees the whole frame:
+ *
+ *      face_detect  (root)
+ *        +-- age_gender        one ROI per detected face
+ *        +-- face_mesh         siblings run in parallel
+ *              +-- iris        two ROIs (eyes) per face mesh
+ *
+ *  graph_run() walks the tree level by level:
+ *    1. ROIs:  gen_rois() turns every parent result into ROIs (quads).
+ *    2. crop:  every ROI is cropped and read back on the GL thread, into
+ *              buffers which are reused from frame to frame.
+ *    3. run:   run() gets all the ROIs of the node at once, so it can batch
+ *              them (see tflite_pool_run()). The nodes of the same level
+ *              run in parallel with each other.
+ *  Crop and run time of every node are measured.
+ *
+ *  With graph_set_skip_threshold(), the crop of the root node goes through a
+ *  content change detector (util_frame_diff) first, and an unchanged frame
+ *  skips every node and keeps the results of the last run.
+ */
+
+/* quad in normalized frame coordinates.  0--------1
+ *                                         |        |
+ *                                         3--------2  */
+typedef struct _graph_roi_t
+{
+    float   pos[4][2];
+    int     parent_roi;     /* ROI of the parent node which produced this one */
+} graph_roi_t;
+
+/*
+ *  ROIs of this node from one result of the parent. parent_roi is the region
+ *  the parent ran on, to map crop-relative results (e.g. landmarks) back to
+ *  the frame. returns the number of ROIs.
+ */
+typedef int  (*graph_roi_func_t) (void *ctx, const graph_roi_t *parent_roi, const void *parent_result,
+                                  graph_roi_t *rois, int max_rois);
+
+/* results[i] (result_size bytes each) from the cropped RGBA images rgba[i] (w x h) */
+typedef void (*graph_run_func_t) (void *ctx, int num_rois, uint8_t * const *rgba, int w, int h, void *results);
+
+typedef struct _graph_node_desc_t
+{
+    const char          *name;
+    const char          *parent;        /* NULL: root node */
+    int                 crop_w, crop_h; /* size of the cropped images */
+    int                 max_rois;
+    size_t              result_size;    /* bytes of the result of one ROI */
+    graph_roi_func_t    gen_rois;       /* unused for the root node */
+    graph_run_func_t    run;
+    void                *ctx;
+} graph_node_desc_t;
+
+typedef struct _graph_t graph_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* nodes must come after their parent. */
+graph_t *graph_create (const graph_node_desc_t *nodes, int num_nodes);
+void graph_destroy (graph_t *g);
+
+int  graph_find_node (graph_t *g, const char *name);
+
+/*
+ *  skip the frames whose grid cells all differ from the last processed frame
+ *  by less than threshold [0, 255] luma levels. 0: skip identical frames only, <0: never skip (default).
+ */
+void graph_set_skip_threshold (graph_t *g, float threshold);
+
+/*
+ *  run the nodes of a level one after another on the calling thread, e.g.
+ *  when they invoke a GPU delegate, which has to run on the GL thread.
+ */
+void graph_set_gl_thread_only (graph_t *g, int enable);
+
+/*
+ *  run every node on the frame (GL thread). the crops are drawn into the
+ *  current framebuffer (win_w x win_h) and must fit in it.
+ *  returns 1 when the frame was skipped, -1 on error.
+ */
+int  graph_run (graph_t *g, texture_2d_t *srctex, int win_w, int win_h);
+
+/* ROIs and results of the last run. returns the number of ROIs. */
+int  graph_get_results (graph_t *g, int node_id, const graph_roi_t **rois, const void **results);
+
+/* time spent by the node in the last run [ms] */
+void graph_get_node_time (graph_t *g, int node_id, double *crop_ms, double *run_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_GRAPH_H_ */
@@ -0,0 +1,376 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <mutex>
+#include <atomic>
+#include <cstring>
+#include <cinttypes>
+#include "util_metrics.h"
+#include "util_debug.h"
+
+/*
+ *  log-linear buckets of microseconds:
+ *    [0, 64)      : one bucket per 1 [us]
+ *    [2^n, 2^n+1) : 32 buckets (n >= 6)
+ */
+#define SUB_BITS        5
+#define SUB_COUNT       (1 << SUB_BITS)
+#define LINEAR_COUNT    (SUB_COUNT * 2)
+#define MAX_SHIFT       31
+#define NUM_BINS        (LINEAR_COUNT + MAX_SHIFT * SUB_COUNT)
+
+#define TYPE_TIMER      0
+#define TYPE_COUNTER    1
+
+typedef struct _metrics_hist_t
+{
+    std::atomic<uint32_t>   bins[NUM_BINS];
+    std::atomic<uint64_t>   count;
+    std::atomic<uint64_t>   sum_us;
+    std::atomic<uint64_t>   max_us;
+} metrics_hist_t;
+
+typedef struct _metrics_slot_t
+{
+    std::atomic<metrics_hist_t *>   hist[METRICS_MAX_ENTRIES];   /* allocated on first record */
+    std::atomic<int64_t>            counter[METRICS_MAX_ENTRIES];
+} metrics_slot_t;
+
+typedef struct _metrics_entry_t
+{
+    char    name[METRICS_NAME_LEN];
+    int     type;
+} metrics_entry_t;
+
+static metrics_entry_t  s_entries[METRICS_MAX_ENTRIES];
+static std::atomic<int> s_num_entries;
+static std::mutex       s_entry_mtx;        /* registration only */
+
+static std::atomic<uint64_t> s_last_us[METRICS_MAX_ENTRIES];
+
+static metrics_slot_t   s_slots[METRICS_MAX_THREADS];
+static std::atomic<int> s_num_slots;
+static thread_local int t_slot = -1;
+
+
+static int
+bin_index (uint64_t us)
+{
+    if (us < LINEAR_COUNT)
+        return (int)us;
+
+    int msb   = 63 - __builtin_clzll (us);
+    int shift = msb - SUB_BITS;
+    if (shift > MAX_SHIFT)
+        return NUM_BINS - 1;
+
+    int sub = (int)(us >> shift) - SUB_COUNT;
+    return LINEAR_COUNT + (shift - 1) * SUB_COUNT + sub;
+}
+
+/* middle of the bucket [us] */
+static double
+bin_value (int idx)
+{
+    if (idx < LINEAR_COUNT)
+        return idx + 0.5;
+
+    int shift = (idx - LINEAR_COUNT) / SUB_COUNT + 1;
+    int sub   = (idx - LINEAR_COUNT) % SUB_COUNT + SUB_COUNT;
+    double lo    = (double)((uint64_t)sub << shift);
+    double width = (double)((uint64_t)1 << shift);
+    return lo + width * 0.5;
+}
+
+
+static metrics_slot_t *
+get_slot (void)
+{
+    if (t_slot < 0)
+    {
+        int slot = s_num_slots.fetch_add (1);
+        if (slot >= METRICS_MAX_THREADS)
+            slot = METRICS_MAX_THREADS - 1;     /* shared overflow slot (atomics keep it safe) */
+        t_slot = slot;
+    }
+    return &s_slots[t_slot];
+}
+
+static int
+register_entry (const char *name, int type)
+{
+    std::lock_guard<std::mutex> lock (s_entry_mtx);
+
+    int num = s_num_entries.load (std::memory_order_relaxed);
+    for (int i = 0; i < num; i ++)
+    {
+        if (s_entries[i].type == type && strcmp (s_entries[i].name, name) == 0)
+            return i;
+    }
+
+    if (num >= METRICS_MAX_ENTRIES)
+    {
+        DBG_LOGE ("ERR: %s(%d): too many metrics (%s)\n", __FILE__, __LINE__, name);
+        return -1;
+    }
+
+    strncpy (s_entries[num].name, name, METRICS_NAME_LEN - 1);
+    s_entries[num].name[METRICS_NAME_LEN - 1] = '\0';
+    s_entries[num].type = type;
+    s_num_entries.store (num + 1, std::memory_order_release);
+    return num;
+}
+
+int
+metrics_timer_id (const char *name)
+{
+    return register_entry (name, TYPE_TIMER);
+}
+
+int
+metrics_counter_id (const char *name)
+{
+    return register_entry (name, TYPE_COUNTER);
+}
+
+
+void
+metrics_record_ms (int id, double ms)
+{
+    if (id < 0 || id >= METRICS_MAX_ENTRIES)
+        return;
+
+    metrics_slot_t *slot = get_slot ();
+    metrics_hist_t *hist = slot->hist[id].load (std::memory_order_acquire);
+    if (hist == NULL)
+    {
+        metrics_hist_t *new_hist = new metrics_hist_t ();
+        if (slot->hist[id].compare_exchange_strong (hist, new_hist, std::memory_order_acq_rel))
+            hist = new_hist;
+        else
+            delete new_hist;                    /* another thread of the overflow slot won */
+    }
+
+    uint64_t us = (ms > 0) ? (uint64_t)(ms * 1000.0) : 0;
+    s_last_us[id].store (us, std::memory_order_relaxed);
+    hist->bins[bin_index (us)].fetch_add (1, std::memory_order_relaxed);
+    hist->count.fetch_add (1, std::memory_order_relaxed);
+    hist->sum_us.fetch_add (us, std::memory_order_relaxed);
+
+    uint64_t cur_max = hist->max_us.load (std::memory_order_relaxed);
+    while (us > cur_max &&
+           !hist->max_us.compare_exchange_weak (cur_max, us, std::memory_order_relaxed))
+        ;
+}
+
+void
+metrics_count (int id, int64_t delta)
+{
+    if (id < 0 || id >= METRICS_MAX_ENTRIES)
+        return;
+
+    get_slot ()->counter[id].fetch_add (delta, std::memory_order_relaxed);
+}
+
+
+int
+metrics_get_num_entries (void)
+{
+    return s_num_entries.load (std::memory_order_acquire);
+}
+
+const char *
+metrics_get_name (int id)
+{
+    if (id < 0 || id >= metrics_get_num_entries ())
+        return NULL;
+    return s_entries[id].name;
+}
+
+int
+metrics_is_timer (int id)
+{
+    if (id < 0 || id >= metrics_get_num_entries ())
+        return 0;
+    return s_entries[id].type == TYPE_TIMER;
+}
+
+
+static int
+num_used_slots (void)
+{
+    int num = s_num_slots.load (std::memory_order_acquire);
+    return (num < METRICS_MAX_THREADS) ? num : METRICS_MAX_THREADS;
+}
+
+static double
+percentile_ms (const uint32_t *bins, uint64_t count, double ratio, double max_ms)
+{
+    uint64_t target = (uint64_t)(count * ratio);
+    uint64_t acc = 0;
+
+    for (int i = 0; i < NUM_BINS; i ++)
+    {
+        acc += bins[i];
+        if (acc > target)
+        {
+            double ms = bin_value (i) / 1000.0;
+            return (ms < max_ms) ? ms : max_ms;
+        }
+    }
+    return max_ms;
+}
+
+int
+metrics_get_timer (int id, metrics_timer_stats_t *stats)
+{
+    static uint32_t s_bins[NUM_BINS];       /* readers are serialized by s_entry_mtx */
+    uint64_t count = 0, sum_us = 0, max_us = 0;
+
+    memset (stats, 0, sizeof (*stats));
+    if (!metrics_is_timer (id))
+        return -1;
+
+    std::lock_guard<std::mutex> lock (s_entry_mtx);
+    memset (s_bins, 0, sizeof (s_bins));
+
+    for (int i = 0; i < num_used_slots (); i ++)
+    {
+        metrics_hist_t *hist = s_slots[i].hist[id].load (std::memory_order_acquire);
+        if (hist == NULL)
+            continue;
+
+        for (int j = 0; j < NUM_BINS; j ++)
+            s_bins[j] += hist->bins[j].load (std::memory_order_relaxed);
+
+        count  += hist->count.load (std::memory_order_relaxed);
+        sum_us += hist->sum_us.load (std::memory_order_relaxed);
+        uint64_t m = hist->max_us.load (std::memory_order_relaxed);
+        if (m > max_us)
+            max_us = m;
+    }
+
+    if (count == 0)
+        return 0;
+
+    double max_ms = max_us / 1000.0;
+    stats->count   = count;
+    stats->mean_ms = sum_us / 1000.0 / count;
+    stats->p50_ms  = percentile_ms (s_bins, count, 0.50, max_ms);
+    stats->p95_ms  = percentile_ms (s_bins, count, 0.95, max_ms);
+    stats->p99_ms  = percentile_ms (s_bins, count, 0.99, max_ms);
+    stats->max_ms  = max_ms;
+    stats->last_ms = metrics_get_last_ms (id);
+    return 0;
+}
+
+double
+metrics_get_last_ms (int id)
+{
+    if (id < 0 || id >= METRICS_MAX_ENTRIES)
+        return 0.0;
+
+    return s_last_us[id].load (std::memory_order_relaxed) / 1000.0;
+}
+
+int64_t
+metrics_get_counter (int id)
+{
+    int64_t val = 0;
+
+    if (id < 0 || id >= metrics_get_num_entries ())
+        return 0;
+
+    for (int i = 0; i < num_used_slots (); i ++)
+        val += s_slots[i].counter[id].load (std::memory_order_relaxed);
+    return val;
+}
+
+void
+metrics_reset (void)
+{
+    int num_entries = metrics_get_num_entries ();
+
+    for (int id = 0; id < num_entries; id ++)
+        s_last_us[id].store (0, std::memory_order_relaxed);
+
+    for (int i = 0; i < num_used_slots (); i ++)
+    {
+        for (int id = 0; id < num_entries; id ++)
+        {
+            s_slots[i].counter[id].store (0, std::memory_order_relaxed);
+
+            metrics_hist_t *hist = s_slots[i].hist[id].load (std::memory_order_acquire);
+            if (hist == NULL)
+                continue;
+
+            for (int j = 0; j < NUM_BINS; j ++)
+                hist->bins[j].store (0, std::memory_order_relaxed);
+            hist->count.store  (0, std::memory_order_relaxed);
+            hist->sum_us.store (0, std::memory_order_relaxed);
+            hist->max_us.store (0, std::memory_order_relaxed);
+        }
+    }
+}
+
+
+/* -------------------------------------------------- *
+ *  export
+ * -------------------------------------------------- */
+int
+metrics_export_json (FILE *fp)
+{
+    int num_entries = metrics_get_num_entries ();
+
+    fprintf (fp, "{\n  \"timers\": {");
+    for (int id = 0, n = 0; id < num_entries; id ++)
+    {
+        metrics_timer_stats_t st;
+        if (!metrics_is_timer (id))
+            continue;
+
+        metrics_get_timer (id, &st);
+        fprintf (fp, "%s\n    \"%s\": {\"count\": %" PRIu64 ", \"mean_ms\": %.3f, "
+                 "\"p50_ms\": %.3f, \"p95_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f}",
+                 n ++ ? "," : "", s_entries[id].name, st.count, st.mean_ms,
+                 st.p50_ms, st.p95_ms, st.p99_ms, st.max_ms);
+    }
+    fprintf (fp, "\n  },\n  \"counters\": {");
+    for (int id = 0, n = 0; id < num_entries; id ++)
+    {
+        if (metrics_is_timer (id))
+            continue;
+
+        fprintf (fp, "%s\n    \"%s\": %" PRId64, n ++ ? "," : "",
+                 s_entries[id].name, metrics_get_counter (id));
+    }
+    fprintf (fp, "\n  }\n}\n");
+
+    return ferror (fp) ? -1 : 0;
+}
+
+int
+metrics_export_csv (FILE *fp)
+{
+    int num_entries = metrics_get_num_entries ();
+
+    fprintf (fp, "name,type,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n");
+    for (int id = 0; id < num_entries; id ++)
+    {
+        if (metrics_is_timer (id))
+        {
+            metrics_timer_stats_t st;
+            metrics_get_timer (id, &st);
+            fprintf (fp, "%s,timer,%" PRIu64 ",%.3f,%.3f,%.3f,%.3f,%.3f\n", s_entries[id].name,
+                     st.count, st.mean_ms, st.p50_ms, st.p95_ms, st.p99_ms, st.max_ms);
+        }
+        else
+        {
+            fprintf (fp, "%s,counter,%" PRId64 ",,,,,\n", s_entries[id].name,
+                     metrics_get_counter (id));
+        }
+    }
+
+    return ferror (fp) ? -1 : 0;
+}
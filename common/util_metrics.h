@@ -0,0 +1,70 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_METRICS_H_
+#define _UTIL_METRICS_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define METRICS_MAX_ENTRIES     64
+#define METRICS_MAX_THREADS     32      /* later threads share the last slot */
+#define METRICS_NAME_LEN        48
+
+/*
+ *  Named counters and timers (the core of util_pmeter, without GL).
+ *
+ *  Register a name once (e.g. at init) and keep the id; recording is then
+ *  lock-free from any thread: every thread owns a slot of histograms and
+ *  counters, which are merged only when read.
+ *
+ *  Timers go into HDR-style log-linear histograms of microseconds (32 sub
+ *  buckets per power of two, i.e. about 3% resolution up to 2^37 us, ~38
+ *  hours; longer ones land in the last bucket), so the tail latency
+ *  (p95/p99/max) is kept, not just the mean.
+ */
+typedef struct _metrics_timer_stats_t
+{
+    uint64_t    count;
+    double      mean_ms;
+    double      p50_ms;
+    double      p95_ms;
+    double      p99_ms;
+    double      max_ms;
+    double      last_ms;
+} metrics_timer_stats_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* returns the id of the name (registered on the first call), or -1 when the table is full. */
+int  metrics_timer_id   (const char *name);
+int  metrics_counter_id (const char *name);
+
+/* lock-free. a negative id is ignored. */
+void metrics_record_ms  (int id, double ms);
+void metrics_count      (int id, int64_t delta);
+
+int  metrics_get_num_entries (void);
+const char *metrics_get_name (int id);
+int  metrics_is_timer (int id);
+
+int     metrics_get_timer   (int id, metrics_timer_stats_t *stats);
+double  metrics_get_last_ms (int id);   /* latest value recorded by any thread */
+int64_t metrics_get_counter (int id);
+
+/* clear the recorded values (the names stay registered). */
+void metrics_reset (void);
+
+/* every entry, as one JSON object / as CSV rows with a header. */
+int  metrics_export_json (FILE *fp);
+int  metrics_export_csv  (FILE *fp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_METRICS_H_ */
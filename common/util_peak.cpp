@@ -0,0 +1,223 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "util_peak.h"
+#include "util_debug.h"
+
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#define PEAK_USE_NEON
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#define PEAK_USE_SSE2
+#endif
+
+
+/* -------------------------------------------------- *
+ *  SIMD primitives
+ * -------------------------------------------------- */
+
+/* dst[i] = max (a[i], b[i]). dst may alias a. */
+static void
+vec_max (float *dst, const float *a, const float *b, int n)
+{
+    int i = 0;
+#if defined (PEAK_USE_NEON)
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32 (&dst[i], vmaxq_f32 (vld1q_f32 (&a[i]), vld1q_f32 (&b[i])));
+#elif defined (PEAK_USE_SSE2)
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps (&dst[i], _mm_max_ps (_mm_loadu_ps (&a[i]), _mm_loadu_ps (&b[i])));
+#endif
+    for (; i < n; i ++)
+        dst[i] = std::max (a[i], b[i]);
+}
+
+/* returns non-zero if any of the 4 lanes satisfies (s >= thresh && s >= m) */
+static inline int
+any_peak4 (const float *s, const float *m, float thresh)
+{
+#if defined (PEAK_USE_NEON)
+    float32x4_t vs = vld1q_f32 (s);
+    uint32x4_t  c  = vandq_u32 (vcgeq_f32 (vs, vdupq_n_f32 (thresh)),
+                                vcgeq_f32 (vs, vld1q_f32 (m)));
+    uint32x2_t  c2 = vorr_u32 (vget_low_u32 (c), vget_high_u32 (c));
+    return (vget_lane_u32 (c2, 0) | vget_lane_u32 (c2, 1)) != 0;
+#elif defined (PEAK_USE_SSE2)
+    __m128 vs = _mm_loadu_ps (s);
+    __m128 c  = _mm_and_ps (_mm_cmpge_ps (vs, _mm_set1_ps (thresh)),
+                            _mm_cmpge_ps (vs, _mm_loadu_ps (m)));
+    return _mm_movemask_ps (c);
+#else
+    for (int i = 0; i < 4; i ++)
+    {
+        if (s[i] >= thresh && s[i] >= m[i])
+            return 1;
+    }
+    return 0;
+#endif
+}
+
+
+/* -------------------------------------------------- *
+ *  separable max filter
+ *
+ *  In HWC layout the neighbour at (x +/- d) is exactly (d * ch) floats
+ *  away, so each pass is a max of two contiguous shifted arrays and is
+ *  vectorized over all channels at once.
+ * -------------------------------------------------- */
+static void
+max_filter_h (const float *src, float *tmp, int w, int h, int ch, int rad)
+{
+    int stride = w * ch;
+
+    for (int y = 0; y < h; y ++)
+    {
+        const float *s = &src[y * stride];
+        float       *t = &tmp[y * stride];
+
+        memcpy (t, s, stride * sizeof (float));
+        for (int d = 1; d <= rad && d < w; d ++)
+        {
+            int len = (w - d) * ch;
+            vec_max (&t[d * ch], &t[d * ch], s, len);   /* left  neighbour */
+            vec_max (t, t, &s[d * ch], len);            /* right neighbour */
+        }
+    }
+}
+
+static void
+max_filter_v_row (const float *tmp, float *dst, int y, int w, int h, int ch, int rad)
+{
+    int stride = w * ch;
+
+    memcpy (dst, &tmp[y * stride], stride * sizeof (float));
+    for (int d = 1; d <= rad; d ++)
+    {
+        if (y - d >= 0)
+            vec_max (dst, dst, &tmp[(y - d) * stride], stride);
+        if (y + d < h)
+            vec_max (dst, dst, &tmp[(y + d) * stride], stride);
+    }
+}
+
+void
+peak_max_filter (const float *src, float *dst, float *tmp, int w, int h, int ch, int rad)
+{
+    max_filter_h (src, tmp, w, h, ch, rad);
+
+    for (int y = 0; y < h; y ++)
+        max_filter_v_row (tmp, &dst[y * w * ch], y, w, h, ch, rad);
+}
+
+
+/* -------------------------------------------------- *
+ *  peak extraction
+ * -------------------------------------------------- */
+static float *
+get_work_buf (int size)
+{
+    static float *s_buf = NULL;
+    static int    s_size = 0;
+
+    if (size > s_size)
+    {
+        free (s_buf);
+        s_buf = (float *)malloc (size * sizeof (float));
+        if (s_buf == NULL)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            s_size = 0;
+            return NULL;
+        }
+        s_size = size;
+    }
+    return s_buf;
+}
+
+int
+peak_extract (const float *src, int w, int h, int ch, int rad, float thresh,
+              heatmap_peak_t *peaks, int max_peaks)
+{
+    int stride = w * ch;
+    float *tmp = get_work_buf (stride * (h + 1));
+    if (tmp == NULL)
+        return 0;
+
+    float *rowmax = &tmp[stride * h];
+    int num_peaks = 0;
+
+    max_filter_h (src, tmp, w, h, ch, rad);
+
+    for (int y = 0; y < h; y ++)
+    {
+        const float *s = &src[y * stride];
+        max_filter_v_row (tmp, rowmax, y, w, h, ch, rad);
+
+        for (int i = 0; i < stride; i += 4)
+        {
+            int e = std::min (i + 4, stride);
+
+            if (e - i == 4 && !any_peak4 (&s[i], &rowmax[i], thresh))
+                continue;
+
+            for (int j = i; j < e; j ++)
+            {
+                if (s[j] < thresh || s[j] < rowmax[j])
+                    continue;
+
+                if (num_peaks >= max_peaks)
+                    return num_peaks;
+
+                heatmap_peak_t *peak = &peaks[num_peaks ++];
+                peak->score = s[j];
+                peak->x     = j / ch;
+                peak->y     = y;
+                peak->ch    = j % ch;
+            }
+        }
+    }
+
+    return num_peaks;
+}
+
+
+/* -------------------------------------------------- *
+ *  root queue (binary max-heap)
+ * -------------------------------------------------- */
+static bool
+peak_is_lower (const heatmap_peak_t &a, const heatmap_peak_t &b)
+{
+    if (a.score != b.score)
+        return a.score < b.score;
+
+    /* same score: the later one in scan order comes out later. */
+    if (a.y != b.y)
+        return a.y > b.y;
+    if (a.x != b.x)
+        return a.x > b.x;
+    return a.ch > b.ch;
+}
+
+void
+peak_queue_init (heatmap_peak_t *peaks, int num)
+{
+    std::make_heap (peaks, peaks + num, peak_is_lower);
+}
+
+int
+peak_queue_pop (heatmap_peak_t *peaks, int *num, heatmap_peak_t *top)
+{
+    if (*num <= 0)
+        return -1;
+
+    std::pop_heap (peaks, peaks + *num, peak_is_lower);
+    *num -= 1;
+    *top = peaks[*num];
+
+    return 0;
+}
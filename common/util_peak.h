@@ -0,0 +1,48 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_PEAK_H_
+#define _UTIL_PEAK_H_
+
+typedef struct _heatmap_peak_t
+{
+    float   score;
+    int     x;
+    int     y;
+    int     ch;         /* channel (keypoint) index */
+} heatmap_peak_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  Separable max filter over an HWC heatmap. Every channel is filtered with
+ *  a (2*rad+1)x(2*rad+1) window clipped at the borders.
+ *  "dst" and "tmp" must hold (w * h * ch) floats.
+ */
+void peak_max_filter (const float *src, float *dst, float *tmp, int w, int h, int ch, int rad);
+
+/*
+ *  Collect every cell whose score is >= thresh and is the maximum of its
+ *  local window, in (y, x, ch) scan order. Returns the number of peaks
+ *  written (at most max_peaks). Work buffers are kept internally, so this
+ *  is not reentrant.
+ */
+int  peak_extract (const float *src, int w, int h, int ch, int rad, float thresh,
+                   heatmap_peak_t *peaks, int max_peaks);
+
+/*
+ *  Binary max-heap over a flat peak array. Ties are popped in scan order,
+ *  which matches a stable descending sort.
+ */
+void peak_queue_init (heatmap_peak_t *peaks, int num);
+int  peak_queue_pop  (heatmap_peak_t *peaks, int *num, heatmap_peak_t *top);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_PEAK_H_ */
@@ -0,0 +1,418 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include "util_pipeline.h"
+#include "util_pmeter.h"
+#include "util_trace.h"
+#include "util_debug.h"
+
+#define QUEUE_SIZE  (PIPELINE_MAX_SLOTS + 1)
+
+
+/* -------------------------------------------------- *
+ *  bounded SPSC lock-free queue (+ doorbell to sleep on)
+ * -------------------------------------------------- */
+typedef struct _frame_queue_t
+{
+    pipeline_frame_t        *buf[QUEUE_SIZE];
+    std::atomic<int>        head;       /* written by the consumer */
+    std::atomic<int>        tail;       /* written by the producer */
+
+    std::atomic<int>        waiting;
+    std::mutex              mtx;
+    std::condition_variable cv;
+} frame_queue_t;
+
+static void
+queue_init (frame_queue_t *q)
+{
+    q->head    = 0;
+    q->tail    = 0;
+    q->waiting = 0;
+}
+
+static void
+queue_push (frame_queue_t *q, pipeline_frame_t *frame)
+{
+    /* never full: the queue is larger than the number of slots */
+    int tail = q->tail.load (std::memory_order_relaxed);
+    q->buf[tail] = frame;
+    q->tail.store ((tail + 1) % QUEUE_SIZE, std::memory_order_seq_cst);
+
+    if (q->waiting.load (std::memory_order_seq_cst))
+    {
+        std::lock_guard<std::mutex> lock (q->mtx);
+        q->cv.notify_one ();
+    }
+}
+
+static pipeline_frame_t *
+queue_pop (frame_queue_t *q)
+{
+    int head = q->head.load (std::memory_order_relaxed);
+    if (head == q->tail.load (std::memory_order_acquire))
+        return NULL;
+
+    pipeline_frame_t *frame = q->buf[head];
+    q->head.store ((head + 1) % QUEUE_SIZE, std::memory_order_release);
+    return frame;
+}
+
+static bool
+queue_empty (frame_queue_t *q)
+{
+    return q->head.load (std::memory_order_relaxed) == q->tail.load (std::memory_order_acquire);
+}
+
+static pipeline_frame_t *
+queue_pop_wait (frame_queue_t *q, std::atomic<bool> &quit)
+{
+    for (;;)
+    {
+        pipeline_frame_t *frame = queue_pop (q);
+        if (frame || quit)
+            return frame;
+
+        std::unique_lock<std::mutex> lock (q->mtx);
+        q->waiting.store (1, std::memory_order_seq_cst);
+        q->cv.wait_for (lock, std::chrono::milliseconds (10), [&] {
+            return quit || q->head.load () != q->tail.load ();
+        });
+        q->waiting.store (0, std::memory_order_relaxed);
+    }
+}
+
+
+/* -------------------------------------------------- *
+ *  pipeline
+ * -------------------------------------------------- */
+typedef struct _pipeline_stage_t
+{
+    const char              *name;
+    pipeline_stage_func_t   func;
+    void                    *ctx;
+    std::thread             thread;
+} pipeline_stage_t;
+
+struct _pipeline_t
+{
+    pipeline_frame_t    slots[PIPELINE_MAX_SLOTS];
+    int                 num_slots;
+
+    pipeline_stage_t    stages[PIPELINE_MAX_STAGES];
+    int                 num_stages;
+
+    /*
+     *  queue[0]             : submitted frames  --> stage[0]
+     *  queue[i]             : stage[i-1]        --> stage[i]
+     *  queue[num_stages]    : finished frames   --> render
+     */
+    frame_queue_t       queues[PIPELINE_MAX_STAGES + 1];
+    frame_queue_t       free_queue;
+
+    uint64_t            next_seq;
+    std::atomic<bool>   quit;
+    bool                started;
+
+    /* latency budget and statistics */
+    std::atomic<double>     budget_ms;
+    std::atomic<uint64_t>   num_dropped[PIPELINE_MAX_STAGES + 1];
+    uint64_t            num_submitted;  /* capture side only */
+    uint64_t            num_completed;  /* render side only  */
+    bool                fetched[PIPELINE_MAX_SLOTS];    /* render side only: handed out by fetch_latest */
+    double              latency_sum;
+    double              latency_max;
+    uint32_t            latency_hist[PIPELINE_LATENCY_BINS];
+};
+
+
+/*
+ *  latest-frame policy: a frame over the latency budget is dropped when a
+ *  newer one is already waiting, so a slow stage catches up instead of
+ *  backing up. the newest frame is always processed. dropped frames still
+ *  flow down to render (which releases them), so every queue keeps a single
+ *  producer.
+ */
+static bool
+is_stale_frame (pipeline_t *pl, frame_queue_t *qin, pipeline_frame_t *frame)
+{
+    double budget_ms = pl->budget_ms.load (std::memory_order_relaxed);
+    if (budget_ms <= 0)
+        return false;
+
+    if (pmeter_get_time_ms () - frame->capture_ms <= budget_ms)
+        return false;
+
+    return !queue_empty (qin);
+}
+
+
+static void
+stage_main (pipeline_t *pl, int stage_id)
+{
+    pipeline_stage_t *stage = &pl->stages[stage_id];
+    frame_queue_t *qin  = &pl->queues[stage_id];
+    frame_queue_t *qout = &pl->queues[stage_id + 1];
+
+    trace_set_thread_name (stage->name);
+
+    for (;;)
+    {
+        pipeline_frame_t *frame = queue_pop_wait (qin, pl->quit);
+        if (frame == NULL)
+            return;
+
+        if (!frame->dropped && is_stale_frame (pl, qin, frame))
+        {
+            frame->dropped = 1;
+            pl->num_dropped[stage_id].fetch_add (1, std::memory_order_relaxed);
+        }
+
+        if (!frame->dropped)
+        {
+            TRACE_SCOPE (stage->name);
+            stage->func (stage->ctx, frame);
+        }
+        queue_push (qout, frame);
+    }
+}
+
+
+pipeline_t *
+pipeline_create (void **slot_data, int num_slots)
+{
+    if (num_slots <= 0 || num_slots > PIPELINE_MAX_SLOTS)
+    {
+        DBG_LOGE ("ERR: %s(%d): num_slots=%d\n", __FILE__, __LINE__, num_slots);
+        return NULL;
+    }
+
+    pipeline_t *pl = new pipeline_t;
+    pl->num_slots  = num_slots;
+    pl->num_stages = 0;
+    pl->next_seq   = 0;
+    pl->quit       = false;
+    pl->started    = false;
+    pl->budget_ms  = 0;
+    pipeline_reset_stats (pl);
+
+    for (int i = 0; i < PIPELINE_MAX_STAGES + 1; i ++)
+        queue_init (&pl->queues[i]);
+    queue_init (&pl->free_queue);
+
+    for (int i = 0; i < num_slots; i ++)
+    {
+        pl->slots[i].seq        = 0;
+        pl->slots[i].capture_ms = 0;
+        pl->slots[i].dropped    = 0;
+        pl->slots[i].data       = slot_data[i];
+        pl->fetched[i]          = false;
+        queue_push (&pl->free_queue, &pl->slots[i]);
+    }
+
+    return pl;
+}
+
+void
+pipeline_destroy (pipeline_t *pl)
+{
+    if (pl == NULL)
+        return;
+
+    pl->quit = true;
+    for (int i = 0; i < pl->num_stages; i ++)
+    {
+        frame_queue_t *q = &pl->queues[i];
+        {
+            std::lock_guard<std::mutex> lock (q->mtx);
+            q->cv.notify_all ();
+        }
+    }
+
+    for (int i = 0; i < pl->num_stages; i ++)
+    {
+        if (pl->stages[i].thread.joinable())
+            pl->stages[i].thread.join ();
+    }
+
+    delete pl;
+}
+
+int
+pipeline_add_stage (pipeline_t *pl, const char *name, pipeline_stage_func_t func, void *ctx)
+{
+    if (pl->started || pl->num_stages >= PIPELINE_MAX_STAGES)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    pipeline_stage_t *stage = &pl->stages[pl->num_stages ++];
+    stage->name = name;
+    stage->func = func;
+    stage->ctx  = ctx;
+    return 0;
+}
+
+int
+pipeline_start (pipeline_t *pl)
+{
+    if (pl->started)
+        return 0;
+
+    for (int i = 0; i < pl->num_stages; i ++)
+        pl->stages[i].thread = std::thread (stage_main, pl, i);
+
+    pl->started = true;
+    DBG_LOG ("pipeline: %d stages, %d slots\n", pl->num_stages, pl->num_slots);
+    return 0;
+}
+
+void
+pipeline_set_latency_budget (pipeline_t *pl, double budget_ms)
+{
+    pl->budget_ms.store (budget_ms, std::memory_order_relaxed);
+}
+
+pipeline_frame_t *
+pipeline_acquire (pipeline_t *pl)
+{
+    return queue_pop (&pl->free_queue);
+}
+
+void
+pipeline_submit_at (pipeline_t *pl, pipeline_frame_t *frame, double capture_ms)
+{
+    frame->seq        = pl->next_seq ++;
+    frame->capture_ms = capture_ms;
+    frame->dropped    = 0;
+    pl->num_submitted ++;
+
+    queue_push (&pl->queues[0], frame);
+}
+
+void
+pipeline_submit (pipeline_t *pl, pipeline_frame_t *frame)
+{
+    pipeline_submit_at (pl, frame, pmeter_get_time_ms ());
+}
+
+pipeline_frame_t *
+pipeline_fetch_latest (pipeline_t *pl)
+{
+    frame_queue_t *q = &pl->queues[pl->num_stages];
+    pipeline_frame_t *latest = NULL;
+    pipeline_frame_t *frame;
+
+    /* frames finish in sequence order, so the last one is the newest */
+    while ((frame = queue_pop (q)) != NULL)
+    {
+        if (frame->dropped)
+        {
+            pipeline_release (pl, frame);
+            continue;
+        }
+
+        if (latest)
+        {
+            pl->num_dropped[pl->num_stages].fetch_add (1, std::memory_order_relaxed);
+            pipeline_release (pl, latest);
+        }
+        latest = frame;
+    }
+
+    if (latest)
+        pl->fetched[latest - pl->slots] = true;
+    return latest;
+}
+
+/* the result of a fetched frame is complete when render gives it back */
+static void
+record_latency (pipeline_t *pl, pipeline_frame_t *frame)
+{
+    double latency = pmeter_get_time_ms () - frame->capture_ms;
+    int bin = (int)latency;
+    if (bin < 0)                     bin = 0;
+    if (bin >= PIPELINE_LATENCY_BINS) bin = PIPELINE_LATENCY_BINS - 1;
+
+    pl->latency_hist[bin] ++;
+    pl->latency_sum += latency;
+    if (latency > pl->latency_max)
+        pl->latency_max = latency;
+    pl->num_completed ++;
+}
+
+void
+pipeline_release (pipeline_t *pl, pipeline_frame_t *frame)
+{
+    int slot = frame - pl->slots;
+    if (pl->fetched[slot])
+    {
+        record_latency (pl, frame);
+        pl->fetched[slot] = false;
+    }
+    queue_push (&pl->free_queue, frame);
+}
+
+
+/* -------------------------------------------------- *
+ *  statistics
+ * -------------------------------------------------- */
+static double
+latency_percentile (pipeline_t *pl, double ratio)
+{
+    uint64_t target = (uint64_t)(pl->num_completed * ratio);
+    uint64_t count  = 0;
+
+    for (int i = 0; i < PIPELINE_LATENCY_BINS; i ++)
+    {
+        count += pl->latency_hist[i];
+        if (count > target)
+            return std::min (i + 1.0, pl->latency_max);   /* upper edge of the bin */
+    }
+    return pl->latency_max;
+}
+
+void
+pipeline_get_stats (pipeline_t *pl, pipeline_stats_t *stats)
+{
+    memset (stats, 0, sizeof (*stats));
+
+    stats->num_submitted = pl->num_submitted;
+    stats->num_completed = pl->num_completed;
+    for (int i = 0; i <= pl->num_stages; i ++)
+    {
+        stats->num_dropped_stage[i] = pl->num_dropped[i].load (std::memory_order_relaxed);
+        stats->num_dropped += stats->num_dropped_stage[i];
+    }
+
+    if (pl->num_completed == 0)
+        return;
+
+    stats->latency_mean = pl->latency_sum / pl->num_completed;
+    stats->latency_p50  = latency_percentile (pl, 0.50);
+    stats->latency_p95  = latency_percentile (pl, 0.95);
+    stats->latency_p99  = latency_percentile (pl, 0.99);
+    stats->latency_max  = pl->latency_max;
+}
+
+void
+pipeline_reset_stats (pipeline_t *pl)
+{
+    for (int i = 0; i < PIPELINE_MAX_STAGES + 1; i ++)
+        pl->num_dropped[i] = 0;
+
+    pl->num_submitted = 0;
+    pl->num_completed = 0;
+    pl->latency_sum   = 0;
+    pl->latency_max   = 0;
+    memset (pl->latency_hist, 0, sizeof (pl->latency_hist));
+}
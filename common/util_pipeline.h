@@ -0,0 +1,105 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_PIPELINE_H_
+#define _UTIL_PIPELINE_H_
+
+#include <stdint.h>
+
+#define PIPELINE_MAX_STAGES     8
+#define PIPELINE_MAX_SLOTS      16
+#define PIPELINE_LATENCY_BINS   1000    /* 1 [ms] bins. the last one holds everything above */
+
+/*
+ *  Staged frame pipeline.
+ *
+ *    [capture] --> stage[0] --> stage[1] --> ... --> [render]
+ *
+ *  Capture and render run on the calling (GL) thread: the app acquires a free
+ *  slot, fills it (camera crop, readback) and submits it. Every stage added
+ *  with pipeline_add_stage() runs on its own thread (preprocess, inference,
+ *  postprocess ...), and the render side fetches the newest finished frame.
+ *  Stages are connected by bounded single-producer/single-consumer lock-free
+ *  queues, so throughput approaches the slowest stage rather than the sum.
+ *
+ *  The number of slots bounds the frames in flight. When all of them are busy
+ *  pipeline_acquire() returns NULL and the capture side should skip the frame.
+ */
+typedef struct _pipeline_frame_t
+{
+    uint64_t    seq;            /* sequence number, in capture order */
+    double      capture_ms;     /* pmeter_get_time_ms() at capture */
+    int         dropped;        /* set by the pipeline when a stage skipped this frame */
+    void        *data;          /* app owned slot data */
+} pipeline_frame_t;
+
+/*
+ *  capture-to-result statistics (since pipeline_start() or the last reset).
+ *  a frame is dropped when it waited longer than the latency budget and a
+ *  newer frame was queued behind it, or when a newer finished frame
+ *  superseded it before render fetched it.
+ */
+typedef struct _pipeline_stats_t
+{
+    uint64_t    num_submitted;
+    uint64_t    num_completed;                          /* fetched and released by render */
+    uint64_t    num_dropped;
+    uint64_t    num_dropped_stage[PIPELINE_MAX_STAGES + 1]; /* [num_stages]: superseded at render */
+
+    double      latency_mean;   /* [ms] of the completed frames */
+    double      latency_p50;
+    double      latency_p95;
+    double      latency_p99;
+    double      latency_max;
+} pipeline_stats_t;
+
+typedef struct _pipeline_t pipeline_t;
+
+typedef void (*pipeline_stage_func_t) (void *ctx, pipeline_frame_t *frame);
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* slot_data[i] becomes pipeline_frame_t::data of the i-th slot. */
+pipeline_t *pipeline_create (void **slot_data, int num_slots);
+void pipeline_destroy (pipeline_t *pl);
+
+/* stages run in the order they are added. call before pipeline_start(). */
+int  pipeline_add_stage (pipeline_t *pl, const char *name, pipeline_stage_func_t func, void *ctx);
+int  pipeline_start (pipeline_t *pl);
+
+/*
+ *  frames older than budget_ms (capture to stage start) are skipped in favor
+ *  of a newer queued frame. 0 disables dropping (default).
+ */
+void pipeline_set_latency_budget (pipeline_t *pl, double budget_ms);
+
+/* capture side */
+pipeline_frame_t *pipeline_acquire (pipeline_t *pl);
+void pipeline_submit (pipeline_t *pl, pipeline_frame_t *frame);
+
+/* capture_ms: when the frame was captured (camera timestamp) in pmeter_get_time_ms() time. */
+void pipeline_submit_at (pipeline_t *pl, pipeline_frame_t *frame, double capture_ms);
+
+/*
+ *  render side: returns the newest finished frame (older finished frames are
+ *  released), or NULL when nothing new has finished. The returned frame must
+ *  be given back with pipeline_release(); its latency runs until then, so
+ *  work render still does on it (e.g. a GPU delegate inference, which has to
+ *  run on the GL thread) is included.
+ */
+pipeline_frame_t *pipeline_fetch_latest (pipeline_t *pl);
+void pipeline_release (pipeline_t *pl, pipeline_frame_t *frame);
+
+/* call from the render side */
+void pipeline_get_stats (pipeline_t *pl, pipeline_stats_t *stats);
+void pipeline_reset_stats (pipeline_t *pl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_PIPELINE_H_ */
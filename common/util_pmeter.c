@@ -9,11 +9,20 @@
 #include <GLES2/gl2.h>
 #include "util_pmeter.h"
 #include "util_shader.h"
+#include "util_metrics.h"
+
+/*
+ *  the laps are recorded only into util_metrics (timers "lap<id>.<n>"), and
+ *  draw_pmeter_ex () reads them back from there. the lap counter of an id
+ *  belongs to the one thread that sets its laps.
+ */
+#define LAP_METRIC_NONE     0       /* not registered yet */
+#define LAP_METRIC_FAILED   (-1)    /* the metrics table was full: not retried */
 
 static int    s_laptime_idx[10] = {0};
-static int    s_laptime_num[10] = {0};
-static float  s_laptime_stack[10][PMETER_MAX_LAP_NUM];
 static double s_last_laptime[10] = {0};
+static int    s_lap_metric[10][PMETER_MAX_LAP_NUM];    /* metrics id + 1, or LAP_METRIC_xxx */
+static int    s_lap_num[10];                            /* laps registered so far */
 
 double
 pmeter_get_time_ms ()
@@ -27,7 +36,36 @@ void
 pmeter_reset_lap (int id)
 {
     s_laptime_idx[id] = 0;
-    s_laptime_num[id] = 0;
+}
+
+static void
+record_lap_metric (int id, int lap, double ms)
+{
+    if (s_lap_metric[id][lap] == LAP_METRIC_NONE)
+    {
+        char name[32];
+        int  metric_id;
+
+        sprintf (name, "lap%d.%d", id, lap);
+        metric_id = metrics_timer_id (name);
+        s_lap_metric[id][lap] = (metric_id < 0) ? LAP_METRIC_FAILED : metric_id + 1;
+
+        if (lap >= s_lap_num[id])
+            s_lap_num[id] = lap + 1;
+    }
+
+    if (s_lap_metric[id][lap] != LAP_METRIC_FAILED)
+        metrics_record_ms (s_lap_metric[id][lap] - 1, ms);
+}
+
+/* the latest value of the lap, or 0 when it is not recorded. */
+static float
+get_lap_ms (int id, int lap)
+{
+    if (lap >= s_lap_num[id] || s_lap_metric[id][lap] <= 0)
+        return 0.0f;
+
+    return (float)metrics_get_last_ms (s_lap_metric[id][lap] - 1);
 }
 
 void
@@ -37,22 +75,12 @@ pmeter_set_lap (int id)
         return;
 
     double laptime = pmeter_get_time_ms ();
-    s_laptime_stack[id][s_laptime_idx[id]] = laptime - s_last_laptime[id];
+    record_lap_metric (id, s_laptime_idx[id], laptime - s_last_laptime[id]);
     s_laptime_idx[id] ++;
-    s_laptime_num[id] ++;
 
     s_last_laptime[id] = laptime;
 }
 
-static void
-pmeter_get_laptime (int id, int *num, float **laptime)
-{
-    *num = s_laptime_num[id];
-    *laptime = s_laptime_stack[id];
-
-    s_laptime_num[id] = 0;
-}
-
 
 static char vs_pmeter[] = "                  \n\
 attribute vec4 a_Vertex;                     \n\
@@ -137,20 +165,23 @@ int draw_pmeter_ex (int dpy_id, int x, int y, float scale)
     int i, num_time;
     float vert1[] = { 0.0f, 0.0f, 0.0f, (float)PMETER_DATA_NUM };
     float vert2[] = { 0.0f, 0.0f, 100.0f, 0.0f  };
-    float *laptime,sumval;
-    static int   s_ncnt[PMETER_DPY_NUM] = {0};
-    static float s_lap[PMETER_DPY_NUM][10] = {{0}};
+    float laptime[3], sumval;
 
-    pmeter_get_laptime (dpy_id, &num_time, &laptime);
+    if ( dpy_id >= PMETER_DPY_NUM )
+        return -1;
 
+    /* the latest laps, as recorded into util_metrics */
+    num_time = s_lap_num[dpy_id];
     sumval = 0;
     for (i = 0; i < num_time; i ++)
     {
-        s_lap[dpy_id][i] += laptime[i];
-        sumval += laptime[i];
+        float lap = get_lap_ms (dpy_id, i);
+        if (i < 3)
+            laptime[i] = lap;
+        sumval += lap;
     }
-    s_lap[dpy_id][i] += sumval;
-    s_ncnt[dpy_id] ++;
+    for (; i < 3; i ++)
+        laptime[i] = 0.0f;
 
     if (laptime[0] > 100.0f) laptime[0] = 100.0f;
     if (laptime[1] > 100.0f) laptime[1] = 100.0f;
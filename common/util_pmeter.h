@@ -11,6 +11,13 @@ extern "C" {
 
 #define PMETER_MAX_LAP_NUM 128
 
+/*
+ *  Lap times of the render thread. The laps are recorded into util_metrics
+ *  (as "lap<id>.<n>"), which keeps their percentiles and exports them, and
+ *  draw_pmeter() draws the latest value of each from there. Use util_metrics
+ *  directly for the other threads.
+ */
+
 #if 1
 
 #define PMETER_RESET_LAP_EX(id) pmeter_reset_lap (id)
@@ -0,0 +1,207 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdlib.h>
+#include <string.h>
+#include <GLES2/gl2.h>
+#include "util_segment.h"
+#include "util_debug.h"
+
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#define SEGMENT_USE_NEON
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#define SEGMENT_USE_SSE2
+#endif
+
+
+/* -------------------------------------------------- *
+ *  channel maximum (SIMD) and argmax
+ * -------------------------------------------------- */
+static inline float
+channel_max_float (const float *p, int n)
+{
+    int c = 0;
+    float m = p[0];
+
+#if defined (SEGMENT_USE_NEON)
+    if (n >= 4)
+    {
+        float32x4_t vm = vld1q_f32 (p);
+        for (c = 4; c + 4 <= n; c += 4)
+            vm = vmaxq_f32 (vm, vld1q_f32 (&p[c]));
+        float32x2_t m2 = vpmax_f32 (vget_low_f32 (vm), vget_high_f32 (vm));
+        m2 = vpmax_f32 (m2, m2);
+        m  = vget_lane_f32 (m2, 0);
+    }
+#elif defined (SEGMENT_USE_SSE2)
+    if (n >= 4)
+    {
+        __m128 vm = _mm_loadu_ps (p);
+        for (c = 4; c + 4 <= n; c += 4)
+            vm = _mm_max_ps (vm, _mm_loadu_ps (&p[c]));
+        vm = _mm_max_ps (vm, _mm_shuffle_ps (vm, vm, _MM_SHUFFLE (1, 0, 3, 2)));
+        vm = _mm_max_ps (vm, _mm_shuffle_ps (vm, vm, _MM_SHUFFLE (2, 3, 0, 1)));
+        m  = _mm_cvtss_f32 (vm);
+    }
+#endif
+
+    for (; c < n; c ++)
+        m = (p[c] > m) ? p[c] : m;
+    return m;
+}
+
+static inline uint8_t
+channel_max_uint8 (const uint8_t *p, int n)
+{
+    int c = 0;
+    uint8_t m = p[0];
+
+#if defined (SEGMENT_USE_NEON)
+    if (n >= 16)
+    {
+        uint8x16_t vm = vld1q_u8 (p);
+        for (c = 16; c + 16 <= n; c += 16)
+            vm = vmaxq_u8 (vm, vld1q_u8 (&p[c]));
+        uint8x8_t m8 = vpmax_u8 (vget_low_u8 (vm), vget_high_u8 (vm));
+        m8 = vpmax_u8 (m8, m8);
+        m8 = vpmax_u8 (m8, m8);
+        m8 = vpmax_u8 (m8, m8);
+        m  = vget_lane_u8 (m8, 0);
+    }
+#elif defined (SEGMENT_USE_SSE2)
+    if (n >= 16)
+    {
+        __m128i vm = _mm_loadu_si128 ((const __m128i *)p);
+        for (c = 16; c + 16 <= n; c += 16)
+            vm = _mm_max_epu8 (vm, _mm_loadu_si128 ((const __m128i *)&p[c]));
+        vm = _mm_max_epu8 (vm, _mm_srli_si128 (vm, 8));
+        vm = _mm_max_epu8 (vm, _mm_srli_si128 (vm, 4));
+        vm = _mm_max_epu8 (vm, _mm_srli_si128 (vm, 2));
+        vm = _mm_max_epu8 (vm, _mm_srli_si128 (vm, 1));
+        m  = (uint8_t)_mm_cvtsi128_si32 (vm);
+    }
+#endif
+
+    for (; c < n; c ++)
+        m = (p[c] > m) ? p[c] : m;
+    return m;
+}
+
+/* the maximum is found with SIMD, then the first channel which holds it. */
+template <typename T>
+static inline uint8_t
+first_index_of (const T *p, int n, T val)
+{
+    int c = 0;
+    while (c < n - 1 && p[c] != val)
+        c ++;
+    return (uint8_t)c;
+}
+
+void
+segment_argmax_float (const float *logits, int num_pixels, int num_class, uint8_t *labels)
+{
+    if (num_class == 2)
+    {
+        for (int i = 0; i < num_pixels; i ++, logits += 2)
+            labels[i] = (logits[1] > logits[0]) ? 1 : 0;
+        return;
+    }
+
+    for (int i = 0; i < num_pixels; i ++, logits += num_class)
+    {
+        float m = channel_max_float (logits, num_class);
+        labels[i] = first_index_of (logits, num_class, m);
+    }
+}
+
+void
+segment_argmax_uint8 (const uint8_t *logits, int num_pixels, int num_class, uint8_t *labels)
+{
+    if (num_class == 2)
+    {
+        for (int i = 0; i < num_pixels; i ++, logits += 2)
+            labels[i] = (logits[1] > logits[0]) ? 1 : 0;
+        return;
+    }
+
+    for (int i = 0; i < num_pixels; i ++, logits += num_class)
+    {
+        uint8_t m = channel_max_uint8 (logits, num_class);
+        labels[i] = first_index_of (logits, num_class, m);
+    }
+}
+
+
+/* -------------------------------------------------- *
+ *  LUT colorization
+ * -------------------------------------------------- */
+int
+segment_postproc_init (segment_postproc_t *pp, int w, int h)
+{
+    memset (pp, 0, sizeof (*pp));
+
+    pp->rgba = (uint32_t *)malloc (w * h * sizeof (uint32_t));
+    if (pp->rgba == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    pp->width  = w;
+    pp->height = h;
+    return 0;
+}
+
+void
+segment_postproc_free (segment_postproc_t *pp)
+{
+    if (pp->tex.texid)
+    {
+        GLuint texid = pp->tex.texid;
+        glDeleteTextures (1, &texid);
+    }
+
+    free (pp->rgba);
+    memset (pp, 0, sizeof (*pp));
+}
+
+void
+segment_set_class_color (segment_postproc_t *pp, int class_id, float *col)
+{
+    if (class_id < 0 || class_id >= SEGMENT_MAX_CLASS)
+        return;
+
+    unsigned int r = ((int)(col[0] * 255)) & 0xff;
+    unsigned int g = ((int)(col[1] * 255)) & 0xff;
+    unsigned int b = ((int)(col[2] * 255)) & 0xff;
+    unsigned int a = ((int)(col[3] * 255)) & 0xff;
+    pp->lut[class_id] = (a << 24) | (b << 16) | (g << 8) | (r);
+}
+
+int
+segment_update_texture (segment_postproc_t *pp, const uint8_t *labels)
+{
+    int num_pixels = pp->width * pp->height;
+    uint32_t *dst = pp->rgba;
+
+    for (int i = 0; i < num_pixels; i ++)
+        dst[i] = pp->lut[labels[i]];
+
+    if (pp->tex.texid == 0)
+    {
+        create_2d_texture_ex (&pp->tex, pp->rgba, pp->width, pp->height,
+                              pixfmt_fourcc('R', 'G', 'B', 'A'));
+        return 0;
+    }
+
+    glBindTexture (GL_TEXTURE_2D, pp->tex.texid);
+    glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, pp->width, pp->height,
+                     GL_RGBA, GL_UNSIGNED_BYTE, pp->rgba);
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_SEGMENT_H_
+#define _UTIL_SEGMENT_H_
+
+#include <stdint.h>
+#include "util_texture.h"
+
+#define SEGMENT_MAX_CLASS   256
+
+typedef struct _segment_postproc_t
+{
+    int         width;
+    int         height;
+    uint32_t    *rgba;                      /* [height][width] colorized label map */
+    uint32_t    lut[SEGMENT_MAX_CLASS];     /* class id --> RGBA8888 */
+    texture_2d_t tex;                       /* persistent texture (created on first upload) */
+} segment_postproc_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  Per-pixel argmax over an HWC logit map. The first class wins on a tie.
+ *  Quantized logits are compared in their raw form (the mapping is monotonic).
+ */
+void segment_argmax_float (const float   *logits, int num_pixels, int num_class, uint8_t *labels);
+void segment_argmax_uint8 (const uint8_t *logits, int num_pixels, int num_class, uint8_t *labels);
+
+int  segment_postproc_init (segment_postproc_t *pp, int w, int h);
+void segment_postproc_free (segment_postproc_t *pp);
+
+/* col: RGBA [0.0, 1.0] */
+void segment_set_class_color (segment_postproc_t *pp, int class_id, float *col);
+
+/* colorize the label map via LUT and upload it into pp->tex (needs GL context) */
+int  segment_update_texture (segment_postproc_t *pp, const uint8_t *labels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_SEGMENT_H_ */
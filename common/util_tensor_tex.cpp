@@ -0,0 +1,377 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <GLES2/gl2.h>
+#include "util_tensor_tex.h"
+#include "util_debug.h"
+
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#define TENSOR_TEX_USE_NEON
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#define TENSOR_TEX_USE_SSE2
+#endif
+
+#define CHUNK_PIXELS    64
+
+
+/* -------------------------------------------------- *
+ *  float --> uint8 with saturation (SIMD)
+ * -------------------------------------------------- */
+static void
+saturate_to_u8 (const float *src, int num, float mul, float add, uint8_t *dst)
+{
+    int i = 0;
+
+#if defined (TENSOR_TEX_USE_NEON)
+    float32x4_t vadd = vdupq_n_f32 (add);
+    float32x4_t vmin = vdupq_n_f32 (0.0f);
+    float32x4_t vmax = vdupq_n_f32 (255.0f);
+    for (; i + 16 <= num; i += 16)
+    {
+        float32x4_t v0 = vmlaq_n_f32 (vadd, vld1q_f32 (&src[i +  0]), mul);
+        float32x4_t v1 = vmlaq_n_f32 (vadd, vld1q_f32 (&src[i +  4]), mul);
+        float32x4_t v2 = vmlaq_n_f32 (vadd, vld1q_f32 (&src[i +  8]), mul);
+        float32x4_t v3 = vmlaq_n_f32 (vadd, vld1q_f32 (&src[i + 12]), mul);
+        v0 = vminq_f32 (vmaxq_f32 (v0, vmin), vmax);
+        v1 = vminq_f32 (vmaxq_f32 (v1, vmin), vmax);
+        v2 = vminq_f32 (vmaxq_f32 (v2, vmin), vmax);
+        v3 = vminq_f32 (vmaxq_f32 (v3, vmin), vmax);
+
+        uint16x8_t lo = vcombine_u16 (vmovn_u32 (vcvtq_u32_f32 (v0)), vmovn_u32 (vcvtq_u32_f32 (v1)));
+        uint16x8_t hi = vcombine_u16 (vmovn_u32 (vcvtq_u32_f32 (v2)), vmovn_u32 (vcvtq_u32_f32 (v3)));
+        vst1q_u8 (&dst[i], vcombine_u8 (vmovn_u16 (lo), vmovn_u16 (hi)));
+    }
+#elif defined (TENSOR_TEX_USE_SSE2)
+    __m128 vmul = _mm_set1_ps (mul);
+    __m128 vadd = _mm_set1_ps (add);
+    __m128 vmin = _mm_setzero_ps ();
+    __m128 vmax = _mm_set1_ps (255.0f);
+    for (; i + 16 <= num; i += 16)
+    {
+        __m128 v0 = _mm_add_ps (_mm_mul_ps (_mm_loadu_ps (&src[i +  0]), vmul), vadd);
+        __m128 v1 = _mm_add_ps (_mm_mul_ps (_mm_loadu_ps (&src[i +  4]), vmul), vadd);
+        __m128 v2 = _mm_add_ps (_mm_mul_ps (_mm_loadu_ps (&src[i +  8]), vmul), vadd);
+        __m128 v3 = _mm_add_ps (_mm_mul_ps (_mm_loadu_ps (&src[i + 12]), vmul), vadd);
+        v0 = _mm_min_ps (_mm_max_ps (v0, vmin), vmax);
+        v1 = _mm_min_ps (_mm_max_ps (v1, vmin), vmax);
+        v2 = _mm_min_ps (_mm_max_ps (v2, vmin), vmax);
+        v3 = _mm_min_ps (_mm_max_ps (v3, vmin), vmax);
+
+        __m128i lo = _mm_packs_epi32 (_mm_cvttps_epi32 (v0), _mm_cvttps_epi32 (v1));
+        __m128i hi = _mm_packs_epi32 (_mm_cvttps_epi32 (v2), _mm_cvttps_epi32 (v3));
+        _mm_storeu_si128 ((__m128i *)&dst[i], _mm_packus_epi16 (lo, hi));
+    }
+#endif
+
+    for (; i < num; i ++)
+    {
+        float v = src[i] * mul + add;
+        v = fminf (fmaxf (v, 0.0f), 255.0f);
+        dst[i] = (uint8_t)v;
+    }
+}
+
+/* interleave 8bit channels into RGBA8888 (alpha = 0xFF) */
+static void
+pack_rgba (const uint8_t *src, int num_pixels, int ch, uint32_t *dst)
+{
+    switch (ch)
+    {
+    case 1:
+        for (int i = 0; i < num_pixels; i ++)
+            dst[i] = 0xFF000000 | (src[i] * 0x00010101);
+        break;
+    case 3:
+        for (int i = 0; i < num_pixels; i ++, src += 3)
+            dst[i] = 0xFF000000 | (src[2] << 16) | (src[1] << 8) | src[0];
+        break;
+    default:
+        for (int i = 0; i < num_pixels; i ++, src += ch)
+            dst[i] = 0xFF000000 | (src[2] << 16) | (src[1] << 8) | src[0];
+        break;
+    }
+}
+
+
+/* -------------------------------------------------- *
+ *  row band conversion (one task per band)
+ * -------------------------------------------------- */
+typedef struct _convert_job_t
+{
+    tensor_tex_t    *tt;
+    const float     *src_f32;
+    const uint8_t   *src_u8;
+    uint8_t         lut[256];
+    int             num_tasks;
+} convert_job_t;
+
+static void
+convert_rows_float (tensor_tex_t *tt, const float *src, int y0, int y1)
+{
+    uint8_t tmp[CHUNK_PIXELS * 4];
+    int ch = tt->ch;
+    int num_pixels = (y1 - y0) * tt->width;
+    uint32_t *dst = tt->rgba + y0 * tt->width;
+
+    src += y0 * tt->width * ch;
+    for (int i = 0; i < num_pixels; i += CHUNK_PIXELS)
+    {
+        int n = num_pixels - i;
+        if (n > CHUNK_PIXELS)
+            n = CHUNK_PIXELS;
+
+        saturate_to_u8 (&src[i * ch], n * ch, tt->mul, tt->add, tmp);
+        pack_rgba (tmp, n, ch, &dst[i]);
+    }
+}
+
+static void
+convert_rows_uint8 (tensor_tex_t *tt, const uint8_t *src, const uint8_t *lut, int y0, int y1)
+{
+    uint8_t tmp[CHUNK_PIXELS * 4];
+    int ch = tt->ch;
+    int num_pixels = (y1 - y0) * tt->width;
+    uint32_t *dst = tt->rgba + y0 * tt->width;
+
+    src += y0 * tt->width * ch;
+    for (int i = 0; i < num_pixels; i += CHUNK_PIXELS)
+    {
+        int n = num_pixels - i;
+        if (n > CHUNK_PIXELS)
+            n = CHUNK_PIXELS;
+
+        const uint8_t *s = &src[i * ch];
+        for (int j = 0; j < n * ch; j ++)
+            tmp[j] = lut[s[j]];
+        pack_rgba (tmp, n, ch, &dst[i]);
+    }
+}
+
+static void
+convert_task (void *arg, int task_id)
+{
+    convert_job_t *job = (convert_job_t *)arg;
+    int h  = job->tt->height;
+    int y0 = h * task_id       / job->num_tasks;
+    int y1 = h * (task_id + 1) / job->num_tasks;
+
+    if (job->src_f32)
+        convert_rows_float (job->tt, job->src_f32, y0, y1);
+    else
+        convert_rows_uint8 (job->tt, job->src_u8, job->lut, y0, y1);
+}
+
+static int
+upload_texture (tensor_tex_t *tt)
+{
+    if (tt->tex.texid == 0)
+    {
+        create_2d_texture_ex (&tt->tex, tt->rgba, tt->width, tt->height,
+                              pixfmt_fourcc('R', 'G', 'B', 'A'));
+        return 0;
+    }
+
+    glBindTexture (GL_TEXTURE_2D, tt->tex.texid);
+    glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, tt->width, tt->height,
+                     GL_RGBA, GL_UNSIGNED_BYTE, tt->rgba);
+    return 0;
+}
+
+static void
+run_convert (tensor_tex_t *tt, convert_job_t *job)
+{
+    /* a couple of bands per thread to even out the load */
+    int num_tasks = 1;
+    if (tt->pool)
+        num_tasks = thread_pool_get_num_threads (tt->pool) * 2;
+    if (num_tasks > tt->height)
+        num_tasks = tt->height;
+
+    job->tt        = tt;
+    job->num_tasks = num_tasks;
+
+    if (tt->pool)
+        thread_pool_run (tt->pool, convert_task, job, num_tasks);
+    else
+        convert_task (job, 0);
+}
+
+
+/* -------------------------------------------------- *
+ *  API
+ * -------------------------------------------------- */
+int
+tensor_tex_init (tensor_tex_t *tt, int w, int h, int ch, int num_threads)
+{
+    memset (tt, 0, sizeof (*tt));
+
+    if (ch != 1 && ch != 3 && ch != 4)
+    {
+        DBG_LOGE ("ERR: %s(%d): ch=%d\n", __FILE__, __LINE__, ch);
+        return -1;
+    }
+
+    tt->rgba = (uint32_t *)malloc (w * h * sizeof (uint32_t));
+    if (tt->rgba == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (num_threads != 1)
+    {
+        tt->pool = thread_pool_create (num_threads);
+        if (thread_pool_get_num_threads (tt->pool) == 1)
+        {
+            thread_pool_destroy (tt->pool);
+            tt->pool = NULL;
+        }
+    }
+
+    tt->width  = w;
+    tt->height = h;
+    tt->ch     = ch;
+    tensor_tex_set_range (tt, TENSOR_RANGE_0_1);
+    return 0;
+}
+
+void
+tensor_tex_free (tensor_tex_t *tt)
+{
+    if (tt->tex.texid)
+    {
+        GLuint texid = tt->tex.texid;
+        glDeleteTextures (1, &texid);
+    }
+
+    thread_pool_destroy (tt->pool);
+    free (tt->rgba);
+    memset (tt, 0, sizeof (*tt));
+}
+
+void
+tensor_tex_set_range (tensor_tex_t *tt, int range)
+{
+    switch (range)
+    {
+    case TENSOR_RANGE_M1_1:
+        tensor_tex_set_affine (tt, 127.5f, 127.5f);
+        break;
+    case TENSOR_RANGE_0_255:
+        tensor_tex_set_affine (tt, 1.0f, 0.0f);
+        break;
+    case TENSOR_RANGE_0_1:
+    default:
+        tensor_tex_set_affine (tt, 255.0f, 0.0f);
+        break;
+    }
+}
+
+void
+tensor_tex_set_affine (tensor_tex_t *tt, float mul, float add)
+{
+    tt->mul = mul;
+    tt->add = add;
+}
+
+void
+tensor_tex_convert_float (tensor_tex_t *tt, const float *src)
+{
+    convert_job_t job;
+    job.src_f32 = src;
+    job.src_u8  = NULL;
+
+    run_convert (tt, &job);
+}
+
+void
+tensor_tex_convert_uint8 (tensor_tex_t *tt, const uint8_t *src, float quant_scale, int quant_zerop)
+{
+    convert_job_t job;
+    job.src_f32 = NULL;
+    job.src_u8  = src;
+
+    /* dequantize + range mapping folded into a 256 entry table */
+    for (int q = 0; q < 256; q ++)
+    {
+        float v = (q - quant_zerop) * quant_scale;
+        saturate_to_u8 (&v, 1, tt->mul, tt->add, &job.lut[q]);
+    }
+
+    run_convert (tt, &job);
+}
+
+int
+tensor_tex_update_float (tensor_tex_t *tt, const float *src)
+{
+    tensor_tex_convert_float (tt, src);
+    return upload_texture (tt);
+}
+
+int
+tensor_tex_update_uint8 (tensor_tex_t *tt, const uint8_t *src, float quant_scale, int quant_zerop)
+{
+    tensor_tex_convert_uint8 (tt, src, quant_scale, quant_zerop);
+    return upload_texture (tt);
+}
+
+void
+tensor_minmax_float (const float *src, int num, float *vmin, float *vmax)
+{
+    int i = 0;
+    float mn =  FLT_MAX;
+    float mx = -FLT_MAX;
+
+#if defined (TENSOR_TEX_USE_NEON)
+    if (num >= 4)
+    {
+        float32x4_t vmn = vld1q_f32 (src);
+        float32x4_t vmx = vmn;
+        for (i = 4; i + 4 <= num; i += 4)
+        {
+            float32x4_t v = vld1q_f32 (&src[i]);
+            vmn = vminq_f32 (vmn, v);
+            vmx = vmaxq_f32 (vmx, v);
+        }
+        float32x2_t mn2 = vpmin_f32 (vget_low_f32 (vmn), vget_high_f32 (vmn));
+        float32x2_t mx2 = vpmax_f32 (vget_low_f32 (vmx), vget_high_f32 (vmx));
+        mn = vget_lane_f32 (vpmin_f32 (mn2, mn2), 0);
+        mx = vget_lane_f32 (vpmax_f32 (mx2, mx2), 0);
+    }
+#elif defined (TENSOR_TEX_USE_SSE2)
+    if (num >= 4)
+    {
+        __m128 vmn = _mm_loadu_ps (src);
+        __m128 vmx = vmn;
+        for (i = 4; i + 4 <= num; i += 4)
+        {
+            __m128 v = _mm_loadu_ps (&src[i]);
+            vmn = _mm_min_ps (vmn, v);
+            vmx = _mm_max_ps (vmx, v);
+        }
+        vmn = _mm_min_ps (vmn, _mm_shuffle_ps (vmn, vmn, _MM_SHUFFLE (1, 0, 3, 2)));
+        vmn = _mm_min_ps (vmn, _mm_shuffle_ps (vmn, vmn, _MM_SHUFFLE (2, 3, 0, 1)));
+        vmx = _mm_max_ps (vmx, _mm_shuffle_ps (vmx, vmx, _MM_SHUFFLE (1, 0, 3, 2)));
+        vmx = _mm_max_ps (vmx, _mm_shuffle_ps (vmx, vmx, _MM_SHUFFLE (2, 3, 0, 1)));
+        mn = _mm_cvtss_f32 (vmn);
+        mx = _mm_cvtss_f32 (vmx);
+    }
+#endif
+
+    for (; i < num; i ++)
+    {
+        mn = (src[i] < mn) ? src[i] : mn;
+        mx = (src[i] > mx) ? src[i] : mx;
+    }
+
+    *vmin = mn;
+    *vmax = mx;
+}
@@ -0,0 +1,60 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_TENSOR_TEX_H_
+#define _UTIL_TENSOR_TEX_H_
+
+#include <stdint.h>
+#include "util_texture.h"
+#include "util_thread_pool.h"
+
+/* value range of the output tensor */
+#define TENSOR_RANGE_0_1        0       /* [ 0.0, 1.0] */
+#define TENSOR_RANGE_M1_1       1       /* [-1.0, 1.0] */
+#define TENSOR_RANGE_0_255      2       /* [ 0.0, 255.0] */
+
+typedef struct _tensor_tex_t
+{
+    int         width;
+    int         height;
+    int         ch;             /* 1: gray, 3: RGB, 4: RGBA (HWC) */
+    float       mul;            /* pixel = saturate (val * mul + add) */
+    float       add;
+    uint32_t    *rgba;          /* [height][width] reusable upload buffer */
+    texture_2d_t tex;           /* persistent texture (created on first upload) */
+    thread_pool_t *pool;        /* rows are converted in parallel */
+} tensor_tex_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* num_threads <= 0 means one thread per core. */
+int  tensor_tex_init (tensor_tex_t *tt, int w, int h, int ch, int num_threads);
+void tensor_tex_free (tensor_tex_t *tt);
+
+void tensor_tex_set_range  (tensor_tex_t *tt, int range);
+void tensor_tex_set_affine (tensor_tex_t *tt, float mul, float add);
+
+/*
+ *  Convert the tensor into RGBA8888 and upload it into tt->tex (needs GL context).
+ *  Values are saturated to [0, 255] and truncated, alpha is 0xFF.
+ *  Quantized tensors are dequantized with (q - zerop) * scale before the range mapping.
+ */
+int  tensor_tex_update_float (tensor_tex_t *tt, const float *src);
+int  tensor_tex_update_uint8 (tensor_tex_t *tt, const uint8_t *src, float quant_scale, int quant_zerop);
+
+/* the conversion alone: fill tt->rgba without touching GL (any thread). */
+void tensor_tex_convert_float (tensor_tex_t *tt, const float *src);
+void tensor_tex_convert_uint8 (tensor_tex_t *tt, const uint8_t *src, float quant_scale, int quant_zerop);
+
+/* minimum and maximum of a float array */
+void tensor_minmax_float (const float *src, int num, float *vmin, float *vmax);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_TENSOR_TEX_H_ */
@@ -4,6 +4,7 @@
  * ------------------------------------------------ */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <GLES2/gl2.h>
 #include "util_texture.h"
 #include "assertgl.h"
@@ -47,6 +48,29 @@ create_2d_texture (void *imgbuf, int width, int height)
     return texid;
 }
 
+/* GL format and row width of a pixfmt_fourcc () image, and set the unpack alignment for it */
+static void
+set_unpack_format (uint32_t fmt, int *glfmt, int *glw)
+{
+    if (fmt == pixfmt_fourcc('Y', 'U', 'Y', 'V') ||
+        fmt == pixfmt_fourcc('U', 'Y', 'V', 'Y'))
+    {
+        glPixelStorei (GL_UNPACK_ALIGNMENT, 2);
+        *glfmt = GL_RGBA;
+        *glw  /= 2;
+    }
+    else if (fmt == PIXFMT_GREY)
+    {
+        glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
+        *glfmt = GL_LUMINANCE;
+    }
+    else
+    {
+        glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+        *glfmt = GL_RGBA;
+    }
+}
+
 int
 create_2d_texture_ex (texture_2d_t *tex2d, void *imgbuf, int width, int height, uint32_t fmt)
 {
@@ -67,19 +91,9 @@ create_2d_texture_ex (texture_2d_t *tex2d, void *imgbuf, int width, int height,
 
     int glw   = width;
     int glh   = height;
-    int glfmt = GL_RGBA;
-
-    if (fmt == pixfmt_fourcc('Y', 'U', 'Y', 'V') ||
-        fmt == pixfmt_fourcc('U', 'Y', 'V', 'Y'))
-    {
-        glPixelStorei (GL_UNPACK_ALIGNMENT, 2);
-        glw /= 2;
-    }
-    else
-    {
-        glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
-    }
+    int glfmt;
 
+    set_unpack_format (fmt, &glfmt, &glw);
     glTexImage2D (GL_TEXTURE_2D, 0, glfmt, glw, glh, 0, glfmt, GL_UNSIGNED_BYTE, imgbuf);
 
     tex2d->texid  = texid;
@@ -90,6 +104,205 @@ create_2d_texture_ex (texture_2d_t *tex2d, void *imgbuf, int width, int height,
 }
 
 
+/* -------------------------------------------------- *
+ *  texture / staging buffer pool
+ * -------------------------------------------------- */
+typedef struct _pool_texture_t
+{
+    texture_2d_t    tex;
+    int             in_use;
+} pool_texture_t;
+
+typedef struct _pool_buffer_t
+{
+    void            *buf;
+    size_t          size;
+    int             in_use;
+} pool_buffer_t;
+
+static pool_texture_t       s_pool_tex[TEXTURE_POOL_MAX_TEXTURES];
+static pool_buffer_t        s_pool_buf[TEXTURE_POOL_MAX_BUFFERS];
+static texture_pool_stats_t s_pool_stats;
+
+texture_2d_t *
+texture_pool_acquire (int w, int h, uint32_t fmt)
+{
+    pool_texture_t *empty = NULL;
+    int i;
+
+    for (i = 0; i < TEXTURE_POOL_MAX_TEXTURES; i ++)
+    {
+        pool_texture_t *pt = &s_pool_tex[i];
+        if (pt->tex.texid == 0)
+        {
+            if (empty == NULL)
+                empty = pt;
+            continue;
+        }
+
+        if (!pt->in_use && pt->tex.width == w && pt->tex.height == h && pt->tex.format == fmt)
+        {
+            pt->in_use = 1;
+            s_pool_stats.tex_reused ++;
+            return &pt->tex;
+        }
+    }
+
+    if (empty == NULL)
+    {
+        fprintf (stderr, "ERR: %s(%d): texture pool is full\n", __FILE__, __LINE__);
+        return NULL;
+    }
+
+    /* storage only: the contents come with texture_pool_upload () */
+    create_2d_texture_ex (&empty->tex, NULL, w, h, fmt);
+    empty->in_use = 1;
+    s_pool_stats.tex_created ++;
+    return &empty->tex;
+}
+
+void
+texture_pool_upload (texture_2d_t *tex, void *imgbuf)
+{
+    int glw = tex->width;
+    int glfmt;
+
+    glBindTexture (GL_TEXTURE_2D, tex->texid);
+    set_unpack_format (tex->format, &glfmt, &glw);
+    glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, glw, tex->height, glfmt, GL_UNSIGNED_BYTE, imgbuf);
+
+    s_pool_stats.upload_bytes += (uint64_t)glw * tex->height * (glfmt == GL_LUMINANCE ? 1 : 4);
+}
+
+void
+texture_pool_release (texture_2d_t *tex)
+{
+    int i;
+
+    for (i = 0; i < TEXTURE_POOL_MAX_TEXTURES; i ++)
+    {
+        if (&s_pool_tex[i].tex == tex)
+        {
+            s_pool_tex[i].in_use = 0;
+            return;
+        }
+    }
+}
+
+void *
+texture_pool_acquire_buffer (size_t size)
+{
+    pool_buffer_t *best  = NULL;
+    pool_buffer_t *empty = NULL;
+    int i;
+
+    /* the smallest free buffer that fits */
+    for (i = 0; i < TEXTURE_POOL_MAX_BUFFERS; i ++)
+    {
+        pool_buffer_t *pb = &s_pool_buf[i];
+        if (pb->buf == NULL)
+        {
+            if (empty == NULL)
+                empty = pb;
+            continue;
+        }
+
+        if (!pb->in_use && pb->size >= size && (best == NULL || pb->size < best->size))
+            best = pb;
+    }
+
+    if (best)
+    {
+        best->in_use = 1;
+        s_pool_stats.buf_reused ++;
+        return best->buf;
+    }
+
+    if (empty == NULL)
+    {
+        fprintf (stderr, "ERR: %s(%d): buffer pool is full\n", __FILE__, __LINE__);
+        return NULL;
+    }
+
+    empty->buf = malloc (size);
+    if (empty->buf == NULL)
+    {
+        fprintf (stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+        return NULL;
+    }
+    empty->size   = size;
+    empty->in_use = 1;
+    s_pool_stats.buf_created ++;
+    return empty->buf;
+}
+
+void
+texture_pool_release_buffer (void *buf)
+{
+    int i;
+
+    for (i = 0; i < TEXTURE_POOL_MAX_BUFFERS; i ++)
+    {
+        if (buf && s_pool_buf[i].buf == buf)
+        {
+            s_pool_buf[i].in_use = 0;
+            return;
+        }
+    }
+}
+
+void
+texture_pool_get_stats (texture_pool_stats_t *stats)
+{
+    int i;
+
+    *stats = s_pool_stats;
+    stats->num_textures      = 0;
+    stats->num_textures_used = 0;
+    stats->num_buffers       = 0;
+    stats->num_buffers_used  = 0;
+    stats->buffer_bytes      = 0;
+
+    for (i = 0; i < TEXTURE_POOL_MAX_TEXTURES; i ++)
+    {
+        if (s_pool_tex[i].tex.texid == 0)
+            continue;
+        stats->num_textures ++;
+        stats->num_textures_used += s_pool_tex[i].in_use;
+    }
+
+    for (i = 0; i < TEXTURE_POOL_MAX_BUFFERS; i ++)
+    {
+        if (s_pool_buf[i].buf == NULL)
+            continue;
+        stats->num_buffers ++;
+        stats->num_buffers_used += s_pool_buf[i].in_use;
+        stats->buffer_bytes     += s_pool_buf[i].size;
+    }
+}
+
+/* the GL context must still be current */
+void
+texture_pool_destroy (void)
+{
+    int i;
+
+    for (i = 0; i < TEXTURE_POOL_MAX_TEXTURES; i ++)
+    {
+        GLuint texid = s_pool_tex[i].tex.texid;
+        if (texid)
+            glDeleteTextures (1, &texid);
+    }
+
+    for (i = 0; i < TEXTURE_POOL_MAX_BUFFERS; i ++)
+        free (s_pool_buf[i].buf);
+
+    memset (s_pool_tex, 0, sizeof (s_pool_tex));
+    memset (s_pool_buf, 0, sizeof (s_pool_buf));
+    memset (&s_pool_stats, 0, sizeof (s_pool_stats));
+}
+
+
 int
 load_png_texture (char *name, int *lpTexID, int *lpWidth, int *lpHeight)
 {
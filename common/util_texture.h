@@ -6,6 +6,7 @@
 #define TEXTURE_UTIL_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 #define pixfmt_fourcc(a, b, c, d)\
     ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
@@ -18,6 +19,27 @@ typedef struct _texture_2d_t
     uint32_t    format;
 } texture_2d_t;
 
+/* 8bit single channel (GL_LUMINANCE) */
+#define PIXFMT_GREY     pixfmt_fourcc('G', 'R', 'E', 'Y')
+
+#define TEXTURE_POOL_MAX_TEXTURES   16
+#define TEXTURE_POOL_MAX_BUFFERS    16
+
+typedef struct _texture_pool_stats_t
+{
+    int         num_textures;       /* textures held by the pool        */
+    int         num_textures_used;  /* of which acquired at the moment  */
+    int         num_buffers;        /* staging buffers held by the pool */
+    int         num_buffers_used;
+    size_t      buffer_bytes;       /* total size of the staging buffers */
+
+    uint64_t    tex_created;        /* glTexImage2D () allocations */
+    uint64_t    tex_reused;
+    uint64_t    buf_created;        /* malloc () of staging buffers */
+    uint64_t    buf_reused;
+    uint64_t    upload_bytes;       /* glTexSubImage2D () traffic */
+} texture_pool_stats_t;
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +52,25 @@ uint32_t create_2d_texture (void *imgbuf, int width, int height);
 
 int create_2d_texture_ex (texture_2d_t *tex2d, void *imgbuf, int w, int h, uint32_t fmt);
 
+/*
+ *  Pool of textures and CPU staging buffers for per-frame uploads and
+ *  readbacks. A released texture (keyed by size and format) or buffer (any
+ *  buffer at least as large) is handed out again on the next acquire, so the
+ *  steady state creates no GL texture and mallocs nothing.
+ *  Call from the GL thread only. Both acquire functions return NULL when the
+ *  pool is full. texture_pool_destroy () must run before the GL context is
+ *  terminated: the pooled texture names do not survive it.
+ */
+texture_2d_t *texture_pool_acquire (int w, int h, uint32_t fmt);
+void          texture_pool_upload  (texture_2d_t *tex, void *imgbuf);
+void          texture_pool_release (texture_2d_t *tex);
+
+void *texture_pool_acquire_buffer (size_t size);
+void  texture_pool_release_buffer (void *buf);
+
+void  texture_pool_get_stats (texture_pool_stats_t *stats);
+void  texture_pool_destroy (void);
+
 #if defined (USE_INPUT_CAMERA_CAPTURE)
 int  create_capture_texture (texture_2d_t *captex);
 void update_capture_texture (texture_2d_t *captex);
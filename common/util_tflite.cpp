@@ -4,7 +4,11 @@
  * ------------------------------------------------ */
 #include "util_tflite.h"
 #include "util_debug.h"
+#include "util_pmeter.h"
+#include "util_trace.h"
 #include <thread>
+#include <atomic>
+#include <algorithm>
 
 using namespace tflite;
 
@@ -137,11 +141,62 @@ tflite_print_tensor_info (std::unique_ptr<Interpreter> &interpreter)
 }
 
 
+static void
+setup_op_resolver (tflite_op_resolver_t *resolver)
+{
+#if defined (USE_REDUCED_OP_RESOLVER)
+    tflite_register_model_ops (resolver);
+#endif
+}
+
+
+const char *
+tflite_get_delegate_name (void)
+{
+#if defined (USE_GL_DELEGATE)
+    return "GL_DELEGATE";
+#elif defined (USE_GPU_DELEGATEV2)
+    return "GPU_DELEGATEV2";
+#elif defined (USE_NNAPI_DELEGATE)
+    return "NNAPI_DELEGATE";
+#elif defined (USE_HEXAGON_DELEGATE)
+    return "HEXAGON_DELEGATE";
+#elif defined (USE_XNNPACK_DELEGATE)
+    return "XNNPACK_DELEGATE";
+#else
+    return "CPU";
+#endif
+}
+
+static int
+is_delegate_disabled (void)
+{
+    char *env_tflite_delegate = getenv ("FORCE_TFLITE_DELEGATE");
+    return (env_tflite_delegate && strcmp (env_tflite_delegate, "none") == 0);
+}
+
+int
+tflite_is_gpu_delegate_active (void)
+{
+#if defined (USE_GL_DELEGATE) || defined (USE_GPU_DELEGATEV2)
+    return !is_delegate_disabled ();
+#else
+    return 0;
+#endif
+}
+
 static int
-modify_graph_with_delegate (tflite_interpreter_t *p, tflite_createopt_t *opt)
+modify_graph_with_delegate (std::unique_ptr<Interpreter> &interpreter, tflite_createopt_t *opt, int num_threads)
 {
     TfLiteDelegate *delegate = NULL;
 
+    /* run on the CPU even when a delegate is built in (e.g. to compare them) */
+    if (is_delegate_disabled ())
+    {
+        DBG_LOGI ("@@@@@@ FORCE_TFLITE_DELEGATE=none\n");
+        return 0;
+    }
+
 #if defined (USE_GL_DELEGATE)
     const TfLiteGpuDelegateOptions options = {
         .metadata = NULL,
@@ -157,7 +212,7 @@ modify_graph_with_delegate (tflite_interpreter_t *p, tflite_createopt_t *opt)
     if (opt && opt->gpubuffer)
     {
         int ssbo_id = opt->gpubuffer;
-        int tensor_index = p->interpreter->inputs()[0];
+        int tensor_index = interpreter->inputs()[0];
 
         TfLiteIntArray *dim = interpreter->tensor(tensor_index)->dims;
         if (TfLiteGpuDelegateBindBufferToTensor(delegate, ssbo_id, tensor_index) != kTfLiteOk)
@@ -210,14 +265,6 @@ modify_graph_with_delegate (tflite_interpreter_t *p, tflite_createopt_t *opt)
 #endif
 
 #if defined (USE_XNNPACK_DELEGATE)
-    int num_threads = std::thread::hardware_concurrency();
-    char *env_tflite_num_threads = getenv ("FORCE_TFLITE_NUM_THREADS");
-    if (env_tflite_num_threads)
-    {
-        num_threads = atoi (env_tflite_num_threads);
-        DBG_LOGI ("@@@@@@ FORCE_TFLITE_NUM_THREADS(XNNPACK)=%d\n", num_threads);
-    }
-
     // IMPORTANT: initialize options with TfLiteXNNPackDelegateOptionsDefault() for
     // API-compatibility with future extensions of the TfLiteXNNPackDelegateOptions
     // structure.
@@ -234,7 +281,7 @@ modify_graph_with_delegate (tflite_interpreter_t *p, tflite_createopt_t *opt)
     if (!delegate)
         return 0;
 
-    if (p->interpreter->ModifyGraphWithDelegate(delegate) != kTfLiteOk)
+    if (interpreter->ModifyGraphWithDelegate(delegate) != kTfLiteOk)
     {
         DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
         return -1;
@@ -254,6 +301,7 @@ tflite_create_interpreter_from_file (tflite_interpreter_t *p, const char *model_
         return -1;
     }
 
+    setup_op_resolver (&p->resolver);
     InterpreterBuilder(*(p->model), p->resolver)(&(p->interpreter));
     if (!p->interpreter)
     {
@@ -271,7 +319,7 @@ tflite_create_interpreter_from_file (tflite_interpreter_t *p, const char *model_
     DBG_LOG ("@@@@@@ TFLITE_NUM_THREADS=%d\n", num_threads);
     p->interpreter->SetNumThreads(num_threads);
 
-    if (modify_graph_with_delegate (p, NULL) < 0)
+    if (modify_graph_with_delegate (p->interpreter, NULL, num_threads) < 0)
     {
         DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
         //return -1;
@@ -302,6 +350,7 @@ tflite_create_interpreter_ex_from_file (tflite_interpreter_t *p, const char *mod
         return -1;
     }
 
+    setup_op_resolver (&p->resolver);
     InterpreterBuilder(*(p->model), p->resolver)(&(p->interpreter));
     if (!p->interpreter)
     {
@@ -325,7 +374,7 @@ tflite_create_interpreter_ex_from_file (tflite_interpreter_t *p, const char *mod
     p->interpreter->ResizeInputTensor(input_id, sizes);
 #endif
 
-    if (modify_graph_with_delegate (p, opt) < 0)
+    if (modify_graph_with_delegate (p->interpreter, opt, num_threads) < 0)
     {
         DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
         //return -1;
@@ -357,6 +406,7 @@ tflite_create_interpreter (tflite_interpreter_t *p, const char *model_buf, size_
         return -1;
     }
 
+    setup_op_resolver (&p->resolver);
     InterpreterBuilder(*(p->model), p->resolver)(&(p->interpreter));
     if (!p->interpreter)
     {
@@ -374,7 +424,7 @@ tflite_create_interpreter (tflite_interpreter_t *p, const char *model_buf, size_
     DBG_LOG ("@@@@@@ TFLITE_NUM_THREADS=%d\n", num_threads);
     p->interpreter->SetNumThreads(num_threads);
 
-    if (modify_graph_with_delegate (p, NULL) < 0)
+    if (modify_graph_with_delegate (p->interpreter, NULL, num_threads) < 0)
     {
         DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
         //return -1;
@@ -405,6 +455,7 @@ tflite_create_interpreter_ex (tflite_interpreter_t *p, const char *model_buf, si
         return -1;
     }
 
+    setup_op_resolver (&p->resolver);
     InterpreterBuilder(*(p->model), p->resolver)(&(p->interpreter));
     if (!p->interpreter)
     {
@@ -428,7 +479,7 @@ tflite_create_interpreter_ex (tflite_interpreter_t *p, const char *model_buf, si
     p->interpreter->ResizeInputTensor(input_id, sizes);
 #endif
 
-    if (modify_graph_with_delegate (p, opt) < 0)
+    if (modify_graph_with_delegate (p->interpreter, opt, num_threads) < 0)
     {
         DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
         //return -1;
@@ -450,11 +501,9 @@ tflite_create_interpreter_ex (tflite_interpreter_t *p, const char *model_buf, si
 }
 
 
-int
-tflite_get_tensor_by_name (tflite_interpreter_t *p, int io, const char *name, tflite_tensor_t *ptensor)
+static int
+get_tensor_by_name (std::unique_ptr<Interpreter> &interpreter, int io, const char *name, tflite_tensor_t *ptensor)
 {
-    std::unique_ptr<Interpreter> &interpreter = p->interpreter;
-
     memset (ptensor, 0, sizeof (*ptensor));
 
     int tensor_idx;
@@ -518,3 +567,235 @@ tflite_get_tensor_by_name (tflite_interpreter_t *p, int io, const char *name, tf
     return 0;
 }
 
+
+int
+tflite_get_tensor_by_name (tflite_interpreter_t *p, int io, const char *name, tflite_tensor_t *ptensor)
+{
+    return get_tensor_by_name (p->interpreter, io, name, ptensor);
+}
+
+
+/* -------------------------------------------------- *
+ *  per-op trace events (the tag is the op name, e.g. "CONV_2D")
+ * -------------------------------------------------- */
+class TraceProfiler : public tflite::Profiler
+{
+public:
+    using tflite::Profiler::EndEvent;
+
+    uint32_t BeginEvent (const char *tag, EventType event_type,
+                         int64_t event_metadata1, int64_t event_metadata2) override
+    {
+        trace_begin (tag);
+        return 1;
+    }
+
+    void EndEvent (uint32_t event_handle) override
+    {
+        trace_end (NULL);
+    }
+};
+
+static TraceProfiler s_trace_profiler;
+
+void
+tflite_enable_op_trace (tflite_interpreter_t *p)
+{
+    p->interpreter->SetProfiler (&s_trace_profiler);
+}
+
+void
+tflite_pool_enable_op_trace (tflite_interpreter_pool_t *p)
+{
+    for (auto &interpreter : p->interpreters)
+        interpreter->SetProfiler (&s_trace_profiler);
+}
+
+
+/* -------------------------------------------------- *
+ *  Interpreter pool
+ * -------------------------------------------------- */
+int
+tflite_create_interpreter_pool (tflite_interpreter_pool_t *p, const char *model_buf, size_t model_size, int num_interpreters)
+{
+    p->model = FlatBufferModel::BuildFromBuffer(model_buf, model_size);
+    if (!p->model)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    /* total number of threads shared by all the interpreters */
+    int num_cores = std::thread::hardware_concurrency();
+    char *env_tflite_num_threads = getenv ("FORCE_TFLITE_NUM_THREADS");
+    if (env_tflite_num_threads)
+    {
+        num_cores = atoi (env_tflite_num_threads);
+        DBG_LOGI ("@@@@@@ FORCE_TFLITE_NUM_THREADS=%d\n", num_cores);
+    }
+    if (num_cores <= 0)
+        num_cores = 1;
+
+    if (tflite_is_gpu_delegate_active ())
+        num_interpreters = 1;
+    if (num_interpreters <= 0 || num_interpreters > num_cores)
+        num_interpreters = num_cores;
+    if (num_interpreters > TFLITE_POOL_MAX_INTERPRETERS)
+        num_interpreters = TFLITE_POOL_MAX_INTERPRETERS;
+
+    /*
+     *  sized for a full pool. tflite_pool_run() hands the cores of the idle
+     *  interpreters to the busy ones when there are fewer ROIs.
+     */
+    int num_threads = num_cores / num_interpreters;
+    if (num_threads < 1)
+        num_threads = 1;
+
+    setup_op_resolver (&p->resolver);
+    for (int i = 0; i < num_interpreters; i ++)
+    {
+        std::unique_ptr<Interpreter> interpreter;
+
+        InterpreterBuilder(*(p->model), p->resolver)(&interpreter);
+        if (!interpreter)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            return -1;
+        }
+
+        interpreter->SetNumThreads(num_threads);
+
+        if (modify_graph_with_delegate (interpreter, NULL, num_threads) < 0)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            //return -1;
+        }
+
+        if (interpreter->AllocateTensors() != kTfLiteOk)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            return -1;
+        }
+
+        p->interpreters.push_back (std::move (interpreter));
+    }
+
+    p->num_interpreters = num_interpreters;
+    p->num_cores        = num_cores;
+    p->num_threads      = num_threads;
+    for (int i = 0; i < num_interpreters; i ++)
+        p->cur_threads[i] = num_threads;
+
+    /* one worker per interpreter. (the caller of tflite_pool_run() is one of them) */
+    p->workers = thread_pool_create (num_interpreters);
+    p->invoke_metric = metrics_timer_id ("tflite_pool_invoke");
+
+#if 1 /* for debug */
+    DBG_LOG ("\n");
+    DBG_LOG ("##### LOAD TFLITE: %p: %zu[byte]\n", model_buf, model_size);
+    DBG_LOG ("@@@@@@ TFLITE_POOL: %d interpreters x %d threads\n", num_interpreters, num_threads);
+    tflite_print_tensor_info (p->interpreters[0]);
+#endif
+
+    return 0;
+}
+
+void
+tflite_destroy_interpreter_pool (tflite_interpreter_pool_t *p)
+{
+    thread_pool_destroy (p->workers);
+    p->workers = NULL;
+
+    p->interpreters.clear ();
+    p->model.reset ();
+    p->num_interpreters = 0;
+}
+
+int
+tflite_pool_get_tensor_by_name (tflite_interpreter_pool_t *p, int interp_id, int io, const char *name, tflite_tensor_t *ptensor)
+{
+    if (interp_id < 0 || interp_id >= p->num_interpreters)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    return get_tensor_by_name (p->interpreters[interp_id], io, name, ptensor);
+}
+
+int
+tflite_pool_invoke (tflite_interpreter_pool_t *p, int interp_id)
+{
+    double ttime0 = pmeter_get_time_ms ();
+    TRACE_SCOPE ("Invoke");
+    if (p->interpreters[interp_id]->Invoke() != kTfLiteOk)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    /* lock-free: called from the pool workers */
+    metrics_record_ms (p->invoke_metric, pmeter_get_time_ms () - ttime0);
+    return 0;
+}
+
+
+typedef struct _pool_job_t
+{
+    tflite_interpreter_pool_t *pool;
+    tflite_pool_func_t  func;
+    void                *arg;
+    int                 num_rois;
+    std::atomic<int>    next_roi;
+} pool_job_t;
+
+/*
+ *  one lane per interpreter. a lane pulls the next ROI as soon as its
+ *  interpreter is free, so a slow ROI never holds up the others.
+ */
+static void
+pool_lane (void *arg, int interp_id)
+{
+    pool_job_t *job = (pool_job_t *)arg;
+
+    for (;;)
+    {
+        int roi_id = job->next_roi.fetch_add (1);
+        if (roi_id >= job->num_rois)
+            return;
+
+        job->func (job->arg, interp_id, roi_id);
+    }
+}
+
+void
+tflite_pool_run (tflite_interpreter_pool_t *p, tflite_pool_func_t func, void *arg, int num_rois)
+{
+    if (num_rois <= 0)
+        return;
+
+    pool_job_t job;
+    job.pool     = p;
+    job.func     = func;
+    job.arg      = arg;
+    job.num_rois = num_rois;
+    job.next_roi = 0;
+
+    int num_lanes = std::min (p->num_interpreters, num_rois);
+
+    /*
+     *  the cores go to the interpreters which run this time: one ROI gets
+     *  them all, a full pool splits them. (no Invoke() is in flight here)
+     */
+    int num_threads = std::max (p->num_cores / num_lanes, 1);
+    for (int i = 0; i < num_lanes; i ++)
+    {
+        if (p->cur_threads[i] != num_threads)
+        {
+            p->interpreters[i]->SetNumThreads(num_threads);
+            p->cur_threads[i] = num_threads;
+        }
+    }
+
+    thread_pool_run (p->workers, pool_lane, &job, num_lanes);
+}
@@ -8,6 +8,7 @@
 #include "tensorflow/lite/kernels/register.h"
 #include "tensorflow/lite/model.h"
 #include "tensorflow/lite/optional_debug_tools.h"
+#include "tensorflow/lite/core/api/profiler.h"
 
 #if defined (USE_GL_DELEGATE)
 #include "tensorflow/lite/delegates/gpu/gl_delegate.h"
@@ -28,14 +29,54 @@
 #include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
 #endif
 
+#include "util_thread_pool.h"
+#include "util_metrics.h"
+
+#define TFLITE_POOL_MAX_INTERPRETERS    4   /* more only adds contention for the big cores */
+
+/*
+ *  USE_REDUCED_OP_RESOLVER: register only the ops of the app's bundled models.
+ *  tflite_register_model_ops () is generated from the .tflite files by
+ *  tools/gen_op_resolver at build time, and the kernels of the other builtin
+ *  ops are never referenced. Custom ops are still added by the app with
+ *  resolver.AddCustom () as before.
+ */
+#if defined (USE_REDUCED_OP_RESOLVER)
+typedef tflite::MutableOpResolver               tflite_op_resolver_t;
+void tflite_register_model_ops (tflite::MutableOpResolver *resolver);
+#else
+typedef tflite::ops::builtin::BuiltinOpResolver tflite_op_resolver_t;
+#endif
 
 typedef struct tflite_interpreter_t
 {
     std::unique_ptr<tflite::FlatBufferModel> model;
     std::unique_ptr<tflite::Interpreter>     interpreter;
-    tflite::ops::builtin::BuiltinOpResolver  resolver;
+    tflite_op_resolver_t                     resolver;
 } tflite_interpreter_t;
 
+/*
+ *  Interpreter pool: N interpreters built from one shared FlatBufferModel.
+ *  Used to run a second-stage model (landmark, attribute ...) on several
+ *  ROIs in parallel. Results are written by ROI index, so they come out in
+ *  the same order as the ROIs whichever interpreter ran them.
+ */
+typedef struct tflite_interpreter_pool_t
+{
+    std::unique_ptr<tflite::FlatBufferModel>            model;
+    std::vector<std::unique_ptr<tflite::Interpreter>>   interpreters;
+    tflite_op_resolver_t                                resolver;
+    int             num_interpreters;
+    int             num_cores;          /* threads shared by all the interpreters */
+    int             num_threads;        /* intra-op threads of each interpreter in a full pool */
+    int             cur_threads[TFLITE_POOL_MAX_INTERPRETERS];  /* as set for the last run */
+    thread_pool_t   *workers;
+    int             invoke_metric;      /* util_metrics timer "tflite_pool_invoke" */
+} tflite_interpreter_pool_t;
+
+/* called once for every roi_id in [0, num_rois) with a free interpreter. */
+typedef void (*tflite_pool_func_t) (void *arg, int interp_id, int roi_id);
+
 typedef struct tflite_createopt_t
 {
     int gpubuffer;
@@ -62,8 +103,37 @@ int tflite_create_interpreter (tflite_interpreter_t *p, const char *model_buf, s
 int tflite_get_tensor_by_name (tflite_interpreter_t *p, int io, const char *name, tflite_tensor_t *ptensor);
 
 int tflite_create_interpreter_from_file (tflite_interpreter_t *p, const char *model_path);
+
+/*
+ *  the delegate built in by USE_xxx_DELEGATE ("CPU" when none).
+ *  FORCE_TFLITE_DELEGATE=none in the environment skips it at runtime, as
+ *  FORCE_TFLITE_NUM_THREADS=N overrides the number of threads.
+ */
+const char *tflite_get_delegate_name (void);
+
+/* a GPU delegate is built in and not disabled: Invoke() has to run on the GL thread. */
+int tflite_is_gpu_delegate_active (void);
 int tflite_create_interpreter_ex_from_file (tflite_interpreter_t *p, const char *model_path, tflite_createopt_t *opt);
 
+/*
+ *  num_interpreters <= 0 means one per core, up to TFLITE_POOL_MAX_INTERPRETERS.
+ *  Each run divides the cores among the interpreters it dispatches (one per
+ *  ROI), so a single ROI still gets every core. When a GPU delegate is active
+ *  (not disabled by FORCE_TFLITE_DELEGATE=none) the pool has a single
+ *  interpreter which runs on the calling thread.
+ */
+int  tflite_create_interpreter_pool (tflite_interpreter_pool_t *p, const char *model_buf, size_t model_size, int num_interpreters);
+void tflite_destroy_interpreter_pool (tflite_interpreter_pool_t *p);
+int  tflite_pool_get_tensor_by_name (tflite_interpreter_pool_t *p, int interp_id, int io, const char *name, tflite_tensor_t *ptensor);
+int  tflite_pool_invoke (tflite_interpreter_pool_t *p, int interp_id);
+
+/* run func for every ROI and return when all of them have finished. */
+void tflite_pool_run (tflite_interpreter_pool_t *p, tflite_pool_func_t func, void *arg, int num_rois);
+
+/* record every op of Invoke() into util_trace (while the trace is enabled). */
+void tflite_enable_op_trace (tflite_interpreter_t *p);
+void tflite_pool_enable_op_trace (tflite_interpreter_pool_t *p);
+
 
 
 #ifdef __cplusplus
@@ -0,0 +1,168 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include "util_thread_pool.h"
+#include "util_debug.h"
+
+struct _thread_pool_t
+{
+    std::vector<std::thread> workers;
+    std::mutex               mtx;
+    std::condition_variable  cv_start;
+    std::condition_variable  cv_done;
+
+    /* current job. (guarded by mtx, except the task counter) */
+    thread_pool_func_t  func;
+    void                *arg;
+    int                 num_tasks;
+    std::atomic<int>    next_task;
+    int                 num_joined;     /* workers which picked up the current job */
+    int                 num_busy;
+    unsigned int        generation;
+    bool                quit;
+};
+
+
+static void
+run_tasks (thread_pool_t *pool, thread_pool_func_t func, void *arg, int num_tasks)
+{
+    for (;;)
+    {
+        int task_id = pool->next_task.fetch_add (1);
+        if (task_id >= num_tasks)
+            return;
+
+        func (arg, task_id);
+    }
+}
+
+static void
+worker_main (thread_pool_t *pool)
+{
+    unsigned int seen_generation = 0;
+
+    for (;;)
+    {
+        thread_pool_func_t func;
+        void *arg;
+        int num_tasks;
+        {
+            std::unique_lock<std::mutex> lock (pool->mtx);
+            pool->cv_start.wait (lock, [&] {
+                return pool->quit || pool->generation != seen_generation;
+            });
+            if (pool->quit)
+                return;
+
+            seen_generation = pool->generation;
+            func      = pool->func;
+            arg       = pool->arg;
+            num_tasks = pool->num_tasks;
+            pool->num_joined ++;
+            pool->num_busy ++;
+        }
+
+        run_tasks (pool, func, arg, num_tasks);
+
+        {
+            std::lock_guard<std::mutex> lock (pool->mtx);
+            pool->num_busy --;
+            if (pool->num_busy == 0)
+                pool->cv_done.notify_all ();
+        }
+    }
+}
+
+
+thread_pool_t *
+thread_pool_create (int num_threads)
+{
+    if (num_threads <= 0)
+        num_threads = std::thread::hardware_concurrency();
+    if (num_threads <= 0)
+        num_threads = 1;
+
+    thread_pool_t *pool = new thread_pool_t;
+    pool->func       = NULL;
+    pool->arg        = NULL;
+    pool->num_tasks  = 0;
+    pool->next_task  = 0;
+    pool->num_joined = 0;
+    pool->num_busy   = 0;
+    pool->generation = 0;
+    pool->quit       = false;
+
+    for (int i = 0; i < num_threads - 1; i ++)
+        pool->workers.push_back (std::thread (worker_main, pool));
+
+    DBG_LOG ("thread_pool: %d threads\n", num_threads);
+    return pool;
+}
+
+void
+thread_pool_destroy (thread_pool_t *pool)
+{
+    if (pool == NULL)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock (pool->mtx);
+        pool->quit = true;
+    }
+    pool->cv_start.notify_all ();
+
+    for (auto &th : pool->workers)
+        th.join ();
+
+    delete pool;
+}
+
+int
+thread_pool_get_num_threads (thread_pool_t *pool)
+{
+    return (int)pool->workers.size() + 1;
+}
+
+void
+thread_pool_run (thread_pool_t *pool, thread_pool_func_t func, void *arg, int num_tasks)
+{
+    if (num_tasks <= 0)
+        return;
+
+    /* not worth waking anybody up */
+    if (num_tasks == 1 || pool->workers.empty())
+    {
+        for (int i = 0; i < num_tasks; i ++)
+            func (arg, i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock (pool->mtx);
+        pool->func      = func;
+        pool->arg       = arg;
+        pool->num_tasks = num_tasks;
+        pool->next_task = 0;
+        pool->num_joined = 0;
+        pool->generation ++;
+    }
+    pool->cv_start.notify_all ();
+
+    run_tasks (pool, func, arg, num_tasks);
+
+    /*
+     * wait until every worker has joined and left this job. otherwise a late
+     * worker could pick up the task counter of the next job with this func.
+     */
+    int num_workers = (int)pool->workers.size();
+    std::unique_lock<std::mutex> lock (pool->mtx);
+    pool->cv_done.wait (lock, [&] {
+        return pool->num_joined == num_workers && pool->num_busy == 0;
+    });
+}
@@ -0,0 +1,34 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_THREAD_POOL_H_
+#define _UTIL_THREAD_POOL_H_
+
+typedef struct _thread_pool_t thread_pool_t;
+
+/* called once for every task_id in [0, num_tasks) */
+typedef void (*thread_pool_func_t) (void *arg, int task_id);
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* num_threads <= 0 means std::thread::hardware_concurrency(). */
+thread_pool_t *thread_pool_create (int num_threads);
+void thread_pool_destroy (thread_pool_t *pool);
+int  thread_pool_get_num_threads (thread_pool_t *pool);
+
+/*
+ *  Run func for every task and return when all of them have finished.
+ *  The calling thread takes part in the work, so a pool of N threads
+ *  owns (N - 1) worker threads.
+ */
+void thread_pool_run (thread_pool_t *pool, thread_pool_func_t func, void *arg, int num_tasks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_THREAD_POOL_H_ */
@@ -0,0 +1,278 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include "util_topk.h"
+
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#define TOPK_USE_NEON
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#define TOPK_USE_SSE2
+#endif
+
+/*
+ *  The scores are scanned in blocks of 16 elements. The maximum of each
+ *  block is computed with SIMD and compared against the worst item of the
+ *  heap, so most blocks of a softmax output are rejected without touching
+ *  the heap at all.
+ */
+#define TOPK_BLOCK_LEN  16
+
+
+/* -------------------------------------------------- *
+ *  fixed-size min-heap (root is the worst item)
+ * -------------------------------------------------- */
+template <typename T>
+struct topk_heap_t
+{
+    int num;
+    int cap;
+    T   val[TOPK_MAX_NUM];
+    int id [TOPK_MAX_NUM];
+};
+
+/* item "a" ranks below item "b" (smaller score, or same score and later index) */
+template <typename T>
+static inline bool
+is_worse (T va, int ia, T vb, int ib)
+{
+    return (va < vb) || (va == vb && ia > ib);
+}
+
+template <typename T>
+static inline void
+heap_swap (topk_heap_t<T> *heap, int a, int b)
+{
+    T   v = heap->val[a]; heap->val[a] = heap->val[b]; heap->val[b] = v;
+    int i = heap->id [a]; heap->id [a] = heap->id [b]; heap->id [b] = i;
+}
+
+template <typename T>
+static void
+heap_sift_down (topk_heap_t<T> *heap, int pos)
+{
+    int num = heap->num;
+    for (;;)
+    {
+        int l = 2 * pos + 1;
+        int r = l + 1;
+        int worst = pos;
+
+        if (l < num && is_worse (heap->val[l], heap->id[l], heap->val[worst], heap->id[worst]))
+            worst = l;
+        if (r < num && is_worse (heap->val[r], heap->id[r], heap->val[worst], heap->id[worst]))
+            worst = r;
+        if (worst == pos)
+            return;
+
+        heap_swap (heap, pos, worst);
+        pos = worst;
+    }
+}
+
+template <typename T>
+static void
+heap_sift_up (topk_heap_t<T> *heap, int pos)
+{
+    while (pos > 0)
+    {
+        int parent = (pos - 1) / 2;
+        if (!is_worse (heap->val[pos], heap->id[pos], heap->val[parent], heap->id[parent]))
+            return;
+
+        heap_swap (heap, pos, parent);
+        pos = parent;
+    }
+}
+
+/* scores are pushed in ascending index order, so a tie never replaces the root. */
+template <typename T>
+static inline void
+heap_push (topk_heap_t<T> *heap, T val, int id)
+{
+    if (heap->num < heap->cap)
+    {
+        heap->val[heap->num] = val;
+        heap->id [heap->num] = id;
+        heap->num ++;
+        heap_sift_up (heap, heap->num - 1);
+        return;
+    }
+
+    if (val > heap->val[0])
+    {
+        heap->val[0] = val;
+        heap->id [0] = id;
+        heap_sift_down (heap, 0);
+    }
+}
+
+template <typename T>
+static inline void
+heap_push_range (topk_heap_t<T> *heap, const T *scores, int s, int e)
+{
+    for (int i = s; i < e; i ++)
+        heap_push (heap, scores[i], i);
+}
+
+/* sort the heap contents into descending order (k is small: insertion sort). */
+template <typename T>
+static void
+heap_sort_desc (topk_heap_t<T> *heap)
+{
+    for (int i = 1; i < heap->num; i ++)
+    {
+        T   v  = heap->val[i];
+        int id = heap->id [i];
+        int j  = i - 1;
+        while (j >= 0 && is_worse (heap->val[j], heap->id[j], v, id))
+        {
+            heap->val[j + 1] = heap->val[j];
+            heap->id [j + 1] = heap->id [j];
+            j --;
+        }
+        heap->val[j + 1] = v;
+        heap->id [j + 1] = id;
+    }
+}
+
+
+/* -------------------------------------------------- *
+ *  block maximum
+ * -------------------------------------------------- */
+static inline float
+block_max_float (const float *p)
+{
+#if defined (TOPK_USE_NEON) && defined (__aarch64__)
+    float32x4_t m0 = vmaxq_f32 (vld1q_f32 (p +  0), vld1q_f32 (p +  4));
+    float32x4_t m1 = vmaxq_f32 (vld1q_f32 (p +  8), vld1q_f32 (p + 12));
+    return vmaxvq_f32 (vmaxq_f32 (m0, m1));
+#elif defined (TOPK_USE_NEON)
+    float32x4_t m0 = vmaxq_f32 (vld1q_f32 (p +  0), vld1q_f32 (p +  4));
+    float32x4_t m1 = vmaxq_f32 (vld1q_f32 (p +  8), vld1q_f32 (p + 12));
+    float32x4_t m  = vmaxq_f32 (m0, m1);
+    float32x2_t m2 = vpmax_f32 (vget_low_f32 (m), vget_high_f32 (m));
+    m2 = vpmax_f32 (m2, m2);
+    return vget_lane_f32 (m2, 0);
+#elif defined (TOPK_USE_SSE2)
+    __m128 m0 = _mm_max_ps (_mm_loadu_ps (p +  0), _mm_loadu_ps (p +  4));
+    __m128 m1 = _mm_max_ps (_mm_loadu_ps (p +  8), _mm_loadu_ps (p + 12));
+    __m128 m  = _mm_max_ps (m0, m1);
+    m = _mm_max_ps (m, _mm_shuffle_ps (m, m, _MM_SHUFFLE (1, 0, 3, 2)));
+    m = _mm_max_ps (m, _mm_shuffle_ps (m, m, _MM_SHUFFLE (2, 3, 0, 1)));
+    return _mm_cvtss_f32 (m);
+#else
+    float m = p[0];
+    for (int i = 1; i < TOPK_BLOCK_LEN; i ++)
+        m = (p[i] > m) ? p[i] : m;
+    return m;
+#endif
+}
+
+static inline uint8_t
+block_max_uint8 (const uint8_t *p)
+{
+#if defined (TOPK_USE_NEON) && defined (__aarch64__)
+    return vmaxvq_u8 (vld1q_u8 (p));
+#elif defined (TOPK_USE_NEON)
+    uint8x16_t m  = vld1q_u8 (p);
+    uint8x8_t  m8 = vpmax_u8 (vget_low_u8 (m), vget_high_u8 (m));
+    m8 = vpmax_u8 (m8, m8);
+    m8 = vpmax_u8 (m8, m8);
+    m8 = vpmax_u8 (m8, m8);
+    return vget_lane_u8 (m8, 0);
+#elif defined (TOPK_USE_SSE2)
+    __m128i m = _mm_loadu_si128 ((const __m128i *)p);
+    m = _mm_max_epu8 (m, _mm_srli_si128 (m, 8));
+    m = _mm_max_epu8 (m, _mm_srli_si128 (m, 4));
+    m = _mm_max_epu8 (m, _mm_srli_si128 (m, 2));
+    m = _mm_max_epu8 (m, _mm_srli_si128 (m, 1));
+    return (uint8_t)_mm_cvtsi128_si32 (m);
+#else
+    uint8_t m = p[0];
+    for (int i = 1; i < TOPK_BLOCK_LEN; i ++)
+        m = (p[i] > m) ? p[i] : m;
+    return m;
+#endif
+}
+
+static inline float block_max (const float   *p) { return block_max_float (p); }
+static inline uint8_t block_max (const uint8_t *p) { return block_max_uint8 (p); }
+
+
+/* -------------------------------------------------- *
+ *  streaming scan
+ * -------------------------------------------------- */
+template <typename T>
+static void
+scan_topk (topk_heap_t<T> *heap, const T *scores, int num, int k)
+{
+    heap->num = 0;
+    heap->cap = k;
+
+    /* fill the heap with the first k items unconditionally */
+    int i = (k < num) ? k : num;
+    heap_push_range (heap, scores, 0, i);
+
+    for (; i + TOPK_BLOCK_LEN <= num; i += TOPK_BLOCK_LEN)
+    {
+        if (block_max (&scores[i]) > heap->val[0])
+            heap_push_range (heap, scores, i, i + TOPK_BLOCK_LEN);
+    }
+
+    heap_push_range (heap, scores, i, num);
+
+    heap_sort_desc (heap);
+}
+
+static int
+clamp_k (int num, int k)
+{
+    if (k > TOPK_MAX_NUM)
+        k = TOPK_MAX_NUM;
+    if (k > num)
+        k = num;
+    return k;
+}
+
+
+int
+topk_float (const float *scores, int num, int k, topk_item_t *items)
+{
+    topk_heap_t<float> heap;
+
+    k = clamp_k (num, k);
+    if (k <= 0)
+        return 0;
+
+    scan_topk (&heap, scores, num, k);
+
+    for (int i = 0; i < heap.num; i ++)
+    {
+        items[i].id    = heap.id [i];
+        items[i].score = heap.val[i];
+    }
+    return heap.num;
+}
+
+int
+topk_uint8 (const uint8_t *scores, int num, int k,
+            float quant_scale, int quant_zerop, topk_item_t *items)
+{
+    topk_heap_t<uint8_t> heap;
+
+    k = clamp_k (num, k);
+    if (k <= 0)
+        return 0;
+
+    scan_topk (&heap, scores, num, k);
+
+    for (int i = 0; i < heap.num; i ++)
+    {
+        items[i].id    = heap.id [i];
+        items[i].score = (heap.val[i] - quant_zerop) * quant_scale;
+    }
+    return heap.num;
+}
@@ -0,0 +1,37 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_TOPK_H_
+#define _UTIL_TOPK_H_
+
+#include <stdint.h>
+
+#define TOPK_MAX_NUM    32
+
+typedef struct _topk_item_t
+{
+    int     id;         /* index in the score tensor */
+    float   score;      /* dequantized score */
+} topk_item_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  Scan "num" scores in their native type and return the best "k" items
+ *  (k <= TOPK_MAX_NUM) sorted in descending order. Equal scores keep the
+ *  smaller index first. Only the winners are dequantized.
+ *  Returns the number of items written to "items".
+ */
+int topk_float (const float   *scores, int num, int k, topk_item_t *items);
+int topk_uint8 (const uint8_t *scores, int num, int k,
+                float quant_scale, int quant_zerop, topk_item_t *items);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UTIL_TOPK_H_ */
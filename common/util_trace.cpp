@@ -0,0 +1,206 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <atomic>
+#include <mutex>
+#include <cinttypes>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "util_trace.h"
+#include "util_pmeter.h"
+#include "util_debug.h"
+
+#define TRACE_MAX_THREADS   64
+
+typedef struct _trace_event_t
+{
+    std::atomic<uint64_t>   seq;        /* index + 1 once the event is complete. 0: empty */
+    std::atomic<const char *> name;     /* (relaxed atomics: a dump may race with a writer) */
+    std::atomic<double>     ts_ms;
+    std::atomic<int>        tid;
+    std::atomic<char>       ph;         /* 'B': begin, 'E': end */
+} trace_event_t;
+
+typedef struct _trace_thread_t
+{
+    int         tid;
+    const char  *name;
+} trace_thread_t;
+
+static trace_event_t        s_events[TRACE_MAX_EVENTS];
+static std::atomic<uint64_t> s_head;
+static std::atomic<int>     s_enabled;
+
+static trace_thread_t       s_threads[TRACE_MAX_THREADS];
+static int                  s_num_threads;
+static std::mutex           s_thread_mtx;
+
+static thread_local int     t_tid;
+
+
+static int
+get_tid (void)
+{
+    if (t_tid == 0)
+        t_tid = (int)syscall (SYS_gettid);
+    return t_tid;
+}
+
+void
+trace_enable (int enable)
+{
+    s_enabled.store (enable ? 1 : 0, std::memory_order_relaxed);
+}
+
+int
+trace_is_enabled (void)
+{
+    return s_enabled.load (std::memory_order_relaxed);
+}
+
+static void
+record_event (const char *name, char ph)
+{
+    if (!s_enabled.load (std::memory_order_relaxed))
+        return;
+
+    uint64_t idx = s_head.fetch_add (1, std::memory_order_relaxed);
+    trace_event_t *ev = &s_events[idx % TRACE_MAX_EVENTS];
+
+    /* invalidate the slot while it is rewritten, so a dump skips it */
+    ev->seq.store (0, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+    ev->name.store  (name,                 std::memory_order_relaxed);
+    ev->ts_ms.store (pmeter_get_time_ms (), std::memory_order_relaxed);
+    ev->tid.store   (get_tid (),           std::memory_order_relaxed);
+    ev->ph.store    (ph,                   std::memory_order_relaxed);
+    ev->seq.store (idx + 1, std::memory_order_release);
+}
+
+void
+trace_begin (const char *name)
+{
+    record_event (name, 'B');
+}
+
+void
+trace_end (const char *name)
+{
+    record_event (name, 'E');
+}
+
+void
+trace_set_thread_name (const char *name)
+{
+    std::lock_guard<std::mutex> lock (s_thread_mtx);
+    int tid = get_tid ();
+
+    for (int i = 0; i < s_num_threads; i ++)
+    {
+        if (s_threads[i].tid == tid)
+        {
+            s_threads[i].name = name;
+            return;
+        }
+    }
+
+    if (s_num_threads < TRACE_MAX_THREADS)
+    {
+        s_threads[s_num_threads].tid  = tid;
+        s_threads[s_num_threads].name = name;
+        s_num_threads ++;
+    }
+}
+
+void
+trace_clear (void)
+{
+    for (int i = 0; i < TRACE_MAX_EVENTS; i ++)
+        s_events[i].seq.store (0, std::memory_order_relaxed);
+    s_head.store (0, std::memory_order_relaxed);
+}
+
+
+/* -------------------------------------------------- *
+ *  Chrome trace event format (JSON)
+ * -------------------------------------------------- */
+static void
+print_json_string (FILE *fp, const char *str)
+{
+    fputc ('"', fp);
+    for (; *str; str ++)
+    {
+        if (*str == '"' || *str == '\\')
+            fputc ('\\', fp);
+        if ((unsigned char)*str >= 0x20)
+            fputc (*str, fp);
+    }
+    fputc ('"', fp);
+}
+
+int
+trace_dump_json (FILE *fp)
+{
+    uint64_t head  = s_head.load (std::memory_order_acquire);
+    uint64_t start = (head > TRACE_MAX_EVENTS) ? head - TRACE_MAX_EVENTS : 0;
+    int pid = (int)getpid ();
+    int num = 0;
+
+    fprintf (fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+    {
+        std::lock_guard<std::mutex> lock (s_thread_mtx);
+        for (int i = 0; i < s_num_threads; i ++)
+        {
+            fprintf (fp, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": ",
+                     num ++ ? ",\n" : "", pid, s_threads[i].tid);
+            print_json_string (fp, s_threads[i].name);
+            fprintf (fp, "}}");
+        }
+    }
+
+    for (uint64_t idx = start; idx < head; idx ++)
+    {
+        trace_event_t *ev = &s_events[idx % TRACE_MAX_EVENTS];
+        if (ev->seq.load (std::memory_order_acquire) != idx + 1)
+            continue;       /* being rewritten */
+
+        const char *name = ev->name.load (std::memory_order_relaxed);
+        double ts_us = ev->ts_ms.load (std::memory_order_relaxed) * 1000.0;
+        int    tid   = ev->tid.load (std::memory_order_relaxed);
+        char   ph    = ev->ph.load (std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if (ev->seq.load (std::memory_order_relaxed) != idx + 1)
+            continue;
+
+        fprintf (fp, "%s{\"ph\": \"%c\", \"ts\": %.1f, \"pid\": %d, \"tid\": %d",
+                 num ++ ? ",\n" : "", ph, ts_us, pid, tid);
+        if (name)
+        {
+            fprintf (fp, ", \"name\": ");
+            print_json_string (fp, name);
+        }
+        fprintf (fp, "}");
+    }
+
+    fprintf (fp, "\n]}\n");
+    return ferror (fp) ? -1 : 0;
+}
+
+int
+trace_dump_json_file (const char *fname)
+{
+    FILE *fp = fopen (fname, "w");
+    if (fp == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d): can't open %s\n", __FILE__, __LINE__, fname);
+        return -1;
+    }
+
+    int ret = trace_dump_json (fp);
+    fclose (fp);
+
+    DBG_LOG ("trace: %s\n", fname);
+    return ret;
+}
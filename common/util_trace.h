@@ -0,0 +1,66 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _UTIL_TRACE_H_
+#define _UTIL_TRACE_H_
+
+#include <stdio.h>
+
+#define TRACE_MAX_EVENTS    (1 << 16)   /* ring buffer. the oldest events are overwritten */
+
+/*
+ *  Lightweight event tracer.
+ *
+ *  Begin/end events are recorded with a timestamp and the thread id into a
+ *  lock-free ring buffer (a few atomics per event, nothing at all while
+ *  disabled), and dumped in the Chrome trace event format. Open the JSON
+ *  with chrome://tracing or https://ui.perfetto.dev to see every thread of
+ *  the frame pipeline on one timeline.
+ *
+ *  Event names are stored by pointer: pass string literals (or strings
+ *  which outlive the dump).
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void trace_enable (int enable);
+int  trace_is_enabled (void);
+
+void trace_begin (const char *name);
+void trace_end   (const char *name);    /* name may be NULL: closes the last begin of the thread */
+
+/* name of the calling thread in the trace (e.g. the pipeline stage) */
+void trace_set_thread_name (const char *name);
+
+void trace_clear (void);
+int  trace_dump_json (FILE *fp);
+int  trace_dump_json_file (const char *fname);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#define TRACE_BEGIN(name)   trace_begin (name)
+#define TRACE_END(name)     trace_end (name)
+
+#ifdef __cplusplus
+/* traces the enclosing scope */
+class trace_scope_t
+{
+public:
+    explicit trace_scope_t (const char *name) : m_name (name) { trace_begin (name); }
+    ~trace_scope_t () { trace_end (m_name); }
+private:
+    const char *m_name;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b)  TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name)   trace_scope_t TRACE_CONCAT(trace_scope_, __LINE__) (name)
+#endif
+
+#endif /* _UTIL_TRACE_H_ */
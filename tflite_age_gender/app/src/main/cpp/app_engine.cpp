@@ -10,6 +10,7 @@
 #include "util_pmeter.h"
 #include "util_texture.h"
 #include "util_render2d.h"
+#include "util_graph.h"
 #include "app_engine.h"
 #include "render_imgui.h"
 #include "assertgl.h"
@@ -21,27 +22,27 @@
 #define CAMERA_CROP_WIDTH       480 /* make a src image square */
 #define CAMERA_CROP_HEIGHT      480 /* make a src image square */
 
+#define FRAME_SKIP_THRESH       8.0f    /* luma difference of a grid cell to run the models again */
 
-/* resize image to DNN network input size and convert to fp32. */
-void
-feed_face_detect_image(texture_2d_t *srctex, int win_w, int win_h)
-{
-    int x, y, w, h;
-    float *buf_fp32 = (float *)get_face_detect_input_buf (&w, &h);
-    unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
 
-    if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
-
-    buf_ui8 = pui8;
-
-    draw_2d_texture_ex (srctex, 0, win_h - h, w, h, RENDER2D_FLIP_V);
+/* --------------------------------------------------------------------------- *
+ *  pipeline graph:  face_detect --> age_gender (one ROI per face)
+ *  the graph crops the input images on the GL thread into rgba[].
+ * --------------------------------------------------------------------------- */
+static graph_t *s_graph;
+static int      s_node_facedet;
+static int      s_node_agegend;
 
-    glPixelStorei (GL_PACK_ALIGNMENT, 4);
-    glReadPixels (0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, buf_ui8);
+/* convert UI8 [0, 255] ==> FP32 [-1, 1] and detect faces. */
+static void
+run_face_detect (void *ctx, int num_rois, uint8_t * const *rgba, int w, int h, void *results)
+{
+    float *buf_fp32 = (float *)get_face_detect_input_buf (&w, &h);
+    const unsigned char *buf_ui8 = rgba[0];
+    int x, y;
+    UNUSED (ctx);
+    UNUSED (num_rois);
 
-    /* convert UI8 [0, 255] ==> FP32 [-1, 1] */
     float mean = 128.0f;
     float std  = 128.0f;
     for (y = 0; y < h; y ++)
@@ -58,50 +59,39 @@ feed_face_detect_image(texture_2d_t *srctex, int win_w, int win_h)
         }
     }
 
-    return;
+    invoke_face_detect ((face_detect_result_t *)results);
 }
 
-void
-feed_age_gender_image(texture_2d_t *srctex, int win_w, int win_h, face_detect_result_t *detection, unsigned int face_id)
+/* one ROI per detected face */
+static int
+gen_face_rois (void *ctx, const graph_roi_t *parent_roi, const void *parent_result, graph_roi_t *rois, int max_rois)
 {
-    int x, y, w, h;
-    float *buf_fp32 = (float *)get_age_gender_input_buf (&w, &h);
-    unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
-    if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
-
-    buf_ui8 = pui8;
+    const face_detect_result_t *detection = (const face_detect_result_t *)parent_result;
+    int num = detection->num < max_rois ? detection->num : max_rois;
+    UNUSED (ctx);
+    UNUSED (parent_roi);    /* the detector ran on the whole frame */
 
-    float texcoord[] = { 0.0f, 1.0f,
-                         0.0f, 0.0f,
-                         1.0f, 1.0f,
-                         1.0f, 0.0f };
-
-    if (detection->num > face_id)
+    for (int i = 0; i < num; i ++)
     {
-        face_t *face = &(detection->faces[face_id]);
-        float x0 = face->face_pos[0].x;
-        float y0 = face->face_pos[0].y;
-        float x1 = face->face_pos[1].x; //    0--------1
-        float y1 = face->face_pos[1].y; //    |        |
-        float x2 = face->face_pos[2].x; //    |        |
-        float y2 = face->face_pos[2].y; //    3--------2
-        float x3 = face->face_pos[3].x;
-        float y3 = face->face_pos[3].y;
-        texcoord[0] = x3;   texcoord[1] = y3;
-        texcoord[2] = x0;   texcoord[3] = y0;
-        texcoord[4] = x2;   texcoord[5] = y2;
-        texcoord[6] = x1;   texcoord[7] = y1;
+        const face_t *face = &detection->faces[i];
+        for (int j = 0; j < 4; j ++)
+        {
+            rois[i].pos[j][0] = face->face_pos[j].x;
+            rois[i].pos[j][1] = face->face_pos[j].y;
+        }
     }
+    return num;
+}
 
-    draw_2d_texture_ex_texcoord (srctex, 0, win_h - h, w, h, texcoord);
-
-    glPixelStorei (GL_PACK_ALIGNMENT, 4);
-    glReadPixels (0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, buf_ui8);
+/* convert UI8 [0, 255] ==> FP32 [0, 255] */
+static void
+convert_age_gender_input (void *arg, int face_id, void *input_buf, int w, int h)
+{
+    uint8_t * const *rgba = (uint8_t * const *)arg;
+    const unsigned char *buf_ui8 = rgba[face_id];
+    float *buf_fp32 = (float *)input_buf;
+    int x, y;
 
-    /* convert UI8 [0, 255] ==> FP32 [0, 255] */
     float mean = 0.0f;
     float std  = 1.0f;
     for (y = 0; y < h; y ++)
@@ -121,10 +111,53 @@ feed_age_gender_image(texture_2d_t *srctex, int win_w, int win_h, face_detect_re
     return;
 }
 
+/* every face in parallel on the interpreter pool */
+static void
+run_age_gender (void *ctx, int num_rois, uint8_t * const *rgba, int w, int h, void *results)
+{
+    UNUSED (ctx);
+    UNUSED (w);
+    UNUSED (h);
+
+    invoke_age_gender (num_rois, convert_age_gender_input, (void *)rgba,
+                       (age_gender_result_t *)results);
+}
+
+static int
+create_graph (void)
+{
+    int facedet_w, facedet_h, agegend_w, agegend_h;
+    get_face_detect_input_buf (&facedet_w, &facedet_h);
+    get_age_gender_input_size (&agegend_w, &agegend_h);
+
+    graph_node_desc_t nodes[] = {
+        /* name          parent         crop size               max_rois      result_size */
+        {"face_detect",  NULL,          facedet_w, facedet_h,   1,            sizeof (face_detect_result_t),
+         NULL,           run_face_detect, NULL},
+        {"age_gender",   "face_detect", agegend_w, agegend_h,   MAX_FACE_NUM, sizeof (age_gender_result_t),
+         gen_face_rois,  run_age_gender,  NULL},
+    };
+
+    s_graph = graph_create (nodes, sizeof (nodes) / sizeof (nodes[0]));
+    if (s_graph == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    /* an unchanged frame (e.g. the static image) keeps the last results */
+    graph_set_skip_threshold (s_graph, FRAME_SKIP_THRESH);
+    graph_set_gl_thread_only (s_graph, get_age_gender_invoke_on_gl_thread ());
+
+    s_node_facedet = graph_find_node (s_graph, "face_detect");
+    s_node_agegend = graph_find_node (s_graph, "age_gender");
+    return 0;
+}
+
 
 static void
 render_detect_region (int ofstx, int ofsty, int texw, int texh,
-                      face_detect_result_t *detection, age_gender_result_t *age_genders)
+                      const face_detect_result_t *detection, const age_gender_result_t *age_genders)
 {
     float col_red[]   = {1.0f, 0.0f, 0.0f, 1.0f};
     float col_blue[]  = {0.0f, 0.0f, 1.0f, 1.0f};
@@ -133,14 +166,14 @@ render_detect_region (int ofstx, int ofsty, int texw, int texh,
 
     for (int i = 0; i < detection->num; i ++)
     {
-        face_t *face = &(detection->faces[i]);
+        const face_t *face = &(detection->faces[i]);
         float x1 = face->topleft.x  * texw + ofstx;
         float y1 = face->topleft.y  * texh + ofsty;
         float x2 = face->btmright.x * texw + ofstx;
         float y2 = face->btmright.y * texh + ofsty;
         char buf[512];
 
-        age_gender_result_t *age_gender = &age_genders[i];
+        const age_gender_result_t *age_gender = &age_genders[i];
         int age = age_gender->age.age;
         if (age_gender->gender.score_m > age_gender->gender.score_f)
         {
@@ -182,14 +215,14 @@ render_detect_region (int ofstx, int ofsty, int texw, int texh,
 
 static void
 render_cropped_face_image (texture_2d_t *srctex, int ofstx, int ofsty, int texw, int texh,
-                           face_detect_result_t *detection, unsigned int face_id)
+                           const face_detect_result_t *detection, int face_id)
 {
     float texcoord[8];
 
     if (detection->num <= face_id)
         return;
 
-    face_t *face = &(detection->faces[face_id]);
+    const face_t *face = &(detection->faces[face_id]);
     float x0 = face->face_pos[0].x;
     float y0 = face->face_pos[0].y;
     float x1 = face->face_pos[1].x; //    0--------1
@@ -309,7 +342,7 @@ AppEngine::RenderFrame ()
     texture_2d_t srctex = glctx.tex_input;
     int win_w  = glctx.disp_w;
     int win_h  = glctx.disp_h;
-    static double ttime[10] = {0}, interval, invoke_ms0 = 0, invoke_ms1 = 0;
+    static double ttime[10] = {0}, interval, crop_ms, invoke_ms0 = 0, invoke_ms1 = 0;
 
     int draw_x, draw_y, draw_w, draw_h;
     int texw = srctex.width;
@@ -323,8 +356,8 @@ AppEngine::RenderFrame ()
      * --------------------------------------- */
     int count = glctx.frame_count;
     {
-        face_detect_result_t face_detect_ret = {0};
-        age_gender_result_t  age_gender_ret[MAX_FACE_NUM] = {};
+        const face_detect_result_t *face_detect_ret;
+        const age_gender_result_t  *age_gender_ret;
         char strbuf[512];
 
         PMETER_RESET_LAP ();
@@ -337,39 +370,27 @@ AppEngine::RenderFrame ()
         glClear (GL_COLOR_BUFFER_BIT);
 
         /* --------------------------------------- *
-         *  face detection
-         * --------------------------------------- */
-        feed_face_detect_image (&srctex, win_w, win_h);
-
-        ttime[2] = pmeter_get_time_ms ();
-        invoke_face_detect (&face_detect_ret);
-        ttime[3] = pmeter_get_time_ms ();
-        invoke_ms0 = ttime[3] - ttime[2];
-
-        /* --------------------------------------- *
-         *  Age Gender estimation
+         *  face detection --> Age Gender estimation
          * --------------------------------------- */
-        invoke_ms1 = 0;
-        for (int face_id = 0; face_id < face_detect_ret.num; face_id ++)
-        {
-            feed_age_gender_image (&srctex, win_w, win_h, &face_detect_ret, face_id);
+        int skipped = graph_run (s_graph, &srctex, win_w, win_h);
 
-            ttime[4] = pmeter_get_time_ms ();
-            invoke_age_gender (&age_gender_ret[face_id]);
-            ttime[5] = pmeter_get_time_ms ();
-            invoke_ms1 += ttime[5] - ttime[4];
-        }
+        graph_get_results (s_graph, s_node_facedet, NULL, (const void **)&face_detect_ret);
+        graph_get_results (s_graph, s_node_agegend, NULL, (const void **)&age_gender_ret);
+        double crop_ms0, crop_ms1;
+        graph_get_node_time (s_graph, s_node_facedet, &crop_ms0, &invoke_ms0);
+        graph_get_node_time (s_graph, s_node_agegend, &crop_ms1, &invoke_ms1);
+        crop_ms = crop_ms0 + crop_ms1;
 
         /* --------------------------------------- *
          *  render scene
          * --------------------------------------- */
         glClear (GL_COLOR_BUFFER_BIT);
         draw_2d_texture_ex (&srctex, draw_x, draw_y, draw_w, draw_h, 0);
-        render_detect_region (draw_x, draw_y, draw_w, draw_h, &face_detect_ret, age_gender_ret);
+        render_detect_region (draw_x, draw_y, draw_w, draw_h, face_detect_ret, age_gender_ret);
 
         /* visualize the segmentation results. */
         /* draw cropped image of the face area */
-        for (int face_id = 0; face_id < face_detect_ret.num; face_id ++)
+        for (int face_id = 0; face_id < face_detect_ret->num; face_id ++)
         {
             float w = 100;
             float h = 100;
@@ -377,7 +398,7 @@ AppEngine::RenderFrame ()
             float y = h * face_id + 10;
             float col_white[] = {1.0f, 1.0f, 1.0f, 1.0f};
 
-            render_cropped_face_image (&srctex, x, y, w, h, &face_detect_ret, face_id);
+            render_cropped_face_image (&srctex, x, y, w, h, face_detect_ret, face_id);
             draw_2d_rect (x, y, w, h, col_white, 2.0f);
         }
 
@@ -388,8 +409,8 @@ AppEngine::RenderFrame ()
 
         draw_pmeter (0, 40);
 
-        sprintf (strbuf, "Interval:%5.1f [ms]\nTFLite0 :%5.1f [ms]\nTFLite1 :%5.1f [ms]",
-            interval, invoke_ms0, invoke_ms1);
+        sprintf (strbuf, "Interval:%5.1f [ms]\nCrop    :%5.1f [ms]\nTFLite0 :%5.1f [ms]%s\nTFLite1 :%5.1f [ms]",
+            interval, crop_ms, invoke_ms0, (skipped == 1) ? " (skip)" : "", invoke_ms1);
         draw_dbgstr (strbuf, 10, 10);
 
         /* renderer info */
@@ -487,6 +508,9 @@ AppEngine::InitGLES (void)
         (const char *)m_facedet_tflite_model_buf.data(), m_facedet_tflite_model_buf.size(),
         (const char *)m_agegend_tflite_model_buf.data(), m_agegend_tflite_model_buf.size());
 
+    /* crop sizes come from the loaded models */
+    create_graph ();
+
     setup_imgui (w, h, &imgui_data);
 
     glctx.disp_w = w;
@@ -510,6 +534,11 @@ AppEngine::InitGLES (void)
 void
 AppEngine::TerminateGLES (void)
 {
+    graph_destroy (s_graph);
+    s_graph = NULL;
+
+    /* pooled texture names belong to this context */
+    texture_pool_destroy ();
     egl_terminate ();
 }
 
@@ -82,8 +82,16 @@ int init_tflite_age_gender (const char *face_detect_model_buf, size_t face_detec
 void *get_face_detect_input_buf (int *w, int *h);
 int  invoke_face_detect (face_detect_result_t *facedet_result);
 
-void  *get_age_gender_input_buf (int *w, int *h);
-int invoke_age_gender (age_gender_result_t *age_gender_result);
+/*
+ *  fill the input tensor (FP32, h x w x RGB) with the image of face_id.
+ *  called from the worker threads of the interpreter pool.
+ */
+typedef void (*age_gender_feed_func_t) (void *arg, int face_id, void *input_buf, int w, int h);
+
+void get_age_gender_input_size (int *w, int *h);
+int  get_age_gender_invoke_on_gl_thread ();
+int  invoke_age_gender (int num_faces, age_gender_feed_func_t feed, void *feed_arg,
+                        age_gender_result_t *age_gender_result);
 
 #ifdef __cplusplus
 }
@@ -10,6 +10,7 @@
 #include "util_pmeter.h"
 #include "util_texture.h"
 #include "util_render2d.h"
+#include "util_tensor_tex.h"
 #include "app_engine.h"
 #include "render_imgui.h"
 #include "assertgl.h"
@@ -29,10 +30,9 @@ feed_tflite_image (texture_2d_t *srctex, int win_w, int win_h)
     int x, y, w, h;
     float *buf_fp32 = (float *)get_animegan2_input_buf (&w, &h);
     unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
+    unsigned char *pui8 = (unsigned char *)texture_pool_acquire_buffer (w * h * 4);
     if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
+        return;
 
     buf_ui8 = pui8;
 
@@ -58,53 +58,25 @@ feed_tflite_image (texture_2d_t *srctex, int win_w, int win_h)
         }
     }
 
+    texture_pool_release_buffer (pui8);
     return;
 }
 
-static float
-clamp (float s)
-{
-    s = fmax (s, 0.0f);
-    s = fmin (s, 1.0f);
-    return s;
-}
-
 /* upload style transfered image to OpenGLES texture */
 static int
 update_style_transfered_texture (animegan2_t *transfer)
 {
-    static int s_texid = 0;
-    static uint8_t *s_texbuf = NULL;
-    int img_w = transfer->w;
-    int img_h = transfer->h;
+    static tensor_tex_t s_tensor_tex;
 
-    if (s_texid == 0)
+    if (s_tensor_tex.rgba == NULL)
     {
-        s_texbuf = (uint8_t *)calloc (1, img_w * img_h * 4);
-        s_texid  = create_2d_texture (s_texbuf, img_w, img_h);
-    }
-
-    uint8_t *d = s_texbuf;
-    float   *s = (float *)transfer->param;
-
-    for (int y = 0; y < img_h; y ++)
-    {
-        for (int x = 0; x < img_w; x ++)
-        {
-            float r = *s ++;
-            float g = *s ++;
-            float b = *s ++;
-            *d ++ = (uint8_t)(clamp(r) * 255);
-            *d ++ = (uint8_t)(clamp(g) * 255);
-            *d ++ = (uint8_t)(clamp(b) * 255);
-            *d ++ = 0xFF;
-        }
+        /* RGB [0, 1] */
+        tensor_tex_init (&s_tensor_tex, transfer->w, transfer->h, 3, 0);
     }
 
-    glBindTexture (GL_TEXTURE_2D, s_texid);
-    glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, img_w, img_h, GL_RGBA, GL_UNSIGNED_BYTE, s_texbuf);
+    tensor_tex_update_float (&s_tensor_tex, (float *)transfer->param);
 
-    return s_texid;
+    return s_tensor_tex.tex.texid;
 }
 
 void
@@ -379,6 +351,8 @@ AppEngine::InitGLES (void)
 void
 AppEngine::TerminateGLES (void)
 {
+    /* pooled texture names belong to this context */
+    texture_pool_destroy ();
     egl_terminate ();
 }
 
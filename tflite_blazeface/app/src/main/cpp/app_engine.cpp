@@ -8,10 +8,14 @@
 #include "util_egl.h"
 #include "util_debugstr.h"
 #include "util_pmeter.h"
+#include "util_alloc_audit.h"
 #include "util_texture.h"
 #include "util_render2d.h"
+#include "util_pipeline.h"
+#include "util_trace.h"
 #include "app_engine.h"
 #include "render_imgui.h"
+#include "blazeface_feed.h"
 #include "assertgl.h"
 
 #define UNUSED(x) (void)(x)
@@ -21,45 +25,111 @@
 #define CAMERA_CROP_WIDTH       480 /* make a src image square */
 #define CAMERA_CROP_HEIGHT      480 /* make a src image square */
 
+/*
+ *  run preprocess (and inference on the CPU) on their own threads.
+ *  with the GPU delegate the inference stays on the GL thread.
+ */
+#define USE_FRAME_PIPELINE
+#define PIPELINE_NUM_SLOTS      4
+#define PIPELINE_LATENCY_BUDGET 100.0   /* [ms] capture to result. older frames are dropped */
+
+
+#if defined (USE_FRAME_PIPELINE)
+/* -------------------------------------------------- *
+ *  frame pipeline:
+ *    CPU: [capture (GL)] -> preprocess -> inference -> [render (GL)]
+ *    GPU: [capture (GL)] -> preprocess -> [inference, render (GL)]
+ * -------------------------------------------------- */
+typedef struct _face_frame_t
+{
+    int                 w, h;
+    unsigned char       *rgba;          /* captured image   */
+    float               *input;         /* preprocessed     */
+    blazeface_config_t  config;
+    blazeface_result_t  result;
+    double              invoke_ms;
+} face_frame_t;
 
-/* resize image to DNN network input size and convert to fp32. */
-void
-feed_blazeface_image(texture_2d_t *srctex, int win_w, int win_h)
+static face_frame_t     s_face_frames[PIPELINE_NUM_SLOTS];
+static pipeline_t       *s_face_pipeline;
+
+static void
+preprocess_stage (void *ctx, pipeline_frame_t *frame)
+{
+    face_frame_t *f = (face_frame_t *)frame->data;
+    TRACE_SCOPE ("feed_blazeface");
+    convert_blazeface_input (f->rgba, f->input, f->w, f->h);
+}
+
+static void
+inference_stage (void *ctx, pipeline_frame_t *frame)
 {
-    int x, y, w, h;
+    face_frame_t *f = (face_frame_t *)frame->data;
+    int w, h;
     float *buf_fp32 = (float *)get_blazeface_input_buf (&w, &h);
-    unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
 
-    if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
+    memcpy (buf_fp32, f->input, w * h * 3 * sizeof (float));
 
-    buf_ui8 = pui8;
+    double ttime0 = pmeter_get_time_ms ();
+    invoke_blazeface (&f->result, &f->config);
+    f->invoke_ms = pmeter_get_time_ms () - ttime0;
+}
 
-    draw_2d_texture_ex (srctex, 0, win_h - h, w, h, RENDER2D_FLIP_V);
+static void
+destroy_face_pipeline ()
+{
+    pipeline_destroy (s_face_pipeline);
+    s_face_pipeline = NULL;
 
-    glPixelStorei (GL_PACK_ALIGNMENT, 4);
-    glReadPixels (0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, buf_ui8);
+    for (int i = 0; i < PIPELINE_NUM_SLOTS; i ++)
+    {
+        face_frame_t *f = &s_face_frames[i];
+        free (f->rgba);
+        free (f->input);
+        f->rgba  = NULL;
+        f->input = NULL;
+    }
+}
 
-    /* convert UI8 [0, 255] ==> FP32 [-1, 1] */
-    float mean = 128.0f;
-    float std  = 128.0f;
-    for (y = 0; y < h; y ++)
+static int
+init_face_pipeline ()
+{
+    void *slot_data[PIPELINE_NUM_SLOTS];
+    int w, h;
+
+    get_blazeface_input_buf (&w, &h);
+    for (int i = 0; i < PIPELINE_NUM_SLOTS; i ++)
     {
-        for (x = 0; x < w; x ++)
+        face_frame_t *f = &s_face_frames[i];
+        f->w     = w;
+        f->h     = h;
+        f->rgba  = (unsigned char *)malloc (w * h * 4);
+        f->input = (float *)malloc (w * h * 3 * sizeof (float));
+        if (f->rgba == NULL || f->input == NULL)
         {
-            int r = *buf_ui8 ++;
-            int g = *buf_ui8 ++;
-            int b = *buf_ui8 ++;
-            buf_ui8 ++;          /* skip alpha */
-            *buf_fp32 ++ = (float)(r - mean) / std;
-            *buf_fp32 ++ = (float)(g - mean) / std;
-            *buf_fp32 ++ = (float)(b - mean) / std;
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            destroy_face_pipeline ();
+            return -1;
         }
+        slot_data[i] = f;
     }
 
-    return;
+    s_face_pipeline = pipeline_create (slot_data, PIPELINE_NUM_SLOTS);
+    if (s_face_pipeline == NULL)
+    {
+        destroy_face_pipeline ();
+        return -1;
+    }
+
+    pipeline_add_stage (s_face_pipeline, "preprocess", preprocess_stage, NULL);
+    if (!get_blazeface_invoke_on_gl_thread ())
+        pipeline_add_stage (s_face_pipeline, "inference",  inference_stage,  NULL);
+    pipeline_set_latency_budget (s_face_pipeline, PIPELINE_LATENCY_BUDGET);
+    pipeline_start (s_face_pipeline);
+
+    return 0;
 }
+#endif
 
 
 static void
@@ -225,6 +295,7 @@ AppEngine::RenderFrame ()
 
         PMETER_RESET_LAP ();
         PMETER_SET_LAP ();
+        alloc_audit_frame_begin ();
 
         ttime[1] = pmeter_get_time_ms ();
         interval = (count > 0) ? ttime[1] - ttime[0] : 0;
@@ -235,16 +306,59 @@ AppEngine::RenderFrame ()
         /* --------------------------------------- *
          *  face detection
          * --------------------------------------- */
+#if defined (USE_FRAME_PIPELINE)
+        static blazeface_result_t s_face_ret = {0};
+
+        if (s_face_pipeline == NULL && init_face_pipeline () < 0)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            return;
+        }
+
+        /* capture: skipped when every slot is in flight */
+        pipeline_frame_t *frame = pipeline_acquire (s_face_pipeline);
+        if (frame)
+        {
+            face_frame_t *f = (face_frame_t *)frame->data;
+            TRACE_BEGIN ("readback");
+            readback_blazeface_image (&srctex, win_w, win_h, f->w, f->h, f->rgba);
+            TRACE_END ("readback");
+            f->config = imgui_data.blazeface_config;
+
+            double capture_ms = glctx.tex_camera_valid ? m_ImgReader.GetCaptureTimeMs () : pmeter_get_time_ms ();
+            pipeline_submit_at (s_face_pipeline, frame, capture_ms);
+        }
+
+        /* pick up the newest result, keep the previous one otherwise */
+        pipeline_frame_t *done = pipeline_fetch_latest (s_face_pipeline);
+        if (done)
+        {
+            face_frame_t *f = (face_frame_t *)done->data;
+            if (get_blazeface_invoke_on_gl_thread ())
+            {
+                TRACE_SCOPE ("inference");
+                inference_stage (NULL, done);
+            }
+            s_face_ret = f->result;
+            invoke_ms  = f->invoke_ms;
+            pipeline_release (s_face_pipeline, done);
+        }
+        face_ret = s_face_ret;
+#else
+        TRACE_BEGIN ("feed_blazeface");
         feed_blazeface_image (&srctex, win_w, win_h);
+        TRACE_END ("feed_blazeface");
 
         ttime[2] = pmeter_get_time_ms ();
         invoke_blazeface (&face_ret, &imgui_data.blazeface_config);
         ttime[3] = pmeter_get_time_ms ();
         invoke_ms = ttime[3] - ttime[2];
+#endif
 
         /* --------------------------------------- *
          *  render scene
          * --------------------------------------- */
+        TRACE_BEGIN ("render");
         glClear (GL_COLOR_BUFFER_BIT);
 
         /* visualize the face detection results. */
@@ -261,6 +375,16 @@ AppEngine::RenderFrame ()
         sprintf (strbuf, "Interval:%5.1f [ms]\nTFLite  :%5.1f [ms]", interval, invoke_ms);
         draw_dbgstr (strbuf, 10, 10);
 
+#if defined (USE_FRAME_PIPELINE)
+        /* capture-to-result latency */
+        pipeline_stats_t stats;
+        pipeline_get_stats (s_face_pipeline, &stats);
+        sprintf (strbuf, "Latency :%5.1f [ms] (p50:%3.0f p95:%3.0f p99:%3.0f)\nDropped :%5llu/%llu",
+                 stats.latency_mean, stats.latency_p50, stats.latency_p95, stats.latency_p99,
+                 (unsigned long long)stats.num_dropped, (unsigned long long)stats.num_submitted);
+        draw_dbgstr (strbuf, 10, 10 + 22 * 2);
+#endif
+
         /* renderer info */
         int y = win_h - 22 * 3;
         draw_dbgstr (glctx.str_glverstion, 10, y); y += 22;
@@ -270,7 +394,16 @@ AppEngine::RenderFrame ()
 #if defined (USE_IMGUI)
         invoke_imgui (&imgui_data);
 #endif
+        TRACE_END ("render");
+
+        TRACE_BEGIN ("swap");
         egl_swap();
+        TRACE_END ("swap");
+
+        /* the steady state must not allocate (USE_ALLOC_AUDIT) */
+        alloc_audit_frame_end ("blazeface");
+
+        UpdateTrace ();
     }
     glctx.frame_count ++;
 }
@@ -369,13 +502,48 @@ AppEngine::InitGLES (void)
     glctx.tex_input.height = glctx.rtarget_crop.height;
     glctx.tex_input.format = pixfmt_fourcc('R', 'G', 'B', 'A');
 
+    trace_set_thread_name ("GL");
+
     glctx.initdone = 1;
 }
 
 
+/* ---------------------------------------------------------------------------- *
+ *  Chrome trace: saved into the external files dir of the app
+ *    (adb pull /sdcard/Android/data/<package>/files/trace.json)
+ * ---------------------------------------------------------------------------- */
+void
+AppEngine::UpdateTrace (void)
+{
+    if (trace_is_enabled () != imgui_data.trace_enable)
+    {
+        if (imgui_data.trace_enable)
+            trace_clear ();
+        trace_enable (imgui_data.trace_enable);
+    }
+
+    if (imgui_data.trace_save)
+    {
+        char fname[512];
+        const char *dir = m_app->activity->externalDataPath;
+        if (dir == NULL)
+            dir = m_app->activity->internalDataPath;
+
+        snprintf (fname, sizeof (fname), "%s/trace.json", dir);
+        trace_dump_json_file (fname);
+        imgui_data.trace_save = 0;
+    }
+}
+
+
 void
 AppEngine::TerminateGLES (void)
 {
+#if defined (USE_FRAME_PIPELINE)
+    destroy_face_pipeline ();
+#endif
+    /* pooled texture names belong to this context */
+    texture_pool_destroy ();
     egl_terminate ();
 }
 
@@ -394,13 +562,17 @@ AppEngine::UpdateFrame (void)
             DeleteCamera ();
             CreateCamera (m_camera_facing);
         }
+        TRACE_BEGIN ("UpdateCameraTexture");
         UpdateCameraTexture();
+        TRACE_END ("UpdateCameraTexture");
     }
 
     if (m_cameraGranted && glctx.tex_camera_valid == false)
         return;
 
+    TRACE_BEGIN ("CropCameraTexture");
     CropCameraTexture ();
+    TRACE_END ("CropCameraTexture");
 
     RenderFrame();
 }
@@ -74,6 +74,7 @@ public:
     void RenderFrame (void);
 
     void DrawTFLiteConfigInfo ();
+    void UpdateTrace (void);
 
     // IMGUI
     void setup_imgui (int win_w, int win_h, imgui_data_t *imgui_data);
@@ -0,0 +1,56 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <GLES2/gl2.h>
+#include "util_render2d.h"
+#include "tflite_blazeface.h"
+#include "blazeface_feed.h"
+
+/* convert UI8 [0, 255] ==> FP32 [-1, 1] */
+void
+convert_blazeface_input (unsigned char *buf_ui8, float *buf_fp32, int w, int h)
+{
+    float mean = 128.0f;
+    float std  = 128.0f;
+    for (int y = 0; y < h; y ++)
+    {
+        for (int x = 0; x < w; x ++)
+        {
+            int r = *buf_ui8 ++;
+            int g = *buf_ui8 ++;
+            int b = *buf_ui8 ++;
+            buf_ui8 ++;          /* skip alpha */
+            *buf_fp32 ++ = (float)(r - mean) / std;
+            *buf_fp32 ++ = (float)(g - mean) / std;
+            *buf_fp32 ++ = (float)(b - mean) / std;
+        }
+    }
+}
+
+/* resize image to DNN network input size and read it back. */
+void
+readback_blazeface_image (texture_2d_t *srctex, int win_w, int win_h, int w, int h, unsigned char *buf_ui8)
+{
+    draw_2d_texture_ex (srctex, 0, win_h - h, w, h, RENDER2D_FLIP_V);
+
+    glPixelStorei (GL_PACK_ALIGNMENT, 4);
+    glReadPixels (0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, buf_ui8);
+}
+
+/* resize image to DNN network input size and convert to fp32. */
+void
+feed_blazeface_image (texture_2d_t *srctex, int win_w, int win_h)
+{
+    int w, h;
+    float *buf_fp32 = (float *)get_blazeface_input_buf (&w, &h);
+    unsigned char *pui8 = (unsigned char *)texture_pool_acquire_buffer (w * h * 4);
+    if (pui8 == NULL)
+        return;
+
+    readback_blazeface_image (srctex, win_w, win_h, w, h, pui8);
+    convert_blazeface_input (pui8, buf_fp32, w, h);
+
+    texture_pool_release_buffer (pui8);
+    return;
+}
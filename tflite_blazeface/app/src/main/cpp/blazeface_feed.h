@@ -0,0 +1,31 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef BLAZEFACE_FEED_H_
+#define BLAZEFACE_FEED_H_
+
+#include "util_texture.h"
+
+/*
+ *  input side of the face detection, shared by the app and
+ *  tools/pipeline_golden so that the golden check runs the app's own feed.
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* convert UI8 [0, 255] ==> FP32 [-1, 1] */
+void convert_blazeface_input (unsigned char *buf_ui8, float *buf_fp32, int w, int h);
+
+/* resize image to DNN network input size and read it back (GL thread). */
+void readback_blazeface_image (texture_2d_t *srctex, int win_w, int win_h, int w, int h, unsigned char *buf_ui8);
+
+/* resize image to DNN network input size and convert to fp32. */
+void feed_blazeface_image (texture_2d_t *srctex, int win_w, int win_h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLAZEFACE_FEED_H_ */
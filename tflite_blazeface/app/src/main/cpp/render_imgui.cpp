@@ -121,6 +121,16 @@ render_gui (imgui_data_t *imgui_data)
         imgui_data->frame_color[2] = frame_color.z;
         imgui_data->frame_color[3] = frame_color.w;
 
+        /* Chrome trace (chrome://tracing, ui.perfetto.dev) */
+        bool trace_enable = imgui_data->trace_enable;
+        ImGui::Checkbox ("Trace", &trace_enable);
+        imgui_data->trace_enable = trace_enable;
+        ImGui::SameLine ();
+        if (ImGui::Button ("Save trace"))
+        {
+            imgui_data->trace_save = 1;
+        }
+
         s_win_pos [s_win_num] = ImGui::GetWindowPos  ();
         s_win_size[s_win_num] = ImGui::GetWindowSize ();
         s_win_num ++;
@@ -16,6 +16,8 @@ typedef struct _imgui_data_t
     blazeface_config_t blazeface_config;
     int     camera_facing;
     float   frame_color[4];
+    int     trace_enable;
+    int     trace_save;     /* set by the button, cleared by the app */
 } imgui_data_t;
 
 int  init_imgui (int width, int height);
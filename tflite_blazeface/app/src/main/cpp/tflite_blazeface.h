@@ -52,6 +52,7 @@ typedef struct _blazeface_config_t
 
 int init_tflite_blazeface (const char *model_buf, size_t model_size, blazeface_config_t *config);
 void  *get_blazeface_input_buf (int *w, int *h);
+int   get_blazeface_invoke_on_gl_thread ();
 
 int invoke_blazeface (blazeface_result_t *blazeface_result, blazeface_config_t *config);
     
@@ -8,6 +8,7 @@
 #include "util_egl.h"
 #include "util_debugstr.h"
 #include "util_pmeter.h"
+#include "util_alloc_audit.h"
 #include "util_texture.h"
 #include "util_render2d.h"
 #include "app_engine.h"
@@ -31,10 +32,9 @@ feed_classification_image_uint8 (texture_2d_t *srctex, int win_w, int win_h)
     int x, y, w, h;
     uint8_t *buf_u8 = (uint8_t *)get_classification_input_buf (&w, &h);
     unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
+    unsigned char *pui8 = (unsigned char *)texture_pool_acquire_buffer (w * h * 4);
     if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
+        return;
 
     buf_ui8 = pui8;
 
@@ -58,6 +58,7 @@ feed_classification_image_uint8 (texture_2d_t *srctex, int win_w, int win_h)
         }
     }
 
+    texture_pool_release_buffer (pui8);
     return;
 }
 
@@ -67,10 +68,9 @@ feed_classification_image_float (texture_2d_t *srctex, int win_w, int win_h)
     int x, y, w, h;
     float *buf_fp32 = (float *)get_classification_input_buf (&w, &h);
     unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
+    unsigned char *pui8 = (unsigned char *)texture_pool_acquire_buffer (w * h * 4);
     if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
+        return;
 
     buf_ui8 = pui8;
 
@@ -96,6 +96,7 @@ feed_classification_image_float (texture_2d_t *srctex, int win_w, int win_h)
         }
     }
 
+    texture_pool_release_buffer (pui8);
     return;
 }
 
@@ -260,6 +261,7 @@ AppEngine::RenderFrame ()
 
         PMETER_RESET_LAP ();
         PMETER_SET_LAP ();
+        alloc_audit_frame_begin ();
 
         ttime[1] = pmeter_get_time_ms ();
         interval = (count > 0) ? ttime[1] - ttime[0] : 0;
@@ -306,6 +308,9 @@ AppEngine::RenderFrame ()
         invoke_imgui (&imgui_data);
 #endif
         egl_swap();
+
+        /* the steady state must not allocate (USE_ALLOC_AUDIT) */
+        alloc_audit_frame_end ("classification");
     }
     glctx.frame_count ++;
 }
@@ -414,6 +419,8 @@ AppEngine::InitGLES (void)
 void
 AppEngine::TerminateGLES (void)
 {
+    /* pooled texture names belong to this context */
+    texture_pool_destroy ();
     egl_terminate ();
 }
 
@@ -4,8 +4,8 @@
  * ------------------------------------------------ */
 #include "util_tflite.h"
 #include "util_debug.h"
+#include "util_topk.h"
 #include "tflite_classification.h"
-#include <list>
 
 
 static tflite_interpreter_t s_interpreter;
@@ -75,64 +75,33 @@ get_classification_input_buf (int *w, int *h)
 /* -------------------------------------------------- *
  * Invoke TensorFlow Lite
  * -------------------------------------------------- */
-static float
-get_scoreval (int class_id)
+static int
+decode_topk_scores (topk_item_t *topk, int topn)
 {
-    if (s_tensor_output.type == kTfLiteFloat32)
-    {
-        float *val = (float *)s_tensor_output.ptr;
-        return val[class_id];
-    }
+    int num_class = s_tensor_output.dims[1];
+    if (num_class > MAX_CLASS_NUM)
+        num_class = MAX_CLASS_NUM;
 
     if (s_tensor_output.type == kTfLiteUInt8)
     {
         uint8_t *val8 = (uint8_t *)s_tensor_output.ptr;
-        float scale = s_tensor_output.quant_scale;
-        float zerop = s_tensor_output.quant_zerop;
-        float fval = (val8[class_id] - zerop) * scale;
-        return fval;
+        return topk_uint8 (val8, num_class, topn,
+                           s_tensor_output.quant_scale, s_tensor_output.quant_zerop, topk);
     }
 
-    return 0;
-}
-
-static int
-push_listitem (std::list<classify_t> &class_list, classify_t &item, size_t topn)
-{
-    size_t idx = 0;
-
-    /* search insert point */
-    for (auto itr = class_list.begin(); itr != class_list.end(); itr ++)
+    if (s_tensor_output.type == kTfLiteFloat32)
     {
-        if (item.score > itr->score)
-        {
-            class_list.insert (itr, item);
-            if (class_list.size() > topn)
-            {
-                class_list.pop_back();
-            }
-            return 0;
-        }
-
-        idx ++;
-        if (idx >= topn)
-        {
-            return 0;
-        }
+        float *val = (float *)s_tensor_output.ptr;
+        return topk_float (val, num_class, topn, topk);
     }
 
-    /* if list is not full, add item to the bottom */
-    if (class_list.size() < topn)
-    {
-        class_list.push_back (item);
-    }
     return 0;
 }
 
 int
 invoke_classification (classification_result_t *class_ret)
 {
-    size_t topn = 5;
+    int topn = 5;
 
     if (s_interpreter.interpreter->Invoke() != kTfLiteOk)
     {
@@ -141,28 +110,18 @@ invoke_classification (classification_result_t *class_ret)
     }
 
 
-    std::list<classify_t> classify_list;
-    for (int i = 0; i < MAX_CLASS_NUM; i ++)
-    {
-        classify_t item;
-        item.id = i;
-        item.score = get_scoreval (i);
-
-        push_listitem (classify_list, item, topn);
-    }
+    topk_item_t topk[TOPK_MAX_NUM];
+    int num_topk = decode_topk_scores (topk, topn);
 
-    int count = 0;
-    for (auto itr = classify_list.begin(); itr != classify_list.end(); itr ++)
+    for (int i = 0; i < num_topk; i ++)
     {
-        classify_t *item = &class_ret->classify[count];
-
-        item->id    = itr->id;
-        item->score = itr->score;
-        memcpy (item->name, s_class_name[itr->id], 64);
+        classify_t *item = &class_ret->classify[i];
 
-        count ++;
-        class_ret->num = count;
+        item->id    = topk[i].id;
+        item->score = topk[i].score;
+        memcpy (item->name, s_class_name[topk[i].id], 64);
     }
+    class_ret->num = num_topk;
 
     return 0;
 }
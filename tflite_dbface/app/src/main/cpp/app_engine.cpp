@@ -13,6 +13,7 @@
 #include "app_engine.h"
 #include "render_imgui.h"
 #include "assertgl.h"
+#include "util_governor.h"
 
 #define UNUSED(x) (void)(x)
 
@@ -21,6 +22,21 @@
 #define CAMERA_CROP_WIDTH       640
 #define CAMERA_CROP_HEIGHT      480
 
+#define DBFACE_TARGET_MS        33.0f   /* inference budget for the adaptive quality */
+
+/*
+ *  model variants from the best quality to the cheapest one.
+ *  the optional ones are skipped when they are not in the assets.
+ */
+static const char *s_dbface_variant_path[] = {
+    DBFACE_MODEL_PATH,
+    DBFACE_QUANT_MODEL_PATH,
+    DBFACE_LITE_MODEL_PATH,
+    DBFACE_LITE_QUANT_MODEL_PATH,
+};
+
+static governor_t s_governor;
+
 
 /* resize image to DNN network input size and convert to fp32. */
 void
@@ -29,10 +45,9 @@ feed_dbface_image(texture_2d_t *srctex, int win_w, int win_h)
     int x, y, w, h;
     float *buf_fp32 = (float *)get_dbface_input_buf (&w, &h);
     unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
+    unsigned char *pui8 = (unsigned char *)texture_pool_acquire_buffer (w * h * 4);
     if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
+        return;
 
     buf_ui8 = pui8;
 
@@ -58,6 +73,7 @@ feed_dbface_image(texture_2d_t *srctex, int win_w, int win_h)
         }
     }
 
+    texture_pool_release_buffer (pui8);
     return;
 }
 
@@ -197,6 +213,8 @@ AppEngine::setup_imgui (int win_w, int win_h, imgui_data_t *imgui_data)
     imgui_data->frame_color[1] = 0.5f;
     imgui_data->frame_color[2] = 1.0f;
     imgui_data->frame_color[3] = 1.0f;
+    imgui_data->adaptive_quality = 1;
+    imgui_data->target_ms        = DBFACE_TARGET_MS;
 }
 
 
@@ -242,6 +260,22 @@ AppEngine::RenderFrame ()
         ttime[3] = pmeter_get_time_ms ();
         invoke_ms = ttime[3] - ttime[2];
 
+        /* the variant which produced invoke_ms */
+        int input_w, input_h;
+        int variant = get_tflite_dbface_variant ();
+        get_dbface_input_buf (&input_w, &input_h);
+
+        /* pick the model variant for the next frame */
+        if (imgui_data.adaptive_quality)
+        {
+            governor_set_target (&s_governor, imgui_data.target_ms);
+            select_tflite_dbface_variant (governor_update (&s_governor, invoke_ms));
+        }
+        else
+        {
+            select_tflite_dbface_variant (0);
+        }
+
         /* --------------------------------------- *
          *  render scene
          * --------------------------------------- */
@@ -258,7 +292,12 @@ AppEngine::RenderFrame ()
 
         draw_pmeter (0, 40);
 
-        sprintf (strbuf, "Interval:%5.1f [ms]\nTFLite  :%5.1f [ms]", interval, invoke_ms);
+        if (imgui_data.adaptive_quality)
+            sprintf (strbuf, "Interval:%5.1f [ms]\nTFLite  :%5.1f [ms]\nModel   :%dx%d (%d/%d)", interval, invoke_ms,
+                     input_w, input_h, variant, s_governor.num_levels);
+        else
+            sprintf (strbuf, "Interval:%5.1f [ms]\nTFLite  :%5.1f [ms]\nModel   :%dx%d (adaptive off)", interval, invoke_ms,
+                     input_w, input_h);
         draw_dbgstr (strbuf, 10, 10);
 
         /* renderer info */
@@ -347,12 +386,25 @@ AppEngine::InitGLES (void)
     init_dbgstr (w, h);
 
     asset_read_file (m_app->activity->assetManager,
-                    (char *)DBFACE_MODEL_PATH, m_tflite_model_buf);
+                    (char *)DBFACE_MODEL_PATH, m_tflite_model_buf[0]);
 
     ret = init_tflite_dbface (
-        (const char *)m_tflite_model_buf.data(), m_tflite_model_buf.size(),
+        (const char *)m_tflite_model_buf[0].data(), m_tflite_model_buf[0].size(),
         &imgui_data.dbface_config);
 
+    /* preload the other variants so that the governor can switch instantly */
+    for (int i = 1; i < DBFACE_MAX_VARIANTS; i ++)
+    {
+        if (!asset_read_file (m_app->activity->assetManager,
+                              (char *)s_dbface_variant_path[i], m_tflite_model_buf[i]))
+        {
+            DBG_LOG ("skip model variant: %s\n", s_dbface_variant_path[i]);
+            continue;
+        }
+        add_tflite_dbface_variant ((const char *)m_tflite_model_buf[i].data(), m_tflite_model_buf[i].size());
+    }
+    governor_init (&s_governor, get_tflite_dbface_variant_num (), DBFACE_TARGET_MS);
+
     setup_imgui (w, h, &imgui_data);
 
     glctx.disp_w = w;
@@ -376,6 +428,8 @@ AppEngine::InitGLES (void)
 void
 AppEngine::TerminateGLES (void)
 {
+    /* pooled texture names belong to this context */
+    texture_pool_destroy ();
     egl_terminate ();
 }
 
@@ -96,7 +96,7 @@ private:
     ImageReaderHelper   m_ImgReader;
 
     gles_ctx_t          glctx;
-    std::vector<uint8_t> m_tflite_model_buf;
+    std::vector<uint8_t> m_tflite_model_buf[DBFACE_MAX_VARIANTS];
 
     imgui_data_t        imgui_data;
     int                 m_camera_facing;
@@ -110,6 +110,15 @@ render_gui (imgui_data_t *imgui_data)
         ImGui::SliderFloat("Score thresh", &imgui_data->dbface_config.score_thresh, 0.0f, 1.0f);
         ImGui::SliderFloat("IOU   thresh", &imgui_data->dbface_config.iou_thresh,   0.0f, 1.0f);
 
+        bool force_nms = imgui_data->dbface_config.force_nms;
+        ImGui::Checkbox("Force NMS (debug)", &force_nms);
+        imgui_data->dbface_config.force_nms = force_nms ? 1 : 0;
+
+        bool adaptive_quality = imgui_data->adaptive_quality;
+        ImGui::Checkbox("Adaptive quality", &adaptive_quality);
+        imgui_data->adaptive_quality = adaptive_quality ? 1 : 0;
+        ImGui::SliderFloat("Target [ms]", &imgui_data->target_ms, 10.0f, 200.0f);
+
         ImVec4 frame_color;
         frame_color.x = imgui_data->frame_color[0];
         frame_color.y = imgui_data->frame_color[1];
@@ -16,6 +16,8 @@ typedef struct _imgui_data_t
     dbface_config_t dbface_config;
     int     camera_facing;
     float   frame_color[4];
+    int     adaptive_quality;   /* switch the model variants to meet target_ms */
+    float   target_ms;
 } imgui_data_t;
 
 int  init_imgui (int width, int height);
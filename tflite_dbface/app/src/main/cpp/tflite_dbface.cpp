@@ -3,16 +3,37 @@
  * Copyright (c) 2020 terryky1220@gmail.com
  * ------------------------------------------------ */
 #include "util_tflite.h"
+#include "util_peak.h"
+#include "util_box_array.h"
+#include "util_debug.h"
 #include "tflite_dbface.h"
-#include <list>
+#include <algorithm>
 
 
-static tflite_interpreter_t s_detect_interpreter;
+typedef struct _dbface_variant_t
+{
+    tflite_interpreter_t    interpreter;
+    tflite_tensor_t         tensor_input;
+    tflite_tensor_t         tensor_hm;
+    tflite_tensor_t         tensor_box;
+    tflite_tensor_t         tensor_landmark;
+} dbface_variant_t;
+
+static dbface_variant_t     s_variants[DBFACE_MAX_VARIANTS];
+static int                  s_num_variants;
+static int                  s_cur_variant;
+
+/* tensors of the current variant */
 static tflite_tensor_t      s_detect_tensor_input;
 static tflite_tensor_t      s_detect_tensor_hm;
 static tflite_tensor_t      s_detect_tensor_box;
 static tflite_tensor_t      s_detect_tensor_landmark;
 
+static heatmap_peak_t       *s_peaks;
+static int                  s_peaks_max;
+
+static box_array_t          s_boxes;            /* one slot per peak */
+static int                  s_sel[MAX_FACE_NUM];
 
 
 
@@ -21,17 +42,94 @@ static tflite_tensor_t      s_detect_tensor_landmark;
  *  Create TFLite Interpreter
  * -------------------------------------------------- */
 int
-init_tflite_dbface(const char *model_buf, size_t model_size, dbface_config_t *config)
+add_tflite_dbface_variant (const char *model_buf, size_t model_size)
 {
+    if (s_num_variants >= DBFACE_MAX_VARIANTS)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
     /* Face detect */
-	tflite_create_interpreter (&s_detect_interpreter, model_buf, model_size);
-    tflite_get_tensor_by_name (&s_detect_interpreter, 0, "input",          &s_detect_tensor_input);
-    tflite_get_tensor_by_name (&s_detect_interpreter, 1, "Identity_2",     &s_detect_tensor_hm);
-    tflite_get_tensor_by_name (&s_detect_interpreter, 1, "Identity_1",     &s_detect_tensor_box);
-    tflite_get_tensor_by_name (&s_detect_interpreter, 1, "Identity",       &s_detect_tensor_landmark);
+    dbface_variant_t *v = &s_variants[s_num_variants];
+    if (tflite_create_interpreter (&v->interpreter, model_buf, model_size) < 0)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+    tflite_get_tensor_by_name (&v->interpreter, 0, "input",          &v->tensor_input);
+    tflite_get_tensor_by_name (&v->interpreter, 1, "Identity_2",     &v->tensor_hm);
+    tflite_get_tensor_by_name (&v->interpreter, 1, "Identity_1",     &v->tensor_box);
+    tflite_get_tensor_by_name (&v->interpreter, 1, "Identity",       &v->tensor_landmark);
+
+    /* every heatmap cell can be a peak in the worst case (flat plateau) */
+    int peaks_max = v->tensor_hm.dims[1] * v->tensor_hm.dims[2];
+    if (peaks_max > s_peaks_max)
+    {
+        heatmap_peak_t *peaks = (heatmap_peak_t *)realloc (s_peaks, peaks_max * sizeof (heatmap_peak_t));
+        if (peaks == NULL)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            return -1;
+        }
+        s_peaks     = peaks;
+        s_peaks_max = peaks_max;
+
+        box_array_free (&s_boxes);
+        if (box_array_init (&s_boxes, peaks_max) < 0)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            return -1;
+        }
+    }
+
+    return s_num_variants ++;
+}
+
+int
+select_tflite_dbface_variant (int variant_id)
+{
+    if (variant_id < 0 || variant_id >= s_num_variants)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    dbface_variant_t *v = &s_variants[variant_id];
+    s_detect_tensor_input    = v->tensor_input;
+    s_detect_tensor_hm       = v->tensor_hm;
+    s_detect_tensor_box      = v->tensor_box;
+    s_detect_tensor_landmark = v->tensor_landmark;
+    s_cur_variant = variant_id;
+
+    return 0;
+}
+
+int
+get_tflite_dbface_variant ()
+{
+    return s_cur_variant;
+}
+
+int
+get_tflite_dbface_variant_num ()
+{
+    return s_num_variants;
+}
+
+int
+init_tflite_dbface(const char *model_buf, size_t model_size, dbface_config_t *config)
+{
+    if (add_tflite_dbface_variant (model_buf, model_size) < 0)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+    select_tflite_dbface_variant (0);
 
     config->score_thresh = 0.3f;
     config->iou_thresh   = 0.3f;
+    config->force_nms    = 0;
 
     return 0;
 }
@@ -79,157 +177,96 @@ _exp (float v)
 }
 
 
-static int
-decode_bounds (std::list<face_t> &face_list, float score_thresh)
+static void
+decode_box (int x, int y, float *x0, float *y0, float *x1, float *y1)
 {
-    face_t face_item;
-    float  *scores_ptr = (float *)s_detect_tensor_hm.ptr;
     int score_w = s_detect_tensor_hm.dims[2];
     int score_h = s_detect_tensor_hm.dims[1];
-
-    for (int y = 0; y < score_h; y ++)
-    {
-        for (int x = 0; x < score_w; x ++)
-        {
-            int idx = y * score_w + x;
-            float score = scores_ptr[idx];
-
-            if (score < score_thresh)
-                continue;
-
-            float *p = get_bbox_ptr (idx);
-            float bx = p[0];
-            float by = p[1];
-            float bw = p[2];
-            float bh = p[3];
-
-            fvec2 topleft, btmright;
-            topleft.x  = (x - bx) / (float)score_w;
-            topleft.y  = (y - by) / (float)score_h;
-            btmright.x = (x + bw) / (float)score_w;
-            btmright.y = (y + bh) / (float)score_h;
-
-            face_item.score    = score;
-            face_item.topleft  = topleft;
-            face_item.btmright = btmright;
-
-            /* landmark positions (5 keys) */
-            float *lm = get_landmark_ptr (idx);
-            for (int j = 0; j < kFaceKeyNum; j ++)
-            {
-                float lx = lm[j    ] * 4;
-                float ly = lm[j + 5] * 4;
-                lx = (_exp (lx) + x) / (float)score_w;
-                ly = (_exp (ly) + y) / (float)score_h;
-
-                face_item.keys[j].x = lx;
-                face_item.keys[j].y = ly;
-            }
-
-            face_list.push_back (face_item);
-        }
-    }
-    return 0;
+    int idx = y * score_w + x;
+
+    float *p = get_bbox_ptr (idx);
+    float bx = p[0];
+    float by = p[1];
+    float bw = p[2];
+    float bh = p[3];
+
+    *x0 = (x - bx) / (float)score_w;
+    *y0 = (y - by) / (float)score_h;
+    *x1 = (x + bw) / (float)score_w;
+    *y1 = (y + bh) / (float)score_h;
 }
 
-
-/* -------------------------------------------------- *
- *  Apply NonMaxSuppression:
- *      https://github.com/tensorflow/tfjs/blob/master/tfjs-core/src/ops/image_ops.ts
- * -------------------------------------------------- */
-static float
-calc_intersection_over_union (face_t &face0, face_t &face1)
+static void
+decode_keys (int x, int y, face_t *face_item)
 {
-    float sx0 = face0.topleft.x;
-    float sy0 = face0.topleft.y;
-    float ex0 = face0.btmright.x;
-    float ey0 = face0.btmright.y;
-    float sx1 = face1.topleft.x;
-    float sy1 = face1.topleft.y;
-    float ex1 = face1.btmright.x;
-    float ey1 = face1.btmright.y;
-    
-    float xmin0 = std::min (sx0, ex0);
-    float ymin0 = std::min (sy0, ey0);
-    float xmax0 = std::max (sx0, ex0);
-    float ymax0 = std::max (sy0, ey0);
-    float xmin1 = std::min (sx1, ex1);
-    float ymin1 = std::min (sy1, ey1);
-    float xmax1 = std::max (sx1, ex1);
-    float ymax1 = std::max (sy1, ey1);
-    
-    float area0 = (ymax0 - ymin0) * (xmax0 - xmin0);
-    float area1 = (ymax1 - ymin1) * (xmax1 - xmin1);
-    if (area0 <= 0 || area1 <= 0)
-        return 0.0f;
-
-    float intersect_xmin = std::max (xmin0, xmin1);
-    float intersect_ymin = std::max (ymin0, ymin1);
-    float intersect_xmax = std::min (xmax0, xmax1);
-    float intersect_ymax = std::min (ymax0, ymax1);
-
-    float intersect_area = std::max (intersect_ymax - intersect_ymin, 0.0f) *
-                           std::max (intersect_xmax - intersect_xmin, 0.0f);
-    
-    return intersect_area / (area0 + area1 - intersect_area);
-}
+    int score_w = s_detect_tensor_hm.dims[2];
+    int score_h = s_detect_tensor_hm.dims[1];
+    int idx = y * score_w + x;
 
-static bool
-compare (face_t &v1, face_t &v2)
-{
-    if (v1.score > v2.score)
-        return true;
-    else
-        return false;
+    /* landmark positions (5 keys) */
+    float *lm = get_landmark_ptr (idx);
+    for (int j = 0; j < kFaceKeyNum; j ++)
+    {
+        float lx = lm[j    ] * 4;
+        float ly = lm[j + 5] * 4;
+        lx = (_exp (lx) + x) / (float)score_w;
+        ly = (_exp (ly) + y) / (float)score_h;
+
+        face_item->keys[j].x = lx;
+        face_item->keys[j].y = ly;
+    }
 }
 
+/*
+ *  CenterNet style decoding: only the local maxima of the heatmap (3x3 max-pool
+ *  test) become face candidates, so boxes are decoded for a handful of cells
+ *  instead of every cell above the threshold. the landmarks are decoded in
+ *  pack_face_result () for the faces which are output.
+ */
 static int
-non_max_suppression (std::list<face_t> &face_list, std::list<face_t> &face_sel_list, float iou_thresh)
+decode_bounds (box_array_t *boxes, float score_thresh)
 {
-    face_list.sort (compare);
+    float  *scores_ptr = (float *)s_detect_tensor_hm.ptr;
+    int score_w = s_detect_tensor_hm.dims[2];
+    int score_h = s_detect_tensor_hm.dims[1];
 
-    for (auto itr = face_list.begin(); itr != face_list.end(); itr ++)
-    {
-        face_t face_candidate = *itr;
+    int num_peaks = peak_extract (scores_ptr, score_w, score_h, 1, 1, score_thresh,
+                                  s_peaks, s_peaks_max);
 
-        int ignore_candidate = false;
-        for (auto itr_sel = face_sel_list.rbegin(); itr_sel != face_sel_list.rend(); itr_sel ++)
-        {
-            face_t face_sel = *itr_sel;
-
-            float iou = calc_intersection_over_union (face_candidate, face_sel);
-            if (iou >= iou_thresh)
-            {
-                ignore_candidate = true;
-                break;
-            }
-        }
+    box_array_clear (boxes);
 
-        if (!ignore_candidate)
-        {
-            face_sel_list.push_back(face_candidate);
-            if (face_sel_list.size() >= MAX_FACE_NUM)
-                break;
-        }
-    }
+    for (int i = 0; i < num_peaks; i ++)
+    {
+        heatmap_peak_t *peak = &s_peaks[i];
+        float x0, y0, x1, y1;
 
+        decode_box (peak->x, peak->y, &x0, &y0, &x1, &y1);
+        box_array_push (boxes, peak->score, x0, y0, x1, y1, peak->y * score_w + peak->x);
+    }
     return 0;
 }
 
+/* sel[]: slot indices of the boxes to output (box_array_nms () or box_array_sort ()) */
 static void
-pack_face_result (dbface_result_t *face_result, std::list<face_t> &face_list)
+pack_face_result (dbface_result_t *face_result, box_array_t *boxes, int *sel, int num_sel)
 {
-    int num_faces = 0;
-    for (auto itr = face_list.begin(); itr != face_list.end(); itr ++)
-    {
-        face_t face = *itr;
-        memcpy (&face_result->faces[num_faces], &face, sizeof (face));
-        num_faces ++;
-        face_result->num = num_faces;
+    int score_w = s_detect_tensor_hm.dims[2];
 
-        if (num_faces >= MAX_FACE_NUM)
-            break;
+    int num_faces = std::min (num_sel, MAX_FACE_NUM);
+    for (int i = 0; i < num_faces; i ++)
+    {
+        face_t *face = &face_result->faces[i];
+        int    slot  = sel[i];
+        int    idx   = boxes->id[slot];
+
+        face->score      = boxes->score[slot];
+        face->topleft.x  = boxes->x0[slot];
+        face->topleft.y  = boxes->y0[slot];
+        face->btmright.x = boxes->x1[slot];
+        face->btmright.y = boxes->y1[slot];
+        decode_keys (idx % score_w, idx / score_w, face);
     }
+    face_result->num = num_faces;
 }
 
 
@@ -239,27 +276,28 @@ pack_face_result (dbface_result_t *face_result, std::list<face_t> &face_list)
 int
 invoke_dbface (dbface_result_t *face_result, dbface_config_t *config)
 {
-    if (s_detect_interpreter.interpreter->Invoke() != kTfLiteOk)
+    if (s_variants[s_cur_variant].interpreter.interpreter->Invoke() != kTfLiteOk)
     {
-        fprintf (stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
         return -1;
     }
 
     /* decode boundary box and landmark keypoints */
     float score_thresh = config->score_thresh;
-    std::list<face_t> face_list;
+    int   num_sel;
 
-    decode_bounds (face_list, score_thresh);
+    decode_bounds (&s_boxes, score_thresh);
 
-#if 1 /* USE NMS */
+    /*
+     *  the heatmap peaks are usually one per face already. NMS runs only when
+     *  some of their boxes overlap, otherwise sorting by score is the same.
+     */
     float iou_thresh = config->iou_thresh;
-    std::list<face_t> face_nms_list;
-
-    non_max_suppression (face_list, face_nms_list, iou_thresh);
-    pack_face_result (face_result, face_nms_list);
-#else
-    pack_face_result (face_result, face_list);
-#endif
+    if (config->force_nms || box_array_overlaps (&s_boxes, iou_thresh))
+        num_sel = box_array_nms (&s_boxes, iou_thresh, s_sel, MAX_FACE_NUM);
+    else
+        num_sel = box_array_sort (&s_boxes, s_sel, MAX_FACE_NUM);
+    pack_face_result (face_result, &s_boxes, s_sel, num_sel);
 
     return 0;
 }
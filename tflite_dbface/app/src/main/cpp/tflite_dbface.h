@@ -13,12 +13,15 @@ extern "C" {
  * https://github.com/PINTO0309/PINTO_model_zoo/tree/master/041_DBFace/01_float32
  * https://github.com/PINTO0309/PINTO_model_zoo/tree/master/041_DBFace/03_integer_quantization
  */
-//#define DBFACE_MODEL_PATH        "./model/dbface_keras_256x256_float32_nhwc.tflite"
-//#define DBFACE_QUANT_MODEL_PATH  "./model/dbface_keras_256x256_integer_quant_nhwc.tflite"
-
 #define DBFACE_MODEL_PATH        "model/dbface_keras_480x640_float32_nhwc.tflite"
 #define DBFACE_QUANT_MODEL_PATH  "model/dbface_keras_480x640_integer_quant_nhwc.tflite"
 
+/* low resolution variants (optional) for the adaptive quality governor */
+#define DBFACE_LITE_MODEL_PATH        "model/dbface_keras_256x256_float32_nhwc.tflite"
+#define DBFACE_LITE_QUANT_MODEL_PATH  "model/dbface_keras_256x256_integer_quant_nhwc.tflite"
+
+#define DBFACE_MAX_VARIANTS  4
+
 #define MAX_FACE_NUM  100
 
 enum face_key_id {
@@ -54,10 +57,21 @@ typedef struct _dbface_config_t
 {
     float score_thresh;
     float iou_thresh;
+    int   force_nms;        /* debug: run NMS even when the peaks left no overlapping boxes */
 } dbface_config_t;
 
 int init_tflite_dbface (const char *model_buf, size_t model_size, dbface_config_t *config);
 
+/*
+ *  model variants: every variant is loaded up front so that switching is
+ *  instant. variant 0 is the model given to init_tflite_dbface().
+ *  add_tflite_dbface_variant() returns the variant id.
+ */
+int add_tflite_dbface_variant (const char *model_buf, size_t model_size);
+int select_tflite_dbface_variant (int variant_id);
+int get_tflite_dbface_variant ();
+int get_tflite_dbface_variant_num ();
+
 void *get_dbface_input_buf (int *w, int *h);
 int invoke_dbface (dbface_result_t *dbface_result, dbface_config_t *config);
 
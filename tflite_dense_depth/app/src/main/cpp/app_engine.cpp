@@ -36,10 +36,9 @@ feed_dense_depth_image(texture_2d_t *srctex, int win_w, int win_h)
     int x, y, w, h;
     float *buf_fp32 = (float *)get_dense_depth_input_buf (&w, &h);
     unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
+    unsigned char *pui8 = (unsigned char *)texture_pool_acquire_buffer (w * h * 4);
     if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
+        return;
 
     buf_ui8 = pui8;
 
@@ -65,6 +64,7 @@ feed_dense_depth_image(texture_2d_t *srctex, int win_w, int win_h)
         }
     }
 
+    texture_pool_release_buffer (pui8);
     return;
 }
 
@@ -86,7 +86,9 @@ render_depth_image (texture_2d_t *srctex, int ofstx, int ofsty, int texw, int te
     int depthmap_w  = dense_depth_ret->depthmap_dims[0];
     int depthmap_h  = dense_depth_ret->depthmap_dims[1];
     int x, y;
-    unsigned int imgbuf[depthmap_h][depthmap_w];
+    unsigned int *imgbuf = (unsigned int *)texture_pool_acquire_buffer (depthmap_w * depthmap_h * 4);
+    if (imgbuf == NULL)
+        return;
 
     /* find the most confident class for each pixel. */
     for (y = 0; y < depthmap_h; y ++)
@@ -103,15 +105,22 @@ render_depth_image (texture_2d_t *srctex, int ofstx, int ofsty, int texw, int te
             unsigned char b = r;
             unsigned char a = 255;
 
-            imgbuf[y][x] = (a << 24) | (b << 16) | (g << 8) | (r);
+            imgbuf[y * depthmap_w + x] = (a << 24) | (b << 16) | (g << 8) | (r);
         }
     }
 
-    texture_2d_t animtex;
-    create_2d_texture_ex (&animtex, imgbuf, depthmap_w, depthmap_h, pixfmt_fourcc ('R', 'G', 'B', 'A'));
-    draw_2d_texture_ex (&animtex, ofstx, ofsty, texw, texh, 0);
+    /* the texture is reused across frames: only its contents are uploaded */
+    texture_2d_t *tex = texture_pool_acquire (depthmap_w, depthmap_h, pixfmt_fourcc ('R', 'G', 'B', 'A'));
+    if (tex == NULL)
+    {
+        texture_pool_release_buffer (imgbuf);
+        return;
+    }
+    texture_pool_upload (tex, imgbuf);
+    draw_2d_texture_ex (tex, ofstx, ofsty, texw, texh, 0);
 
-    glDeleteTextures (1, &animtex.texid);
+    texture_pool_release (tex);
+    texture_pool_release_buffer (imgbuf);
 }
 
 
@@ -138,40 +147,13 @@ render_depth_image_3d (texture_2d_t *srctex, int ofstx, int ofsty, int texw, int
         create_mesh (&s_depth_mesh, depthmap_w - 1, depthmap_h - 1);
         s_is_first_render3d = 0;
     }
-    float *vtx = s_depth_mesh.vtx_array;
-    float *uv  = s_depth_mesh.uv_array;
 
-    /* create 3D vertex coordinate */
-    for (int y = 0; y < depthmap_h; y ++)
-    {
-        for (int x = 0; x < depthmap_w; x ++)
-        {
-            int   idx = (y * depthmap_w + x);
-            float d = depthmap[idx];
+    /* only the depth changes every frame. normalization is done in the shader. */
+    update_mesh_depth (&s_depth_mesh, depthmap);
 
-            if (1)
-            {
-                d -= 0;//s_gui_prop.depth_min;
-                d /= 10;//s_gui_prop.depth_max;
-                d = (d * 2.0 - 1.0) * s_gui_prop.pose_scale_z;
-            }
-            else
-            {
-                //d = s_gui_prop.depth_max / d;   //  inf -> 1.0
-                //d = 2 - d;                      // -inf -> 1.0
-                //d = d * s_gui_prop.pose_scale_z;
-            }
-
-            vtx[3 * idx + 0] =  ((x / (float)depthmap_h) * 2.0f - 1.0f) * s_gui_prop.pose_scale_x;
-            vtx[3 * idx + 1] = -((y / (float)depthmap_h) * 2.0f - 1.0f) * s_gui_prop.pose_scale_y;
-            vtx[3 * idx + 2] =  d;
-
-            uv [2 * idx + 0] = x / (float)depthmap_w;
-            uv [2 * idx + 1] = y / (float)depthmap_h;
-        }
-    }
-    float colb[] = {1.0, 1.0, 1.0, 1.0};
-    draw_point_arrays (mtxGlobal, vtx, uv, depthmap_h * depthmap_w, srctex->texid, colb);
+    float scale[] = {s_gui_prop.pose_scale_x, s_gui_prop.pose_scale_y, s_gui_prop.pose_scale_z};
+    float colb[]  = {1.0, 1.0, 1.0, 1.0};
+    draw_mesh_points (mtxGlobal, &s_depth_mesh, scale, 0.0f, 10.0f, srctex->texid, colb);
 
     if (s_gui_prop.draw_axis)
     {
@@ -402,6 +384,15 @@ AppEngine::RenderFrame ()
         sprintf (strbuf, "Interval:%5.1f [ms]\nTFLite  :%5.1f [ms]", interval, invoke_ms);
         draw_dbgstr (strbuf, 10, 10);
 
+        /* per-frame textures/buffers: "new" must stay flat in the steady state */
+        texture_pool_stats_t pool_stats;
+        texture_pool_get_stats (&pool_stats);
+        sprintf (strbuf, "TexPool :%2d tex %2d buf (new:%llu reuse:%llu)",
+                 pool_stats.num_textures, pool_stats.num_buffers,
+                 (unsigned long long)(pool_stats.tex_created + pool_stats.buf_created),
+                 (unsigned long long)(pool_stats.tex_reused  + pool_stats.buf_reused));
+        draw_dbgstr (strbuf, 10, 10 + 22 * 2);
+
         /* renderer info */
         int y = win_h - 22 * 3;
         draw_dbgstr (glctx.str_glverstion, 10, y); y += 22;
@@ -517,6 +508,8 @@ AppEngine::InitGLES (void)
 void
 AppEngine::TerminateGLES (void)
 {
+    /* pooled texture names belong to this context */
+    texture_pool_destroy ();
     egl_terminate ();
 }
 
@@ -31,6 +31,13 @@ static GLint        s_loc_color;
 static GLint        s_loc_alpha;
 static GLint        s_loc_lightpos;
 
+static shader_obj_t s_sobj_mesh;
+static GLint        s_loc_mesh_depth;
+static GLint        s_loc_mesh_mtx_pmv;
+static GLint        s_loc_mesh_scale;
+static GLint        s_loc_mesh_depth_range;
+static GLint        s_loc_mesh_color;
+
 
 static GLfloat s_nrm[] =
 {
@@ -122,6 +129,44 @@ void main(void)                                             \n\
     gl_FragColor = vec4(color, u_alpha);                    \n\
 }                                                           ";
 
+/*
+ *  depth point cloud: the grid XY and UV are static, only the depth
+ *  is streamed every frame and normalized here.
+ *      z = ((depth - min) / (max - min) * 2 - 1) * scale.z
+ */
+static char s_strVS_mesh[] = "                              \n\
+                                                            \n\
+attribute vec2  a_Vertex;                                   \n\
+attribute float a_Depth;                                    \n\
+attribute vec2  a_TexCoord;                                 \n\
+uniform   mat4  u_PMVMatrix;                                \n\
+uniform   vec3  u_Scale;                                    \n\
+uniform   vec2  u_DepthRange;   /* (min, 1.0 / (max - min)) */\n\
+varying   vec2  v_texcoord;                                 \n\
+                                                            \n\
+void main(void)                                             \n\
+{                                                           \n\
+    float d = (a_Depth - u_DepthRange.x) * u_DepthRange.y;  \n\
+    vec4 pos = vec4(a_Vertex, d * 2.0 - 1.0, 1.0);          \n\
+    pos.xyz *= u_Scale;                                     \n\
+    gl_Position  = u_PMVMatrix * pos;                       \n\
+    gl_PointSize = 1.0;                                     \n\
+    v_texcoord   = a_TexCoord;                              \n\
+}                                                           ";
+
+static char s_strFS_mesh[] = "                              \n\
+precision mediump float;                                    \n\
+                                                            \n\
+uniform vec4    u_color;                                    \n\
+varying vec2    v_texcoord;                                 \n\
+uniform sampler2D u_sampler;                                \n\
+                                                            \n\
+void main(void)                                             \n\
+{                                                           \n\
+    vec3 color = vec3(texture2D(u_sampler, v_texcoord));    \n\
+    gl_FragColor = vec4(color * u_color.rgb, u_color.a);    \n\
+}                                                           ";
+
 
 static void
 compute_invmat3x3 (float *matMVI3x3, float *matMV)
@@ -154,6 +199,13 @@ init_cube (float aspect)
     s_loc_alpha   = glGetUniformLocation(s_sobj.program, "u_alpha" );
     s_loc_lightpos= glGetUniformLocation(s_sobj.program, "u_LightPos" );
 
+    generate_shader (&s_sobj_mesh, s_strVS_mesh, s_strFS_mesh);
+    s_loc_mesh_depth       = glGetAttribLocation (s_sobj_mesh.program, "a_Depth" );
+    s_loc_mesh_mtx_pmv     = glGetUniformLocation(s_sobj_mesh.program, "u_PMVMatrix" );
+    s_loc_mesh_scale       = glGetUniformLocation(s_sobj_mesh.program, "u_Scale" );
+    s_loc_mesh_depth_range = glGetUniformLocation(s_sobj_mesh.program, "u_DepthRange" );
+    s_loc_mesh_color       = glGetUniformLocation(s_sobj_mesh.program, "u_color" );
+
     matrix_proj_perspective (s_matPrj, 72.0f, aspect, 1.f, 10000.f);
 
     unsigned char imgbuf[] = {255, 255, 255, 255};
@@ -302,43 +354,57 @@ draw_point (float *mtxGlobal, float *p0, float *color)
 }
 
 
+/* stream the depth of every grid vertex into the dynamic VBO */
 int
-draw_point_arrays (float *mtxGlobal, float *vtx, float *uv, int num, int texid, float *color)
+update_mesh_depth (mesh_obj_t *mesh, float *depth)
 {
-    float matMV[16], matPMV[16], matMVI3x3[9];
+    glBindBuffer (GL_ARRAY_BUFFER, mesh->vbo_depth);
+    glBufferData (GL_ARRAY_BUFFER, mesh->num_vtx * sizeof (float), depth, GL_STREAM_DRAW);
+    glBindBuffer (GL_ARRAY_BUFFER, 0);
+
+    return 0;
+}
+
+int
+draw_mesh_points (float *mtxGlobal, mesh_obj_t *mesh, float *scale,
+                  float depth_min, float depth_max, int texid, float *color)
+{
+    float matPMV[16];
 
     glEnable (GL_DEPTH_TEST);
     glDisable (GL_CULL_FACE);
 
-    glUseProgram( s_sobj.program );
+    glUseProgram( s_sobj_mesh.program );
 
-    glEnableVertexAttribArray (s_sobj.loc_vtx);
-    glEnableVertexAttribArray (s_sobj.loc_uv );
-    glDisableVertexAttribArray(s_sobj.loc_nrm);
-    glVertexAttribPointer (s_sobj.loc_vtx, 3, GL_FLOAT, GL_FALSE, 0, vtx);
-    glVertexAttribPointer (s_sobj.loc_uv , 2, GL_FLOAT, GL_FALSE, 0, uv );
-    glVertexAttrib4fv (s_sobj.loc_nrm, s_nrm);
+    glEnableVertexAttribArray (s_sobj_mesh.loc_vtx);
+    glEnableVertexAttribArray (s_sobj_mesh.loc_uv );
+    glEnableVertexAttribArray (s_loc_mesh_depth);
 
-    matrix_identity (matMV);
-    compute_invmat3x3 (matMVI3x3, matMV);
+    glBindBuffer (GL_ARRAY_BUFFER, mesh->vbo_vtx);
+    glVertexAttribPointer (s_sobj_mesh.loc_vtx, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    glBindBuffer (GL_ARRAY_BUFFER, mesh->vbo_uv);
+    glVertexAttribPointer (s_sobj_mesh.loc_uv , 2, GL_FLOAT, GL_FALSE, 0, 0);
+    glBindBuffer (GL_ARRAY_BUFFER, mesh->vbo_depth);
+    glVertexAttribPointer (s_loc_mesh_depth,    1, GL_FLOAT, GL_FALSE, 0, 0);
+    glBindBuffer (GL_ARRAY_BUFFER, 0);
 
-    matrix_mult (matMV, mtxGlobal, matMV);
-    matrix_mult (matPMV, s_matPrj, matMV);
+    matrix_mult (matPMV, s_matPrj, mtxGlobal);
 
-    glUniformMatrix4fv (s_loc_mtx_mv,   1, GL_FALSE, matMV );
-    glUniformMatrix4fv (s_loc_mtx_pmv,  1, GL_FALSE, matPMV);
-    glUniformMatrix3fv (s_loc_mtx_nrm,  1, GL_FALSE, matMVI3x3);
-    glUniform3f (s_loc_lightpos, 1.0f, 1.0f, 1.0f);
-    glUniform3f (s_loc_color, color[0], color[1], color[2]);
-    glUniform1f (s_loc_alpha, color[3]);
+    float depth_scale = (depth_max > depth_min) ? 1.0f / (depth_max - depth_min) : 1.0f;
+    glUniformMatrix4fv (s_loc_mesh_mtx_pmv, 1, GL_FALSE, matPMV);
+    glUniform3f (s_loc_mesh_scale, scale[0], scale[1], scale[2]);
+    glUniform2f (s_loc_mesh_depth_range, depth_min, depth_scale);
+    glUniform4f (s_loc_mesh_color, color[0], color[1], color[2], color[3]);
 
     glEnable (GL_BLEND);
 
     glBindTexture (GL_TEXTURE_2D, texid);
-    glDrawArrays (GL_POINTS, 0, num);
+    glDrawArrays (GL_POINTS, 0, mesh->num_vtx);
 
     glDisable (GL_BLEND);
 
+    glDisableVertexAttribArray (s_loc_mesh_depth);
+
     return 0;
 }
 
@@ -350,14 +416,42 @@ create_mesh (mesh_obj_t *mesh, int num_tile_w, int num_tile_h)
     int num_vtx_v = num_tile_h + 1;
     int num_vtx   = num_vtx_u * num_vtx_v;
 
-    mesh->vtx_array = (float *)malloc (num_vtx * 3 * sizeof(float));
-    mesh->uv_array  = (float *)malloc (num_vtx * 2 * sizeof(float));
+    GLuint vbos[4];
+    glGenBuffers (4, vbos);
+    mesh->vbo_vtx   = vbos[0];
+    mesh->vbo_uv    = vbos[1];
+    mesh->vbo_idx   = vbos[2];
+    mesh->vbo_depth = vbos[3];
+
+    /*
+     *  the grid XY and UV never change, so they are uploaded only once.
+     *  XY is normalized by the height to keep the aspect ratio.
+     */
+    float *vtx_array = (float *)malloc (num_vtx * 2 * sizeof(float));
+    float *uv_array  = (float *)malloc (num_vtx * 2 * sizeof(float));
+    for (int y = 0; y < num_vtx_v; y ++)
+    {
+        for (int x = 0; x < num_vtx_u; x ++)
+        {
+            int idx = y * num_vtx_u + x;
+            vtx_array[2 * idx + 0] =  ((x / (float)num_vtx_v) * 2.0f - 1.0f);
+            vtx_array[2 * idx + 1] = -((y / (float)num_vtx_v) * 2.0f - 1.0f);
+
+            uv_array [2 * idx + 0] = x / (float)num_vtx_u;
+            uv_array [2 * idx + 1] = y / (float)num_vtx_v;
+        }
+    }
+
+    glBindBuffer (GL_ARRAY_BUFFER, mesh->vbo_vtx);
+    glBufferData (GL_ARRAY_BUFFER, num_vtx * 2 * sizeof(float), vtx_array, GL_STATIC_DRAW);
+    glBindBuffer (GL_ARRAY_BUFFER, mesh->vbo_uv);
+    glBufferData (GL_ARRAY_BUFFER, num_vtx * 2 * sizeof(float), uv_array, GL_STATIC_DRAW);
+    glBindBuffer (GL_ARRAY_BUFFER, mesh->vbo_depth);
+    glBufferData (GL_ARRAY_BUFFER, num_vtx * sizeof(float), NULL, GL_STREAM_DRAW);
+    glBindBuffer (GL_ARRAY_BUFFER, 0);
 
-    GLuint vbos[3];
-    glGenBuffers (3, vbos);
-    mesh->vbo_vtx = vbos[0];
-    mesh->vbo_uv  = vbos[1];
-    mesh->vbo_idx = vbos[2];
+    free (vtx_array);
+    free (uv_array);
 
     int num_tri = num_tile_w * num_tile_h * 2;
     int num_idx = num_tri * 3;
@@ -381,6 +475,7 @@ create_mesh (mesh_obj_t *mesh, int num_tile_w, int num_tile_h)
     mesh->idx_array = idx_array;
     mesh->num_tile_w = num_tile_w;
     mesh->num_tile_h = num_tile_h;
+    mesh->num_vtx    = num_vtx;
     mesh->num_idx    = num_idx;
 
     glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, mesh->vbo_idx);
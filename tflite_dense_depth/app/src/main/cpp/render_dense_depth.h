@@ -7,16 +7,16 @@
 
 typedef struct _mesh_obj_t
 {
-    float           *vtx_array;
-    float           *uv_array;
     unsigned short  *idx_array;
 
-    GLuint vbo_vtx;
-    GLuint vbo_uv;
+    GLuint vbo_vtx;         /* static: grid XY */
+    GLuint vbo_uv;          /* static: grid UV */
     GLuint vbo_idx;
+    GLuint vbo_depth;       /* streamed every frame */
 
     int num_tile_w;
     int num_tile_h;
+    int num_vtx;
     int num_idx;
 } mesh_obj_t;
 
@@ -30,7 +30,9 @@ int draw_floor (float *mtxGlobal, float div_u, float div_v);
 int draw_line (float *mtxGlobal, float *p0, float *p1, float *color);
 int draw_triangle (float *mtxGlobal, float *p0, float *p1, float *p2, float *color);
 
-int draw_point_arrays (float *mtxGlobal, float *vtx, float *uv, int num, int texid, float *color);
+int update_mesh_depth (mesh_obj_t *mesh, float *depth);
+int draw_mesh_points (float *mtxGlobal, mesh_obj_t *mesh, float *scale,
+                      float depth_min, float depth_max, int texid, float *color);
 
 int create_mesh (mesh_obj_t *mobj, int num_tile_w, int num_tile_h);
 
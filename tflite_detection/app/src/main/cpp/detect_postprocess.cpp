@@ -7,15 +7,23 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
-#include <numeric>
 #include <cmath>
+#include "util_box_array.h"
+#include "util_debug.h"
 #include "detect_postprocess.h"
 
 static float    *s_anchors;
 static int      s_anchors_count;
 
 static float    *s_decoded_boxes;
-static uint8_t  *s_active_candidate;
+
+/* NMS work areas, allocated once by init_detect_postprocess () */
+static box_array_t  s_cand_boxes;       /* candidates of a class, one slot per anchor */
+static box_array_t  s_top_boxes;        /* regular NMS: the best ATTR_MAX_DETECTIONS of all classes */
+static int          *s_sel;
+static int          *s_selected;        /* anchor indices selected by NMS */
+static float        *s_max_scores;      /* fast NMS: top class score of every anchor */
+static int          *s_max_class;
 
 /* Attrubutes of TFLite_Detection_PostProcess */
 #define ATTR_X_SCALE                      10.0
@@ -99,107 +107,39 @@ DecodeCenterSizeBoxes (float *decoded_boxes, const float *input_box_encodings)
 }
 
 
-void DecreasingPartialArgSort(const float* values, int num_values,
-                              int num_to_sort, int* indices) {
-  std::iota(indices, indices + num_values, 0);
-  std::partial_sort(
-      indices, indices + num_to_sort, indices + num_values,
-      [&values](const int i, const int j) { return values[i] > values[j]; });
-}
-
-
-void SelectDetectionsAboveScoreThreshold(const std::vector<float>& values,
-                                         const float threshold,
-                                         std::vector<float>* keep_values,
-                                         std::vector<int>* keep_indices) {
-  for (unsigned int i = 0; i < values.size(); i++) {
-    if (values[i] >= threshold) {
-      keep_values->emplace_back(values[i]);
-      keep_indices->emplace_back(i);
-    }
-  }
-}
-
+/*
+ *  The NMS below keeps the logic of the TFLite kernel, but the candidates go
+ *  into box_array_t (util_box_array) instead of per-frame std::vectors, so a
+ *  frame does not allocate. box_array_nms () drops a box at IoU >= threshold
+ *  where the kernel drops it at IoU > threshold.
+ */
+#if ATTR_MAX_CLASSES_PER_DETECTION != 1
+#error "only the top class of an anchor is kept"
+#endif
 
-float ComputeIntersectionOverUnion(const float* decoded_boxes,
-                                   const int i, const int j) {
-  auto& box_i = reinterpret_cast<const BoxCornerEncoding*>(decoded_boxes)[i];
-  auto& box_j = reinterpret_cast<const BoxCornerEncoding*>(decoded_boxes)[j];
-  const float area_i = (box_i.ymax - box_i.ymin) * (box_i.xmax - box_i.xmin);
-  const float area_j = (box_j.ymax - box_j.ymin) * (box_j.xmax - box_j.xmin);
-  if (area_i <= 0 || area_j <= 0) return 0.0;
-  const float intersection_ymin = std::max<float>(box_i.ymin, box_j.ymin);
-  const float intersection_xmin = std::max<float>(box_i.xmin, box_j.xmin);
-  const float intersection_ymax = std::min<float>(box_i.ymax, box_j.ymax);
-  const float intersection_xmax = std::min<float>(box_i.xmax, box_j.xmax);
-  const float intersection_area =
-      std::max<float>(intersection_ymax - intersection_ymin, 0.0) *
-      std::max<float>(intersection_xmax - intersection_xmin, 0.0);
-  return intersection_area / (area_i + area_j - intersection_area);
-}
+/* candidates above the score threshold of a single class, then NMS */
+static int
+NonMaxSuppressionSingleClass (const float *decoded_boxes, const float *scores, int stride,
+                              int max_detections, int *selected)
+{
+    box_array_clear (&s_cand_boxes);
 
+    for (int row = 0; row < s_anchors_count; row ++)
+    {
+        float score = scores[row * stride];
+        if (score < ATTR_NMS_SCORE_THRESHOLD)
+            continue;
 
-// NonMaxSuppressionSingleClass() prunes out the box locations with high overlap
-// before selecting the highest scoring boxes (max_detections in number)
-// It assumes all boxes are good in beginning and sorts based on the scores.
-// If lower-scoring box has too much overlap with a higher-scoring box,
-// we get rid of the lower-scoring box.
-// Complexity is O(N^2) pairwise comparison between boxes
-int
-NonMaxSuppressionSingleClassHelper(const float *decoded_boxes,
-                                   const std::vector<float>& scores, 
-                                   std::vector<int>* selected, int max_detections) {
-
-    const float non_max_suppression_score_threshold = ATTR_NMS_SCORE_THRESHOLD;
-    const float intersection_over_union_threshold   = ATTR_NMS_IOU_THRESHOLD;
-
-    // threshold scores
-    std::vector<int> keep_indices;
-    // TODO (chowdhery): Remove the dynamic allocation and replace it
-    // with temporaries, esp for std::vector<float>
-    std::vector<float> keep_scores;
-    SelectDetectionsAboveScoreThreshold(
-        scores, non_max_suppression_score_threshold, &keep_scores, &keep_indices);
-
-    int num_scores_kept = keep_scores.size();
-    std::vector<int> sorted_indices;
-    sorted_indices.resize(num_scores_kept);
-    DecreasingPartialArgSort(keep_scores.data(), num_scores_kept, num_scores_kept,
-                                sorted_indices.data());
-    const int num_boxes_kept = num_scores_kept;
-    const unsigned int output_size = std::min(num_boxes_kept, max_detections);
-    selected->clear();
-
-    int num_active_candidate = num_boxes_kept;
-    uint8_t* active_box_candidate = s_active_candidate;
-    for (int row = 0; row < num_boxes_kept; row++) {
-        active_box_candidate[row] = 1;
+        auto& box = reinterpret_cast<const BoxCornerEncoding*>(decoded_boxes)[row];
+        box_array_push (&s_cand_boxes, score, box.xmin, box.ymin, box.xmax, box.ymax, row);
     }
 
-    for (int i = 0; i < num_boxes_kept; ++i) {
-        if (num_active_candidate == 0 || selected->size() >= output_size) break;
-        if (active_box_candidate[i] == 1) {
-            selected->push_back(keep_indices[sorted_indices[i]]);
-            active_box_candidate[i] = 0;
-            num_active_candidate--;
-        } else {
-            continue;
-        }
+    int num_sel = box_array_nms (&s_cand_boxes, ATTR_NMS_IOU_THRESHOLD, s_sel, max_detections);
 
-        for (int j = i + 1; j < num_boxes_kept; ++j) {
-            if (active_box_candidate[j] == 1) {
-                float intersection_over_union = ComputeIntersectionOverUnion(
-                    decoded_boxes, keep_indices[sorted_indices[i]],
-                    keep_indices[sorted_indices[j]]);
-
-                if (intersection_over_union > intersection_over_union_threshold) {
-                    active_box_candidate[j] = 0;
-                    num_active_candidate--;
-                }
-            }
-        }
-    }
-    return 0;
+    /* slot indices --> anchor indices */
+    for (int i = 0; i < num_sel; i ++)
+        selected[i] = s_cand_boxes.id[s_sel[i]];
+    return num_sel;
 }
 
 
@@ -210,96 +150,48 @@ NonMaxSuppressionSingleClassHelper(const float *decoded_boxes,
 // 3) The worst runtime of the regular NMS is O(K*N^2)
 // where N is the number of anchors and K the number of
 // classes.
-int
-NonMaxSuppressionMultiClassRegularHelper(std::vector<DetectionBox> &detection_boxes, 
-                                         const float *decoded_boxes, const float* scores) {
-    const int num_boxes   = s_anchors_count;
+static int
+NonMaxSuppressionMultiClassRegular (DetectionBox *detection_boxes, int max_boxes,
+                                    const float *decoded_boxes, const float* scores)
+{
     const int num_classes = ATTR_NUM_CLASSES;
-    const int num_detections_per_class = ATTR_DETECTIONS_PER_CLASS;
-    const int max_detections = ATTR_MAX_DETECTIONS;
 
     // The row index offset is 1 if background class is included and 0 otherwise.
     const int label_offset = 1;
     const int num_classes_with_background = num_classes + label_offset;
 
-    // For each class, perform non-max suppression.
-    std::vector<float> class_scores(num_boxes);
-
-    std::vector<int> box_indices_after_regular_non_max_suppression(num_boxes + max_detections);
-    std::vector<float> scores_after_regular_non_max_suppression(num_boxes +  max_detections);
+    /* the top ATTR_MAX_DETECTIONS over all the classes (a bounded min-heap) */
+    box_array_clear (&s_top_boxes);
 
-    int size_of_sorted_indices = 0;
-    std::vector<int> sorted_indices;
-    sorted_indices.resize(num_boxes + max_detections);
-    std::vector<float> sorted_values;
-    sorted_values.resize(max_detections);
-
-    for (int col = 0; col < num_classes; col++) {
-        for (int row = 0; row < num_boxes; row++) {
-            // Get scores of boxes corresponding to all anchors for single class
-            class_scores[row] =
-                *(scores + row * num_classes_with_background + col + label_offset);
-        }
-        // Perform non-maximal suppression on single class
-        std::vector<int> selected;
-        NonMaxSuppressionSingleClassHelper(decoded_boxes, class_scores, &selected, num_detections_per_class);
-
-        // Add selected indices from non-max suppression of boxes in this class
-        int output_index = size_of_sorted_indices;
-        for (const auto& selected_index : selected) {
-            box_indices_after_regular_non_max_suppression[output_index] =
-                (selected_index * num_classes_with_background + col + label_offset);
-            scores_after_regular_non_max_suppression[output_index] =
-                class_scores[selected_index];
-            output_index++;
-        }
-
-        // Sort the max scores among the selected indices
-        // Get the indices for top scores
-        int num_indices_to_sort = std::min(output_index, max_detections);
-        DecreasingPartialArgSort(scores_after_regular_non_max_suppression.data(),
-                             output_index, num_indices_to_sort,
-                             sorted_indices.data());
-
-        // Copy values to temporary vectors
-        for (int row = 0; row < num_indices_to_sort; row++) {
-            int temp = sorted_indices[row];
-            sorted_indices[row] = box_indices_after_regular_non_max_suppression[temp];
-            sorted_values[row] = scores_after_regular_non_max_suppression[temp];
-        }
-        // Copy scores and indices from temporary vectors
-        for (int row = 0; row < num_indices_to_sort; row++) {
-            box_indices_after_regular_non_max_suppression[row] = sorted_indices[row];
-            scores_after_regular_non_max_suppression[row] = sorted_values[row];
+    for (int col = 0; col < num_classes; col++)
+    {
+        const float *class_scores = scores + col + label_offset;
+        int num_sel = NonMaxSuppressionSingleClass (decoded_boxes, class_scores,
+                                                    num_classes_with_background,
+                                                    ATTR_DETECTIONS_PER_CLASS, s_selected);
+
+        for (int i = 0; i < num_sel; i ++)
+        {
+            int row = s_selected[i];
+            auto& box = reinterpret_cast<const BoxCornerEncoding*>(decoded_boxes)[row];
+            box_array_push (&s_top_boxes, class_scores[row * num_classes_with_background],
+                            box.xmin, box.ymin, box.xmax, box.ymax, row * num_classes + col);
         }
-        size_of_sorted_indices = num_indices_to_sort;
     }
 
-    // Allocate output tensors
-    for (int output_box_index = 0; output_box_index < max_detections; output_box_index++) {
-        if (output_box_index < size_of_sorted_indices) {
-            const int anchor_index = floor(
-                        box_indices_after_regular_non_max_suppression[output_box_index] /
-                        num_classes_with_background);
-            const int class_index =
-                        box_indices_after_regular_non_max_suppression[output_box_index] -
-                        anchor_index * num_classes_with_background - label_offset;
-            const float selected_score =
-                        scores_after_regular_non_max_suppression[output_box_index];
-
-            BoxCornerEncoding box = reinterpret_cast<const BoxCornerEncoding*>(s_decoded_boxes)[anchor_index];
-
-            detection_boxes.push_back({box.xmin, box.ymin,
-                                       box.xmax, box.ymax,
-                                       selected_score, class_index});
-        } else {
-        }
+    int num = box_array_sort (&s_top_boxes, s_sel, std::min (max_boxes, ATTR_MAX_DETECTIONS));
+    for (int i = 0; i < num; i ++)
+    {
+        int slot = s_sel[i];
+        DetectionBox *det = &detection_boxes[i];
+        det->x1       = s_top_boxes.x0[slot];
+        det->y1       = s_top_boxes.y0[slot];
+        det->x2       = s_top_boxes.x1[slot];
+        det->y2       = s_top_boxes.y1[slot];
+        det->score    = s_top_boxes.score[slot];
+        det->class_id = s_top_boxes.id[slot] % num_classes;
     }
-
-    box_indices_after_regular_non_max_suppression.clear();
-    scores_after_regular_non_max_suppression.clear();
-
-    return 0;
+    return num;
 }
 
 
@@ -310,61 +202,47 @@ NonMaxSuppressionMultiClassRegularHelper(std::vector<DetectionBox> &detection_bo
 // 3) Compared to standard NMS, the worst runtime of this version is O(N^2)
 // instead of O(KN^2) where N is the number of anchors and K the number of
 // classes.
-int
-NonMaxSuppressionMultiClassFastHelper (std::vector<DetectionBox> &detection_boxes, 
-                                       const float *decoded_boxes, const float* scores) {
-    const int num_boxes   = s_anchors_count;
+static int
+NonMaxSuppressionMultiClassFast (DetectionBox *detection_boxes, int max_boxes,
+                                 const float *decoded_boxes, const float* scores)
+{
     const int num_classes = ATTR_NUM_CLASSES;
-    const int max_categories_per_anchor = ATTR_MAX_CLASSES_PER_DETECTION;
 
     // The row index offset is 1 if background class is included and 0 otherwise.
     const int label_offset = 1;
     const int num_classes_with_background = num_classes + label_offset;
-    const int num_categories_per_anchor   = std::min(max_categories_per_anchor, num_classes);
-
-    std::vector<float> max_scores;
-    max_scores.resize(num_boxes);
-    std::vector<int> sorted_class_indices;
-    sorted_class_indices.resize(num_boxes * num_classes);
-
-    for (int row = 0; row < num_boxes; row++) {
-        const float* box_scores =
-                    scores + row * num_classes_with_background + label_offset;
-        int* class_indices = sorted_class_indices.data() + row * num_classes;
-        DecreasingPartialArgSort(box_scores, num_classes, num_categories_per_anchor,
-                             class_indices);
-        max_scores[row] = box_scores[class_indices[0]];
+
+    /* the top class of every anchor (ties: the lower class index) */
+    for (int row = 0; row < s_anchors_count; row++)
+    {
+        const float* box_scores = scores + row * num_classes_with_background + label_offset;
+        int top = 0;
+        for (int col = 1; col < num_classes; col ++)
+        {
+            if (box_scores[col] > box_scores[top])
+                top = col;
+        }
+        s_max_scores[row] = box_scores[top];
+        s_max_class [row] = top;
     }
 
     // Perform non-maximal suppression on max scores
-    std::vector<int> selected;
-    NonMaxSuppressionSingleClassHelper(decoded_boxes, max_scores, &selected, ATTR_MAX_DETECTIONS);
-
-    // Allocate output tensors
-    for (const auto& selected_index : selected) {
-        const float* box_scores =
-                scores + selected_index * num_classes_with_background + label_offset;
-        const int* class_indices =
-                sorted_class_indices.data() + selected_index * num_classes;
-
-        for (int col = 0; col < num_categories_per_anchor; ++col) {
-
-            // detection_boxes
-            BoxCornerEncoding box = reinterpret_cast<const BoxCornerEncoding*>(decoded_boxes)[selected_index];
-
-            // detection_classes
-            int class_index = class_indices[col];
-
-            // detection_scores
-            float score = box_scores[class_index];
+    int num_sel = NonMaxSuppressionSingleClass (decoded_boxes, s_max_scores, 1,
+                                                std::min (max_boxes, ATTR_MAX_DETECTIONS), s_selected);
 
-            detection_boxes.push_back({box.xmin, box.ymin,
-                                       box.xmax, box.ymax,
-                                       score, class_index});
-        }
+    for (int i = 0; i < num_sel; i ++)
+    {
+        int row = s_selected[i];
+        auto& box = reinterpret_cast<const BoxCornerEncoding*>(decoded_boxes)[row];
+        DetectionBox *det = &detection_boxes[i];
+        det->x1       = box.xmin;
+        det->y1       = box.ymin;
+        det->x2       = box.xmax;
+        det->y2       = box.ymax;
+        det->score    = s_max_scores[row];
+        det->class_id = s_max_class[row];
     }
-
-    return 0;
+    return num_sel;
 }
 
 
@@ -413,17 +291,28 @@ init_detect_postprocess (std::string filename)
     }
 #endif
 
-    s_decoded_boxes    = new float  [s_anchors_count * 4];
-    s_active_candidate = new uint8_t[s_anchors_count];
+    s_decoded_boxes = new float[s_anchors_count * 4];
+    s_sel           = new int  [s_anchors_count];
+    s_selected      = new int  [s_anchors_count];
+    s_max_scores    = new float[s_anchors_count];
+    s_max_class     = new int  [s_anchors_count];
+
+    if (box_array_init (&s_cand_boxes, s_anchors_count) < 0 ||
+        box_array_init (&s_top_boxes,  ATTR_MAX_DETECTIONS) < 0)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
 
     return 0;
 }
 
 
 int
-invoke_detection_postprocess (std::vector<DetectionBox> &detection_boxes,  /* [OUT] */
-                              const float *boxes_ptr,                      /* [IN ] */
-                              const float *scores_ptr)                     /* [IN ] */
+invoke_detection_postprocess (DetectionBox *detection_boxes,    /* [OUT] */
+                              int max_boxes,
+                              const float *boxes_ptr,           /* [IN ] */
+                              const float *scores_ptr)          /* [IN ] */
 {
     float *decoded_boxes = s_decoded_boxes;
 
@@ -434,14 +323,7 @@ invoke_detection_postprocess (std::vector<DetectionBox> &detection_boxes,  /* [O
     DecodeCenterSizeBoxes (decoded_boxes, boxes_ptr);
 
     if (ATTR_USE_REGULAR_NMS)
-    {
-        NonMaxSuppressionMultiClassRegularHelper(detection_boxes, decoded_boxes, scores_ptr);
-    }
+        return NonMaxSuppressionMultiClassRegular (detection_boxes, max_boxes, decoded_boxes, scores_ptr);
     else
-    {
-        NonMaxSuppressionMultiClassFastHelper (detection_boxes, decoded_boxes, scores_ptr);
-    }
-
-    return 0;
+        return NonMaxSuppressionMultiClassFast (detection_boxes, max_boxes, decoded_boxes, scores_ptr);
 }
-
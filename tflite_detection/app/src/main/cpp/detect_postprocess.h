@@ -17,9 +17,11 @@ struct DetectionBox {
 
 int init_detect_postprocess (std::string filename);
 
+/* returns the number of boxes written to detection_boxes (at most max_boxes) */
 int
-invoke_detection_postprocess (std::vector<DetectionBox> &detection_boxes,  /* [OUT] */
-                              const float *boxes_ptr,                      /* [IN ] */
-                              const float *_scores_ptr);                   /* [IN ] */
+invoke_detection_postprocess (DetectionBox *detection_boxes,    /* [OUT] */
+                              int max_boxes,
+                              const float *boxes_ptr,           /* [IN ] */
+                              const float *scores_ptr);         /* [IN ] */
 
 #endif /* _DETECT_POSTPROCESS_H_ */
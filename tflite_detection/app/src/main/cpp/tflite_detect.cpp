@@ -16,6 +16,7 @@ static tflite_tensor_t  s_tensor_boxes;
 static tflite_tensor_t  s_tensor_scores;
 static float            *s_boxes_buf;
 static float            *s_scores_buf;
+static DetectionBox     s_detection_boxes[MAX_DETECT_OBJS];
 #else
 static tflite_tensor_t  s_tensor_boxes;
 static tflite_tensor_t  s_tensor_scores;
@@ -215,7 +216,6 @@ invoke_detect (detect_result_t *detection)
     }
 
 #if defined (INVOKE_POSTPROCESS_AFTER_TFLITE)
-    std::vector<DetectionBox> detection_boxes = {};
     float *scores = (float *)s_tensor_scores.ptr;
     float *boxes  = (float *)s_tensor_boxes.ptr;
 
@@ -237,10 +237,8 @@ invoke_detect (detect_result_t *detection)
             boxes[i] = (boxes_u8[i] - s_tensor_boxes.quant_zerop) * s_tensor_boxes.quant_scale;
     }
 
-    invoke_detection_postprocess (detection_boxes, boxes, scores);
-
-    int num = detection_boxes.size();
-    num = std::min (num, MAX_DETECT_OBJS);
+    DetectionBox *detection_boxes = s_detection_boxes;
+    int num = invoke_detection_postprocess (detection_boxes, MAX_DETECT_OBJS, boxes, scores);
 
     detection->num = num;
     for (int i = 0; i < num; i ++)
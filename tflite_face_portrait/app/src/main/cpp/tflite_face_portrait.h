@@ -70,8 +70,15 @@ int init_tflite_portrait (const char *face_detect_model_buf,   size_t face_detec
 void *get_face_detect_input_buf (int *w, int *h);
 int  invoke_face_detect (face_detect_result_t *facedet_result);
 
-void  *get_portrait_input_buf (int *w, int *h);
-int invoke_portrait (portrait_result_t *portrait_result);
+/*
+ *  fill the input tensor (FP32, h x w x RGB) with the image of face_id.
+ *  called from the worker threads of the interpreter pool.
+ */
+typedef void (*portrait_feed_func_t) (void *arg, int face_id, void *input_buf, int w, int h);
+
+void get_portrait_input_size (int *w, int *h);
+int  invoke_portrait (int num_faces, portrait_feed_func_t feed, void *feed_arg,
+                      portrait_result_t *portrait_result);
 
 #ifdef __cplusplus
 }
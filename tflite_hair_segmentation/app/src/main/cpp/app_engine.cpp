@@ -10,6 +10,8 @@
 #include "util_pmeter.h"
 #include "util_texture.h"
 #include "util_render2d.h"
+#include "util_segment.h"
+#include "util_frame_diff.h"
 #include "util_matrix.h"
 #include "app_engine.h"
 #include "render_hair.h"
@@ -23,18 +25,25 @@
 #define CAMERA_CROP_WIDTH       480 /* make a src image square */
 #define CAMERA_CROP_HEIGHT      480 /* make a src image square */
 
+#define FRAME_SKIP_THRESH       8.0f    /* luma difference of a grid cell to run the model again */
 
-/* resize image to DNN network input size and convert to fp32. */
-void
+static frame_diff_t s_frame_diff;
+
+
+/*
+ *  resize image to DNN network input size and convert to fp32.
+ *  returns 1 when the image changed, 0 when it did not change since the
+ *  last inference, -1 when no readback buffer was available.
+ */
+int
 feed_segmentation_image (texture_2d_t *srctex, int win_w, int win_h)
 {
     int x, y, w, h;
     float *buf_fp32 = (float *)get_segmentation_input_buf (&w, &h);
     unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
+    unsigned char *pui8 = (unsigned char *)texture_pool_acquire_buffer (w * h * 4);
     if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
+        return -1;
 
     buf_ui8 = pui8;
 
@@ -43,6 +52,12 @@ feed_segmentation_image (texture_2d_t *srctex, int win_w, int win_h)
     glPixelStorei (GL_PACK_ALIGNMENT, 4);
     glReadPixels (0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, buf_ui8);
 
+    if (frame_diff_update (&s_frame_diff, buf_ui8, w, h) == 0)
+    {
+        texture_pool_release_buffer (pui8);
+        return 0;
+    }
+
     /* convert UI8 [0, 255] ==> FP32 [0, 1] */
     float mean =   0.0f;
     float std  = 255.0f;
@@ -61,7 +76,8 @@ feed_segmentation_image (texture_2d_t *srctex, int win_w, int win_h)
         }
     }
 
-    return;
+    texture_pool_release_buffer (pui8);
+    return 1;
 }
 
 static void 
@@ -140,24 +156,23 @@ render_hsv_circle (int x0, int y0, float angle)
     draw_2d_rect (x1 - (q/2), y1 - (q/2), q, q, col_white, 2);
 }
 
+/* colorized label map. the texture is freed in TerminateGLES() with the context */
+static segment_postproc_t s_segment_pp;
+
 //#define RENDER_BY_BLEND 1
 void
 render_segment_result (int ofstx, int ofsty, int draw_w, int draw_h, 
                        texture_2d_t *srctex, segmentation_result_t *segment_ret)
 {
-    float *segmap = segment_ret->segmentmap;
     int segmap_w  = segment_ret->segmentmap_dims[0];
     int segmap_h  = segment_ret->segmentmap_dims[1];
-    int segmap_c  = segment_ret->segmentmap_dims[2];
-    int x, y, c;
-    static unsigned int *imgbuf = NULL;
     float hair_color[4] = {0};
     float back_color[4] = {0};
     static float s_hsv_h = 0.0f;
 
-    if (imgbuf == NULL)
+    if (s_segment_pp.rgba == NULL)
     {
-        imgbuf = (unsigned int *)malloc (segmap_w * segmap_h * sizeof(unsigned int));
+        segment_postproc_init (&s_segment_pp, segmap_w, segmap_h);
     }
 
     s_hsv_h += 5.0f;
@@ -171,47 +186,12 @@ render_segment_result (int ofstx, int ofsty, int draw_w, int draw_h,
     hair_color[3] = lumi;
 #endif
 
-    /* find the most confident class for each pixel. */
-    for (y = 0; y < segmap_h; y ++)
-    {
-        for (x = 0; x < segmap_w; x ++)
-        {
-            int max_id;
-            float conf_max = 0;
-            for (c = 0; c < MAX_SEGMENT_CLASS; c ++)
-            {
-                float confidence = segmap[(y * segmap_w * segmap_c)+ (x * segmap_c) + c];
-                if (c == 0 || confidence > conf_max)
-                {
-                    conf_max = confidence;
-                    max_id = c;
-                }
-            }
-
-            float *col = (max_id > 0) ? hair_color : back_color;
-            unsigned char r = ((int)(col[0] * 255)) & 0xff;
-            unsigned char g = ((int)(col[1] * 255)) & 0xff;
-            unsigned char b = ((int)(col[2] * 255)) & 0xff;
-            unsigned char a = ((int)(col[3] * 255)) & 0xff;
-
-            imgbuf[y * segmap_w + x] = (a << 24) | (b << 16) | (g << 8) | (r);
-        }
-    }
-
-    GLuint texid;
-    glGenTextures (1, &texid );
-    glBindTexture (GL_TEXTURE_2D, texid);
-
-    glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    /* colorize the most confident class of each pixel. */
+    segment_set_class_color (&s_segment_pp, 0, back_color);
+    segment_set_class_color (&s_segment_pp, 1, hair_color);
+    segment_update_texture (&s_segment_pp, segment_ret->labelmap);
 
-    glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
-
-    glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA,
-        segmap_w, segmap_h, 0, GL_RGBA,
-        GL_UNSIGNED_BYTE, imgbuf);
+    GLuint texid = s_segment_pp.tex.texid;
 
 #if !defined (RENDER_BY_BLEND)
     draw_colored_hair (srctex, texid, ofstx, ofsty, draw_w, draw_h, 0, hair_color);
@@ -222,8 +202,6 @@ render_segment_result (int ofstx, int ofsty, int draw_w, int draw_h,
     draw_2d_texture_blendfunc (texid, ofstx, ofsty, draw_w, draw_h, 0, blend_add);
 #endif
 
-    glDeleteTextures (1, &texid);
-
     render_hsv_circle (ofstx + draw_w - 100, ofsty + 100, s_hsv_h);
 }
 
@@ -346,7 +324,8 @@ AppEngine::RenderFrame ()
      * --------------------------------------- */
     int count = glctx.frame_count;
     {
-        segmentation_result_t segment_result;
+        static segmentation_result_t segment_result;
+        static int s_result_valid = 0;
         char strbuf[512];
 
         PMETER_RESET_LAP ();
@@ -361,10 +340,15 @@ AppEngine::RenderFrame ()
         /* --------------------------------------- *
          *  hair segmentation
          * --------------------------------------- */
-        feed_segmentation_image (&srctex, win_w, win_h);
+        /* an unchanged frame (e.g. the static image) keeps the last result */
+        int changed = feed_segmentation_image (&srctex, win_w, win_h);
+
+        if (changed < 0)
+            DBG_LOGE ("ERR: %s(%d): no readback buffer, inference skipped\n", __FILE__, __LINE__);
 
         ttime[2] = pmeter_get_time_ms ();
-        invoke_segmentation (&segment_result);
+        if (changed > 0 && invoke_segmentation (&segment_result) == 0)
+            s_result_valid = 1;
         ttime[3] = pmeter_get_time_ms ();
         invoke_ms = ttime[3] - ttime[2];
 
@@ -374,7 +358,8 @@ AppEngine::RenderFrame ()
         glClear (GL_COLOR_BUFFER_BIT);
         draw_2d_texture_ex (&srctex, draw_x, draw_y, draw_w, draw_h, 0);
 
-        render_segment_result (draw_x, draw_y, draw_w, draw_h, &srctex, &segment_result);
+        if (s_result_valid)
+            render_segment_result (draw_x, draw_y, draw_w, draw_h, &srctex, &segment_result);
 
         /* --------------------------------------- *
          *  post process
@@ -383,7 +368,8 @@ AppEngine::RenderFrame ()
 
         draw_pmeter (0, 40);
 
-        sprintf (strbuf, "Interval:%5.1f [ms]\nTFLite  :%5.1f [ms]", interval, invoke_ms);
+        sprintf (strbuf, "Interval:%5.1f [ms]\nTFLite  :%5.1f [ms]%s", interval, invoke_ms,
+                 (changed > 0) ? "" : (changed == 0) ? " (skip)" : " (no buffer)");
         draw_dbgstr (strbuf, 10, 10);
 
         /* renderer info */
@@ -478,6 +464,8 @@ AppEngine::InitGLES (void)
     ret = init_tflite_segmentation (
         (const char *)m_tflite_model_buf.data(), m_tflite_model_buf.size());
 
+    frame_diff_init (&s_frame_diff, FRAME_DIFF_GRID, FRAME_DIFF_GRID, FRAME_SKIP_THRESH);
+
     setup_imgui (w, h, &imgui_data);
 
     glctx.disp_w = w;
@@ -501,6 +489,9 @@ AppEngine::InitGLES (void)
 void
 AppEngine::TerminateGLES (void)
 {
+    /* pooled texture names belong to this context */
+    texture_pool_destroy ();
+    segment_postproc_free (&s_segment_pp);
     egl_terminate ();
 }
 
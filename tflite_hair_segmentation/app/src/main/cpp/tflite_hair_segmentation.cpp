@@ -5,6 +5,7 @@
 #include "util_tflite.h"
 #include "tflite_hair_segmentation.h"
 #include "util_debug.h"
+#include "util_segment.h"
 #include "custom_ops/max_pool_argmax.h"
 #include "custom_ops/max_unpooling.h"
 #include "custom_ops/transpose_conv_bias.h"
@@ -14,6 +15,7 @@
 static tflite_interpreter_t s_interpreter;
 static tflite_tensor_t      s_tensor_input;
 static tflite_tensor_t      s_tensor_segment;
+static uint8_t              *s_labelmap = NULL;
 
 
 int
@@ -47,6 +49,33 @@ get_segmentation_input_buf (int *w, int *h)
 }
 
 
+/* per-pixel class id of the segment map. */
+static int
+decode_labelmap ()
+{
+    int segmap_w = s_tensor_segment.dims[2];
+    int segmap_h = s_tensor_segment.dims[1];
+    int segmap_c = s_tensor_segment.dims[3];
+
+    if (s_labelmap == NULL)
+    {
+        s_labelmap = (uint8_t *)malloc (segmap_w * segmap_h);
+        if (s_labelmap == NULL)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            return -1;
+        }
+    }
+
+    if (s_tensor_segment.type == kTfLiteUInt8)
+        segment_argmax_uint8 ((uint8_t *)s_tensor_segment.ptr, segmap_w * segmap_h, segmap_c, s_labelmap);
+    else
+        segment_argmax_float ((float   *)s_tensor_segment.ptr, segmap_w * segmap_h, segmap_c, s_labelmap);
+
+    return 0;
+}
+
+
 int
 invoke_segmentation (segmentation_result_t *segment_result)
 {
@@ -61,6 +90,9 @@ invoke_segmentation (segmentation_result_t *segment_result)
     segment_result->segmentmap_dims[1] = s_tensor_segment.dims[1];
     segment_result->segmentmap_dims[2] = s_tensor_segment.dims[3];
 
+    decode_labelmap ();
+    segment_result->labelmap = s_labelmap;
+
     return 0;
 }
 
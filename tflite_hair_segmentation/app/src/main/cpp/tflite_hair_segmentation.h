@@ -5,6 +5,8 @@
 #ifndef TFLITE_HAIR_SEGMENTATION_H_
 #define TFLITE_HAIR_SEGMENTATION_H_
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -19,8 +21,9 @@ extern "C" {
 
 typedef struct _segmentation_result_t
 {
-    float *segmentmap;
-    int   segmentmap_dims[3];
+    float   *segmentmap;
+    int     segmentmap_dims[3];
+    uint8_t *labelmap;          /* [h][w] 0: background, 1: hair */
 } segmentation_result_t;
 
 
@@ -24,8 +24,14 @@
 #define CAMERA_CROP_WIDTH       480 /* make a src image square */
 #define CAMERA_CROP_HEIGHT      480 /* make a src image square */
 
+#define HAND_TRACK_REDETECT_INTERVAL    30      /* palm detection at least every N frames */
+#define HAND_TRACK_SCORE_THRESH         0.5f    /* handflag to keep tracking a hand */
+
 static imgui_data_t s_gui_prop = {0};
 
+static palm_detection_result_t s_palm_track = {0};    /* hand regions for the next frame */
+static int                     s_track_age  = 0;      /* frames since the last palm detection */
+
 
 
 
@@ -36,10 +42,9 @@ feed_palm_detection_image(texture_2d_t *srctex, int win_w, int win_h)
     int x, y, w, h;
     float *buf_fp32 = (float *)get_palm_detection_input_buf (&w, &h);
     unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
+    unsigned char *pui8 = (unsigned char *)texture_pool_acquire_buffer (w * h * 4);
     if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
+        return;
 
     buf_ui8 = pui8;
 
@@ -65,6 +70,7 @@ feed_palm_detection_image(texture_2d_t *srctex, int win_w, int win_h)
         }
     }
 
+    texture_pool_release_buffer (pui8);
     return;
 }
 
@@ -74,10 +80,9 @@ feed_hand_landmark_image(texture_2d_t *srctex, int win_w, int win_h, palm_detect
     int x, y, w, h;
     float *buf_fp32 = (float *)get_hand_landmark_input_buf (&w, &h);
     unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
+    unsigned char *pui8 = (unsigned char *)texture_pool_acquire_buffer (w * h * 4);
     if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
+        return;
 
     buf_ui8 = pui8;
 
@@ -125,6 +130,7 @@ feed_hand_landmark_image(texture_2d_t *srctex, int win_w, int win_h, palm_detect
         }
     }
 
+    texture_pool_release_buffer (pui8);
     return;
 }
 
@@ -683,6 +689,7 @@ AppEngine::setup_imgui (int win_w, int win_h, imgui_data_t *imgui_data)
     s_gui_prop.bone_radius  = 2.0f;
     s_gui_prop.draw_axis    = 0;
     s_gui_prop.draw_pmeter  = 1;
+    s_gui_prop.track_roi    = 1;
     *imgui_data = s_gui_prop;
 }
 
@@ -725,7 +732,16 @@ AppEngine::RenderFrame ()
          *  palm detection
          * --------------------------------------- */
         bool enable_palm_detect = true;
-        if (enable_palm_detect)
+        bool use_tracked_roi    = s_gui_prop.track_roi && (s_palm_track.num > 0) &&
+                                  (s_track_age < HAND_TRACK_REDETECT_INTERVAL);
+        if (use_tracked_roi)
+        {
+            /* ROI tracking: hand regions come from the previous landmarks */
+            palm_ret = s_palm_track;
+            s_track_age ++;
+            invoke_ms0 = 0;
+        }
+        else if (enable_palm_detect)
         {
             feed_palm_detection_image (&srctex, win_w, win_h);
 
@@ -733,6 +749,7 @@ AppEngine::RenderFrame ()
             invoke_palm_detection (&palm_ret, 0);
             ttime[3] = pmeter_get_time_ms ();
             invoke_ms0 = ttime[3] - ttime[2];
+            s_track_age = 0;
         }
         else
         {
@@ -753,6 +770,16 @@ AppEngine::RenderFrame ()
             invoke_ms1 += ttime[5] - ttime[4];
         }
 
+        /*
+         *  regions for the next frame. a lost hand (low handflag) forces
+         *  palm detection, which also picks up hands that newly appeared
+         *  every HAND_TRACK_REDETECT_INTERVAL frames.
+         */
+        s_palm_track = palm_ret;
+        int num_tracked = track_palm_from_landmark (&s_palm_track, hand_ret, HAND_TRACK_SCORE_THRESH);
+        if (num_tracked < palm_ret.num)
+            s_track_age = HAND_TRACK_REDETECT_INTERVAL;
+
         /* --------------------------------------- *
          *  render scene  (right half)
          * --------------------------------------- */
@@ -930,6 +957,8 @@ AppEngine::InitGLES (void)
 void
 AppEngine::TerminateGLES (void)
 {
+    /* pooled texture names belong to this context */
+    texture_pool_destroy ();
     egl_terminate ();
 }
 
@@ -115,10 +115,13 @@ render_gui (imgui_data_t *imgui_data)
 
         bool draw_axis   = imgui_data->draw_axis;
         bool draw_pmeter = imgui_data->draw_pmeter;
+        bool track_roi   = imgui_data->track_roi;
         ImGui::Checkbox("draw_axis",   &draw_axis);
         ImGui::Checkbox("draw_pmeter", &draw_pmeter);
+        ImGui::Checkbox("track_roi",   &track_roi);
         imgui_data->draw_axis   = draw_axis   ? 1 : 0;
         imgui_data->draw_pmeter = draw_pmeter ? 1 : 0;
+        imgui_data->track_roi   = track_roi   ? 1 : 0;
 
         s_win_pos [s_win_num] = ImGui::GetWindowPos  ();
         s_win_size[s_win_num] = ImGui::GetWindowSize ();
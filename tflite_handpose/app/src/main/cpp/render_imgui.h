@@ -25,6 +25,7 @@ typedef struct _imgui_data_t
     float bone_radius;
     int   draw_axis;
     int   draw_pmeter;
+    int   track_roi;        /* skip palm detection between keyframes */
 } imgui_data_t;
 
 int  init_imgui (int width, int height);
@@ -4,8 +4,11 @@
  * ------------------------------------------------ */
 #include "util_tflite.h"
 #include "tflite_handpose.h"
+#include "util_debug.h"
+#include "util_box_array.h"
+#include "util_anchor.h"
 #include "custom_ops/transpose_conv_bias.h"
-#include <list>
+#include <float.h>
 
 
 static tflite_interpreter_t s_palm_interpreter;
@@ -24,7 +27,9 @@ typedef struct Anchor
     float x_center, y_center, w, h;
 } Anchor;
 
-static std::vector<Anchor>  s_anchors;
+static anchor_set_t         s_anchors;
+static box_array_t          s_boxes;            /* one slot per anchor */
+static int                  s_sel[MAX_PALM_NUM];
 
 typedef struct SsdAnchorsCalculatorOptions 
 {
@@ -167,15 +172,35 @@ GenerateAnchors(std::vector<Anchor>* anchors, const SsdAnchorsCalculatorOptions&
 }
 
 
+/*
+ *  GenerateAnchors () of the 256x256 palm detection model below, generated at
+ *  compile time: strides {8, 16, 32, 32, 32} (the three 32s merge into one
+ *  layer), 2 anchors per layer, fixed anchor size (w = h = 1).
+ */
+static constexpr anchor_layer_t s_palm_layers[] = {
+    /* grid_w, grid_h, num, stride, normalized */
+    {32, 32, 2,  8, 1},
+    {16, 16, 2, 16, 1},
+    { 8,  8, 6, 32, 1},
+};
+static constexpr anchor_table_t<2944> s_palm_anchors =
+    make_anchor_table<2944> (s_palm_layers, 3);
+
 static int
-generate_ssd_anchors ()
+generate_ssd_anchors (int input_w, int input_h)
 {
+    if (input_w == 256 && input_h == 256)
+    {
+        anchor_set_static (&s_anchors, s_palm_anchors);
+        return 0;
+    }
+
     SsdAnchorsCalculatorOptions anchor_options;
     anchor_options.num_layers = 5;
     anchor_options.min_scale = 0.1171875;
     anchor_options.max_scale = 0.75;
-    anchor_options.input_size_height = 256;
-    anchor_options.input_size_width  = 256;
+    anchor_options.input_size_height = input_h;
+    anchor_options.input_size_width  = input_w;
     anchor_options.anchor_offset_x  = 0.5f;
     anchor_options.anchor_offset_y  = 0.5f;
 //  anchor_options.feature_map_width .push_back(0);
@@ -190,16 +215,38 @@ generate_ssd_anchors ()
     anchor_options.interpolated_scale_aspect_ratio = 1.0;
     anchor_options.fixed_anchor_size = true;
 
-    GenerateAnchors (&s_anchors, anchor_options);
+    std::vector<Anchor> anchors;
+    GenerateAnchors (&anchors, anchor_options);
 
 #if 0
-    for (int i = 0; i < (int)s_anchors.size(); i ++)
+    for (int i = 0; i < (int)anchors.size(); i ++)
     {
         fprintf (stderr, "[%4d](%f, %f, %f, %f)\n", i,
-            s_anchors[i].x_center, s_anchors[i].y_center, s_anchors[i].w, s_anchors[i].h);
+            anchors[i].x_center, anchors[i].y_center, anchors[i].w, anchors[i].h);
     }
 #endif
 
+    /* only the centers are used (fixed anchor size) */
+    int num = anchors.size ();
+    float *buf = (float *)malloc (num * 2 * sizeof (float));
+    if (buf == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    for (int i = 0; i < num; i ++)
+    {
+        buf[i      ] = anchors[i].x_center;
+        buf[i + num] = anchors[i].y_center;
+    }
+
+    anchor_set_free (&s_anchors);
+    s_anchors.num = num;
+    s_anchors.x   = buf;
+    s_anchors.y   = buf + num;
+    s_anchors.buf = buf;
+
     return 0;
 }
 
@@ -226,7 +273,10 @@ init_tflite_hand_landmark(const char *detect_model_buf, size_t detect_model_size
     tflite_get_tensor_by_name (&s_hand_interpreter, 1, "ld_21_3d",        &s_hand_tensor_landmark);
     tflite_get_tensor_by_name (&s_hand_interpreter, 1, "output_handflag", &s_hand_tensor_handflag);
 
-    generate_ssd_anchors ();
+    if (generate_ssd_anchors (s_palm_tensor_input.dims[2], s_palm_tensor_input.dims[1]) < 0)
+        return -1;
+    if (box_array_init (&s_boxes, s_anchors.num) < 0)
+        return -1;
 
     return 0;
 }
@@ -250,19 +300,25 @@ get_hand_landmark_input_buf (int *w, int *h)
 
 /* -------------------------------------------------- *
  *  Decode palm detection result
- * -------------------------------------------------- */static int
-decode_keypoints (std::list<palm_t> &palm_list, float score_thresh)
+ * -------------------------------------------------- *//*
+ *  only the box and the score of a candidate are decoded here. the keypoints
+ *  are decoded in pack_palm_result () for the palms which survive NMS.
+ */
+static int
+decode_bounds (box_array_t *boxes, float score_thresh)
 {
-    palm_t palm_item;
     float *scores_ptr = (float *)s_palm_tensor_scores.ptr;
     float *points_ptr = (float *)s_palm_tensor_points.ptr;
     int img_w = s_palm_tensor_input.dims[2];
     int img_h = s_palm_tensor_input.dims[1];
+    int num_anchors = s_anchors.num;
+
+    box_array_clear (boxes);
 
-    int i = 0;
-    for (auto itr = s_anchors.begin(); itr != s_anchors.end(); i ++, itr ++)
+    for (int i = 0; i < num_anchors; i ++)
     {
-        Anchor anchor = *itr;
+        float x_center = s_anchors.x[i];
+        float y_center = s_anchors.y[i];
         float score0 = scores_ptr[i];
         float score = 1.0f / (1.0f + exp(-score0));
 
@@ -276,126 +332,46 @@ decode_keypoints (std::list<palm_t> &palm_list, float score_thresh)
             float w  = p[2];
             float h  = p[3];
 
-            float cx = sx + anchor.x_center * img_w;
-            float cy = sy + anchor.y_center * img_h;
+            float cx = sx + x_center * img_w;
+            float cy = sy + y_center * img_h;
 
             cx /= (float)img_w;
             cy /= (float)img_h;
             w  /= (float)img_w;
             h  /= (float)img_h;
 
-            fvec2 topleft, btmright;
-            topleft.x  = cx - w * 0.5f;
-            topleft.y  = cy - h * 0.5f;
-            btmright.x = cx + w * 0.5f;
-            btmright.y = cy + h * 0.5f;
-
-            palm_item.score         = score;
-            palm_item.rect.topleft  = topleft;
-            palm_item.rect.btmright = btmright;
-
-            /* landmark positions (7 keys) */
-            for (int j = 0; j < 7; j ++)
-            {
-                float lx = p[4 + (2 * j) + 0];
-                float ly = p[4 + (2 * j) + 1];
-                lx += anchor.x_center * img_w;
-                ly += anchor.y_center * img_h;
-                lx /= (float)img_w;
-                ly /= (float)img_h;
-
-                palm_item.keys[j].x = lx;
-                palm_item.keys[j].y = ly;
-            }
-
-            palm_list.push_back (palm_item);
+            box_array_push (boxes, score,
+                            cx - w * 0.5f, cy - h * 0.5f,
+                            cx + w * 0.5f, cy + h * 0.5f, i);
         }
     }
     return 0;
 }
 
-
-
-/* -------------------------------------------------- *
- *  Apply NonMaxSuppression:
- * -------------------------------------------------- */
-static float
-calc_intersection_over_union (rect_t &rect0, rect_t &rect1)
-{
-    float sx0 = rect0.topleft.x;
-    float sy0 = rect0.topleft.y;
-    float ex0 = rect0.btmright.x;
-    float ey0 = rect0.btmright.y;
-    float sx1 = rect1.topleft.x;
-    float sy1 = rect1.topleft.y;
-    float ex1 = rect1.btmright.x;
-    float ey1 = rect1.btmright.y;
-    
-    float xmin0 = std::min (sx0, ex0);
-    float ymin0 = std::min (sy0, ey0);
-    float xmax0 = std::max (sx0, ex0);
-    float ymax0 = std::max (sy0, ey0);
-    float xmin1 = std::min (sx1, ex1);
-    float ymin1 = std::min (sy1, ey1);
-    float xmax1 = std::max (sx1, ex1);
-    float ymax1 = std::max (sy1, ey1);
-    
-    float area0 = (ymax0 - ymin0) * (xmax0 - xmin0);
-    float area1 = (ymax1 - ymin1) * (xmax1 - xmin1);
-    if (area0 <= 0 || area1 <= 0)
-        return 0.0f;
-
-    float intersect_xmin = std::max (xmin0, xmin1);
-    float intersect_ymin = std::max (ymin0, ymin1);
-    float intersect_xmax = std::min (xmax0, xmax1);
-    float intersect_ymax = std::min (ymax0, ymax1);
-
-    float intersect_area = std::max (intersect_ymax - intersect_ymin, 0.0f) *
-                           std::max (intersect_xmax - intersect_xmin, 0.0f);
-    
-    return intersect_area / (area0 + area1 - intersect_area);
-}
-
-static bool
-compare (palm_t &v1, palm_t &v2)
+static void
+decode_keys (palm_t *palm, int anchor_idx)
 {
-    if (v1.score > v2.score)
-        return true;
-    else
-        return false;
-}
+    float *points_ptr = (float *)s_palm_tensor_points.ptr;
+    int img_w = s_palm_tensor_input.dims[2];
+    int img_h = s_palm_tensor_input.dims[1];
 
-static int
-non_max_suppression (std::list<palm_t> &face_list, std::list<palm_t> &face_sel_list, float iou_thresh)
-{
-    face_list.sort (compare);
+    float x_center = s_anchors.x[anchor_idx];
+    float y_center = s_anchors.y[anchor_idx];
+    float *p = points_ptr + (anchor_idx * 18);
 
-    for (auto itr = face_list.begin(); itr != face_list.end(); itr ++)
+    /* landmark positions (7 keys) */
+    for (int j = 0; j < 7; j ++)
     {
-        palm_t face_candidate = *itr;
-
-        int ignore_candidate = false;
-        for (auto itr_sel = face_sel_list.rbegin(); itr_sel != face_sel_list.rend(); itr_sel ++)
-        {
-            palm_t face_sel = *itr_sel;
-
-            float iou = calc_intersection_over_union (face_candidate.rect, face_sel.rect);
-            if (iou >= iou_thresh)
-            {
-                ignore_candidate = true;
-                break;
-            }
-        }
-
-        if (!ignore_candidate)
-        {
-            face_sel_list.push_back(face_candidate);
-            if (face_sel_list.size() >= MAX_PALM_NUM)
-                break;
-        }
+        float lx = p[4 + (2 * j) + 0];
+        float ly = p[4 + (2 * j) + 1];
+        lx += x_center * img_w;
+        ly += y_center * img_h;
+        lx /= (float)img_w;
+        ly /= (float)img_h;
+
+        palm->keys[j].x = lx;
+        palm->keys[j].y = ly;
     }
-
-    return 0;
 }
 
 
@@ -486,24 +462,27 @@ compute_hand_rect (palm_t &palm)
     }
 }
 
+/* sel[]: slot indices of the boxes to output (box_array_nms () or box_array_sort ()) */
 static void
-pack_palm_result (palm_detection_result_t *palm_result, std::list<palm_t> &palm_list)
+pack_palm_result (palm_detection_result_t *palm_result, box_array_t *boxes, int *sel, int num_sel)
 {
-    int num_palms = 0;
-    for (auto itr = palm_list.begin(); itr != palm_list.end(); itr ++)
+    int num_palms = std::min (num_sel, MAX_PALM_NUM);
+    for (int i = 0; i < num_palms; i ++)
     {
-        palm_t palm = *itr;
-        
-        compute_rotation (palm);
-        compute_hand_rect (palm);
+        palm_t &palm = palm_result->palms[i];
+        int    slot  = sel[i];
 
-        memcpy (&palm_result->palms[num_palms], &palm, sizeof (palm));
-        num_palms ++;
-        palm_result->num = num_palms;
+        palm.score              = boxes->score[slot];
+        palm.rect.topleft.x     = boxes->x0[slot];
+        palm.rect.topleft.y     = boxes->y0[slot];
+        palm.rect.btmright.x    = boxes->x1[slot];
+        palm.rect.btmright.y    = boxes->y1[slot];
+        decode_keys (&palm, boxes->id[slot]);
 
-        if (num_palms >= MAX_PALM_NUM)
-            break;
+        compute_rotation (palm);
+        compute_hand_rect (palm);
     }
+    palm_result->num = num_palms;
 }
 
 
@@ -521,19 +500,19 @@ detect_palm (palm_detection_result_t *palm_result)
     }
 
     float score_thresh = 0.7f;
-    std::list<palm_t> palm_list;
+    int   num_sel;
 
-    decode_keypoints (palm_list, score_thresh);
+    decode_bounds (&s_boxes, score_thresh);
 
 #if 1 /* USE NMS */
     float iou_thresh = 0.03f;
-    std::list<palm_t> palm_nms_list;
 
-    non_max_suppression (palm_list, palm_nms_list, iou_thresh);
-    pack_palm_result (palm_result, palm_nms_list);
+    num_sel = box_array_nms (&s_boxes, iou_thresh, s_sel, MAX_PALM_NUM);
 #else
-    pack_palm_result (palm_result, palm_list);
+    /* without NMS the boxes are kept in anchor order */
+    num_sel = box_array_list (&s_boxes, s_sel, MAX_PALM_NUM);
 #endif
+    pack_palm_result (palm_result, &s_boxes, s_sel, num_sel);
 
     return 0;
 }
@@ -572,6 +551,73 @@ invoke_palm_detection (palm_detection_result_t *palm_result, int flag)
 
 
 
+/* -------------------------------------------------- *
+ *  ROI tracking (palm region from the previous landmarks)
+ * -------------------------------------------------- */
+static void
+landmark_to_global (palm_t &palm, fvec3 &joint, fvec2 &pos)
+{
+    /*
+     *  the landmark crop is the rotated hand region:
+     *      (0,0) -> hand_pos[0], (1,0) -> hand_pos[1], (0,1) -> hand_pos[3]
+     */
+    float u = joint.x;
+    float v = joint.y;
+    pos.x = palm.hand_pos[0].x + u * (palm.hand_pos[1].x - palm.hand_pos[0].x)
+                               + v * (palm.hand_pos[3].x - palm.hand_pos[0].x);
+    pos.y = palm.hand_pos[0].y + u * (palm.hand_pos[1].y - palm.hand_pos[0].y)
+                               + v * (palm.hand_pos[3].y - palm.hand_pos[0].y);
+}
+
+int
+track_palm_from_landmark (palm_detection_result_t *palm_result,
+                          hand_landmark_result_t *hand_result, float score_thresh)
+{
+    /* wrist, thumb CMC and the MCP of each finger span the palm */
+    static const int palm_joints[] = {0, 1, 5, 9, 13, 17};
+    int num_palms = 0;
+
+    for (int i = 0; i < palm_result->num; i ++)
+    {
+        if (hand_result[i].score < score_thresh)
+            continue;
+
+        palm_t prev = palm_result->palms[i];
+        palm_t palm = prev;
+        fvec2  pmin = { FLT_MAX,  FLT_MAX};
+        fvec2  pmax = {-FLT_MAX, -FLT_MAX};
+
+        for (unsigned int j = 0; j < sizeof (palm_joints) / sizeof (palm_joints[0]); j ++)
+        {
+            fvec2 pos;
+            landmark_to_global (prev, hand_result[i].joint[palm_joints[j]], pos);
+            pmin.x = std::min (pmin.x, pos.x);
+            pmin.y = std::min (pmin.y, pos.y);
+            pmax.x = std::max (pmax.x, pos.x);
+            pmax.y = std::max (pmax.y, pos.y);
+        }
+
+        /* same keys as the palm detector: [0] wrist center, [2] MCP of middle finger */
+        landmark_to_global (prev, hand_result[i].joint[0], palm.keys[0]);
+        landmark_to_global (prev, hand_result[i].joint[9], palm.keys[2]);
+
+        palm.score         = hand_result[i].score;
+        palm.rect.topleft  = pmin;
+        palm.rect.btmright = pmax;
+
+        compute_rotation (palm);
+        compute_hand_rect (palm);
+
+        palm_result->palms[num_palms] = palm;
+        num_palms ++;
+    }
+
+    palm_result->num = num_palms;
+    return num_palms;
+}
+
+
+
 /* -------------------------------------------------- *
  * Invoke TensorFlow Lite (Hand landmark)
  * -------------------------------------------------- */
@@ -79,6 +79,14 @@ int   invoke_palm_detection (palm_detection_result_t *palm_result, int flag);
 void  *get_hand_landmark_input_buf (int *w, int *h);
 int   invoke_hand_landmark (hand_landmark_result_t *hand_landmark_result);
 
+/*
+ *  ROI tracking: replace each palm with the region derived from its hand
+ *  landmarks so that the next frame can skip palm detection. Hands whose
+ *  score is below score_thresh are dropped. Returns the number of palms kept.
+ */
+int   track_palm_from_landmark (palm_detection_result_t *palm_result,
+                                hand_landmark_result_t *hand_landmark_result, float score_thresh);
+
 #ifdef __cplusplus
 }
 #endif
@@ -15,6 +15,7 @@
 #include "assertgl.h"
 #include "util_matrix.h"
 #include "tflite_facemesh.h"
+#include "facemesh_graph.h"
 
 #define UNUSED(x) (void)(x)
 
@@ -23,197 +24,13 @@
 #define CAMERA_CROP_WIDTH       480 /* make a src image square */
 #define CAMERA_CROP_HEIGHT      480 /* make a src image square */
 
+#define FACE_TRACK_REDETECT_INTERVAL    30      /* face detection at least every N frames */
+#define FACE_TRACK_SCORE_THRESH         0.5f    /* mesh score to keep tracking a face */
 
-/* resize image to DNN network input size and convert to fp32. */
-void
-feed_face_detect_image(texture_2d_t *srctex, int win_w, int win_h)
-{
-    int x, y, w, h;
-    float *buf_fp32 = (float *)get_face_detect_input_buf (&w, &h);
-    unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
-    if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
-
-    buf_ui8 = pui8;
-
-    draw_2d_texture_ex (srctex, 0, win_h - h, w, h, RENDER2D_FLIP_V);
-
-    glPixelStorei (GL_PACK_ALIGNMENT, 4);
-    glReadPixels (0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, buf_ui8);
-
-    /* convert UI8 [0, 255] ==> FP32 [-1, 1] */
-    float mean = 128.0f;
-    float std  = 128.0f;
-    for (y = 0; y < h; y ++)
-    {
-        for (x = 0; x < w; x ++)
-        {
-            int r = *buf_ui8 ++;
-            int g = *buf_ui8 ++;
-            int b = *buf_ui8 ++;
-            buf_ui8 ++;          /* skip alpha */
-            *buf_fp32 ++ = (float)(r - mean) / std;
-            *buf_fp32 ++ = (float)(g - mean) / std;
-            *buf_fp32 ++ = (float)(b - mean) / std;
-        }
-    }
-
-    return;
-}
-
-void
-feed_face_landmark_image(texture_2d_t *srctex, int win_w, int win_h, face_detect_result_t *detection, unsigned int face_id)
-{
-    int x, y, w, h;
-    float *buf_fp32 = (float *)get_facemesh_landmark_input_buf (&w, &h);
-    unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
-    if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
-
-    buf_ui8 = pui8;
-
-    float texcoord[] = { 0.0f, 1.0f,
-                         0.0f, 0.0f,
-                         1.0f, 1.0f,
-                         1.0f, 0.0f };
-
-    if (detection->num > face_id)
-    {
-        face_t *face = &(detection->faces[face_id]);
-        float x0 = face->face_pos[0].x;
-        float y0 = face->face_pos[0].y;
-        float x1 = face->face_pos[1].x; //    0--------1
-        float y1 = face->face_pos[1].y; //    |        |
-        float x2 = face->face_pos[2].x; //    |        |
-        float y2 = face->face_pos[2].y; //    3--------2
-        float x3 = face->face_pos[3].x;
-        float y3 = face->face_pos[3].y;
-        texcoord[0] = x3;   texcoord[1] = y3;
-        texcoord[2] = x0;   texcoord[3] = y0;
-        texcoord[4] = x2;   texcoord[5] = y2;
-        texcoord[6] = x1;   texcoord[7] = y1;
-    }
-
-    draw_2d_texture_ex_texcoord (srctex, 0, win_h - h, w, h, texcoord);
-
-    glPixelStorei (GL_PACK_ALIGNMENT, 4);
-    glReadPixels (0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, buf_ui8);
-
-    /* convert UI8 [0, 255] ==> FP32 [0, 1] */
-    float mean = 0.0f;
-    float std  = 255.0f;
-    for (y = 0; y < h; y ++)
-    {
-        for (x = 0; x < w; x ++)
-        {
-            int r = *buf_ui8 ++;
-            int g = *buf_ui8 ++;
-            int b = *buf_ui8 ++;
-            buf_ui8 ++;          /* skip alpha */
-            *buf_fp32 ++ = (float)(r - mean) / std;
-            *buf_fp32 ++ = (float)(g - mean) / std;
-            *buf_fp32 ++ = (float)(b - mean) / std;
-        }
-    }
-
-    return;
-}
+static face_detect_result_t s_face_track = {0};   /* face regions for the next frame */
+static int                  s_track_age  = 0;     /* frames since the last face detection */
 
-
-void
-feed_iris_landmark_image(texture_2d_t *srctex, int win_w, int win_h, 
-                         face_t *face, face_landmark_result_t *facemesh, int eye_id)
-{
-    int x, y, w, h;
-    float *buf_fp32 = (float *)get_irismesh_landmark_input_buf (&w, &h);
-    unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
-    if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
-
-    buf_ui8 = pui8;
-
-    float texcoord[8];
-
-    float scale_x = face->face_w;
-    float scale_y = face->face_h;
-    float pivot_x = face->face_cx;
-    float pivot_y = face->face_cy;
-    float rotation= face->rotation;
-    
-    float x0 = facemesh->eye_pos[eye_id][0].x;
-    float y0 = facemesh->eye_pos[eye_id][0].y;
-    float x1 = facemesh->eye_pos[eye_id][1].x; //    0--------1
-    float y1 = facemesh->eye_pos[eye_id][1].y; //    |        |
-    float x2 = facemesh->eye_pos[eye_id][2].x; //    |        |
-    float y2 = facemesh->eye_pos[eye_id][2].y; //    3--------2
-    float x3 = facemesh->eye_pos[eye_id][3].x;
-    float y3 = facemesh->eye_pos[eye_id][3].y;
-
-    float mat[16];
-    float vec[4][2] = {{x0, y0}, {x1, y1}, {x2, y2}, {x3, y3}};
-    matrix_identity (mat);
-    
-    matrix_translate (mat, pivot_x, pivot_y, 0);
-    matrix_rotate (mat, RAD_TO_DEG(rotation), 0, 0, 1);
-    matrix_scale (mat, scale_x, scale_y, 1.0f);
-    matrix_translate (mat, -0.5f, -0.5f, 0);
-
-    matrix_multvec2 (mat, vec[0], vec[0]);
-    matrix_multvec2 (mat, vec[1], vec[1]);
-    matrix_multvec2 (mat, vec[2], vec[2]);
-    matrix_multvec2 (mat, vec[3], vec[3]);
-
-    x0 = vec[0][0];  y0 = vec[0][1];
-    x1 = vec[1][0];  y1 = vec[1][1];
-    x2 = vec[2][0];  y2 = vec[2][1];
-    x3 = vec[3][0];  y3 = vec[3][1];
-
-    /* Upside down */
-    if (eye_id == 0)
-    {
-        texcoord[0] = x3;   texcoord[1] = y3;
-        texcoord[2] = x0;   texcoord[3] = y0;
-        texcoord[4] = x2;   texcoord[5] = y2;
-        texcoord[6] = x1;   texcoord[7] = y1;
-    }
-    else /* need to horizontal flip for right eye */
-    {
-        texcoord[0] = x2;   texcoord[1] = y2;
-        texcoord[2] = x1;   texcoord[3] = y1;
-        texcoord[4] = x3;   texcoord[5] = y3;
-        texcoord[6] = x0;   texcoord[7] = y0;
-    }
-
-    draw_2d_texture_ex_texcoord (srctex, 0, win_h - h, w, h, texcoord);
-
-    glPixelStorei (GL_PACK_ALIGNMENT, 4);
-    glReadPixels (0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, buf_ui8);
-
-    /* convert UI8 [0, 255] ==> FP32 [-1, 1] */
-    float mean = 0.0f;
-    float std  = 255.0f;
-    for (y = 0; y < h; y ++)
-    {
-        for (x = 0; x < w; x ++)
-        {
-            int r = *buf_ui8 ++;
-            int g = *buf_ui8 ++;
-            int b = *buf_ui8 ++;
-            buf_ui8 ++;          /* skip alpha */
-            *buf_fp32 ++ = (float)(r - mean) / std;
-            *buf_fp32 ++ = (float)(g - mean) / std;
-            *buf_fp32 ++ = (float)(b - mean) / std;
-        }
-    }
-
-    return;
-}
+static facemesh_graph_t s_facemesh_graph;     /* face_detect --> face_mesh --> iris */
 
 
 static void
@@ -589,25 +406,6 @@ render_iris_landmark_on_main (int ofstx, int ofsty, int texw, int texh,
     }
 }
 
-static void
-flip_horizontal_iris_landmark (irismesh_result_t *irismesh)
-{
-    fvec3 *eye  = irismesh->eye_landmark;
-    fvec3 *iris = irismesh->iris_landmark;
-
-    for (int i = 0; i < 71; i ++)
-    {
-        eye[i].x = 1.0f - eye[i].x;
-    }
-
-    for (int i = 0; i < 5; i ++)
-    {
-        iris[i].x = 1.0f - iris[i].x;
-    }
-
-}
-
-
 void
 AppEngine::DrawTFLiteConfigInfo ()
 {
@@ -702,6 +500,7 @@ AppEngine::setup_imgui (int win_w, int win_h, imgui_data_t *imgui_data)
 #endif
 
     imgui_data->camera_facing  = m_camera_facing;
+    imgui_data->track_roi      = 1;
 }
 
 
@@ -711,7 +510,7 @@ AppEngine::RenderFrame ()
     texture_2d_t srctex = glctx.tex_input;
     int win_w  = glctx.disp_w;
     int win_h  = glctx.disp_h;
-    static double ttime[10] = {0}, interval, invoke_ms0 = 0, invoke_ms1 = 0, invoke_ms2 = 0;
+    static double ttime[10] = {0}, interval, crop_ms = 0, invoke_ms0 = 0, invoke_ms1 = 0, invoke_ms2 = 0;
 
     int draw_x, draw_y, draw_w, draw_h;
     int texw = srctex.width;
@@ -741,47 +540,29 @@ AppEngine::RenderFrame ()
         glViewport (0, 0, win_w, win_h);
 
         /* --------------------------------------- *
-         *  face detection
-         * --------------------------------------- */
-        feed_face_detect_image (&srctex, win_w, win_h);
-
-        ttime[2] = pmeter_get_time_ms ();
-        invoke_face_detect (&face_detect_ret);
-        ttime[3] = pmeter_get_time_ms ();
-        invoke_ms0 = ttime[3] - ttime[2];
-
-        /* --------------------------------------- *
-         *  face landmark
+         *  face detection --> face landmark --> iris landmark
          * --------------------------------------- */
-        invoke_ms1 = 0;
-        for (int face_id = 0; face_id < face_detect_ret.num; face_id ++)
-        {
-            feed_face_landmark_image (&srctex, win_w, win_h, &face_detect_ret, face_id);
-
-            ttime[4] = pmeter_get_time_ms ();
-            invoke_facemesh_landmark (&face_mesh_ret[face_id]);
-            ttime[5] = pmeter_get_time_ms ();
-            invoke_ms1 += ttime[5] - ttime[4];
-        }
-
-        /* --------------------------------------- *
-         *  Iris landmark
-         * --------------------------------------- */
-        invoke_ms2 = 0;
-        for (int face_id = 0; face_id < face_detect_ret.num; face_id ++)
-        {
-            for (int eye_id = 0; eye_id < 2; eye_id ++)
-            {
-                feed_iris_landmark_image (&srctex, win_w, win_h, &face_detect_ret.faces[face_id], &face_mesh_ret[face_id], eye_id);
-
-                ttime[6] = pmeter_get_time_ms ();
-                invoke_irismesh_landmark (&iris_mesh_ret[face_id][eye_id]);
-                ttime[7] = pmeter_get_time_ms ();
-                invoke_ms2 += ttime[7] - ttime[6];
-            }
-            /* need to horizontal flip for right eye */
-            flip_horizontal_iris_landmark (&iris_mesh_ret[face_id][1]);
-        }
+        bool use_tracked_roi = imgui_data.track_roi && (s_face_track.num > 0) &&
+                               (s_track_age < FACE_TRACK_REDETECT_INTERVAL);
+        if (use_tracked_roi)
+            s_track_age ++;
+        else
+            s_track_age = 0;
+
+        s_facemesh_graph.tracked_faces = use_tracked_roi ? &s_face_track : NULL;
+        run_facemesh_graph (&s_facemesh_graph, &srctex, win_w, win_h,
+                            &face_detect_ret, face_mesh_ret, iris_mesh_ret);
+        get_facemesh_graph_time (&s_facemesh_graph, &crop_ms, &invoke_ms0, &invoke_ms1, &invoke_ms2);
+
+        /*
+         *  regions for the next frame. a lost face (low mesh score) forces
+         *  face detection, which also picks up faces that newly appeared
+         *  every FACE_TRACK_REDETECT_INTERVAL frames.
+         */
+        s_face_track = face_detect_ret;
+        int num_tracked = track_face_from_landmark (&s_face_track, face_mesh_ret, FACE_TRACK_SCORE_THRESH);
+        if (num_tracked < face_detect_ret.num)
+            s_track_age = FACE_TRACK_REDETECT_INTERVAL;
 
 
         /* --------------------------------------- *
@@ -846,8 +627,8 @@ AppEngine::RenderFrame ()
 
         draw_pmeter (0, 40);
 
-        sprintf (strbuf, "Interval:%5.1f [ms]\nTFLite0 :%5.1f [ms]\nTFLite1 :%5.1f [ms]\nTFLite2 :%5.1f [ms]",
-            interval, invoke_ms0, invoke_ms1, invoke_ms2);
+        sprintf (strbuf, "Interval:%5.1f [ms]\nCrop    :%5.1f [ms]\nTFLite0 :%5.1f [ms]\nTFLite1 :%5.1f [ms]\nTFLite2 :%5.1f [ms]",
+            interval, crop_ms, invoke_ms0, invoke_ms1, invoke_ms2);
         draw_dbgstr (strbuf, 10, 10);
 
         /* renderer info */
@@ -949,6 +730,9 @@ AppEngine::InitGLES (void)
         (const char *)m_facelandmark_tflite_model_buf.data(), m_facelandmark_tflite_model_buf.size(),
         (const char *)m_irislandmark_tflite_model_buf.data(), m_irislandmark_tflite_model_buf.size());
 
+    /* crop sizes come from the loaded models */
+    create_facemesh_graph (&s_facemesh_graph);
+
     setup_imgui (w, h, &imgui_data);
 
     glctx.disp_w = w;
@@ -972,6 +756,10 @@ AppEngine::InitGLES (void)
 void
 AppEngine::TerminateGLES (void)
 {
+    destroy_facemesh_graph (&s_facemesh_graph);
+
+    /* pooled texture names belong to this context */
+    texture_pool_destroy ();
     egl_terminate ();
 }
 
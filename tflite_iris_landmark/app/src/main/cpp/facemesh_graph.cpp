@@ -0,0 +1,274 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <cstring>
+#include "util_debug.h"
+#include "facemesh_graph.h"
+
+#define UNUSED(x) (void)(x)
+
+/* convert UI8 [0, 255] ==> FP32 [-1, 1] and detect faces. (or take the tracked regions) */
+static void
+run_face_detect (void *ctx, int num_rois, uint8_t * const *rgba, int w, int h, void *results)
+{
+    facemesh_graph_t *fg = (facemesh_graph_t *)ctx;
+    UNUSED (num_rois);
+
+    if (fg->tracked_faces)
+    {
+        /* ROI tracking: face regions come from the previous landmarks */
+        *(face_detect_result_t *)results = *fg->tracked_faces;
+        return;
+    }
+
+    float *buf_fp32 = (float *)get_face_detect_input_buf (&w, &h);
+    const unsigned char *buf_ui8 = rgba[0];
+    int x, y;
+
+    float mean = 128.0f;
+    float std  = 128.0f;
+    for (y = 0; y < h; y ++)
+    {
+        for (x = 0; x < w; x ++)
+        {
+            int r = *buf_ui8 ++;
+            int g = *buf_ui8 ++;
+            int b = *buf_ui8 ++;
+            buf_ui8 ++;          /* skip alpha */
+            *buf_fp32 ++ = (float)(r - mean) / std;
+            *buf_fp32 ++ = (float)(g - mean) / std;
+            *buf_fp32 ++ = (float)(b - mean) / std;
+        }
+    }
+
+    invoke_face_detect ((face_detect_result_t *)results);
+}
+
+/* one ROI per detected face */
+static int
+gen_face_rois (void *ctx, const graph_roi_t *parent_roi, const void *parent_result, graph_roi_t *rois, int max_rois)
+{
+    const face_detect_result_t *detection = (const face_detect_result_t *)parent_result;
+    int num = detection->num < max_rois ? detection->num : max_rois;
+    UNUSED (ctx);
+    UNUSED (parent_roi);    /* the detector ran on the whole frame */
+
+    for (int i = 0; i < num; i ++)
+    {
+        const face_t *face = &detection->faces[i];
+        for (int j = 0; j < 4; j ++)
+        {
+            rois[i].pos[j][0] = face->face_pos[j].x;
+            rois[i].pos[j][1] = face->face_pos[j].y;
+        }
+    }
+    return num;
+}
+
+/* convert UI8 [0, 255] ==> FP32 [0, 1] */
+static void
+convert_face_landmark_input (void *arg, int face_id, void *input_buf, int w, int h)
+{
+    uint8_t * const *rgba = (uint8_t * const *)arg;
+    const unsigned char *buf_ui8 = rgba[face_id];
+    float *buf_fp32 = (float *)input_buf;
+    int x, y;
+
+    float mean = 0.0f;
+    float std  = 255.0f;
+    for (y = 0; y < h; y ++)
+    {
+        for (x = 0; x < w; x ++)
+        {
+            int r = *buf_ui8 ++;
+            int g = *buf_ui8 ++;
+            int b = *buf_ui8 ++;
+            buf_ui8 ++;          /* skip alpha */
+            *buf_fp32 ++ = (float)(r - mean) / std;
+            *buf_fp32 ++ = (float)(g - mean) / std;
+            *buf_fp32 ++ = (float)(b - mean) / std;
+        }
+    }
+
+    return;
+}
+
+/* every face in parallel on the interpreter pool */
+static void
+run_face_mesh (void *ctx, int num_rois, uint8_t * const *rgba, int w, int h, void *results)
+{
+    UNUSED (ctx);
+    UNUSED (w);
+    UNUSED (h);
+
+    invoke_facemesh_landmark (num_rois, convert_face_landmark_input, (void *)rgba,
+                              (face_landmark_result_t *)results);
+}
+
+/*
+ *  two ROIs per face: the eye regions of the mesh, mapped from the face crop
+ *  to the frame. the crop of the right eye (eye 1) is flipped horizontally.
+ */
+static int
+gen_eye_rois (void *ctx, const graph_roi_t *parent_roi, const void *parent_result, graph_roi_t *rois, int max_rois)
+{
+    const face_landmark_result_t *facemesh = (const face_landmark_result_t *)parent_result;
+    const float (*face)[2] = parent_roi->pos;
+    UNUSED (ctx);
+
+    if (max_rois < 2)
+        return 0;
+
+    for (int eye_id = 0; eye_id < 2; eye_id ++)
+    {
+        float pos[4][2];
+        for (int j = 0; j < 4; j ++)
+        {
+            /* (0,0) -> face[0], (1,0) -> face[1], (0,1) -> face[3] */
+            float u = facemesh->eye_pos[eye_id][j].x;
+            float v = facemesh->eye_pos[eye_id][j].y;
+            pos[j][0] = face[0][0] + u * (face[1][0] - face[0][0]) + v * (face[3][0] - face[0][0]);
+            pos[j][1] = face[0][1] + u * (face[1][1] - face[0][1]) + v * (face[3][1] - face[0][1]);
+        }
+
+        static const int order[2][4] = {{0, 1, 2, 3}, {1, 0, 3, 2}};
+        for (int j = 0; j < 4; j ++)
+        {
+            rois[eye_id].pos[j][0] = pos[order[eye_id][j]][0];
+            rois[eye_id].pos[j][1] = pos[order[eye_id][j]][1];
+        }
+    }
+    return 2;
+}
+
+static void
+flip_horizontal_iris_landmark (irismesh_result_t *irismesh)
+{
+    fvec3 *eye  = irismesh->eye_landmark;
+    fvec3 *iris = irismesh->iris_landmark;
+
+    for (int i = 0; i < 71; i ++)
+    {
+        eye[i].x = 1.0f - eye[i].x;
+    }
+
+    for (int i = 0; i < 5; i ++)
+    {
+        iris[i].x = 1.0f - iris[i].x;
+    }
+
+}
+
+/* convert UI8 [0, 255] ==> FP32 [0, 1] and estimate the iris, one eye after another */
+static void
+run_iris (void *ctx, int num_rois, uint8_t * const *rgba, int w, int h, void *results)
+{
+    irismesh_result_t *iris_results = (irismesh_result_t *)results;
+    UNUSED (ctx);
+
+    for (int i = 0; i < num_rois; i ++)
+    {
+        float *buf_fp32 = (float *)get_irismesh_landmark_input_buf (&w, &h);
+        const unsigned char *buf_ui8 = rgba[i];
+        int x, y;
+
+        float mean = 0.0f;
+        float std  = 255.0f;
+        for (y = 0; y < h; y ++)
+        {
+            for (x = 0; x < w; x ++)
+            {
+                int r = *buf_ui8 ++;
+                int g = *buf_ui8 ++;
+                int b = *buf_ui8 ++;
+                buf_ui8 ++;          /* skip alpha */
+                *buf_fp32 ++ = (float)(r - mean) / std;
+                *buf_fp32 ++ = (float)(g - mean) / std;
+                *buf_fp32 ++ = (float)(b - mean) / std;
+            }
+        }
+
+        invoke_irismesh_landmark (&iris_results[i]);
+
+        /* need to horizontal flip for right eye */
+        if (i % 2 == 1)
+            flip_horizontal_iris_landmark (&iris_results[i]);
+    }
+}
+
+
+
+int
+create_facemesh_graph (facemesh_graph_t *fg)
+{
+    int facedet_w, facedet_h, facemesh_w, facemesh_h, iris_w, iris_h;
+    get_face_detect_input_buf (&facedet_w, &facedet_h);
+    get_facemesh_landmark_input_size (&facemesh_w, &facemesh_h);
+    get_irismesh_landmark_input_buf (&iris_w, &iris_h);
+
+    graph_node_desc_t nodes[] = {
+        /* name          parent         crop size                 max_rois          result_size */
+        {"face_detect",  NULL,          facedet_w,  facedet_h,    1,                sizeof (face_detect_result_t),
+         NULL,           run_face_detect, fg},
+        {"face_mesh",    "face_detect", facemesh_w, facemesh_h,   MAX_FACE_NUM,     sizeof (face_landmark_result_t),
+         gen_face_rois,  run_face_mesh,   NULL},
+        {"iris",         "face_mesh",   iris_w,     iris_h,       MAX_FACE_NUM * 2, sizeof (irismesh_result_t),
+         gen_eye_rois,   run_iris,        NULL},
+    };
+
+    fg->tracked_faces = NULL;
+    fg->graph = graph_create (nodes, sizeof (nodes) / sizeof (nodes[0]));
+    if (fg->graph == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+    graph_set_gl_thread_only (fg->graph, get_facemesh_invoke_on_gl_thread ());
+
+    fg->node_facedet  = graph_find_node (fg->graph, "face_detect");
+    fg->node_facemesh = graph_find_node (fg->graph, "face_mesh");
+    fg->node_iris     = graph_find_node (fg->graph, "iris");
+    return 0;
+}
+
+void
+destroy_facemesh_graph (facemesh_graph_t *fg)
+{
+    graph_destroy (fg->graph);
+    fg->graph = NULL;
+}
+
+int
+run_facemesh_graph (facemesh_graph_t *fg, texture_2d_t *srctex, int win_w, int win_h,
+                    face_detect_result_t *facedet, face_landmark_result_t *facemesh,
+                    irismesh_result_t (*iris)[2])
+{
+    if (graph_run (fg->graph, srctex, win_w, win_h) < 0)
+        return -1;
+
+    const face_detect_result_t   *graph_facedet;
+    const face_landmark_result_t *graph_facemesh;
+    const irismesh_result_t      *graph_iris;
+    graph_get_results (fg->graph, fg->node_facedet,  NULL, (const void **)&graph_facedet);
+    int num_faces = graph_get_results (fg->graph, fg->node_facemesh, NULL, (const void **)&graph_facemesh);
+    int num_eyes  = graph_get_results (fg->graph, fg->node_iris,     NULL, (const void **)&graph_iris);
+
+    /* the eyes come in pairs in the order of the faces */
+    *facedet = *graph_facedet;
+    memcpy (facemesh, graph_facemesh, num_faces * sizeof (face_landmark_result_t));
+    memcpy (iris,     graph_iris,     num_eyes  * sizeof (irismesh_result_t));
+
+    return num_faces;
+}
+
+void
+get_facemesh_graph_time (facemesh_graph_t *fg, double *crop_ms, double *facedet_ms,
+                         double *facemesh_ms, double *iris_ms)
+{
+    double crop_ms0, crop_ms1, crop_ms2;
+    graph_get_node_time (fg->graph, fg->node_facedet,  &crop_ms0, facedet_ms);
+    graph_get_node_time (fg->graph, fg->node_facemesh, &crop_ms1, facemesh_ms);
+    graph_get_node_time (fg->graph, fg->node_iris,     &crop_ms2, iris_ms);
+    *crop_ms = crop_ms0 + crop_ms1 + crop_ms2;
+}
@@ -0,0 +1,52 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef FACEMESH_GRAPH_H_
+#define FACEMESH_GRAPH_H_
+
+#include "util_graph.h"
+#include "tflite_facemesh.h"
+
+/* --------------------------------------------------------------------------- *
+ *  pipeline graph:  face_detect --> face_mesh (one ROI per face)
+ *                                     --> iris (two ROIs per face: eye 0, eye 1)
+ *  the graph crops the input images on the GL thread into rgba[].
+ *
+ *  the app and tools/pipeline_golden both run the chain through here, so the
+ *  golden check covers the same feed, crop and decode code as the app.
+ * --------------------------------------------------------------------------- */
+typedef struct _facemesh_graph_t
+{
+    graph_t                     *graph;
+    int                         node_facedet;
+    int                         node_facemesh;
+    int                         node_iris;
+    const face_detect_result_t  *tracked_faces;  /* non-NULL: take these regions instead of detecting faces */
+} facemesh_graph_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int  create_facemesh_graph (facemesh_graph_t *fg);
+void destroy_facemesh_graph (facemesh_graph_t *fg);
+
+/*
+ *  run the chain on srctex (GL thread) and copy the results out.
+ *  iris[face_id][0..1] are the eyes of facemesh[face_id].
+ *  returns the number of faces, or -1 on error.
+ */
+int  run_facemesh_graph (facemesh_graph_t *fg, texture_2d_t *srctex, int win_w, int win_h,
+                         face_detect_result_t *facedet, face_landmark_result_t *facemesh,
+                         irismesh_result_t (*iris)[2]);
+
+/* crop and run time of the nodes in the last run [ms] */
+void get_facemesh_graph_time (facemesh_graph_t *fg, double *crop_ms, double *facedet_ms,
+                              double *facemesh_ms, double *iris_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FACEMESH_GRAPH_H_ */
@@ -107,6 +107,10 @@ render_gui (imgui_data_t *imgui_data)
             imgui_data->camera_facing = 1 - imgui_data->camera_facing;
         }
 
+        bool track_roi = imgui_data->track_roi;
+        ImGui::Checkbox("track_roi", &track_roi);
+        imgui_data->track_roi = track_roi ? 1 : 0;
+
         s_win_pos [s_win_num] = ImGui::GetWindowPos  ();
         s_win_size[s_win_num] = ImGui::GetWindowSize ();
         s_win_num ++;
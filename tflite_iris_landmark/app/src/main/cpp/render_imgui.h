@@ -12,6 +12,7 @@ extern "C" {
 typedef struct _imgui_data_t
 {
     int     camera_facing;
+    int     track_roi;      /* skip face detection between keyframes */
 } imgui_data_t;
 
 int  init_imgui (int width, int height);
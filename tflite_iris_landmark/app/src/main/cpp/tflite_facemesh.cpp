@@ -5,7 +5,9 @@
 #include "util_tflite.h"
 #include "tflite_facemesh.h"
 #include "util_debug.h"
-#include <list>
+#include "util_box_array.h"
+#include "util_anchor.h"
+#include <float.h>
 
 
 static tflite_interpreter_t s_detect_interpreter;
@@ -13,54 +15,58 @@ static tflite_tensor_t      s_detect_tensor_input;
 static tflite_tensor_t      s_detect_tensor_scores;
 static tflite_tensor_t      s_detect_tensor_bboxes;
 
-static tflite_interpreter_t s_mesh_interpreter;
+static tflite_interpreter_pool_t s_mesh_pool;  /* facemesh runs on every face in parallel */
 static tflite_tensor_t      s_mesh_tensor_input;
-static tflite_tensor_t      s_mesh_tensor_landmark;
-static tflite_tensor_t      s_mesh_tensor_score;
 
 static tflite_interpreter_t s_iris_interpreter;
 static tflite_tensor_t      s_iris_tensor_input;
 static tflite_tensor_t      s_iris_tensor_iris;
 static tflite_tensor_t      s_iris_tensor_eye;
 
-static std::list<fvec2> s_anchors;
+static anchor_set_t       s_anchors;
+static box_array_t        s_boxes;              /* one slot per anchor */
+static int                s_sel[MAX_FACE_NUM];
 
 /*
  * determine where the anchor points are scatterd.
  *   https://github.com/tensorflow/tfjs-models/blob/master/blazeface/src/face.ts
+ *
+ * the table of the 128x128 model is generated at compile time.
  */
+static constexpr anchor_layer_t s_blazeface_layers[] = {
+    /* grid_w, grid_h, num, stride, normalized */
+    {16, 16, 2,  8, 0},
+    { 8,  8, 6, 16, 0},
+};
+static constexpr anchor_table_t<896> s_blazeface_anchors =
+    make_anchor_table<896> (s_blazeface_layers, 2);
+
 static int
 create_blazeface_anchors(int input_w, int input_h)
 {
-    /* ANCHORS_CONFIG  */
+    if (input_w == 128 && input_h == 128)
+    {
+        anchor_set_static (&s_anchors, s_blazeface_anchors);
+        return s_anchors.num;
+    }
+
+    /* ANCHORS_CONFIG (other input sizes are built at run time) */
     int strides[2] = {8, 16};
     int anchors[2] = {2,  6};
-
-    int numtotal = 0;
+    anchor_layer_t layers[2];
 
     for (int i = 0; i < 2; i ++)
     {
         int stride = strides[i];
-        int gridCols = (input_w + stride -1) / stride;
-        int gridRows = (input_h + stride -1) / stride;
-        int anchorNum = anchors[i];
-
-        fvec2 anchor;
-        for (int gridY = 0; gridY < gridRows; gridY ++)
-        {
-            anchor.y = stride * (gridY + 0.5f);
-            for (int gridX = 0; gridX < gridCols; gridX ++)
-            {
-                anchor.x = stride * (gridX + 0.5f);
-                for (int n = 0; n < anchorNum; n ++)
-                {
-                    s_anchors.push_back (anchor);
-                    numtotal ++;
-                }
-            }
-        }
+        layers[i].grid_w     = (input_w + stride -1) / stride;
+        layers[i].grid_h     = (input_h + stride -1) / stride;
+        layers[i].num        = anchors[i];
+        layers[i].stride     = stride;
+        layers[i].normalized = 0;
     }
-    return numtotal;
+
+    anchor_set_free (&s_anchors);
+    return anchor_set_build (&s_anchors, layers, 2);
 }
 
 
@@ -80,10 +86,8 @@ init_tflite_facemesh (const char *face_detect_model_buf, size_t face_detect_mode
     tflite_get_tensor_by_name (&s_detect_interpreter, 1, "classificators", &s_detect_tensor_scores);
 
     /* Facemesh Landmark */
-    tflite_create_interpreter (&s_mesh_interpreter, face_landmark_model_buf, face_landmark_model_size);
-    tflite_get_tensor_by_name (&s_mesh_interpreter, 0, "input_1",   &s_mesh_tensor_input);
-    tflite_get_tensor_by_name (&s_mesh_interpreter, 1, "conv2d_20", &s_mesh_tensor_landmark);
-    tflite_get_tensor_by_name (&s_mesh_interpreter, 1, "conv2d_30", &s_mesh_tensor_score);
+    tflite_create_interpreter_pool (&s_mesh_pool, face_landmark_model_buf, face_landmark_model_size, 0);
+    tflite_pool_get_tensor_by_name (&s_mesh_pool, 0, 0, "input_1", &s_mesh_tensor_input);
 
     /* Iris Landmark */
     tflite_create_interpreter (&s_iris_interpreter, iris_landmark_model_buf, iris_landmark_model_size);
@@ -93,7 +97,9 @@ init_tflite_facemesh (const char *face_detect_model_buf, size_t face_detect_mode
 
     int det_input_w = s_detect_tensor_input.dims[2];
     int det_input_h = s_detect_tensor_input.dims[1];
-    create_blazeface_anchors (det_input_w, det_input_h);
+    int num_anchors = create_blazeface_anchors (det_input_w, det_input_h);
+    if (box_array_init (&s_boxes, num_anchors) < 0)
+        return -1;
 
     return 0;
 }
@@ -106,12 +112,18 @@ get_face_detect_input_buf (int *w, int *h)
     return s_detect_tensor_input.ptr;
 }
 
-void *
-get_facemesh_landmark_input_buf (int *w, int *h)
+void
+get_facemesh_landmark_input_size (int *w, int *h)
 {
     *w = s_mesh_tensor_input.dims[2];
     *h = s_mesh_tensor_input.dims[1];
-    return s_mesh_tensor_input.ptr;
+}
+
+/* the GPU delegate has to be invoked on the GL thread */
+int
+get_facemesh_invoke_on_gl_thread ()
+{
+    return tflite_is_gpu_delegate_active ();
 }
 
 void *
@@ -135,16 +147,21 @@ get_bbox_ptr (int anchor_idx)
     return &bboxes_ptr[idx];
 }
 
+/*
+ *  only the box and the score of a candidate are decoded here. the landmarks
+ *  are decoded in pack_face_result () for the faces which survive NMS.
+ */
 static int
-decode_bounds (std::list<face_t> &face_list, float score_thresh, int input_img_w, int input_img_h)
+decode_bounds (box_array_t *boxes, float score_thresh, int input_img_w, int input_img_h)
 {
-    face_t face_item;
-    float  *scores_ptr = (float *)s_detect_tensor_scores.ptr;
+    float *scores_ptr = (float *)s_detect_tensor_scores.ptr;
+    int   num_anchors = s_anchors.num;
+
+    box_array_clear (boxes);
 
-    int i = 0;
-    for (auto itr = s_anchors.begin(); itr != s_anchors.end(); i ++, itr ++)
+    for (int i = 0; i < num_anchors; i ++)
     {
-        fvec2 anchor = *itr;
+        fvec2 anchor = {s_anchors.x[i], s_anchors.y[i]};
         float score0 = scores_ptr[i];
         float score = 1.0f / (1.0f + exp(-score0));
 
@@ -166,117 +183,33 @@ decode_bounds (std::list<face_t> &face_list, float score_thresh, int input_img_w
             w  /= (float)input_img_w;
             h  /= (float)input_img_h;
 
-            fvec2 topleft, btmright;
-            topleft.x  = cx - w * 0.5f;
-            topleft.y  = cy - h * 0.5f;
-            btmright.x = cx + w * 0.5f;
-            btmright.y = cy + h * 0.5f;
-
-            face_item.score    = score;
-            face_item.topleft  = topleft;
-            face_item.btmright = btmright;
-
-            /* landmark positions (6 keys) */
-            for (int j = 0; j < kFaceKeyNum; j ++)
-            {
-                float lx = p[4 + (2 * j) + 0];
-                float ly = p[4 + (2 * j) + 1];
-                lx += anchor.x;
-                ly += anchor.y;
-                lx /= (float)input_img_w;
-                ly /= (float)input_img_h;
-
-                face_item.keys[j].x = lx;
-                face_item.keys[j].y = ly;
-            }
-
-            face_list.push_back (face_item);
+            box_array_push (boxes, score,
+                            cx - w * 0.5f, cy - h * 0.5f,
+                            cx + w * 0.5f, cy + h * 0.5f, i);
         }
     }
     return 0;
 }
 
-/* -------------------------------------------------- *
- *  Apply NonMaxSuppression:
- *      https://github.com/tensorflow/tfjs/blob/master/tfjs-core/src/ops/image_ops.ts
- * -------------------------------------------------- */
-static float
-calc_intersection_over_union (face_t &face0, face_t &face1)
-{
-    float sx0 = face0.topleft.x;
-    float sy0 = face0.topleft.y;
-    float ex0 = face0.btmright.x;
-    float ey0 = face0.btmright.y;
-    float sx1 = face1.topleft.x;
-    float sy1 = face1.topleft.y;
-    float ex1 = face1.btmright.x;
-    float ey1 = face1.btmright.y;
-    
-    float xmin0 = std::min (sx0, ex0);
-    float ymin0 = std::min (sy0, ey0);
-    float xmax0 = std::max (sx0, ex0);
-    float ymax0 = std::max (sy0, ey0);
-    float xmin1 = std::min (sx1, ex1);
-    float ymin1 = std::min (sy1, ey1);
-    float xmax1 = std::max (sx1, ex1);
-    float ymax1 = std::max (sy1, ey1);
-    
-    float area0 = (ymax0 - ymin0) * (xmax0 - xmin0);
-    float area1 = (ymax1 - ymin1) * (xmax1 - xmin1);
-    if (area0 <= 0 || area1 <= 0)
-        return 0.0f;
-
-    float intersect_xmin = std::max (xmin0, xmin1);
-    float intersect_ymin = std::max (ymin0, ymin1);
-    float intersect_xmax = std::min (xmax0, xmax1);
-    float intersect_ymax = std::min (ymax0, ymax1);
-
-    float intersect_area = std::max (intersect_ymax - intersect_ymin, 0.0f) *
-                           std::max (intersect_xmax - intersect_xmin, 0.0f);
-    
-    return intersect_area / (area0 + area1 - intersect_area);
-}
-
-static bool
-compare (face_t &v1, face_t &v2)
-{
-    if (v1.score > v2.score)
-        return true;
-    else
-        return false;
-}
-
-static int
-non_max_suppression (std::list<face_t> &face_list, std::list<face_t> &face_sel_list, float iou_thresh)
+static void
+decode_keys (face_t *face, int anchor_idx, int input_img_w, int input_img_h)
 {
-    face_list.sort (compare);
+    fvec2 anchor = {s_anchors.x[anchor_idx], s_anchors.y[anchor_idx]};
+    float *p = get_bbox_ptr (anchor_idx);
 
-    for (auto itr = face_list.begin(); itr != face_list.end(); itr ++)
+    /* landmark positions (6 keys) */
+    for (int j = 0; j < kFaceKeyNum; j ++)
     {
-        face_t face_candidate = *itr;
-
-        int ignore_candidate = false;
-        for (auto itr_sel = face_sel_list.rbegin(); itr_sel != face_sel_list.rend(); itr_sel ++)
-        {
-            face_t face_sel = *itr_sel;
-
-            float iou = calc_intersection_over_union (face_candidate, face_sel);
-            if (iou >= iou_thresh)
-            {
-                ignore_candidate = true;
-                break;
-            }
-        }
-
-        if (!ignore_candidate)
-        {
-            face_sel_list.push_back(face_candidate);
-            if (face_sel_list.size() >= MAX_FACE_NUM)
-                break;
-        }
+        float lx = p[4 + (2 * j) + 0];
+        float ly = p[4 + (2 * j) + 1];
+        lx += anchor.x;
+        ly += anchor.y;
+        lx /= (float)input_img_w;
+        ly /= (float)input_img_h;
+
+        face->keys[j].x = lx;
+        face->keys[j].y = ly;
     }
-
-    return 0;
 }
 
 /* -------------------------------------------------- *
@@ -366,35 +299,47 @@ compute_face_rect (face_t &face)
     }
 }
 
-static bool
-sort_right_major (face_t &v1, face_t &v2)
+/* right-eye major order. insertion sort: stable and in place (MAX_FACE_NUM is small) */
+static void
+sort_right_major (face_t *faces, int num_faces)
 {
-    if (v1.keys[kRightEye].x > v2.keys[kRightEye].x)
-        return true;
-    else
-        return false;
+    for (int i = 1; i < num_faces; i ++)
+    {
+        face_t face = faces[i];
+        int j = i - 1;
+        while (j >= 0 && faces[j].keys[kRightEye].x < face.keys[kRightEye].x)
+        {
+            faces[j + 1] = faces[j];
+            j --;
+        }
+        faces[j + 1] = face;
+    }
 }
 
+/* sel[]: slot indices of the boxes to output (box_array_nms () or box_array_sort ()) */
 static void
-pack_face_result (face_detect_result_t *facedet_result, std::list<face_t> &face_list)
+pack_face_result (face_detect_result_t *facedet_result, box_array_t *boxes, int *sel, int num_sel,
+                  int input_img_w, int input_img_h)
 {
-    face_list.sort (sort_right_major);
-
-    int num_faces = 0;
-    for (auto itr = face_list.begin(); itr != face_list.end(); itr ++)
+    int num_faces = std::min (num_sel, MAX_FACE_NUM);
+    for (int i = 0; i < num_faces; i ++)
     {
-        face_t face = *itr;
+        face_t &face = facedet_result->faces[i];
+        int    slot  = sel[i];
+
+        face.score      = boxes->score[slot];
+        face.topleft.x  = boxes->x0[slot];
+        face.topleft.y  = boxes->y0[slot];
+        face.btmright.x = boxes->x1[slot];
+        face.btmright.y = boxes->y1[slot];
+        decode_keys (&face, boxes->id[slot], input_img_w, input_img_h);
 
         compute_rotation (face);
         compute_face_rect (face);
-
-        memcpy (&facedet_result->faces[num_faces], &face, sizeof (face));
-        num_faces ++;
-        facedet_result->num = num_faces;
-
-        if (num_faces >= MAX_FACE_NUM)
-            break;
     }
+    facedet_result->num = num_faces;
+
+    sort_right_major (facedet_result->faces, num_faces);
 }
 
 
@@ -412,22 +357,22 @@ invoke_face_detect (face_detect_result_t *facedet_result)
 
     /* decode boundary box and landmark keypoints */
     float score_thresh = 0.75f;
-    std::list<face_t> face_list;
+    int   num_sel;
 
     int input_img_w = s_detect_tensor_input.dims[2];
     int input_img_h = s_detect_tensor_input.dims[1];
-    decode_bounds (face_list, score_thresh, input_img_w, input_img_h);
+    decode_bounds (&s_boxes, score_thresh, input_img_w, input_img_h);
 
 
 #if 1 /* USE NMS */
     float iou_thresh = 0.3f;
-    std::list<face_t> face_nms_list;
 
-    non_max_suppression (face_list, face_nms_list, iou_thresh);
-    pack_face_result (facedet_result, face_nms_list);
+    num_sel = box_array_nms (&s_boxes, iou_thresh, s_sel, MAX_FACE_NUM);
 #else
-    pack_face_result (facedet_result, face_list);
+    /* without NMS the boxes are kept in anchor order */
+    num_sel = box_array_list (&s_boxes, s_sel, MAX_FACE_NUM);
 #endif
+    pack_face_result (facedet_result, &s_boxes, s_sel, num_sel, input_img_w, input_img_h);
 
     return 0;
 }
@@ -491,19 +436,36 @@ compute_eye_roi (face_landmark_result_t *facemesh_result)
     compute_eye_roi_one (facemesh_result, 1, 362, 263);
 }
  
-int
-invoke_facemesh_landmark (face_landmark_result_t *facemesh_result)
+typedef struct _facemesh_job_t
+{
+    facemesh_feed_func_t    feed;
+    void                    *feed_arg;
+    face_landmark_result_t  *results;
+} facemesh_job_t;
+
+static void
+facemesh_task (void *arg, int interp_id, int face_id)
 {
-    if (s_mesh_interpreter.interpreter->Invoke() != kTfLiteOk)
+    facemesh_job_t *job = (facemesh_job_t *)arg;
+    face_landmark_result_t *facemesh_result = &job->results[face_id];
+    tflite_tensor_t tensor_input, tensor_landmark, tensor_score;
+
+    tflite_pool_get_tensor_by_name (&s_mesh_pool, interp_id, 0, "input_1", &tensor_input);
+    job->feed (job->feed_arg, face_id, tensor_input.ptr, tensor_input.dims[2], tensor_input.dims[1]);
+
+    if (tflite_pool_invoke (&s_mesh_pool, interp_id) < 0)
     {
-        fprintf (stderr, "ERR: %s(%d)\n", __FILE__, __LINE__);
-        return -1;
+        memset (facemesh_result, 0, sizeof (*facemesh_result));
+        return;
     }
 
-    float *meshscore_ptr = (float *)s_mesh_tensor_score.ptr;
-    float *landmark_ptr  = (float *)s_mesh_tensor_landmark.ptr;
-    int img_w = s_mesh_tensor_input.dims[2];
-    int img_h = s_mesh_tensor_input.dims[1];
+    tflite_pool_get_tensor_by_name (&s_mesh_pool, interp_id, 1, "conv2d_20", &tensor_landmark);
+    tflite_pool_get_tensor_by_name (&s_mesh_pool, interp_id, 1, "conv2d_30", &tensor_score);
+
+    float *meshscore_ptr = (float *)tensor_score.ptr;
+    float *landmark_ptr  = (float *)tensor_landmark.ptr;
+    int img_w = tensor_input.dims[2];
+    int img_h = tensor_input.dims[1];
 
     facemesh_result->score = *meshscore_ptr;
     //fprintf (stderr, "meshscore = %f\n", *meshscore_ptr);
@@ -518,10 +480,94 @@ invoke_facemesh_landmark (face_landmark_result_t *facemesh_result)
     }
 
     compute_eye_roi (facemesh_result);
+}
+
+int
+invoke_facemesh_landmark (int num_faces, facemesh_feed_func_t feed, void *feed_arg,
+                          face_landmark_result_t *facemesh_result)
+{
+    facemesh_job_t job;
+    job.feed     = feed;
+    job.feed_arg = feed_arg;
+    job.results  = facemesh_result;
 
+    tflite_pool_run (&s_mesh_pool, facemesh_task, &job, num_faces);
     return 0;
 }
 
+/* -------------------------------------------------- *
+ *  ROI tracking (face region from the previous landmarks)
+ * -------------------------------------------------- */
+static void
+landmark_to_global (face_t &face, fvec3 &joint, fvec2 &pos)
+{
+    /*
+     *  the landmark crop is the rotated face region:
+     *      (0,0) -> face_pos[0], (1,0) -> face_pos[1], (0,1) -> face_pos[3]
+     */
+    float u = joint.x;
+    float v = joint.y;
+    pos.x = face.face_pos[0].x + u * (face.face_pos[1].x - face.face_pos[0].x)
+                               + v * (face.face_pos[3].x - face.face_pos[0].x);
+    pos.y = face.face_pos[0].y + u * (face.face_pos[1].y - face.face_pos[0].y)
+                               + v * (face.face_pos[3].y - face.face_pos[0].y);
+}
+
+int
+track_face_from_landmark (face_detect_result_t *facedet_result,
+                          face_landmark_result_t *facemesh_result, float score_thresh)
+{
+    int num_faces = 0;
+
+    for (int i = 0; i < facedet_result->num; i ++)
+    {
+        face_landmark_result_t *mesh = &facemesh_result[i];
+
+        /* the mesh score is a logit */
+        float score = 1.0f / (1.0f + exp (-mesh->score));
+        if (score < score_thresh)
+            continue;
+
+        face_t prev = facedet_result->faces[i];
+        face_t face = prev;
+        fvec2  pmin = { FLT_MAX,  FLT_MAX};
+        fvec2  pmax = {-FLT_MAX, -FLT_MAX};
+        fvec2  pos[FACE_KEY_NUM];
+
+        for (int j = 0; j < FACE_KEY_NUM; j ++)
+        {
+            landmark_to_global (prev, mesh->joint[j], pos[j]);
+            pmin.x = std::min (pmin.x, pos[j].x);
+            pmin.y = std::min (pmin.y, pos[j].y);
+            pmax.x = std::max (pmax.x, pos[j].x);
+            pmax.y = std::max (pmax.y, pos[j].y);
+        }
+
+        /* same keys as the face detector (eye centers from the eye corners) */
+        face.keys[kRightEye].x = (pos[ 33].x + pos[133].x) * 0.5f;
+        face.keys[kRightEye].y = (pos[ 33].y + pos[133].y) * 0.5f;
+        face.keys[kLeftEye ].x = (pos[263].x + pos[362].x) * 0.5f;
+        face.keys[kLeftEye ].y = (pos[263].y + pos[362].y) * 0.5f;
+        face.keys[kNose    ] = pos[  1];
+        face.keys[kMouth   ] = pos[ 13];
+        face.keys[kRightEar] = pos[234];
+        face.keys[kLeftEar ] = pos[454];
+
+        face.score    = score;
+        face.topleft  = pmin;
+        face.btmright = pmax;
+
+        compute_rotation (face);
+        compute_face_rect (face);
+
+        facedet_result->faces[num_faces] = face;
+        num_faces ++;
+    }
+
+    facedet_result->num = num_faces;
+    return num_faces;
+}
+
 /* -------------------------------------------------- *
  * Invoke TensorFlow Lite (Irismesh landmark)
  * -------------------------------------------------- */
@@ -100,10 +100,27 @@ int  init_tflite_facemesh (const char *face_detect_model_buf, size_t face_detect
                            const char *iris_landmark_model_buf, size_t iris_landmark_model_size);
 
 void *get_face_detect_input_buf (int *w, int *h);
+int   get_facemesh_invoke_on_gl_thread ();
 int  invoke_face_detect (face_detect_result_t *facedet_result);
 
-void *get_facemesh_landmark_input_buf (int *w, int *h);
-int  invoke_facemesh_landmark (face_landmark_result_t *facemesh_result);
+/*
+ *  fill the input tensor (FP32, h x w x RGB) with the image of face_id.
+ *  called from the worker threads of the interpreter pool.
+ */
+typedef void (*facemesh_feed_func_t) (void *arg, int face_id, void *input_buf, int w, int h);
+
+void get_facemesh_landmark_input_size (int *w, int *h);
+int  invoke_facemesh_landmark (int num_faces, facemesh_feed_func_t feed, void *feed_arg,
+                               face_landmark_result_t *facemesh_result);
+
+/*
+ *  ROI tracking: replace each face with the region derived from its mesh
+ *  landmarks so that the next frame can skip face detection. Faces whose
+ *  mesh score (probability) is below score_thresh are dropped.
+ *  Returns the number of faces kept.
+ */
+int  track_face_from_landmark (face_detect_result_t *facedet_result,
+                               face_landmark_result_t *facemesh_result, float score_thresh);
 
 void *get_irismesh_landmark_input_buf (int *w, int *h);
 int  invoke_irismesh_landmark (irismesh_result_t *eyemesh_result);
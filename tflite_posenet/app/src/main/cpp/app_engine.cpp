@@ -8,6 +8,7 @@
 #include "util_egl.h"
 #include "util_debugstr.h"
 #include "util_pmeter.h"
+#include "util_alloc_audit.h"
 #include "util_texture.h"
 #include "util_render2d.h"
 #include "app_engine.h"
@@ -36,10 +37,9 @@ feed_posenet_image(texture_2d_t *srctex, ssbo_t *ssbo, int win_w, int win_h)
     float *buf_fp32 = (float *)get_posenet_input_buf (&w, &h);
 #endif
     unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
+    unsigned char *pui8 = (unsigned char *)texture_pool_acquire_buffer (w * h * 4);
     if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
+        return;
 
     buf_ui8 = pui8;
 
@@ -72,6 +72,7 @@ feed_posenet_image(texture_2d_t *srctex, ssbo_t *ssbo, int win_w, int win_h)
     }
 
 #endif
+    texture_pool_release_buffer (pui8);
     return;
 }
 
@@ -276,6 +277,7 @@ AppEngine::RenderFrame ()
 
         PMETER_RESET_LAP ();
         PMETER_SET_LAP ();
+        alloc_audit_frame_begin ();
 
         ttime[1] = pmeter_get_time_ms ();
         interval = (count > 0) ? ttime[1] - ttime[0] : 0;
@@ -326,6 +328,9 @@ AppEngine::RenderFrame ()
         invoke_imgui (&imgui_data);
 #endif
         egl_swap();
+
+        /* the steady state must not allocate (USE_ALLOC_AUDIT) */
+        alloc_audit_frame_end ("posenet");
     }
     glctx.frame_count ++;
 }
@@ -430,6 +435,9 @@ AppEngine::InitGLES (void)
 void
 AppEngine::TerminateGLES (void)
 {
+    /* pooled texture names belong to this context */
+    texture_pool_destroy ();
+    terminate_tflite_posenet ();
     egl_terminate ();
 }
 
@@ -5,7 +5,8 @@
 #include "util_tflite.h"
 #include "tflite_posenet.h"
 #include "util_debug.h"
-#include <list>
+#include "util_peak.h"
+#include "util_thread_pool.h"
 #include <float.h>
 
 static tflite_interpreter_t s_interpreter;
@@ -21,12 +22,11 @@ static int     s_hmp_w = 0;
 static int     s_hmp_h = 0;
 static int     s_edge_num = 0;
 
-typedef struct part_score_t {
-    float score;
-    int   idx_x;
-    int   idx_y;
-    int   key_id;
-} part_score_t;
+static heatmap_peak_t *s_peaks = NULL;
+static int             s_peaks_max = 0;
+
+static int             s_decode_mode = POSENET_DECODE_PARALLEL;
+static thread_pool_t  *s_decode_pool = NULL;
 
 typedef struct keypoint_t {
     float pos_x;
@@ -83,6 +83,35 @@ init_tflite_posenet(ssbo_t *ssbo, const char *model_buf, size_t model_size)
     /* displacement forward vector dimention */
     s_edge_num = s_tensor_fw_disp.dims[3] / 2;
 
+    /* root candidates: at most one per heatmap cell */
+    s_peaks_max = s_hmp_w * s_hmp_h * kPoseKeyNum;
+    s_peaks = (heatmap_peak_t *)malloc (s_peaks_max * sizeof (heatmap_peak_t));
+    if (s_peaks == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    set_posenet_decode_mode (s_decode_mode);
+
+    return 0;
+}
+
+void
+terminate_tflite_posenet (void)
+{
+    if (s_decode_pool)
+        thread_pool_destroy (s_decode_pool);
+    s_decode_pool = NULL;
+}
+
+int
+set_posenet_decode_mode (int mode)
+{
+    if (mode == POSENET_DECODE_PARALLEL && s_decode_pool == NULL)
+        s_decode_pool = thread_pool_create (0);
+
+    s_decode_mode = mode;
     return 0;
 }
 
@@ -124,27 +153,9 @@ get_offset_vector (float *ofst_x, float *ofst_y, int idx_y, int idx_x, int pose_
     *ofst_y = offsets_ptr[idx1];
 }
 
-/* enqueue an item in descending order. */
-static void
-enqueue_score (std::list<part_score_t> &queue, int x, int y, int key, float score)
-{
-    std::list<part_score_t>::iterator itr;
-    for (itr = queue.begin(); itr != queue.end(); itr++)
-    {
-        if (itr->score < score)
-            break;
-    }
-
-    part_score_t item;
-    item.score = score;
-    item.idx_x = x;
-    item.idx_y = y;
-    item.key_id= key;
-    queue.insert(itr, item);
-}
-
 /*
- * If the score is the highest in local window, return true.
+ * Collect every heatmap cell which is the highest score in its local window
+ * and is not lower than thresh, and arrange them as a max-heap.
  *
  *    xs    xe
  *   +--+--+--+
@@ -155,49 +166,16 @@ enqueue_score (std::list<part_score_t> &queue, int x, int y, int key, float scor
  *   |  |  |  | ye
  *   +--+--+--+
  */
-static bool
-score_is_max_in_local_window (int key, float score, int idx_y, int idx_x, int max_rad)
-{
-    int xs = std::max (idx_x - max_rad,     0);
-    int ys = std::max (idx_y - max_rad,     0);
-    int xe = std::min (idx_x + max_rad + 1, s_hmp_w);
-    int ye = std::min (idx_y + max_rad + 1, s_hmp_h);
-
-    for (int y = ys; y < ye; y ++)
-    {
-        for (int x = xs; x < xe; x ++)
-        {
-            /* if a higher score is found, return false */
-            if (get_heatmap_score (y, x, key) > score)
-                return false;
-        }
-    }
-    return true;
-}
-
-static void
-build_score_queue (std::list<part_score_t> &queue, float thresh, int max_rad)
+static int
+build_score_queue (heatmap_peak_t *queue, float thresh, int max_rad)
 {
-    for (int y = 0; y < s_hmp_h; y ++)
-    {
-        for (int x = 0; x < s_hmp_w; x ++)
-        {
-            for (int key = 0; key < kPoseKeyNum; key ++)
-            {
-                float score = get_heatmap_score (y, x, key);
-
-                /* if this score is lower than thresh, skip this pixel. */
-                if (score < thresh)
-                    continue;
+    float *heatmap_ptr = (float *)s_tensor_heatmap.ptr;
 
-                /* if there is a higher score near this pixel, skip this pixel. */
-                if (!score_is_max_in_local_window (key, score, y, x, max_rad))
-                    continue;
+    int num = peak_extract (heatmap_ptr, s_hmp_w, s_hmp_h, kPoseKeyNum, max_rad, thresh,
+                            queue, s_peaks_max);
+    peak_queue_init (queue, num);
 
-                enqueue_score (queue, x, y, key, score);
-            }
-        }
-    }
+    return num;
 }
 
 /*
@@ -278,12 +256,12 @@ traverse_to_tgt_key(int edge, keypoint_t src_key, int tgt_key_id, void *disp)
 }
 
 static void
-decode_pose (part_score_t &root, keypoint_t *keys)
+decode_pose (heatmap_peak_t &root, keypoint_t *keys)
 {
     /* calculate root key position. */
-    int idx_x = root.idx_x;
-    int idx_y = root.idx_y;
-    int keyid = root.key_id;
+    int idx_x = root.x;
+    int idx_y = root.y;
+    int keyid = root.ch;
     float *fw_disp_ptr = (float *)s_tensor_fw_disp.ptr;
     float *bw_disp_ptr = (float *)s_tensor_bw_disp.ptr;
 
@@ -383,34 +361,109 @@ regist_detected_pose (posenet_result_t *pose_result, keypoint_t *keys, float sco
 static void
 decode_multiple_poses (posenet_result_t *pose_result)
 {
-    std::list<part_score_t> queue;
-
     float score_thresh  = 0.5f;
     int   local_max_rad = 1;
-    build_score_queue (queue, score_thresh, local_max_rad);
+    int   queue_num = build_score_queue (s_peaks, score_thresh, local_max_rad);
 
     memset (pose_result, 0, sizeof (posenet_result_t));
-    while (pose_result->num < MAX_POSE_NUM && !queue.empty())
-    {
-        part_score_t &root = queue.front();
 
+    heatmap_peak_t root;
+    while (pose_result->num < MAX_POSE_NUM &&
+           peak_queue_pop (s_peaks, &queue_num, &root) == 0)
+    {
         float pos_x, pos_y;
-        get_index_to_pos (root.idx_x, root.idx_y, root.key_id, &pos_x, &pos_y);
+        get_index_to_pos (root.x, root.y, root.ch, &pos_x, &pos_y);
 
         float nms_rad = 20.0f;
-        if (within_nms_of_corresponding_point (pose_result, pos_x, pos_y, root.key_id, nms_rad))
-        {
-            queue.pop_front();
+        if (within_nms_of_corresponding_point (pose_result, pos_x, pos_y, root.ch, nms_rad))
             continue;
-        }
 
         keypoint_t key_points[kPoseKeyNum] = {};
         decode_pose (root, key_points);
 
         float score = get_instance_score (pose_result, key_points, nms_rad);
         regist_detected_pose (pose_result, key_points, score);
+    }
+}
+
+/*
+ *  decode_pose() depends only on the root and the output tensors, so the
+ *  next roots which are not yet suppressed are decoded speculatively in
+ *  parallel. The instance scoring and NMS are then applied in queue order
+ *  against the poses registered so far, which gives exactly the same result
+ *  as decode_multiple_poses().
+ */
+#define POSENET_DECODE_BATCH_MAX  32
 
-        queue.pop_front();
+typedef struct decode_batch_t
+{
+    int             num;
+    heatmap_peak_t  root[POSENET_DECODE_BATCH_MAX];
+    keypoint_t      keys[POSENET_DECODE_BATCH_MAX][kPoseKeyNum];
+} decode_batch_t;
+
+static void
+decode_pose_task (void *arg, int task_id)
+{
+    decode_batch_t *batch = (decode_batch_t *)arg;
+    keypoint_t *keys = batch->keys[task_id];
+
+    memset (keys, 0, sizeof (keypoint_t) * kPoseKeyNum);
+    decode_pose (batch->root[task_id], keys);
+}
+
+static void
+decode_multiple_poses_parallel (posenet_result_t *pose_result)
+{
+    static decode_batch_t s_batch;
+
+    float score_thresh  = 0.5f;
+    int   local_max_rad = 1;
+    float nms_rad = 20.0f;
+    int   queue_num = build_score_queue (s_peaks, score_thresh, local_max_rad);
+
+    int batch_max = 2 * thread_pool_get_num_threads (s_decode_pool);
+    batch_max = std::min (batch_max, POSENET_DECODE_BATCH_MAX);
+
+    memset (pose_result, 0, sizeof (posenet_result_t));
+
+    while (pose_result->num < MAX_POSE_NUM)
+    {
+        /* pick up the next roots which are not suppressed by the current poses. */
+        heatmap_peak_t root;
+        s_batch.num = 0;
+        while (s_batch.num < batch_max &&
+               peak_queue_pop (s_peaks, &queue_num, &root) == 0)
+        {
+            float pos_x, pos_y;
+            get_index_to_pos (root.x, root.y, root.ch, &pos_x, &pos_y);
+
+            if (within_nms_of_corresponding_point (pose_result, pos_x, pos_y, root.ch, nms_rad))
+                continue;
+
+            s_batch.root[s_batch.num ++] = root;
+        }
+
+        if (s_batch.num == 0)
+            break;
+
+        thread_pool_run (s_decode_pool, decode_pose_task, &s_batch, s_batch.num);
+
+        /* commit in score order. poses registered in this batch may suppress later roots. */
+        for (int i = 0; i < s_batch.num && pose_result->num < MAX_POSE_NUM; i ++)
+        {
+            heatmap_peak_t *r = &s_batch.root[i];
+
+            float pos_x, pos_y;
+            get_index_to_pos (r->x, r->y, r->ch, &pos_x, &pos_y);
+
+            if (within_nms_of_corresponding_point (pose_result, pos_x, pos_y, r->ch, nms_rad))
+                continue;
+
+            keypoint_t *key_points = s_batch.keys[i];
+            float score = get_instance_score (pose_result, key_points, nms_rad);
+            regist_detected_pose (pose_result, key_points, score);
+        }
     }
 }
 
@@ -470,7 +523,12 @@ invoke_posenet (posenet_result_t *pose_result)
      *   https://github.com/tensorflow/tfjs-models/tree/master/posenet/src/multi_pose
      */
     if (1)
-        decode_multiple_poses (pose_result);
+    {
+        if (s_decode_mode == POSENET_DECODE_PARALLEL)
+            decode_multiple_poses_parallel (pose_result);
+        else
+            decode_multiple_poses (pose_result);
+    }
     else
         decode_single_pose (pose_result);
 
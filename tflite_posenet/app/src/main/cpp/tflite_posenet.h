@@ -19,6 +19,10 @@ extern "C" {
 
 #define MAX_POSE_NUM  10
 
+/* multi-pose decoder mode */
+#define POSENET_DECODE_SERIAL     0
+#define POSENET_DECODE_PARALLEL   1 /* decode root candidates on a thread pool */
+
 enum pose_key_id {
     kNose = 0,          //  0
     kLeftEye,           //  1
@@ -66,9 +70,11 @@ typedef struct _posenet_result_t
 
 
 int   init_tflite_posenet (ssbo_t *ssbo, const char *model_buf, size_t model_size);
+void  terminate_tflite_posenet (void);
 void  *get_posenet_input_buf (int *w, int *h);
 
 int invoke_posenet (posenet_result_t *pose_result);
+int set_posenet_decode_mode (int mode);
 
 #ifdef __cplusplus
 }
@@ -10,6 +10,7 @@
 #include "util_pmeter.h"
 #include "util_texture.h"
 #include "util_render2d.h"
+#include "util_segment.h"
 #include "app_engine.h"
 #include "render_imgui.h"
 #include "assertgl.h"
@@ -29,10 +30,9 @@ feed_deeplab_image(texture_2d_t *srctex, int win_w, int win_h)
     int x, y, w, h;
     float *buf_fp32 = (float *)get_deeplab_input_buf (&w, &h);
     unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
+    unsigned char *pui8 = (unsigned char *)texture_pool_acquire_buffer (w * h * 4);
     if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
+        return;
 
     buf_ui8 = pui8;
 
@@ -58,65 +58,36 @@ feed_deeplab_image(texture_2d_t *srctex, int win_w, int win_h)
         }
     }
 
+    texture_pool_release_buffer (pui8);
     return;
 }
 
 
+/* colorized label map. the texture is freed in TerminateGLES() with the context */
+static segment_postproc_t s_segment_pp;
+
 static void
 render_deeplab_result (int ofstx, int ofsty, int draw_w, int draw_h,
                        deeplab_result_t *deeplab_ret)
 {
-    float *segmap = deeplab_ret->segmentmap;
     int segmap_w  = deeplab_ret->segmentmap_dims[0];
     int segmap_h  = deeplab_ret->segmentmap_dims[1];
-    int segmap_c  = deeplab_ret->segmentmap_dims[2];
-    int x, y, c;
-    unsigned int imgbuf[segmap_h][segmap_w];
+    int c;
 
-    /* find the most confident class for each pixel. */
-    for (y = 0; y < segmap_h; y ++)
+    if (s_segment_pp.rgba == NULL)
     {
-        for (x = 0; x < segmap_w; x ++)
-        {
-            int max_id;
-            float conf_max = 0;
-            for (c = 0; c < 21; c ++)
-            {
-                float confidence = segmap[(y * segmap_w * segmap_c)+ (x * segmap_c) + c];
-                if (c == 0 || confidence > conf_max)
-                {
-                    conf_max = confidence;
-                    max_id = c;
-                }
-            }
-            float *col = get_deeplab_class_color (max_id);
-            unsigned char r = ((int)(col[0] * 255)) & 0xff;
-            unsigned char g = ((int)(col[1] * 255)) & 0xff;
-            unsigned char b = ((int)(col[2] * 255)) & 0xff;
-            unsigned char a = ((int)(col[3] * 255)) & 0xff;
-            imgbuf[y][x] = (a << 24) | (b << 16) | (g << 8) | (r);
-        }
+        segment_postproc_init (&s_segment_pp, segmap_w, segmap_h);
+        for (c = 0; c < MAX_DETECT_CLASS + 1; c ++)
+            segment_set_class_color (&s_segment_pp, c, get_deeplab_class_color (c));
     }
-    
-    GLuint texid;
-    glGenTextures (1, &texid );
-    glBindTexture (GL_TEXTURE_2D, texid);
-
-    glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+    /* colorize the most confident class of each pixel. */
+    segment_update_texture (&s_segment_pp, deeplab_ret->labelmap);
 
-    glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA,
-        segmap_w, segmap_h, 0, GL_RGBA,
-        GL_UNSIGNED_BYTE, imgbuf);
-
-    draw_2d_texture (texid, ofstx, ofsty, draw_w, draw_h, 0);
+    draw_2d_texture (s_segment_pp.tex.texid, ofstx, ofsty, draw_w, draw_h, 0);
 
     /* class name */
-    for (c = 0; c < 21; c ++)
+    for (c = 0; c < MAX_DETECT_CLASS + 1; c ++)
     {
         float col_str[] = {1.0f, 1.0f, 1.0f, 1.0f};
         float *col = get_deeplab_class_color (c);
@@ -125,8 +96,6 @@ render_deeplab_result (int ofstx, int ofsty, int draw_w, int draw_h,
         sprintf (buf, "%2d:%s", c, name);
         draw_dbgstr_ex (buf, ofstx, ofsty + c * 22 * 0.7, 0.7f, col_str, col);
     }
-
-    glDeleteTextures (1, &texid);
 }
 
 void
@@ -137,9 +106,12 @@ render_deeplab_heatmap (int ofstx, int ofsty, int draw_w, int draw_h, deeplab_re
     int segmap_h  = deeplab_ret->segmentmap_dims[1];
     int segmap_c  = deeplab_ret->segmentmap_dims[2];
     int x, y;
-    unsigned char imgbuf[segmap_h][segmap_w];
+    unsigned char *imgbuf = (unsigned char *)texture_pool_acquire_buffer (segmap_w * segmap_h);
     static int s_count = 0;
-    int key_id = (s_count /10)% 21;
+
+    if (imgbuf == NULL)
+        return;
+    int key_id = (s_count /10)% segmap_c;
     s_count ++;
     float conf_min, conf_max;
 
@@ -169,28 +141,23 @@ render_deeplab_heatmap (int ofstx, int ofsty, int draw_w, int draw_h, deeplab_re
             confidence = (confidence - conf_min) / (conf_max - conf_min);
             if (confidence < 0.0f) confidence = 0.0f;
             if (confidence > 1.0f) confidence = 1.0f;
-            imgbuf[y][x] = confidence * 255;
+            imgbuf[y * segmap_w + x] = confidence * 255;
         }
     }
-    
-    GLuint texid;
-    glGenTextures (1, &texid );
-    glBindTexture (GL_TEXTURE_2D, texid);
-
-    glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
-
-    glTexImage2D (GL_TEXTURE_2D, 0, GL_LUMINANCE,
-        segmap_w, segmap_h, 0, GL_LUMINANCE,
-        GL_UNSIGNED_BYTE, imgbuf);
+    /* the texture is reused across frames: only its contents are uploaded */
+    texture_2d_t *tex = texture_pool_acquire (segmap_w, segmap_h, PIXFMT_GREY);
+    if (tex == NULL)
+    {
+        texture_pool_release_buffer (imgbuf);
+        return;
+    }
+    texture_pool_upload (tex, imgbuf);
 
-    draw_2d_colormap (texid, ofstx, ofsty, draw_w, draw_h, 0.8f, 0);
+    draw_2d_colormap (tex->texid, ofstx, ofsty, draw_w, draw_h, 0.8f, 0);
 
-    glDeleteTextures (1, &texid);
+    texture_pool_release (tex);
+    texture_pool_release_buffer (imgbuf);
 
     {
         char strbuf[128];
@@ -360,6 +327,15 @@ AppEngine::RenderFrame ()
         sprintf (strbuf, "Interval:%5.1f [ms]\nTFLite  :%5.1f [ms]", interval, invoke_ms);
         draw_dbgstr (strbuf, 10, 10);
 
+        /* per-frame textures/buffers: "new" must stay flat in the steady state */
+        texture_pool_stats_t pool_stats;
+        texture_pool_get_stats (&pool_stats);
+        sprintf (strbuf, "TexPool :%2d tex %2d buf (new:%llu reuse:%llu)",
+                 pool_stats.num_textures, pool_stats.num_buffers,
+                 (unsigned long long)(pool_stats.tex_created + pool_stats.buf_created),
+                 (unsigned long long)(pool_stats.tex_reused  + pool_stats.buf_reused));
+        draw_dbgstr (strbuf, 10, 10 + 22 * 2);
+
         /* renderer info */
         int y = win_h - 22 * 3;
         draw_dbgstr (glctx.str_glverstion, 10, y); y += 22;
@@ -474,6 +450,9 @@ AppEngine::InitGLES (void)
 void
 AppEngine::TerminateGLES (void)
 {
+    /* pooled texture names belong to this context */
+    texture_pool_destroy ();
+    segment_postproc_free (&s_segment_pp);
     egl_terminate ();
 }
 
@@ -5,10 +5,12 @@
 #include "util_tflite.h"
 #include "tflite_deeplab.h"
 #include "util_debug.h"
+#include "util_segment.h"
 
 static tflite_interpreter_t s_interpreter;
 static tflite_tensor_t      s_tensor_input;
 static tflite_tensor_t      s_tensor_segment;
+static uint8_t              *s_labelmap = NULL;
 
 static float s_class_color[MAX_DETECT_CLASS + 1][4];
 static char  s_class_name [MAX_DETECT_CLASS + 1][64] =
@@ -104,6 +106,33 @@ get_deeplab_class_color (int class_idx)
 }
 
 
+/* per-pixel class id of the segment map. */
+static int
+decode_labelmap ()
+{
+    int segmap_w = s_tensor_segment.dims[2];
+    int segmap_h = s_tensor_segment.dims[1];
+    int segmap_c = s_tensor_segment.dims[3];
+
+    if (s_labelmap == NULL)
+    {
+        s_labelmap = (uint8_t *)malloc (segmap_w * segmap_h);
+        if (s_labelmap == NULL)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            return -1;
+        }
+    }
+
+    if (s_tensor_segment.type == kTfLiteUInt8)
+        segment_argmax_uint8 ((uint8_t *)s_tensor_segment.ptr, segmap_w * segmap_h, segmap_c, s_labelmap);
+    else
+        segment_argmax_float ((float   *)s_tensor_segment.ptr, segmap_w * segmap_h, segmap_c, s_labelmap);
+
+    return 0;
+}
+
+
 int
 invoke_deeplab (deeplab_result_t *deeplab_result)
 {
@@ -118,6 +147,9 @@ invoke_deeplab (deeplab_result_t *deeplab_result)
     deeplab_result->segmentmap_dims[1] = s_tensor_segment.dims[1];
     deeplab_result->segmentmap_dims[2] = s_tensor_segment.dims[3];
 
+    decode_labelmap ();
+    deeplab_result->labelmap = s_labelmap;
+
     return 0;
 }
 
@@ -5,6 +5,8 @@
 #ifndef TFLITE_DEEPLAB_H_
 #define TFLITE_DEEPLAB_H_
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -17,8 +19,9 @@ extern "C" {
 
 typedef struct _deeplab_result_t
 {
-    float *segmentmap;
-    int   segmentmap_dims[3];
+    float   *segmentmap;
+    int     segmentmap_dims[3];
+    uint8_t *labelmap;          /* [h][w] most confident class id */
 } deeplab_result_t;
 
 
@@ -10,6 +10,7 @@
 #include "util_pmeter.h"
 #include "util_texture.h"
 #include "util_render2d.h"
+#include "util_tensor_tex.h"
 #include "util_matrix.h"
 #include "app_engine.h"
 #include "render_imgui.h"
@@ -30,10 +31,9 @@ feed_face_detect_image(texture_2d_t *srctex, int win_w, int win_h)
     int x, y, w, h;
     float *buf_fp32 = (float *)get_face_detect_input_buf (&w, &h);
     unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
-
+    unsigned char *pui8 = (unsigned char *)texture_pool_acquire_buffer (w * h * 4);
     if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
+        return;
 
     buf_ui8 = pui8;
 
@@ -59,21 +59,26 @@ feed_face_detect_image(texture_2d_t *srctex, int win_w, int win_h)
         }
     }
 
+    texture_pool_release_buffer (pui8);
     return;
 }
 
+/*
+ *  crop the face region into the RGBA buffer of face_id (on the GL thread).
+ *  the conversion to the input tensor runs later on the interpreter pool.
+ */
+static unsigned char *s_face_rgba[MAX_FACE_NUM];
+
 void
 feed_selfie2anime_image(texture_2d_t *srctex, int win_w, int win_h, face_detect_result_t *detection, unsigned int face_id)
 {
-    int x, y, w, h;
-    float *buf_fp32 = (float *)get_selfie2anime_input_buf (&w, &h);
-    unsigned char *buf_ui8 = NULL;
-    static unsigned char *pui8 = NULL;
+    int w, h;
+    get_selfie2anime_input_size (&w, &h);
 
-    if (pui8 == NULL)
-        pui8 = (unsigned char *)malloc(w * h * 4);
+    if (s_face_rgba[face_id] == NULL)
+        s_face_rgba[face_id] = (unsigned char *)malloc(w * h * 4);
 
-    buf_ui8 = pui8;
+    unsigned char *buf_ui8 = s_face_rgba[face_id];
 
     float texcoord[] = { 0.0f, 1.0f,
                          0.0f, 0.0f,
@@ -102,6 +107,17 @@ feed_selfie2anime_image(texture_2d_t *srctex, int win_w, int win_h, face_detect_
     glPixelStorei (GL_PACK_ALIGNMENT, 4);
     glReadPixels (0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, buf_ui8);
 
+    return;
+}
+
+static void
+convert_selfie2anime_input (void *arg, int face_id, void *input_buf, int w, int h)
+{
+    unsigned char *buf_ui8 = s_face_rgba[face_id];
+    float *buf_fp32 = (float *)input_buf;
+    int x, y;
+    UNUSED (arg);
+
     /* convert UI8 [0, 255] ==> FP32 [0, 1] */
     float mean = 0.0f;
     float std  = 255.0f;
@@ -187,14 +203,6 @@ render_cropped_face_image (texture_2d_t *srctex, int ofstx, int ofsty, int texw,
     draw_2d_texture_ex_texcoord (srctex, ofstx, ofsty, texw, texh, texcoord);
 }
 
-float
-fclampf (float val)
-{
-    val = fmaxf (0.0f, val);
-    val = fminf (1.0f, val);
-    return val;
-}
-
 static void
 render_animface_image (texture_2d_t *srctex, int ofstx, int ofsty, int texw, int texh,
                        face_detect_result_t *detection, unsigned int face_id, selfie2anime_result_t *selfie2anime_ret)
@@ -205,31 +213,16 @@ render_animface_image (texture_2d_t *srctex, int ofstx, int ofsty, int texw, int
     float *segmap = selfie2anime_ret->segmentmap;
     int segmap_w  = selfie2anime_ret->segmentmap_dims[0];
     int segmap_h  = selfie2anime_ret->segmentmap_dims[1];
-    int x, y;
-    static unsigned int *imgbuf = NULL;
+    int segmap_c  = selfie2anime_ret->segmentmap_dims[2];
+    static tensor_tex_t s_tensor_tex;
 
-    if (imgbuf == NULL)
+    if (s_tensor_tex.rgba == NULL)
     {
-        imgbuf = (unsigned int *)malloc (segmap_w * segmap_h * sizeof(unsigned int));
+        /* RGB [0, 1] */
+        tensor_tex_init (&s_tensor_tex, segmap_w, segmap_h, segmap_c, 0);
     }
 
-    for (y = 0; y < segmap_h; y ++)
-    {
-        for (x = 0; x < segmap_w; x ++)
-        {
-            float *col = &segmap[3 * (y * segmap_w + x)];
-            float fr = fclampf (col[0]) * 255;
-            float fg = fclampf (col[1]) * 255;
-            float fb = fclampf (col[2]) * 255;
-
-            unsigned char r = ((int)fr) & 0xff;
-            unsigned char g = ((int)fg) & 0xff;
-            unsigned char b = ((int)fb) & 0xff;
-            unsigned char a = 0xff;
-
-            imgbuf[y * segmap_w + x] = (a << 24) | (b << 16) | (g << 8) | (r);
-        }
-    }
+    tensor_tex_update_float (&s_tensor_tex, segmap);
 
     face_t *face = &(detection->faces[face_id]);
     float cx     = face->face_cx * texw; //    0--------1
@@ -240,11 +233,7 @@ render_animface_image (texture_2d_t *srctex, int ofstx, int ofsty, int texw, int
     float by     = cy - face_h * 0.5f;
     float rot    = RAD_TO_DEG (face->rotation);
 
-    texture_2d_t animtex;
-    create_2d_texture_ex (&animtex, imgbuf, segmap_w, segmap_h, pixfmt_fourcc ('R', 'G', 'B', 'A'));
-    draw_2d_texture_ex_texcoord_rot (&animtex, ofstx + bx, ofsty + by, face_w, face_h, 0, 0.5, 0.5, rot);
-
-    glDeleteTextures (1, &animtex.texid);
+    draw_2d_texture_ex_texcoord_rot (&s_tensor_tex.tex, ofstx + bx, ofsty + by, face_w, face_h, 0, 0.5, 0.5, rot);
 }
 
 void
@@ -390,17 +379,17 @@ AppEngine::RenderFrame ()
         /* --------------------------------------- *
          *  Selfie to Anime
          * --------------------------------------- */
-        invoke_ms1 = 0;
         for (int face_id = 0; face_id < face_detect_ret.num; face_id ++)
         {
             feed_selfie2anime_image (&srctex, win_w, win_h, &face_detect_ret, face_id);
-
-            ttime[4] = pmeter_get_time_ms ();
-            invoke_selfie2anime (&selfie2anime_result[face_id]);
-            ttime[5] = pmeter_get_time_ms ();
-            invoke_ms1 += ttime[5] - ttime[4];
         }
 
+        /* every face in parallel on the interpreter pool */
+        ttime[4] = pmeter_get_time_ms ();
+        invoke_selfie2anime (face_detect_ret.num, convert_selfie2anime_input, NULL, selfie2anime_result);
+        ttime[5] = pmeter_get_time_ms ();
+        invoke_ms1 = ttime[5] - ttime[4];
+
         /* --------------------------------------- *
          *  render scene
          * --------------------------------------- */
@@ -556,6 +545,8 @@ AppEngine::InitGLES (void)
 void
 AppEngine::TerminateGLES (void)
 {
+    /* pooled texture names belong to this context */
+    texture_pool_destroy ();
     egl_terminate ();
 }
 
@@ -70,8 +70,15 @@ int init_tflite_selfie2anime (const char *face_detect_model_buf, size_t face_det
 void *get_face_detect_input_buf (int *w, int *h);
 int  invoke_face_detect (face_detect_result_t *facedet_result);
 
-void  *get_selfie2anime_input_buf (int *w, int *h);
-int invoke_selfie2anime (selfie2anime_result_t *selfie2anime_result);
+/*
+ *  fill the input tensor (FP32, h x w x RGB) with the image of face_id.
+ *  called from the worker threads of the interpreter pool.
+ */
+typedef void (*selfie2anime_feed_func_t) (void *arg, int face_id, void *input_buf, int w, int h);
+
+void get_selfie2anime_input_size (int *w, int *h);
+int  invoke_selfie2anime (int num_faces, selfie2anime_feed_func_t feed, void *feed_arg,
+                          selfie2anime_result_t *selfie2anime_result);
 
 #ifdef __cplusplus
 }
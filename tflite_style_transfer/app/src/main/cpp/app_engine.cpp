@@ -10,6 +10,7 @@
 #include "util_pmeter.h"
 #include "util_texture.h"
 #include "util_render2d.h"
+#include "util_tensor_tex.h"
 #include "app_engine.h"
 #include "render_imgui.h"
 #include "assertgl.h"
@@ -21,6 +22,8 @@
 #define CAMERA_CROP_WIDTH       480 /* make a src image square */
 #define CAMERA_CROP_HEIGHT      480 /* make a src image square */
 
+#define STYLE_SCENE_CHANGE_THRESH   0.03f   /* mean abs diff of luminance [0, 1] */
+
 
 /* resize image to DNN network input size and convert to fp32. */
 void
@@ -29,22 +32,16 @@ feed_style_transfer_image(int is_predict, texture_2d_t *srctex, int win_w, int w
     int x, y, w, h;
     float *buf_fp32;
     unsigned char *buf_ui8 = NULL;
-    static int buf_w = 0, buf_h = 0;
-    static unsigned char *pui8 = NULL;
+    unsigned char *pui8;
 
     if (is_predict)
         buf_fp32 = (float *)get_style_predict_input_buf (&w, &h);
     else
         buf_fp32 = (float *)get_style_transfer_content_input_buf (&w, &h);
 
-    if (buf_w != w || buf_h != h)
-    {
-        if (pui8)
-            free (pui8);
-        pui8 = (unsigned char *)malloc(w * h * 4);
-        buf_w = w;
-        buf_h = h;
-    }
+    pui8 = (unsigned char *)texture_pool_acquire_buffer (w * h * 4);
+    if (pui8 == NULL)
+        return;
 
     buf_ui8 = pui8;
 
@@ -70,24 +67,10 @@ feed_style_transfer_image(int is_predict, texture_2d_t *srctex, int win_w, int w
         }
     }
 
+    texture_pool_release_buffer (pui8);
     return;
 }
 
-void
-store_style_predict (style_predict_t *style)
-{
-    int size = style->size;
-    float *param = (float *)style->param;
-    float *store_param = (float *)calloc (1, size * sizeof(float));
-
-    style->param = store_param;
-
-    while (size --> 0)
-    {
-        *store_param ++ = *param ++;
-    }
-}
-
 void
 feed_blend_style (style_predict_t *style0, style_predict_t *style1, float ratio)
 {
@@ -119,38 +102,17 @@ feed_blend_style (style_predict_t *style0, style_predict_t *style1, float ratio)
 static int
 update_style_transfered_texture (style_transfer_t *transfer)
 {
-    static int s_texid = 0;
-    static uint8_t *s_texbuf = NULL;
-    int img_w = transfer->w;
-    int img_h = transfer->h;
+    static tensor_tex_t s_tensor_tex;
 
-    if (s_texid == 0)
+    if (s_tensor_tex.rgba == NULL)
     {
-        s_texbuf = (uint8_t *)calloc (1, img_w * img_h * 4);
-        s_texid  = create_2d_texture (s_texbuf, img_w, img_h);
+        /* RGB [0, 1] */
+        tensor_tex_init (&s_tensor_tex, transfer->w, transfer->h, 3, 0);
     }
 
-    uint8_t *d = s_texbuf;
-    float   *s = (float *)transfer->img;
+    tensor_tex_update_float (&s_tensor_tex, (float *)transfer->img);
 
-    for (int y = 0; y < img_h; y ++)
-    {
-        for (int x = 0; x < img_w; x ++)
-        {
-            float r = *s ++;
-            float g = *s ++;
-            float b = *s ++;
-            *d ++ = (uint8_t)(r * 255);
-            *d ++ = (uint8_t)(g * 255);
-            *d ++ = (uint8_t)(b * 255);
-            *d ++ = 0xFF;
-        }
-    }
-
-    glBindTexture (GL_TEXTURE_2D, s_texid);
-    glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, img_w, img_h, GL_RGBA, GL_UNSIGNED_BYTE, s_texbuf);
-
-    return s_texid;
+    return s_tensor_tex.tex.texid;
 }
 
 void
@@ -280,21 +242,20 @@ AppEngine::RenderFrame ()
      * --------------------------------------- */
     if (count == 0 || style_ratio < 1.0f)
     {
-        /* predict style of original image */
+        /* predict style of original image (only when the scene has changed) */
         glClear (GL_COLOR_BUFFER_BIT);
         feed_style_transfer_image (1, &srctex, win_w, win_h);
-        invoke_style_predict (&style_predict[0]);
-        store_style_predict (&style_predict[0]);
-        DBG_LOGI("predict style of original image");
+        if (invoke_style_predict_on_change (&style_predict[0], STYLE_SCENE_CHANGE_THRESH) > 0)
+            DBG_LOGI("predict style of original image");
     }
 
     if (count == 0)
     {
-        /* predict style of target image */
+        /* predict style of target image (cached across runs) */
         glClear (GL_COLOR_BUFFER_BIT);
         feed_style_transfer_image (1, &styletex, win_w, win_h);
-        invoke_style_predict (&style_predict[1]);
-        store_style_predict (&style_predict[1]);
+        invoke_style_predict_cached (&style_predict[1], 1);
+        style_cache_save (m_style_cache_path);
     }
 
     /* --------------------------------------- *
@@ -466,6 +427,10 @@ AppEngine::InitGLES (void)
         (const char *)m_style_predict_tflite_model_buf.data(), m_style_predict_tflite_model_buf.size(),
         (const char *)m_style_transfer_tflite_model_buf.data(), m_style_transfer_tflite_model_buf.size());
 
+    snprintf (m_style_cache_path, sizeof (m_style_cache_path), "%s/%s",
+              m_app->activity->internalDataPath, STYLE_CACHE_FILE);
+    style_cache_load (m_style_cache_path);
+
     setup_imgui (w, h, &imgui_data);
 
     glctx.disp_w = w;
@@ -490,6 +455,8 @@ AppEngine::InitGLES (void)
 void
 AppEngine::TerminateGLES (void)
 {
+    /* pooled texture names belong to this context */
+    texture_pool_destroy ();
     egl_terminate ();
 }
 
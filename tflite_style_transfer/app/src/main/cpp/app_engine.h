@@ -100,6 +100,7 @@ private:
     std::vector<uint8_t> m_style_predict_tflite_model_buf;
     std::vector<uint8_t> m_style_transfer_tflite_model_buf;
     style_predict_t     style_predict[2];
+    char                m_style_cache_path[256];
 
     imgui_data_t        imgui_data;
     int                 m_camera_facing;
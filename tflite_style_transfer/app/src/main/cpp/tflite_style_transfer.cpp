@@ -6,7 +6,8 @@
 #include "tflite_style_transfer.h"
 #include "util_debug.h"
 
-
+#define STYLE_CACHE_MAGIC   0x43595453      /* "STYC" */
+#define STYLE_THUMB_SIZE    16
 
 
 static tflite_interpreter_t s_interpreter_style_predict;
@@ -18,6 +19,39 @@ static tflite_tensor_t      s_transfer_tensor_content_in;
 static tflite_tensor_t      s_transfer_tensor_style_in;
 static tflite_tensor_t      s_transfer_tensor_output;
 
+typedef struct _style_cache_entry_t
+{
+    uint64_t    key;
+    int         persist;
+    int         size;
+    float       *param;
+} style_cache_entry_t;
+
+static uint64_t             s_predict_model_id;
+static style_cache_entry_t  s_style_cache[STYLE_CACHE_MAX];
+static int                  s_style_cache_num;
+static int                  s_style_cache_next;    /* round-robin victim */
+static float                *s_cached_param;        /* copy returned to the caller */
+static int                  s_cached_size;
+
+static float                s_scene_thumb[STYLE_THUMB_SIZE * STYLE_THUMB_SIZE];
+static int                  s_scene_valid;
+static float                *s_scene_param;
+static int                  s_scene_size;
+
+
+static uint64_t
+fnv1a_hash (const void *buf, size_t size, uint64_t hash)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    for (size_t i = 0; i < size; i ++)
+    {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
 
 int
 init_tflite_style_transfer (const char *predict_model_buf, size_t predict_model_size,
@@ -31,6 +65,11 @@ init_tflite_style_transfer (const char *predict_model_buf, size_t predict_model_
     tflite_get_tensor_by_name (p, 0, "style_image",                 &s_predict_tensor_input);
     tflite_get_tensor_by_name (p, 1, "mobilenet_conv/Conv/BiasAdd", &s_predict_tensor_output);
 
+    /* cached vectors are valid only for the same predict model */
+    size_t id_size = (predict_model_size < 4096) ? predict_model_size : 4096;
+    s_predict_model_id  = fnv1a_hash (predict_model_buf, id_size, 0xcbf29ce484222325ULL);
+    s_predict_model_id ^= (uint64_t)predict_model_size;
+
     /* transfeer */
     p = &s_interpreter_style_transfer;
     tflite_create_interpreter (p, transfr_model_buf, transfr_model_size);
@@ -111,3 +150,250 @@ invoke_style_transfer (style_transfer_t *transfered_result)
 
     return 0;
 }
+
+
+/* -------------------------------------------------- *
+ *  Style vector cache
+ * -------------------------------------------------- */
+static style_cache_entry_t *
+style_cache_find (uint64_t key)
+{
+    for (int i = 0; i < s_style_cache_num; i ++)
+    {
+        if (s_style_cache[i].key == key)
+            return &s_style_cache[i];
+    }
+    return NULL;
+}
+
+static style_cache_entry_t *
+style_cache_add (uint64_t key, int persist, const float *param, int size)
+{
+    style_cache_entry_t *entry;
+
+    if (s_style_cache_num < STYLE_CACHE_MAX)
+    {
+        entry = &s_style_cache[s_style_cache_num ++];
+    }
+    else
+    {
+        entry = &s_style_cache[s_style_cache_next];
+        s_style_cache_next = (s_style_cache_next + 1) % STYLE_CACHE_MAX;
+    }
+
+    if (entry->param == NULL || entry->size != size)
+    {
+        free (entry->param);
+        entry->param = (float *)malloc (size * sizeof (float));
+        if (entry->param == NULL)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            entry->key  = 0;
+            entry->size = 0;
+            return NULL;
+        }
+    }
+
+    memcpy (entry->param, param, size * sizeof (float));
+    entry->key     = key;
+    entry->persist = persist;
+    entry->size    = size;
+    return entry;
+}
+
+int
+invoke_style_predict_cached (style_predict_t *predict_result, int persist)
+{
+    size_t in_size = s_predict_tensor_input.dims[1] * s_predict_tensor_input.dims[2] *
+                     s_predict_tensor_input.dims[3] * sizeof (float);
+    uint64_t key = fnv1a_hash (s_predict_tensor_input.ptr, in_size, s_predict_model_id);
+
+    style_cache_entry_t *entry = style_cache_find (key);
+    if (entry == NULL)
+    {
+        style_predict_t style;
+        if (invoke_style_predict (&style) != 0)
+            return -1;
+
+        entry = style_cache_add (key, persist, (float *)style.param, style.size);
+        if (entry == NULL)
+            return -1;
+    }
+    else
+    {
+        entry->persist |= persist;
+    }
+
+    /* an entry is reused by a later insert, so hand out a copy */
+    if (s_cached_param == NULL || s_cached_size != entry->size)
+    {
+        free (s_cached_param);
+        s_cached_param = (float *)malloc (entry->size * sizeof (float));
+        if (s_cached_param == NULL)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            s_cached_size = 0;
+            return -1;
+        }
+        s_cached_size = entry->size;
+    }
+    memcpy (s_cached_param, entry->param, entry->size * sizeof (float));
+
+    predict_result->size  = s_cached_size;
+    predict_result->param = s_cached_param;
+    return 0;
+}
+
+int
+style_cache_load (const char *fname)
+{
+    FILE *fp = fopen (fname, "rb");
+    if (fp == NULL)
+        return -1;
+
+    uint32_t magic = 0;
+    int num = 0;
+    if (fread (&magic, sizeof (magic), 1, fp) != 1 || magic != STYLE_CACHE_MAGIC ||
+        fread (&num,   sizeof (num),   1, fp) != 1 || num < 0 || num > STYLE_CACHE_MAX)
+    {
+        DBG_LOGE ("ERR: %s(%d): broken style cache \"%s\"\n", __FILE__, __LINE__, fname);
+        fclose (fp);
+        return -1;
+    }
+
+    int expect_size = s_predict_tensor_output.dims[3];
+    float *param = (float *)malloc (expect_size * sizeof (float));
+
+    for (int i = 0; i < num; i ++)
+    {
+        uint64_t key;
+        int size;
+        if (fread (&key,  sizeof (key),  1, fp) != 1 ||
+            fread (&size, sizeof (size), 1, fp) != 1 || size != expect_size ||
+            fread (param, sizeof (float), size, fp) != (size_t)size)
+        {
+            DBG_LOGE ("ERR: %s(%d): broken style cache \"%s\"\n", __FILE__, __LINE__, fname);
+            break;
+        }
+
+        if (style_cache_find (key) == NULL)
+            style_cache_add (key, 1, param, size);
+    }
+
+    free (param);
+    fclose (fp);
+
+    DBG_LOG ("style cache: %d entries loaded\n", s_style_cache_num);
+    return 0;
+}
+
+int
+style_cache_save (const char *fname)
+{
+    int num = 0;
+    for (int i = 0; i < s_style_cache_num; i ++)
+    {
+        if (s_style_cache[i].persist)
+            num ++;
+    }
+
+    FILE *fp = fopen (fname, "wb");
+    if (fp == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d): can't open \"%s\"\n", __FILE__, __LINE__, fname);
+        return -1;
+    }
+
+    uint32_t magic = STYLE_CACHE_MAGIC;
+    fwrite (&magic, sizeof (magic), 1, fp);
+    fwrite (&num,   sizeof (num),   1, fp);
+
+    for (int i = 0; i < s_style_cache_num; i ++)
+    {
+        style_cache_entry_t *entry = &s_style_cache[i];
+        if (entry->persist == 0)
+            continue;
+
+        fwrite (&entry->key,  sizeof (entry->key),  1, fp);
+        fwrite (&entry->size, sizeof (entry->size), 1, fp);
+        fwrite (entry->param, sizeof (float), entry->size, fp);
+    }
+
+    fclose (fp);
+    return 0;
+}
+
+
+/* -------------------------------------------------- *
+ *  Scene change detection for the content image
+ * -------------------------------------------------- */
+static void
+compute_scene_thumb (float *thumb)
+{
+    float *img = (float *)s_predict_tensor_input.ptr;
+    int w = s_predict_tensor_input.dims[2];
+    int h = s_predict_tensor_input.dims[1];
+    int cell_w = w / STYLE_THUMB_SIZE;
+    int cell_h = h / STYLE_THUMB_SIZE;
+
+    /* sparse sampling (every other pixel) is enough to see a scene change */
+    for (int ty = 0; ty < STYLE_THUMB_SIZE; ty ++)
+    {
+        for (int tx = 0; tx < STYLE_THUMB_SIZE; tx ++)
+        {
+            float sum = 0.0f;
+            int   num = 0;
+            for (int y = ty * cell_h; y < (ty + 1) * cell_h; y += 2)
+            {
+                float *p = &img[(y * w + tx * cell_w) * 3];
+                for (int x = 0; x < cell_w; x += 2, p += 6)
+                {
+                    sum += 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2];
+                    num ++;
+                }
+            }
+            thumb[ty * STYLE_THUMB_SIZE + tx] = (num > 0) ? sum / num : 0.0f;
+        }
+    }
+}
+
+int
+invoke_style_predict_on_change (style_predict_t *predict_result, float thresh)
+{
+    float thumb[STYLE_THUMB_SIZE * STYLE_THUMB_SIZE];
+    int   invoked = 0;
+
+    compute_scene_thumb (thumb);
+
+    float diff = 0.0f;
+    for (int i = 0; i < STYLE_THUMB_SIZE * STYLE_THUMB_SIZE; i ++)
+        diff += fabsf (thumb[i] - s_scene_thumb[i]);
+    diff /= (STYLE_THUMB_SIZE * STYLE_THUMB_SIZE);
+
+    if (s_scene_valid == 0 || diff > thresh)
+    {
+        style_predict_t style;
+        if (invoke_style_predict (&style) != 0)
+            return -1;
+
+        if (s_scene_param == NULL || s_scene_size != style.size)
+        {
+            free (s_scene_param);
+            s_scene_param = (float *)malloc (style.size * sizeof (float));
+            if (s_scene_param == NULL)
+            {
+                DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+                return -1;
+            }
+            s_scene_size = style.size;
+        }
+        memcpy (s_scene_param, style.param, style.size * sizeof (float));
+        memcpy (s_scene_thumb, thumb, sizeof (thumb));
+        s_scene_valid = 1;
+        invoked = 1;
+    }
+
+    predict_result->size  = s_scene_size;
+    predict_result->param = s_scene_param;
+    return invoked;
+}
@@ -17,6 +17,10 @@ extern "C" {
 #define STYLE_TRANSFER_MODEL_PATH "style_transfer_model/style_transfer_quantized_384.tflite"
 #endif
 
+/* style vectors of the bundled style images are kept across runs */
+#define STYLE_CACHE_FILE          "style_predict_cache.bin"
+#define STYLE_CACHE_MAX           8
+
 typedef struct _style_predict_t
 {
     int size;
@@ -38,6 +42,22 @@ void  *get_style_transfer_content_input_buf (int *w, int *h);
 
 int invoke_style_predict (style_predict_t  *predict_result);
 int invoke_style_transfer(style_transfer_t *transfer_result);
+
+/*
+ *  Style predict with a cache keyed by the hash of the fed image.
+ *  The returned vector is a copy, valid until the next call.
+ *  Entries added with (persist = 1) are written by style_cache_save().
+ */
+int invoke_style_predict_cached (style_predict_t *predict_result, int persist);
+int style_cache_load (const char *fname);
+int style_cache_save (const char *fname);
+
+/*
+ *  Style predict for a live scene. The network runs only when the fed image
+ *  differs from the last predicted one by more than thresh (mean absolute
+ *  difference of a 16x16 luminance thumbnail, [0, 1]). Returns 1 if invoked.
+ */
+int invoke_style_predict_on_change (style_predict_t *predict_result, float thresh);
     
 #ifdef __cplusplus
 }
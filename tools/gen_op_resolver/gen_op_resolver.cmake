@@ -0,0 +1,42 @@
+#
+# tflite_reduced_op_resolver(<target> <model dir | model.tflite> ...)
+#
+#   generates tflite_model_ops.cpp (tflite_register_model_ops ()) from the
+#   .tflite models at build time, adds it to <target> and defines
+#   USE_REDUCED_OP_RESOLVER for the whole target (see util_tflite.h).
+#   needs python3 and ${tfliteDir} (the TensorFlow tree the app is built with).
+#
+set(genOpResolverDir ${CMAKE_CURRENT_LIST_DIR})
+
+function(tflite_reduced_op_resolver target)
+    find_program(PYTHON3 python3)
+    if (NOT PYTHON3)
+        message(FATAL_ERROR "python3 is required by USE_REDUCED_OP_RESOLVER")
+    endif()
+
+    # directories are searched at configure time: re-run cmake after adding a model
+    set(models)
+    foreach(path ${ARGN})
+        if (IS_DIRECTORY ${path})
+            file(GLOB_RECURSE found ${path}/*.tflite)
+            list(APPEND models ${found})
+        else()
+            list(APPEND models ${path})
+        endif()
+    endforeach()
+    if (NOT models)
+        message(FATAL_ERROR "no .tflite model in ${ARGN} (run download_all_assets.sh)")
+    endif()
+
+    set(schema ${tfliteDir}/tensorflow/lite/schema/schema.fbs)
+    set(output ${CMAKE_CURRENT_BINARY_DIR}/tflite_model_ops.cpp)
+
+    add_custom_command(OUTPUT ${output}
+        COMMAND ${PYTHON3} ${genOpResolverDir}/gen_op_resolver.py
+                -s ${schema} -o ${output} ${models}
+        DEPENDS ${genOpResolverDir}/gen_op_resolver.py ${schema} ${models}
+        COMMENT "Generating the OpResolver of ${target}")
+
+    target_sources(${target} PRIVATE ${output})
+    target_compile_definitions(${target} PRIVATE USE_REDUCED_OP_RESOLVER)
+endfunction()
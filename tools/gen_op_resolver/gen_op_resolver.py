@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+#
+# usage: gen_op_resolver.py -s <schema.fbs> -o <out.cpp> <model.tflite | dir> ...
+#
+#   lists the operators used by the models (directories are searched for
+#   *.tflite recursively) and writes tflite_register_model_ops (), which adds
+#   only those builtin kernels (and the custom ops of the TFLite library) to a
+#   tflite::MutableOpResolver. see util_tflite.h (USE_REDUCED_OP_RESOLVER).
+#
+#   the builtin names come from the schema.fbs of the TFLite tree the app is
+#   built with, so the generated code always matches its BuiltinOperator enum.
+#
+import argparse
+import os
+import re
+import struct
+import sys
+
+
+# custom ops implemented in the TFLite library itself (kernels/register.cc).
+# the other custom ops (MaxPoolingWithArgmax2D ...) are added by the app.
+LIBRARY_CUSTOM_OPS = {
+    'TFLite_Detection_PostProcess': 'Register_DETECTION_POSTPROCESS',
+}
+
+
+# -------------------------------------------------------------------------
+#  minimal FlatBuffers reader (just enough for Model.operator_codes)
+# -------------------------------------------------------------------------
+class Table:
+    def __init__(self, buf, pos):
+        self.buf = buf
+        self.pos = pos
+        vtab = pos - struct.unpack_from('<i', buf, pos)[0]
+        self.vtab = vtab
+        self.vlen = struct.unpack_from('<H', buf, vtab)[0]
+
+    def offset(self, field):
+        vo = 4 + field * 2
+        if vo >= self.vlen:
+            return 0
+        return struct.unpack_from('<H', self.buf, self.vtab + vo)[0]
+
+    def scalar(self, field, fmt, default):
+        o = self.offset(field)
+        if o == 0:
+            return default
+        return struct.unpack_from('<' + fmt, self.buf, self.pos + o)[0]
+
+    def indirect(self, field):
+        o = self.offset(field)
+        if o == 0:
+            return 0
+        p = self.pos + o
+        return p + struct.unpack_from('<I', self.buf, p)[0]
+
+    def string(self, field):
+        p = self.indirect(field)
+        if p == 0:
+            return None
+        n = struct.unpack_from('<I', self.buf, p)[0]
+        return self.buf[p + 4:p + 4 + n].decode('utf-8')
+
+    def tables(self, field):
+        p = self.indirect(field)
+        if p == 0:
+            return []
+        n = struct.unpack_from('<I', self.buf, p)[0]
+        ret = []
+        for i in range(n):
+            e = p + 4 + i * 4
+            ret.append(Table(self.buf, e + struct.unpack_from('<I', self.buf, e)[0]))
+        return ret
+
+
+def read_operator_codes(path):
+    with open(path, 'rb') as f:
+        buf = f.read()
+    if len(buf) < 8 or buf[4:8] != b'TFL3':
+        raise ValueError('%s: not a TFLite model' % path)
+
+    model = Table(buf, struct.unpack_from('<I', buf, 0)[0])
+    codes = []
+    for oc in model.tables(1):                      # Model.operator_codes
+        deprecated = oc.scalar(0, 'b', 0)           # deprecated_builtin_code
+        custom     = oc.string(1)                   # custom_code
+        version    = oc.scalar(2, 'i', 1)           # version
+        builtin    = oc.scalar(3, 'i', 0)           # builtin_code (TF 2.5 or later)
+        codes.append((max(deprecated, builtin), custom, version))
+    return codes
+
+
+def read_builtin_names(schema):
+    with open(schema) as f:
+        text = f.read()
+    m = re.search(r'enum\s+BuiltinOperator\s*:\s*\w+\s*\{(.*?)\}', text, re.S)
+    if m is None:
+        raise ValueError('%s: no BuiltinOperator enum' % schema)
+
+    body  = re.sub(r'//[^\n]*', '', m.group(1))
+    names = {}
+    for name, value in re.findall(r'(\w+)\s*=\s*(-?\d+)', body):
+        names[int(value)] = name
+    return names
+
+
+def find_models(paths):
+    models = []
+    for p in paths:
+        if os.path.isdir(p):
+            for root, dirs, files in os.walk(p):
+                dirs.sort()
+                models += [os.path.join(root, f) for f in sorted(files) if f.endswith('.tflite')]
+        else:
+            models.append(p)
+    return models
+
+
+# -------------------------------------------------------------------------
+#  code generation
+# -------------------------------------------------------------------------
+def generate(models, names):
+    builtins = {}       # name -> max version
+    customs  = {}       # name -> max version
+    for model in models:
+        for code, custom, version in read_operator_codes(model):
+            if custom is not None and names.get(code) == 'CUSTOM':
+                customs[custom] = max(customs.get(custom, 1), version)
+            elif code in names:
+                name = names[code]
+                builtins[name] = max(builtins.get(name, 1), version)
+            else:
+                raise ValueError('%s: builtin op %d is not in the schema' % (model, code))
+
+    lines = []
+    lines.append('/* generated by tools/gen_op_resolver/gen_op_resolver.py. DO NOT EDIT. */')
+    lines.append('/*')
+    for model in models:
+        lines.append(' *   %s' % os.path.basename(model))
+    lines.append(' */')
+    lines.append('#include "util_tflite.h"')
+    lines.append('#include "tensorflow/lite/kernels/builtin_op_kernels.h"')
+    lines.append('')
+
+    lib_customs = sorted(c for c in customs if c in LIBRARY_CUSTOM_OPS)
+    if lib_customs:
+        lines.append('namespace tflite { namespace ops { namespace custom {')
+        for c in lib_customs:
+            lines.append('TfLiteRegistration *%s ();' % LIBRARY_CUSTOM_OPS[c])
+        lines.append('} } }')
+        lines.append('')
+
+    lines.append('void')
+    lines.append('tflite_register_model_ops (tflite::MutableOpResolver *resolver)')
+    lines.append('{')
+    for name in sorted(builtins):
+        lines.append('    resolver->AddBuiltin (tflite::BuiltinOperator_%s,' % name)
+        lines.append('        tflite::ops::builtin::Register_%s (), 1, %d);' % (name, builtins[name]))
+    for c in lib_customs:
+        lines.append('    resolver->AddCustom ("%s",' % c)
+        lines.append('        tflite::ops::custom::%s ());' % LIBRARY_CUSTOM_OPS[c])
+    for c in sorted(customs):
+        if c not in LIBRARY_CUSTOM_OPS:
+            lines.append('    /* "%s": added by the app (resolver.AddCustom ()) */' % c)
+    lines.append('}')
+    lines.append('')
+
+    return '\n'.join(lines), builtins, customs
+
+
+def main():
+    parser = argparse.ArgumentParser(description='generate the OpResolver of TFLite models')
+    parser.add_argument('-s', '--schema', required=True, help='tensorflow/lite/schema/schema.fbs')
+    parser.add_argument('-o', '--output', required=True, help='generated .cpp')
+    parser.add_argument('models', nargs='+', help='.tflite files or directories')
+    args = parser.parse_args()
+
+    models = find_models(args.models)
+    if not models:
+        sys.stderr.write('ERR: no .tflite model in %s (run download_all_assets.sh)\n'
+                         % ' '.join(args.models))
+        return 1
+
+    try:
+        names = read_builtin_names(args.schema)
+        code, builtins, customs = generate(models, names)
+    except (IOError, ValueError, struct.error) as e:
+        sys.stderr.write('ERR: %s\n' % e)
+        return 1
+
+    with open(args.output, 'w') as f:
+        f.write(code)
+
+    print('%s: %d builtin ops, %d custom ops (%d models)'
+          % (args.output, len(builtins), len(customs), len(models)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
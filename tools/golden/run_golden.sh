@@ -0,0 +1,133 @@
+#!/bin/bash
+#
+# usage: run_golden.sh [-u] <path/to/tflite_benchmark> [app]
+#
+#   checks the outputs of every model of models.txt (or of one app) against
+#   the golden files under data/, and their p95 latency against the budget.
+#   -u writes the golden files instead (run it on the reference device).
+#
+#   PIPELINE_GOLDEN=<dir of pipeline_golden_xxx> also checks the app chains of pipelines.txt.
+#   MICROBENCH=<path/to/microbench> also checks the kernels of kernel_budgets.txt.
+#   BACKENDS=cpu,delegate compares the delegate too (default: cpu).
+#   ALLOW_MISSING=1 skips what can't be checked (model not downloaded, no golden
+#   files) instead of failing it.
+#
+
+SCRIPT_DIR=$(cd $(dirname $0); pwd)
+REPO_DIR=${SCRIPT_DIR}/../..
+
+UPDATE=0
+if [ "$1" = "-u" ]; then
+    UPDATE=1
+    shift
+fi
+
+BENCH=$1
+FILTER=$2
+BACKENDS=${BACKENDS:-cpu}
+
+if [ -z "${BENCH}" ]; then
+    sed -n '3,15p' $0
+    exit 1
+fi
+
+NUM_PASS=0
+NUM_FAIL=0
+NUM_SKIP=0
+
+# a model which can't be checked fails the gate, unless ALLOW_MISSING=1
+missing () {
+    if [ "${ALLOW_MISSING}" = "1" ]; then
+        echo "SKIP: $1"
+        NUM_SKIP=$((NUM_SKIP + 1))
+    else
+        echo "FAIL: $1 (ALLOW_MISSING=1 to skip)"
+        NUM_FAIL=$((NUM_FAIL + 1))
+    fi
+}
+
+while read APP MODEL RANGE TOL BUDGET; do
+    case "${APP}" in
+        ""|\#*) continue ;;
+    esac
+    if [ -n "${FILTER}" ] && [ "${APP}" != "${FILTER}" ]; then
+        continue
+    fi
+
+    ASSET_DIR=${REPO_DIR}/${APP}/app/src/main/assets
+    GOLDEN_DIR=${SCRIPT_DIR}/data/${APP}/$(basename ${MODEL} .tflite)
+
+    if [ ! -f ${ASSET_DIR}/${MODEL} ]; then
+        missing "${APP}/${MODEL} (not downloaded)"
+        continue
+    fi
+
+    if [ ${UPDATE} -eq 0 ] && ! ls ${GOLDEN_DIR}/*.raw > /dev/null 2>&1; then
+        missing "${APP}/${MODEL} (no golden data: run -u on the reference device)"
+        continue
+    fi
+
+    echo "============= ${APP}/${MODEL} ==============="
+    ARGS="-m ${ASSET_DIR}/${MODEL} -i ${ASSET_DIR} -r ${RANGE} -g ${GOLDEN_DIR} -e ${TOL} -b ${BACKENDS} -t 4 -w 5 -n 50"
+    if [ ${UPDATE} -eq 1 ]; then
+        mkdir -p ${GOLDEN_DIR}
+        ARGS="${ARGS} -u"
+    elif [ "${BUDGET}" != "0" ]; then
+        ARGS="${ARGS} -B ${BUDGET}"
+    fi
+
+    if ${BENCH} ${ARGS} < /dev/null; then
+        NUM_PASS=$((NUM_PASS + 1))
+    else
+        echo "FAIL: ${APP}/${MODEL}"
+        NUM_FAIL=$((NUM_FAIL + 1))
+    fi
+done < ${SCRIPT_DIR}/models.txt
+
+if [ -n "${PIPELINE_GOLDEN}" ]; then
+    while read APP CHAIN TOL; do
+        case "${APP}" in
+            ""|\#*) continue ;;
+        esac
+        if [ -n "${FILTER}" ] && [ "${APP}" != "${FILTER}" ]; then
+            continue
+        fi
+
+        ASSET_DIR=${REPO_DIR}/${APP}/app/src/main/assets
+        GOLDEN_DIR=${SCRIPT_DIR}/data/${APP}/pipeline
+
+        if [ ${UPDATE} -eq 0 ] && ! ls ${GOLDEN_DIR}/*.txt > /dev/null 2>&1; then
+            missing "${APP}/${CHAIN} (no golden data: run -u on the reference device)"
+            continue
+        fi
+
+        echo "============= ${APP}/${CHAIN} ==============="
+        ARGS="-a ${ASSET_DIR} -g ${GOLDEN_DIR} -e ${TOL}"
+        if [ ${UPDATE} -eq 1 ]; then
+            mkdir -p ${GOLDEN_DIR}
+            ARGS="${ARGS} -u"
+        fi
+
+        ${PIPELINE_GOLDEN}/${CHAIN} ${ARGS} < /dev/null
+        case $? in
+            0) NUM_PASS=$((NUM_PASS + 1)) ;;
+            2) missing "${APP}/${CHAIN} (can't run: models not downloaded?)" ;;
+            *) echo "FAIL: ${APP}/${CHAIN}"
+               NUM_FAIL=$((NUM_FAIL + 1)) ;;
+        esac
+    done < ${SCRIPT_DIR}/pipelines.txt
+fi
+
+if [ -n "${MICROBENCH}" ] && [ ${UPDATE} -eq 0 ]; then
+    echo "============= kernels ==============="
+    if ${MICROBENCH} -b ${SCRIPT_DIR}/kernel_budgets.txt; then
+        NUM_PASS=$((NUM_PASS + 1))
+    else
+        echo "FAIL: kernels"
+        NUM_FAIL=$((NUM_FAIL + 1))
+    fi
+fi
+
+echo ""
+echo "pass: ${NUM_PASS}, fail: ${NUM_FAIL}, skip: ${NUM_SKIP}"
+[ ${NUM_FAIL} -eq 0 ]
@@ -0,0 +1,115 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include "microbench.h"
+
+/*
+ *  decode_bounds () and non_max_suppression () are file-local to the app, so
+ *  the app source is compiled into this unit as it is: the cases measure the
+ *  very code the app runs, and follow any change made to it.
+ */
+#include "tflite_blazeface.cpp"
+
+#define BLAZEFACE_INPUT_W   128
+#define BLAZEFACE_INPUT_H   128
+#define BLAZEFACE_ANCHORS   896
+
+typedef struct _blazeface_arg_t
+{
+    float   scores[BLAZEFACE_ANCHORS];
+    float   bboxes[BLAZEFACE_ANCHORS * 16];
+} blazeface_arg_t;
+
+static blazeface_arg_t s_blazeface_typical;
+static blazeface_arg_t s_blazeface_all;
+
+static blazeface_config_t s_config = {0.75f, 0.3f};    /* as init_tflite_blazeface () */
+
+
+static void
+bind_tensors (blazeface_arg_t *a)
+{
+    s_detect_tensor_scores.ptr = a->scores;
+    s_detect_tensor_bboxes.ptr = a->bboxes;
+}
+
+static void
+bench_decode (void *arg)
+{
+    bind_tensors ((blazeface_arg_t *)arg);
+    decode_bounds (&s_boxes, s_config.score_thresh, BLAZEFACE_INPUT_W, BLAZEFACE_INPUT_H);
+}
+
+static void
+bench_decode_nms (void *arg)
+{
+    static blazeface_result_t face_result;
+
+    bind_tensors ((blazeface_arg_t *)arg);
+    decode_bounds (&s_boxes, s_config.score_thresh, BLAZEFACE_INPUT_W, BLAZEFACE_INPUT_H);
+    int num_sel = box_array_nms (&s_boxes, s_config.iou_thresh, s_sel, MAX_FACE_NUM);
+    pack_face_result (&face_result, &s_boxes, s_sel, num_sel, BLAZEFACE_INPUT_W, BLAZEFACE_INPUT_H);
+}
+
+
+/*
+ *  typical: a few faces, each detected by a cluster of neighboring anchors.
+ *  all:     every anchor passes the score threshold (worst case of the NMS).
+ */
+static void
+setup_synthetic (blazeface_arg_t *a, int num_faces)
+{
+    for (int i = 0; i < BLAZEFACE_ANCHORS; i ++)
+    {
+        float *p = &a->bboxes[i * 16];
+        p[0] = bench_rand (-4.0f, 4.0f);
+        p[1] = bench_rand (-4.0f, 4.0f);
+        p[2] = bench_rand (16.0f, 48.0f);
+        p[3] = bench_rand (16.0f, 48.0f);
+        for (int j = 4; j < 16; j ++)
+            p[j] = bench_rand (-16.0f, 16.0f);
+
+        a->scores[i] = (num_faces > 0) ? bench_rand (-12.0f, -4.0f) : bench_rand (2.0f, 8.0f);
+    }
+
+    for (int n = 0; n < num_faces; n ++)
+    {
+        int center = (int)bench_rand (0.0f, BLAZEFACE_ANCHORS - 8.0f);
+        for (int i = center; i < center + 8; i ++)
+            a->scores[i] = bench_rand (2.0f, 8.0f);
+    }
+}
+
+void
+bench_register_blazeface (void)
+{
+    int input0, input1;
+
+    if (create_blazeface_anchors (BLAZEFACE_INPUT_W, BLAZEFACE_INPUT_H) != BLAZEFACE_ANCHORS ||
+        box_array_init (&s_boxes, BLAZEFACE_ANCHORS) < 0)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return;
+    }
+
+    setup_synthetic (&s_blazeface_typical, 3);
+    input0 = bench_load_tensor ("blazeface_classificators_896x1.raw",
+                                s_blazeface_typical.scores, sizeof (s_blazeface_typical.scores));
+    input1 = bench_load_tensor ("blazeface_regressors_896x16.raw",
+                                s_blazeface_typical.bboxes, sizeof (s_blazeface_typical.bboxes));
+    if (input0 != input1)
+    {
+        /* don't mix a recorded tensor with a synthetic one */
+        DBG_LOG ("blazeface: only one of the two outputs is recorded, the synthetic input is used instead\n");
+        setup_synthetic (&s_blazeface_typical, 3);
+        input0 = BENCH_INPUT_SYNTHETIC;
+    }
+
+    setup_synthetic (&s_blazeface_all, 0);
+
+    bench_add ("blazeface/decode",         input0, bench_decode,     &s_blazeface_typical);
+    bench_add ("blazeface/decode_nms",     input0, bench_decode_nms, &s_blazeface_typical);
+    bench_add ("blazeface/decode_all",     BENCH_INPUT_SYNTHETIC, bench_decode,     &s_blazeface_all);
+    bench_add ("blazeface/decode_nms_all", BENCH_INPUT_SYNTHETIC, bench_decode_nms, &s_blazeface_all);
+}
@@ -0,0 +1,165 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <cstring>
+#include "microbench.h"
+#include "util_debug.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "custom_ops/max_pool_argmax.h"
+#include "custom_ops/max_unpooling.h"
+#include "custom_ops/transpose_conv_bias.h"
+
+using namespace mediapipe::tflite_operations;
+
+#define OP_MAX_TENSORS  4
+
+/*
+ *  The custom ops of the hair segmentation model, run through their
+ *  TfLiteRegistration on a minimal TfLiteContext (no interpreter): Prepare ()
+ *  once, then Invoke () is what is measured.
+ */
+typedef struct _op_arg_t
+{
+    const TfLiteRegistration    *reg;
+    TfLiteContext               context;
+    TfLiteNode                  node;
+    TfLiteTensor                tensors[OP_MAX_TENSORS];
+    union
+    {
+        TfLitePoolParams            pool;
+        TfLiteTransposeConvParams   tconv;
+    } params;
+} op_arg_t;
+
+static op_arg_t s_maxpool;
+static op_arg_t s_unpool;
+static op_arg_t s_tconv;
+
+
+static TfLiteStatus
+resize_tensor (TfLiteContext *context, TfLiteTensor *tensor, TfLiteIntArray *new_size)
+{
+    size_t num = 1;
+    for (int i = 0; i < new_size->size; i ++)
+        num *= new_size->data[i];
+
+    if (tensor->dims && tensor->dims != new_size)
+        TfLiteIntArrayFree (tensor->dims);
+    tensor->dims     = new_size;
+    tensor->bytes    = num * sizeof (float);
+    tensor->data.raw = (char *)realloc (tensor->data.raw, tensor->bytes);
+    return tensor->data.raw ? kTfLiteOk : kTfLiteError;
+}
+
+static void
+report_error (TfLiteContext *context, const char *format, ...)
+{
+    va_list args;
+    va_start (args, format);
+    vfprintf (stderr, format, args);
+    va_end (args);
+    fprintf (stderr, "\n");
+}
+
+/* a float tensor of the given shape, filled with random values */
+static void
+init_tensor (TfLiteTensor *tensor, int n, int h, int w, int c)
+{
+    int dims[4] = {n, h, w, c};
+    int num_dims = (h || w || c) ? 4 : 1;
+
+    tensor->type            = kTfLiteFloat32;
+    tensor->allocation_type = kTfLiteDynamic;
+    tensor->dims            = TfLiteIntArrayCreate (num_dims);
+    memcpy (tensor->dims->data, dims, num_dims * sizeof (int));
+
+    resize_tensor (NULL, tensor, tensor->dims);
+    bench_fill_float (tensor->data.f, tensor->bytes / sizeof (float), -1.0f, 1.0f);
+}
+
+static int
+init_op (op_arg_t *a, const TfLiteRegistration *reg, int num_inputs, int num_outputs)
+{
+    a->reg = reg;
+    a->context.tensors      = a->tensors;
+    a->context.tensors_size = num_inputs + num_outputs;
+    a->context.ResizeTensor = resize_tensor;
+    a->context.ReportError  = report_error;
+
+    /* tensors [0, num_inputs) are the inputs, the outputs follow */
+    a->node.inputs  = TfLiteIntArrayCreate (num_inputs);
+    a->node.outputs = TfLiteIntArrayCreate (num_outputs);
+    for (int i = 0; i < num_inputs; i ++)
+        a->node.inputs->data[i] = i;
+    for (int i = 0; i < num_outputs; i ++)
+    {
+        a->node.outputs->data[i] = num_inputs + i;
+        a->tensors[num_inputs + i].type            = kTfLiteFloat32;
+        a->tensors[num_inputs + i].allocation_type = kTfLiteDynamic;
+    }
+
+    a->node.custom_initial_data      = &a->params;
+    a->node.custom_initial_data_size = sizeof (a->params);
+    if (reg->init)
+        a->node.user_data = reg->init (&a->context, (const char *)&a->params, sizeof (a->params));
+
+    if (reg->prepare (&a->context, &a->node) != kTfLiteOk)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+    return 0;
+}
+
+static void
+bench_op (void *arg)
+{
+    op_arg_t *a = (op_arg_t *)arg;
+    a->reg->invoke (&a->context, &a->node);
+}
+
+
+/*
+ *  shapes of the 512x512 hair segmentation model:
+ *    MaxPoolingWithArgmax2D     2x2/2: [1,256,256,16] --> [1,128,128,16] x2
+ *    MaxUnpooling2D             2x2/2: [1,128,128,16] --> [1,256,256,16]
+ *    Convolution2DTransposeBias 2x2/2: [1,256,256,16] --> [1,512,512,2]
+ */
+void
+bench_register_hair_ops (void)
+{
+    TfLitePoolParams pool = {kTfLitePaddingSame, 2, 2, 2, 2, kTfLiteActNone, {{0, 0, 0, 0}}};
+
+    s_maxpool.params.pool = pool;
+    init_tensor (&s_maxpool.tensors[0], 1, 256, 256, 16);
+    if (init_op (&s_maxpool, RegisterMaxPoolingWithArgmax2D (), 1, 2) == 0)
+        bench_add ("hair_ops/maxpool_argmax_256", BENCH_INPUT_SYNTHETIC, bench_op, &s_maxpool);
+
+    /* unpool the pooled values with the argmax indices computed above */
+    s_unpool.params.pool = pool;
+    init_tensor (&s_unpool.tensors[0], 1, 128, 128, 16);
+    init_tensor (&s_unpool.tensors[1], 1, 128, 128, 16);
+    if (s_maxpool.tensors[1].data.raw)
+    {
+        bench_op (&s_maxpool);
+        memcpy (s_unpool.tensors[0].data.raw, s_maxpool.tensors[1].data.raw, s_unpool.tensors[0].bytes);
+        memcpy (s_unpool.tensors[1].data.raw, s_maxpool.tensors[2].data.raw, s_unpool.tensors[1].bytes);
+    }
+    if (init_op (&s_unpool, RegisterMaxUnpooling2D (), 2, 1) == 0)
+        bench_add ("hair_ops/max_unpooling_128", BENCH_INPUT_SYNTHETIC, bench_op, &s_unpool);
+
+    /* inputs: [0] data, [1] weights (OHWI), [2] bias */
+    s_tconv.params.tconv.padding       = kTfLitePaddingSame;
+    s_tconv.params.tconv.stride_width  = 2;
+    s_tconv.params.tconv.stride_height = 2;
+    init_tensor (&s_tconv.tensors[0], 1, 256, 256, 16);
+    init_tensor (&s_tconv.tensors[1], 2, 2, 2, 16);
+    init_tensor (&s_tconv.tensors[2], 2, 0, 0, 0);
+    if (init_op (&s_tconv, RegisterConvolution2DTransposeBias (), 3, 1) == 0)
+        bench_add ("hair_ops/transpose_conv_256", BENCH_INPUT_SYNTHETIC, bench_op, &s_tconv);
+}
@@ -0,0 +1,616 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "microbench.h"
+#include "util_metrics.h"
+#include "util_pmeter.h"
+#include "util_peak.h"
+#include "util_segment.h"
+#include "util_tensor_tex.h"
+#include "util_topk.h"
+#include "util_debug.h"
+
+typedef struct _bench_opt_t
+{
+    const char          *data_dir;      /* NULL: synthetic inputs only */
+    const char          *filter;        /* run the cases whose name contains this */
+    int                 warmup;
+    int                 iterations;
+    int                 list_only;
+    const char          *json_path;
+    const char          *budget_path;   /* "<kernel> <p95 [us]>" per line */
+} bench_opt_t;
+
+typedef struct _bench_result_t
+{
+    bench_case_t        *bc;
+    int                 batch;          /* calls per sample */
+    metrics_timer_stats_t latency;      /* per call */
+    double              min_ms;
+    double              budget_us;      /* 0: none */
+} bench_result_t;
+
+static bench_opt_t                  s_opt;
+static std::vector<bench_case_t>    s_cases;
+static uint32_t                     s_rand_seed = 1;
+
+
+/* -------------------------------------------------- *
+ *  case registry and inputs
+ * -------------------------------------------------- */
+void
+bench_add (const char *name, int input, bench_func_t func, void *arg)
+{
+    bench_case_t bc;
+    bc.name  = name;
+    bc.input = input;
+    bc.func  = func;
+    bc.arg   = arg;
+    s_cases.push_back (bc);
+}
+
+int
+bench_load_tensor (const char *file, void *buf, size_t size)
+{
+    /* synthetic only, or no -d (reported once by main ()) */
+    if (s_opt.data_dir == NULL || file == NULL)
+        return BENCH_INPUT_SYNTHETIC;
+
+    std::string path = std::string (s_opt.data_dir) + "/" + file;
+    FILE *fp = fopen (path.c_str (), "rb");
+    if (fp == NULL)
+    {
+        DBG_LOG ("%s: not recorded, the synthetic input is used instead\n", path.c_str ());
+        return BENCH_INPUT_SYNTHETIC;
+    }
+
+    fseek (fp, 0, SEEK_END);
+    long fsize = ftell (fp);
+    fseek (fp, 0, SEEK_SET);
+
+    if (fsize != (long)size || fread (buf, 1, size, fp) != size)
+    {
+        DBG_LOGE ("ERR: %s(%d): %s: %ld bytes (expected %zu), the synthetic input is used instead\n",
+                  __FILE__, __LINE__, path.c_str (), fsize, size);
+        fclose (fp);
+        return BENCH_INPUT_SYNTHETIC;
+    }
+
+    fclose (fp);
+    return BENCH_INPUT_RECORDED;
+}
+
+float
+bench_rand (float vmin, float vmax)
+{
+    /* xorshift32: libc rand() differs between bionic and glibc */
+    s_rand_seed ^= s_rand_seed << 13;
+    s_rand_seed ^= s_rand_seed >> 17;
+    s_rand_seed ^= s_rand_seed << 5;
+    return vmin + (vmax - vmin) * (s_rand_seed >> 8) / (float)(1 << 24);
+}
+
+void
+bench_fill_float (float *buf, int num, float vmin, float vmax)
+{
+    for (int i = 0; i < num; i ++)
+        buf[i] = bench_rand (vmin, vmax);
+}
+
+void
+bench_fill_uint8 (uint8_t *buf, int num)
+{
+    for (int i = 0; i < num; i ++)
+        buf[i] = (uint8_t)bench_rand (0.0f, 256.0f);
+}
+
+
+/* -------------------------------------------------- *
+ *  RGBA8888 --> normalized float RGB
+ *    the preprocess loop of the apps (convert_xxx_input ())
+ * -------------------------------------------------- */
+typedef struct _normalize_arg_t
+{
+    int                     w, h;
+    std::vector<uint8_t>    rgba;
+    std::vector<float>      dst;
+} normalize_arg_t;
+
+static normalize_arg_t s_normalize_128;
+static normalize_arg_t s_normalize_513;
+
+static void
+bench_normalize (void *arg)
+{
+    normalize_arg_t *a = (normalize_arg_t *)arg;
+    unsigned char *buf_ui8 = a->rgba.data ();
+    float *buf_fp32 = a->dst.data ();
+    float mean = 128.0f;
+    float std  = 128.0f;
+
+    for (int y = 0; y < a->h; y ++)
+    {
+        for (int x = 0; x < a->w; x ++)
+        {
+            int r = *buf_ui8 ++;
+            int g = *buf_ui8 ++;
+            int b = *buf_ui8 ++;
+            buf_ui8 ++;          /* skip alpha */
+            *buf_fp32 ++ = (float)(r - mean) / std;
+            *buf_fp32 ++ = (float)(g - mean) / std;
+            *buf_fp32 ++ = (float)(b - mean) / std;
+        }
+    }
+}
+
+static int
+setup_normalize (normalize_arg_t *a, int w, int h, const char *file)
+{
+    a->w = w;
+    a->h = h;
+    a->rgba.resize (w * h * 4);
+    a->dst.resize  (w * h * 3);
+
+    int input = bench_load_tensor (file, a->rgba.data (), a->rgba.size ());
+    if (input == BENCH_INPUT_SYNTHETIC)
+        bench_fill_uint8 (a->rgba.data (), a->rgba.size ());
+    return input;
+}
+
+
+/* -------------------------------------------------- *
+ *  float tensor --> RGBA8888 (util_tensor_tex, without the GL upload)
+ * -------------------------------------------------- */
+typedef struct _tensor_tex_arg_t
+{
+    tensor_tex_t            tt;
+    std::vector<float>      src_f32;
+    std::vector<uint8_t>    src_u8;
+} tensor_tex_arg_t;
+
+static tensor_tex_arg_t s_tensor_tex_st;
+static tensor_tex_arg_t s_tensor_tex_mt;
+
+static void
+bench_tensor_tex_float (void *arg)
+{
+    tensor_tex_arg_t *a = (tensor_tex_arg_t *)arg;
+    tensor_tex_convert_float (&a->tt, a->src_f32.data ());
+}
+
+static void
+bench_tensor_tex_uint8 (void *arg)
+{
+    tensor_tex_arg_t *a = (tensor_tex_arg_t *)arg;
+    tensor_tex_convert_uint8 (&a->tt, a->src_u8.data (), 1.0f / 127.5f, 128);
+}
+
+static int
+setup_tensor_tex (tensor_tex_arg_t *a, int w, int h, int num_threads, const char *file)
+{
+    if (tensor_tex_init (&a->tt, w, h, 3, num_threads) < 0)
+        return -1;
+    tensor_tex_set_range (&a->tt, TENSOR_RANGE_M1_1);
+
+    a->src_f32.resize (w * h * 3);
+    a->src_u8.resize  (w * h * 3);
+    bench_fill_uint8 (a->src_u8.data (), a->src_u8.size ());
+
+    /* a little outside [-1, 1] so that the saturation is exercised too */
+    int input = bench_load_tensor (file, a->src_f32.data (), a->src_f32.size () * sizeof (float));
+    if (input == BENCH_INPUT_SYNTHETIC)
+        bench_fill_float (a->src_f32.data (), a->src_f32.size (), -1.2f, 1.2f);
+    return input;
+}
+
+
+/* -------------------------------------------------- *
+ *  heatmap peaks (PoseNet, DBFace)
+ * -------------------------------------------------- */
+#define PEAK_MAX_NUM    4096
+
+typedef struct _peak_arg_t
+{
+    int                     w, h, ch;
+    float                   thresh;
+    std::vector<float>      heatmap;
+    heatmap_peak_t          peaks[PEAK_MAX_NUM];
+} peak_arg_t;
+
+static peak_arg_t s_peak_posenet;
+static peak_arg_t s_peak_noise;
+
+static void
+bench_peak (void *arg)
+{
+    peak_arg_t *a = (peak_arg_t *)arg;
+    peak_extract (a->heatmap.data (), a->w, a->h, a->ch, 1, a->thresh, a->peaks, PEAK_MAX_NUM);
+}
+
+static int
+setup_peak (peak_arg_t *a, int w, int h, int ch, float thresh, const char *file)
+{
+    a->w      = w;
+    a->h      = h;
+    a->ch     = ch;
+    a->thresh = thresh;
+    a->heatmap.resize (w * h * ch);
+
+    int input = bench_load_tensor (file, a->heatmap.data (), a->heatmap.size () * sizeof (float));
+    if (input == BENCH_INPUT_RECORDED)
+        return input;
+
+    if (file == NULL)
+    {
+        /* extreme: white noise, every local maximum passes the threshold */
+        bench_fill_float (a->heatmap.data (), a->heatmap.size (), 0.0f, 1.0f);
+        return input;
+    }
+
+    /* typical: a low background and one person (one blob per keypoint) */
+    bench_fill_float (a->heatmap.data (), a->heatmap.size (), 0.0f, 0.2f);
+    for (int c = 0; c < ch; c ++)
+    {
+        int px = (int)bench_rand (1.0f, w - 2.0f);
+        int py = (int)bench_rand (1.0f, h - 2.0f);
+        for (int dy = -1; dy <= 1; dy ++)
+        {
+            for (int dx = -1; dx <= 1; dx ++)
+            {
+                float v = (dx == 0 && dy == 0) ? 0.9f : 0.6f;
+                a->heatmap[((py + dy) * w + (px + dx)) * ch + c] = v;
+            }
+        }
+    }
+    return input;
+}
+
+
+/* -------------------------------------------------- *
+ *  segmentation argmax (DeepLab, hair segmentation)
+ * -------------------------------------------------- */
+typedef struct _argmax_arg_t
+{
+    int                     num_pixels, num_class;
+    std::vector<float>      logits_f32;
+    std::vector<uint8_t>    logits_u8;
+    std::vector<uint8_t>    labels;
+} argmax_arg_t;
+
+static argmax_arg_t s_argmax_257;
+static argmax_arg_t s_argmax_513;
+
+static void
+bench_argmax_float (void *arg)
+{
+    argmax_arg_t *a = (argmax_arg_t *)arg;
+    segment_argmax_float (a->logits_f32.data (), a->num_pixels, a->num_class, a->labels.data ());
+}
+
+static void
+bench_argmax_uint8 (void *arg)
+{
+    argmax_arg_t *a = (argmax_arg_t *)arg;
+    segment_argmax_uint8 (a->logits_u8.data (), a->num_pixels, a->num_class, a->labels.data ());
+}
+
+static int
+setup_argmax (argmax_arg_t *a, int w, int h, int num_class, const char *file)
+{
+    a->num_pixels = w * h;
+    a->num_class  = num_class;
+    a->logits_f32.resize (w * h * num_class);
+    a->logits_u8.resize  (w * h * num_class);
+    a->labels.resize     (w * h);
+    bench_fill_uint8 (a->logits_u8.data (), a->logits_u8.size ());
+
+    int input = bench_load_tensor (file, a->logits_f32.data (), a->logits_f32.size () * sizeof (float));
+    if (input == BENCH_INPUT_SYNTHETIC)
+        bench_fill_float (a->logits_f32.data (), a->logits_f32.size (), -10.0f, 10.0f);
+    return input;
+}
+
+
+/* -------------------------------------------------- *
+ *  classification top-K
+ * -------------------------------------------------- */
+typedef struct _topk_arg_t
+{
+    std::vector<float>      scores;
+    topk_item_t             items[TOPK_MAX_NUM];
+} topk_arg_t;
+
+static topk_arg_t s_topk_1001;
+
+static void
+bench_topk (void *arg)
+{
+    topk_arg_t *a = (topk_arg_t *)arg;
+    topk_float (a->scores.data (), a->scores.size (), 5, a->items);
+}
+
+
+static void
+register_common_cases (void)
+{
+    int input;
+
+    input = setup_normalize (&s_normalize_128, 128, 128, "rgba_128x128.raw");
+    bench_add ("normalize/rgba_128x128", input, bench_normalize, &s_normalize_128);
+    input = setup_normalize (&s_normalize_513, 513, 513, "rgba_513x513.raw");
+    bench_add ("normalize/rgba_513x513", input, bench_normalize, &s_normalize_513);
+
+    input = setup_tensor_tex (&s_tensor_tex_st, 256, 256, 1, "rgb_256x256x3_f32.raw");
+    if (input >= 0)
+    {
+        bench_add ("tensor_tex/f32_256x256x3",    input, bench_tensor_tex_float, &s_tensor_tex_st);
+        bench_add ("tensor_tex/u8_256x256x3",     BENCH_INPUT_SYNTHETIC, bench_tensor_tex_uint8, &s_tensor_tex_st);
+    }
+    input = setup_tensor_tex (&s_tensor_tex_mt, 256, 256, 0, "rgb_256x256x3_f32.raw");
+    if (input >= 0)
+        bench_add ("tensor_tex/f32_256x256x3_mt", input, bench_tensor_tex_float, &s_tensor_tex_mt);
+
+    input = setup_peak (&s_peak_posenet, 33, 33, 17, 0.5f, "posenet_heatmap_33x33x17.raw");
+    bench_add ("peak/posenet_33x33x17", input, bench_peak, &s_peak_posenet);
+    input = setup_peak (&s_peak_noise, 129, 129, 17, 0.0f, NULL);
+    bench_add ("peak/noise_129x129x17", input, bench_peak, &s_peak_noise);
+
+    input = setup_argmax (&s_argmax_257, 257, 257, 21, "deeplab_logits_257x257x21.raw");
+    bench_add ("argmax/f32_257x257x21", input, bench_argmax_float, &s_argmax_257);
+    bench_add ("argmax/u8_257x257x21",  BENCH_INPUT_SYNTHETIC, bench_argmax_uint8, &s_argmax_257);
+    input = setup_argmax (&s_argmax_513, 513, 513, 21, NULL);
+    bench_add ("argmax/f32_513x513x21", input, bench_argmax_float, &s_argmax_513);
+
+    s_topk_1001.scores.resize (1001);
+    input = bench_load_tensor ("classification_scores_1001.raw", s_topk_1001.scores.data (), 1001 * sizeof (float));
+    if (input == BENCH_INPUT_SYNTHETIC)
+        bench_fill_float (s_topk_1001.scores.data (), 1001, 0.0f, 1.0f);
+    bench_add ("topk/f32_1001", input, bench_topk, &s_topk_1001);
+}
+
+
+/* -------------------------------------------------- *
+ *  run and report
+ * -------------------------------------------------- */
+static void
+usage (const char *prog)
+{
+    fprintf (stderr,
+        "usage: %s [options]\n"
+        "  -d dir      recorded tensors (raw dumps) to use instead of the synthetic inputs\n"
+        "  -f str      run only the cases whose name contains str\n"
+        "  -w N        warm-up iterations (default: 20)\n"
+        "  -n N        timed samples (default: 200)\n"
+        "  -l          list the cases and exit\n"
+        "  -j file     write the results as JSON\n"
+        "  -b file     p95 budgets (\"<kernel> <us>\" per line). exit 1 when one is exceeded\n",
+        prog);
+}
+
+static int
+parse_args (int argc, char *argv[], bench_opt_t *opt)
+{
+    int c;
+
+    opt->data_dir   = NULL;
+    opt->filter     = NULL;
+    opt->warmup     = 20;
+    opt->iterations = 200;
+    opt->list_only  = 0;
+    opt->json_path  = NULL;
+    opt->budget_path = NULL;
+
+    while ((c = getopt (argc, argv, "d:f:w:n:lj:b:h")) != -1)
+    {
+        switch (c)
+        {
+        case 'd': opt->data_dir   = optarg;         break;
+        case 'f': opt->filter     = optarg;         break;
+        case 'w': opt->warmup     = atoi (optarg);  break;
+        case 'n': opt->iterations = atoi (optarg);  break;
+        case 'l': opt->list_only  = 1;              break;
+        case 'j': opt->json_path  = optarg;         break;
+        case 'b': opt->budget_path = optarg;        break;
+        default:
+            return -1;
+        }
+    }
+
+    if (opt->iterations <= 0)
+        return -1;
+    return 0;
+}
+
+/*
+ *  util_metrics keeps whole microseconds, so a kernel faster than
+ *  BATCH_MIN_MS is timed in batches of calls and the stats are divided back.
+ */
+#define BATCH_MIN_MS    0.1
+#define BATCH_MAX       10000
+
+static void
+run_case (bench_opt_t *opt, bench_case_t *bc, bench_result_t *result)
+{
+    int timer = metrics_timer_id (bc->name);
+    double min_ms = 1e9;
+    int batch = 1;
+
+    for (int i = 0; i < opt->warmup; i ++)
+        bc->func (bc->arg);
+
+    double ttime0 = pmeter_get_time_ms ();
+    bc->func (bc->arg);
+    double once_ms = pmeter_get_time_ms () - ttime0;
+    if (once_ms < BATCH_MIN_MS)
+        batch = (once_ms > BATCH_MIN_MS / BATCH_MAX) ? (int)(BATCH_MIN_MS / once_ms) + 1 : BATCH_MAX;
+
+    for (int i = 0; i < opt->iterations; i ++)
+    {
+        ttime0 = pmeter_get_time_ms ();
+        for (int j = 0; j < batch; j ++)
+            bc->func (bc->arg);
+        double ms = pmeter_get_time_ms () - ttime0;
+
+        metrics_record_ms (timer, ms);
+        if (ms < min_ms)
+            min_ms = ms;
+    }
+
+    result->bc     = bc;
+    result->batch  = batch;
+    result->min_ms = min_ms / batch;
+    metrics_get_timer (timer, &result->latency);
+    result->latency.mean_ms /= batch;
+    result->latency.p50_ms  /= batch;
+    result->latency.p95_ms  /= batch;
+    result->latency.p99_ms  /= batch;
+    result->latency.max_ms  /= batch;
+}
+
+/* p95 budget of the kernel in the budget file, or 0 */
+static double
+find_budget (bench_opt_t *opt, const char *name)
+{
+    char line[256], kernel[128];
+    double budget_us = 0, us;
+
+    if (opt->budget_path == NULL)
+        return 0;
+
+    FILE *fp = fopen (opt->budget_path, "r");
+    if (fp == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d): can't open %s\n", __FILE__, __LINE__, opt->budget_path);
+        return 0;
+    }
+
+    while (fgets (line, sizeof (line), fp))
+    {
+        if (line[0] == '#')
+            continue;
+        if (sscanf (line, "%127s %lf", kernel, &us) == 2 && strcmp (kernel, name) == 0)
+            budget_us = us;
+    }
+    fclose (fp);
+    return budget_us;
+}
+
+static int
+is_over_budget (bench_result_t &r)
+{
+    return r.budget_us > 0 && r.latency.p95_ms * 1000.0 > r.budget_us;
+}
+
+static const char *
+input_name (int input)
+{
+    return (input == BENCH_INPUT_RECORDED) ? "rec" : "syn";
+}
+
+static void
+print_table (bench_opt_t *opt, std::vector<bench_result_t> &results)
+{
+    printf ("\nwarm-up %d, iterations %d\n", opt->warmup, opt->iterations);
+    printf ("-----------------------------------------------------------------------------------------------------\n");
+    printf (" kernel                          input      min     mean      p50      p95      max [us]   budget\n");
+    printf ("-----------------------------------------------------------------------------------------------------\n");
+    for (auto &r : results)
+    {
+        char budget[32] = "-";
+        if (r.budget_us > 0)
+            snprintf (budget, sizeof (budget), "%8.1f%s", r.budget_us, is_over_budget (r) ? " FAIL" : "");
+
+        printf (" %-31s %-5s %8.1f %8.1f %8.1f %8.1f %8.1f   %s\n",
+                r.bc->name, input_name (r.bc->input), r.min_ms * 1000.0,
+                r.latency.mean_ms * 1000.0, r.latency.p50_ms * 1000.0,
+                r.latency.p95_ms * 1000.0, r.latency.max_ms * 1000.0, budget);
+    }
+    printf ("-----------------------------------------------------------------------------------------------------\n");
+}
+
+static int
+write_json (bench_opt_t *opt, std::vector<bench_result_t> &results)
+{
+    FILE *fp = fopen (opt->json_path, "w");
+    if (fp == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d): can't open %s\n", __FILE__, __LINE__, opt->json_path);
+        return -1;
+    }
+
+    fprintf (fp, "{\n  \"warmup\": %d,\n  \"iterations\": %d,\n  \"results\": [",
+             opt->warmup, opt->iterations);
+    for (size_t i = 0; i < results.size (); i ++)
+    {
+        bench_result_t &r = results[i];
+        fprintf (fp, "%s\n    {\"kernel\": \"%s\", \"input\": \"%s\", \"min_us\": %.2f, \"mean_us\": %.2f, "
+                 "\"p50_us\": %.2f, \"p95_us\": %.2f, \"max_us\": %.2f, \"batch\": %d, "
+                 "\"budget_us\": %.2f, \"over_budget\": %s}",
+                 i ? "," : "", r.bc->name, input_name (r.bc->input), r.min_ms * 1000.0,
+                 r.latency.mean_ms * 1000.0, r.latency.p50_ms * 1000.0,
+                 r.latency.p95_ms * 1000.0, r.latency.max_ms * 1000.0, r.batch,
+                 r.budget_us, is_over_budget (r) ? "true" : "false");
+    }
+    fprintf (fp, "\n  ]\n}\n");
+    fclose (fp);
+    return 0;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    std::vector<bench_result_t> results;
+
+    if (parse_args (argc, argv, &s_opt) < 0)
+    {
+        usage (argv[0]);
+        return -1;
+    }
+
+    if (s_opt.data_dir == NULL)
+        DBG_LOG ("no -d: every case runs on its synthetic input\n");
+
+    register_common_cases ();
+    bench_register_blazeface ();
+    bench_register_hair_ops ();
+
+    for (auto &bc : s_cases)
+    {
+        if (s_opt.filter && strstr (bc.name, s_opt.filter) == NULL)
+            continue;
+
+        if (s_opt.list_only)
+        {
+            printf ("%-31s %s\n", bc.name, input_name (bc.input));
+            continue;
+        }
+
+        bench_result_t result;
+        run_case (&s_opt, &bc, &result);
+        result.budget_us = find_budget (&s_opt, bc.name);
+        results.push_back (result);
+    }
+
+    if (s_opt.list_only)
+        return 0;
+
+    print_table (&s_opt, results);
+
+    if (s_opt.json_path)
+        write_json (&s_opt, results);
+
+    for (auto &r : results)
+    {
+        if (is_over_budget (r))
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef _MICROBENCH_H_
+#define _MICROBENCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* where the input of a case came from */
+#define BENCH_INPUT_SYNTHETIC   0
+#define BENCH_INPUT_RECORDED    1
+
+typedef void (*bench_func_t) (void *arg);
+
+/*
+ *  one measured kernel. func is called (warm-up + iterations) times with arg
+ *  and must leave arg reusable for the next call.
+ */
+typedef struct _bench_case_t
+{
+    const char      *name;      /* "<kernel>/<input>" */
+    int             input;      /* BENCH_INPUT_xxx */
+    bench_func_t    func;
+    void            *arg;
+} bench_case_t;
+
+
+void bench_add (const char *name, int input, bench_func_t func, void *arg);
+
+/*
+ *  recorded tensors: <dir>/<file> (raw bytes as dumped from the tensor) is
+ *  loaded into buf when -d dir is given and the file is exactly size bytes.
+ *  returns BENCH_INPUT_RECORDED, or BENCH_INPUT_SYNTHETIC when buf is untouched
+ *  (file == NULL: synthetic only).
+ */
+int  bench_load_tensor (const char *file, void *buf, size_t size);
+
+/* deterministic pseudo random inputs (same sequence on every run) */
+float bench_rand (float vmin, float vmax);
+void  bench_fill_float (float *buf, int num, float vmin, float vmax);
+void  bench_fill_uint8 (uint8_t *buf, int num);
+
+/* cases that live in their own translation units */
+void bench_register_blazeface (void);
+void bench_register_hair_ops (void);
+
+#endif /* _MICROBENCH_H_ */
@@ -0,0 +1,64 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <string>
+#include "util_debug.h"
+#include "pipeline_golden.h"
+#include "tflite_blazeface.h"
+#include "blazeface_feed.h"
+
+/*
+ *  tflite_blazeface: readback + convert_blazeface_input () (blazeface_feed.cpp)
+ *  --> face detection --> decode_bounds () + NMS (tflite_blazeface.cpp)
+ */
+static char                 *s_model_buf;   /* the interpreter refers to it */
+static blazeface_config_t   s_config;
+
+static int
+init_blazeface_chain (const char *asset_dir)
+{
+    size_t model_size;
+    std::string path = std::string (asset_dir) + "/" + BLAZEFACE_MODEL_PATH;
+
+    s_model_buf = golden_read_file (path.c_str (), &model_size);
+    if (s_model_buf == NULL)
+        return -1;
+
+    /* the default thresholds of the app */
+    if (init_tflite_blazeface (s_model_buf, model_size, &s_config) < 0)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+    return 0;
+}
+
+static int
+run_blazeface_chain (texture_2d_t *srctex, int win_w, int win_h, std::string &out)
+{
+    blazeface_result_t face_ret = {0};
+
+    feed_blazeface_image (srctex, win_w, win_h);
+    if (invoke_blazeface (&face_ret, &s_config) < 0)
+        return -1;
+
+    golden_printf (out, "faces %d\n", face_ret.num);
+    for (int i = 0; i < face_ret.num; i ++)
+    {
+        face_t *face = &face_ret.faces[i];
+        golden_printf (out, "face %d score %.4f rect %.4f %.4f %.4f %.4f keys", i, face->score,
+                       face->topleft.x, face->topleft.y, face->btmright.x, face->btmright.y);
+        for (int j = 0; j < kFaceKeyNum; j ++)
+            golden_printf (out, " %.4f %.4f", face->keys[j].x, face->keys[j].y);
+        golden_printf (out, "\n");
+    }
+    return 0;
+}
+
+golden_chain_t g_golden_chain = {
+    "blazeface",
+    480, 480,       /* CAMERA_CROP_WIDTH/HEIGHT of the app */
+    init_blazeface_chain,
+    run_blazeface_chain,
+};
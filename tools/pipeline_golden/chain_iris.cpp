@@ -0,0 +1,115 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <string>
+#include "util_debug.h"
+#include "pipeline_golden.h"
+#include "tflite_facemesh.h"
+#include "facemesh_graph.h"
+
+/*
+ *  tflite_iris_landmark: the pipeline graph of the app (facemesh_graph.cpp)
+ *    face_detect --> face_mesh (crop per face) --> iris (crop per eye)
+ *  and the ROI tracking of the next frame (track_face_from_landmark ()).
+ *  every frame runs the face detection; the tracked regions are written out
+ *  instead of being fed back, so that the result of a frame does not depend
+ *  on the frames before it.
+ */
+#define FACE_TRACK_SCORE_THRESH 0.5f    /* as the app */
+
+static char             *s_model_buf[3];    /* the interpreters refer to them */
+static facemesh_graph_t s_facemesh_graph;
+
+static int
+init_iris_chain (const char *asset_dir)
+{
+    const char *model_path[3] = {FACE_DETECT_MODEL_PATH, FACE_LANDMARK_MODEL_PATH, IRIS_LANDMARK_MODEL_PATH};
+    size_t model_size[3];
+
+    for (int i = 0; i < 3; i ++)
+    {
+        std::string path = std::string (asset_dir) + "/" + model_path[i];
+        s_model_buf[i] = golden_read_file (path.c_str (), &model_size[i]);
+        if (s_model_buf[i] == NULL)
+            return -1;
+    }
+
+    if (init_tflite_facemesh (s_model_buf[0], model_size[0],
+                              s_model_buf[1], model_size[1],
+                              s_model_buf[2], model_size[2]) < 0)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    return create_facemesh_graph (&s_facemesh_graph);
+}
+
+static void
+print_vec3 (std::string &out, const char *label, const fvec3 *v, int num)
+{
+    golden_printf (out, " %s", label);
+    for (int i = 0; i < num; i ++)
+        golden_printf (out, " %.4f %.4f %.4f", v[i].x, v[i].y, v[i].z);
+}
+
+static int
+run_iris_chain (texture_2d_t *srctex, int win_w, int win_h, std::string &out)
+{
+    static face_detect_result_t   face_detect_ret;
+    static face_landmark_result_t face_mesh_ret[MAX_FACE_NUM];
+    static irismesh_result_t      iris_mesh_ret[MAX_FACE_NUM][2];
+
+    s_facemesh_graph.tracked_faces = NULL;
+    int num_faces = run_facemesh_graph (&s_facemesh_graph, srctex, win_w, win_h,
+                                        &face_detect_ret, face_mesh_ret, iris_mesh_ret);
+    if (num_faces < 0)
+        return -1;
+
+    golden_printf (out, "faces %d\n", face_detect_ret.num);
+    for (int i = 0; i < face_detect_ret.num; i ++)
+    {
+        face_t *face = &face_detect_ret.faces[i];
+        golden_printf (out, "face %d score %.4f rect %.4f %.4f %.4f %.4f roi", i, face->score,
+                       face->topleft.x, face->topleft.y, face->btmright.x, face->btmright.y);
+        for (int j = 0; j < 4; j ++)
+            golden_printf (out, " %.4f %.4f", face->face_pos[j].x, face->face_pos[j].y);
+        golden_printf (out, "\n");
+    }
+
+    for (int i = 0; i < num_faces; i ++)
+    {
+        golden_printf (out, "mesh %d score %.4f", i, face_mesh_ret[i].score);
+        print_vec3 (out, "joint", face_mesh_ret[i].joint, FACE_KEY_NUM);
+        golden_printf (out, "\n");
+
+        for (int eye_id = 0; eye_id < 2; eye_id ++)
+        {
+            golden_printf (out, "eye %d %d", i, eye_id);
+            print_vec3 (out, "eye", iris_mesh_ret[i][eye_id].eye_landmark, 71);
+            print_vec3 (out, "iris", iris_mesh_ret[i][eye_id].iris_landmark, 5);
+            golden_printf (out, "\n");
+        }
+    }
+
+    /* regions the app would take for the next frame */
+    face_detect_result_t face_track = face_detect_ret;
+    int num_tracked = track_face_from_landmark (&face_track, face_mesh_ret, FACE_TRACK_SCORE_THRESH);
+    golden_printf (out, "tracked %d\n", num_tracked);
+    for (int i = 0; i < face_track.num; i ++)
+    {
+        golden_printf (out, "track %d roi", i);
+        for (int j = 0; j < 4; j ++)
+            golden_printf (out, " %.4f %.4f", face_track.faces[i].face_pos[j].x, face_track.faces[i].face_pos[j].y);
+        golden_printf (out, "\n");
+    }
+    return 0;
+}
+
+golden_chain_t g_golden_chain = {
+    "iris_landmark",
+    480, 480,       /* CAMERA_CROP_WIDTH/HEIGHT of the app */
+    init_iris_chain,
+    run_iris_chain,
+};
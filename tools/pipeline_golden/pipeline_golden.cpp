@@ -0,0 +1,456 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cmath>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <dirent.h>
+#include <GLES2/gl2.h>
+#include "util_egl.h"
+#include "util_texture.h"
+#include "util_render2d.h"
+#include "util_render_target.h"
+#include "util_debug.h"
+#include "pipeline_golden.h"
+#include "stb/stb_image.h"
+
+/*
+ *  Golden check of a whole app chain: the recorded frames go through the
+ *  crop of the app (CropCameraTexture), the app's feed, the inference and
+ *  the app's decode, and the decoded results are compared with the golden
+ *  files. A change of a preprocess or a decoder shows up here even when
+ *  the raw model outputs (tools/tflite_benchmark -g) did not move.
+ */
+#define WIN_W               512     /* pbuffer: every crop of the chains must fit in it */
+#define WIN_H               512
+#define MAX_INPUT_FRAMES    32
+
+typedef struct _golden_opt_t
+{
+    const char  *asset_dir;     /* models (and the images when no -i/-f) */
+    const char  *image_dir;
+    const char  *frames_path;   /* raw RGBA8888 frames instead of images */
+    int         frame_w, frame_h;
+    const char  *golden_dir;
+    int         golden_update;
+    double      tolerance;
+} golden_opt_t;
+
+typedef struct _golden_frame_t
+{
+    std::string name;           /* golden file: <golden_dir>/<name>.txt */
+    std::string path;           /* image file, or the raw frames file */
+    int         index;          /* frame of the raw frames file */
+} golden_frame_t;
+
+
+void
+golden_printf (std::string &out, const char *fmt, ...)
+{
+    char buf[1024];
+    va_list ap;
+
+    va_start (ap, fmt);
+    vsnprintf (buf, sizeof (buf), fmt, ap);
+    va_end (ap);
+    out += buf;
+}
+
+char *
+golden_read_file (const char *path, size_t *size)
+{
+    FILE *fp = fopen (path, "rb");
+    if (fp == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d): can't open %s\n", __FILE__, __LINE__, path);
+        return NULL;
+    }
+
+    fseek (fp, 0, SEEK_END);
+    long len = ftell (fp);
+    fseek (fp, 0, SEEK_SET);
+
+    char *buf = (char *)malloc (len);
+    if (buf == NULL || fread (buf, 1, len, fp) != (size_t)len)
+    {
+        DBG_LOGE ("ERR: %s(%d): %s\n", __FILE__, __LINE__, path);
+        free (buf);
+        fclose (fp);
+        return NULL;
+    }
+    fclose (fp);
+
+    *size = len;
+    return buf;
+}
+
+
+static void
+usage (const char *prog)
+{
+    fprintf (stderr,
+        "usage: %s -a dir [options]    (chain: %s)\n"
+        "  -a dir      assets of the app: the models, and the input images by default\n"
+        "  -i dir      input images (jpg/png) instead of the ones of -a\n"
+        "  -f file     recorded raw RGBA8888 frames instead of images (with -W w -H h)\n"
+        "  -g dir      compare the results with the golden files of dir\n"
+        "  -u          write the results into the -g dir as the new golden files\n"
+        "  -e err      tolerance of every number, absolute below 1, relative above (default: 1e-2)\n",
+        prog, g_golden_chain.name);
+}
+
+static int
+parse_args (int argc, char *argv[], golden_opt_t *opt)
+{
+    int c;
+
+    opt->asset_dir     = NULL;
+    opt->image_dir     = NULL;
+    opt->frames_path   = NULL;
+    opt->frame_w       = 0;
+    opt->frame_h       = 0;
+    opt->golden_dir    = NULL;
+    opt->golden_update = 0;
+    opt->tolerance     = 1e-2;
+
+    while ((c = getopt (argc, argv, "a:i:f:W:H:g:ue:h")) != -1)
+    {
+        switch (c)
+        {
+        case 'a': opt->asset_dir     = optarg;         break;
+        case 'i': opt->image_dir     = optarg;         break;
+        case 'f': opt->frames_path   = optarg;         break;
+        case 'W': opt->frame_w       = atoi (optarg);  break;
+        case 'H': opt->frame_h       = atoi (optarg);  break;
+        case 'g': opt->golden_dir    = optarg;         break;
+        case 'u': opt->golden_update = 1;              break;
+        case 'e': opt->tolerance     = atof (optarg);  break;
+        default:
+            return -1;
+        }
+    }
+
+    if (opt->asset_dir == NULL)
+        return -1;
+    if (opt->golden_update && opt->golden_dir == NULL)
+        return -1;
+    if (opt->frames_path && (opt->frame_w <= 0 || opt->frame_h <= 0))
+        return -1;
+    if (opt->image_dir == NULL)
+        opt->image_dir = opt->asset_dir;
+    return 0;
+}
+
+
+/* -------------------------------------------------- *
+ *  input frames
+ * -------------------------------------------------- */
+static std::string
+base_name (const std::string &path)
+{
+    size_t slash = path.rfind ('/');
+    std::string name = (slash == std::string::npos) ? path : path.substr (slash + 1);
+    size_t dot = name.rfind ('.');
+    return (dot == std::string::npos) ? name : name.substr (0, dot);
+}
+
+static int
+list_frames (golden_opt_t *opt, std::vector<golden_frame_t> &frames)
+{
+    if (opt->frames_path)
+    {
+        FILE *fp = fopen (opt->frames_path, "rb");
+        if (fp == NULL)
+        {
+            DBG_LOGE ("ERR: %s(%d): can't open %s\n", __FILE__, __LINE__, opt->frames_path);
+            return -1;
+        }
+        fseek (fp, 0, SEEK_END);
+        long num = ftell (fp) / ((long)opt->frame_w * opt->frame_h * 4);
+        fclose (fp);
+
+        for (int i = 0; i < num && i < MAX_INPUT_FRAMES; i ++)
+        {
+            char suffix[16];
+            snprintf (suffix, sizeof (suffix), "_%03d", i);
+            golden_frame_t frame = {base_name (opt->frames_path) + suffix, opt->frames_path, i};
+            frames.push_back (frame);
+        }
+        return 0;
+    }
+
+    DIR *dir = opendir (opt->image_dir);
+    if (dir == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d): can't open %s\n", __FILE__, __LINE__, opt->image_dir);
+        return -1;
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir (dir)) != NULL)
+    {
+        const char *ext = strrchr (ent->d_name, '.');
+        if (ext && (strcasecmp (ext, ".jpg") == 0 || strcasecmp (ext, ".jpeg") == 0 ||
+                    strcasecmp (ext, ".png") == 0))
+        {
+            std::string path = std::string (opt->image_dir) + "/" + ent->d_name;
+            golden_frame_t frame = {base_name (path), path, 0};
+            frames.push_back (frame);
+        }
+    }
+    closedir (dir);
+
+    std::sort (frames.begin (), frames.end (),
+               [] (const golden_frame_t &a, const golden_frame_t &b) { return a.name < b.name; });
+    if (frames.size () > MAX_INPUT_FRAMES)
+        frames.resize (MAX_INPUT_FRAMES);
+    return 0;
+}
+
+static int
+load_frame (golden_opt_t *opt, const golden_frame_t &frame, texture_2d_t *tex)
+{
+    uint8_t *rgba;
+    int w, h;
+
+    if (opt->frames_path)
+    {
+        w = opt->frame_w;
+        h = opt->frame_h;
+        rgba = (uint8_t *)malloc (w * h * 4);
+        FILE *fp = fopen (frame.path.c_str (), "rb");
+        if (rgba == NULL || fp == NULL ||
+            fseek (fp, (long)frame.index * w * h * 4, SEEK_SET) != 0 ||
+            fread (rgba, w * h * 4, 1, fp) != 1)
+        {
+            DBG_LOGE ("ERR: %s(%d): %s\n", __FILE__, __LINE__, frame.name.c_str ());
+            if (fp)
+                fclose (fp);
+            free (rgba);
+            return -1;
+        }
+        fclose (fp);
+    }
+    else
+    {
+        int ch;
+        rgba = stbi_load (frame.path.c_str (), &w, &h, &ch, 4);
+        if (rgba == NULL)
+        {
+            DBG_LOGE ("ERR: %s(%d): can't load %s\n", __FILE__, __LINE__, frame.path.c_str ());
+            return -1;
+        }
+    }
+
+    create_2d_texture_ex (tex, rgba, w, h, pixfmt_fourcc ('R', 'G', 'B', 'A'));
+    free (rgba);
+    return 0;
+}
+
+/* what CropCameraTexture() of the apps does with a back camera frame: full zoom into a square */
+static void
+crop_frame (texture_2d_t *srctex, render_target_t *rtarget_crop, render_target_t *rtarget_main)
+{
+    set_render_target (rtarget_crop);
+    set_2d_projection_matrix (rtarget_crop->width, rtarget_crop->height);
+    glClear (GL_COLOR_BUFFER_BIT);
+
+    float scale = std::max ((float)rtarget_crop->width  / srctex->width,
+                            (float)rtarget_crop->height / srctex->height);
+    int draw_w = (int)(srctex->width  * scale);
+    int draw_h = (int)(srctex->height * scale);
+    int draw_x = (int)((rtarget_crop->width  - draw_w) * 0.5f);
+    int draw_y = (int)((rtarget_crop->height - draw_h) * 0.5f);
+    draw_2d_texture_ex (srctex, draw_x, draw_y, draw_w, draw_h, RENDER2D_FLIP_V);
+
+    set_render_target (rtarget_main);
+    set_2d_projection_matrix (rtarget_main->width, rtarget_main->height);
+}
+
+
+/* -------------------------------------------------- *
+ *  golden files
+ * -------------------------------------------------- */
+static std::vector<std::string>
+split_tokens (const std::string &str, std::vector<int> &lines)
+{
+    std::vector<std::string> tokens;
+    int line = 1;
+    size_t pos = 0;
+
+    while (pos < str.size ())
+    {
+        if (isspace ((unsigned char)str[pos]))
+        {
+            if (str[pos] == '\n')
+                line ++;
+            pos ++;
+            continue;
+        }
+        size_t end = pos;
+        while (end < str.size () && !isspace ((unsigned char)str[end]))
+            end ++;
+        tokens.push_back (str.substr (pos, end - pos));
+        lines.push_back (line);
+        pos = end;
+    }
+    return tokens;
+}
+
+static int
+compare_golden (const std::string &result, const std::string &path, double tolerance, double *max_err)
+{
+    size_t len;
+    char *buf = golden_read_file (path.c_str (), &len);
+    if (buf == NULL)
+        return -1;      /* no golden file is a failure: run -u on the reference device */
+    std::string golden (buf, len);
+    free (buf);
+
+    std::vector<int> lines, golden_lines;
+    std::vector<std::string> tokens        = split_tokens (result, lines);
+    std::vector<std::string> golden_tokens = split_tokens (golden, golden_lines);
+
+    *max_err = 0;
+    for (size_t i = 0; i < tokens.size () && i < golden_tokens.size (); i ++)
+    {
+        char *end0, *end1;
+        double val        = strtod (tokens[i].c_str (), &end0);
+        double golden_val = strtod (golden_tokens[i].c_str (), &end1);
+
+        if (*end0 == '\0' && *end1 == '\0')
+        {
+            double err = fabs (val - golden_val) / std::max (1.0, fabs (golden_val));
+            *max_err = std::max (*max_err, err);
+            if (err <= tolerance)
+                continue;
+        }
+        else if (tokens[i] == golden_tokens[i])
+        {
+            continue;
+        }
+
+        DBG_LOG ("golden: %s:%d: \"%s\" (golden \"%s\")\n", path.c_str (), golden_lines[i],
+                 tokens[i].c_str (), golden_tokens[i].c_str ());
+        return -1;
+    }
+
+    /* e.g. a face more or less */
+    if (tokens.size () != golden_tokens.size ())
+    {
+        DBG_LOG ("golden: %s: %zu tokens (golden %zu)\n", path.c_str (), tokens.size (), golden_tokens.size ());
+        return -1;
+    }
+    return 0;
+}
+
+static int
+write_golden (const std::string &result, const std::string &path)
+{
+    FILE *fp = fopen (path.c_str (), "w");
+    if (fp == NULL || fwrite (result.data (), 1, result.size (), fp) != result.size ())
+    {
+        DBG_LOGE ("ERR: %s(%d): can't write %s\n", __FILE__, __LINE__, path.c_str ());
+        if (fp)
+            fclose (fp);
+        return -1;
+    }
+    fclose (fp);
+    return 0;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    golden_opt_t opt;
+    std::vector<golden_frame_t> frames;
+
+    if (parse_args (argc, argv, &opt) < 0)
+    {
+        usage (argv[0]);
+        return 2;
+    }
+
+    if (list_frames (&opt, frames) < 0 || frames.empty ())
+    {
+        DBG_LOGE ("ERR: %s(%d): no input frames\n", __FILE__, __LINE__);
+        return 2;
+    }
+
+    if (egl_init_with_pbuffer_surface (2, 0, 0, 0, WIN_W, WIN_H) < 0)
+        return 2;
+    init_2d_renderer (WIN_W, WIN_H);
+
+    if (g_golden_chain.init (opt.asset_dir) < 0)
+        return 2;
+
+    render_target_t rtarget_main, rtarget_crop;
+    get_render_target (&rtarget_main);
+    create_render_target (&rtarget_crop, g_golden_chain.crop_w, g_golden_chain.crop_h, RTARGET_COLOR);
+
+    texture_2d_t croptex;
+    croptex.texid  = rtarget_crop.texc_id;
+    croptex.width  = rtarget_crop.width;
+    croptex.height = rtarget_crop.height;
+    croptex.format = pixfmt_fourcc ('R', 'G', 'B', 'A');
+
+    printf ("chain: %s  (%zu frames", g_golden_chain.name, frames.size ());
+    if (opt.golden_dir)
+        printf (", golden: %s, tolerance %g", opt.golden_dir, opt.tolerance);
+    printf (")\n");
+
+    int num_fail = 0;
+    for (auto &frame : frames)
+    {
+        texture_2d_t srctex;
+        if (load_frame (&opt, frame, &srctex) < 0)
+        {
+            num_fail ++;
+            continue;
+        }
+
+        crop_frame (&srctex, &rtarget_crop, &rtarget_main);
+        glClear (GL_COLOR_BUFFER_BIT);
+
+        std::string result;
+        int ret = g_golden_chain.run (&croptex, WIN_W, WIN_H, result);
+        glDeleteTextures (1, &srctex.texid);
+
+        const char *check = "-";
+        double max_err = 0;
+        if (ret < 0)
+        {
+            check = "FAIL:run";
+        }
+        else if (opt.golden_dir)
+        {
+            std::string path = std::string (opt.golden_dir) + "/" + frame.name + ".txt";
+            if (opt.golden_update)
+                check = (write_golden (result, path) < 0) ? "FAIL:write" : "updated";
+            else
+                check = (compare_golden (result, path, opt.tolerance, &max_err) < 0) ? "FAIL:out" : "ok";
+        }
+        else
+        {
+            fputs (result.c_str (), stdout);
+        }
+
+        if (strncmp (check, "FAIL", 4) == 0)
+            num_fail ++;
+        printf (" %-32s %-10s max error %g\n", frame.name.c_str (), check, max_err);
+    }
+
+    destroy_render_target (&rtarget_crop);
+    egl_terminate ();
+
+    return (num_fail > 0) ? 1 : 0;
+}
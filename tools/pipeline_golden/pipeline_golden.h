@@ -0,0 +1,42 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#ifndef PIPELINE_GOLDEN_H_
+#define PIPELINE_GOLDEN_H_
+
+#include <string>
+#include "util_texture.h"
+
+/*
+ *  one chain of an app (feed -> invoke -> decode), built from the sources of
+ *  the app itself. every chain_xxx.cpp is linked into an executable of its
+ *  own (pipeline_golden_xxx), since the headers of the apps collide.
+ */
+typedef struct _golden_chain_t
+{
+    const char  *name;
+    int         crop_w, crop_h;     /* the app crops the camera image to this (CAMERA_CROP_xxx) */
+
+    /* load the models of the app from asset_dir */
+    int  (*init) (const char *asset_dir);
+
+    /*
+     *  run the chain on srctex (the cropped frame) like RenderFrame() does,
+     *  and append the decoded results to out as text (see golden_printf).
+     */
+    int  (*run)  (texture_2d_t *srctex, int win_w, int win_h, std::string &out);
+} golden_chain_t;
+
+extern golden_chain_t g_golden_chain;
+
+/*
+ *  results are whitespace separated tokens: the words are compared as they are,
+ *  the numbers within the tolerance. keep one record (face, eye, ...) per line.
+ */
+void golden_printf (std::string &out, const char *fmt, ...);
+
+/* the whole file in a malloc()ed buffer. NULL on error */
+char *golden_read_file (const char *path, size_t *size);
+
+#endif /* PIPELINE_GOLDEN_H_ */
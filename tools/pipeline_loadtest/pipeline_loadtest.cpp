@@ -0,0 +1,257 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <chrono>
+#include <unistd.h>
+#include "util_pipeline.h"
+#include "util_frame_source.h"
+#include "util_pmeter.h"
+#include "util_debug.h"
+
+/*
+ *  Drives util_pipeline with a frame source paced like a camera, and stages
+ *  which take a fixed time like the preprocess/inference of the apps, to see
+ *  what the latency budget does to the capture-to-result latency.
+ */
+#define MAX_SLOTS   PIPELINE_MAX_SLOTS
+
+typedef struct _loadtest_opt_t
+{
+    int         w, h;
+    float       fps;
+    int         num_stages;
+    double      stage_ms[PIPELINE_MAX_STAGES];
+    double      budget_ms;      /* 0: no budget */
+    int         num_slots;
+    double      duration_s;
+    const char  *input_path;    /* NULL: synthetic frames */
+} loadtest_opt_t;
+
+typedef struct _loadtest_frame_t
+{
+    int         w, h;
+    uint8_t     *rgba;
+    uint32_t    sum;
+} loadtest_frame_t;
+
+typedef struct _stage_ctx_t
+{
+    char        name[16];       /* util_pipeline keeps the pointer */
+    double      ms;
+} stage_ctx_t;
+
+static loadtest_frame_t s_frames[MAX_SLOTS];
+static stage_ctx_t      s_stage_ctx[PIPELINE_MAX_STAGES];
+
+
+static void
+stage_func (void *ctx, pipeline_frame_t *frame)
+{
+    stage_ctx_t *stage = (stage_ctx_t *)ctx;
+    loadtest_frame_t *f = (loadtest_frame_t *)frame->data;
+
+    /* touch the frame like a preprocess would, then wait out the stage time */
+    double t0 = pmeter_get_time_ms ();
+    uint32_t sum = 0;
+    for (int i = 0; i < f->w * f->h * 4; i += 64)
+        sum += f->rgba[i];
+    f->sum = sum;
+
+    double rest_ms = stage->ms - (pmeter_get_time_ms () - t0);
+    if (rest_ms > 0)
+        std::this_thread::sleep_for (std::chrono::microseconds ((long)(rest_ms * 1000)));
+}
+
+
+static void
+usage (const char *prog)
+{
+    fprintf (stderr,
+        "usage: %s [options]\n"
+        "  -s ms,ms..  time of each stage (default: 20,45)\n"
+        "  -b ms       latency budget, 0 for none (default: 0)\n"
+        "  -r fps      frame rate of the source (default: 60)\n"
+        "  -n N        pipeline slots (default: 4)\n"
+        "  -t sec      duration (default: 10)\n"
+        "  -W w -H h   frame size (default: 256x256)\n"
+        "  -i file     raw RGBA8888 frames instead of the synthetic ones\n",
+        prog);
+}
+
+static int
+parse_stages (const char *str, loadtest_opt_t *opt)
+{
+    opt->num_stages = 0;
+    while (*str)
+    {
+        if (opt->num_stages >= PIPELINE_MAX_STAGES)
+            return -1;
+
+        char *end;
+        double ms = strtod (str, &end);
+        if (end == str || ms < 0)
+            return -1;
+        opt->stage_ms[opt->num_stages ++] = ms;
+
+        str = end;
+        if (*str == ',')
+            str ++;
+    }
+    return (opt->num_stages > 0) ? 0 : -1;
+}
+
+static int
+parse_args (int argc, char *argv[], loadtest_opt_t *opt)
+{
+    int c;
+
+    opt->w          = 256;
+    opt->h          = 256;
+    opt->fps        = 60.0f;
+    opt->budget_ms  = 0;
+    opt->num_slots  = 4;
+    opt->duration_s = 10;
+    opt->input_path = NULL;
+    parse_stages ("20,45", opt);
+
+    while ((c = getopt (argc, argv, "s:b:r:n:t:W:H:i:h")) != -1)
+    {
+        switch (c)
+        {
+        case 's':
+            if (parse_stages (optarg, opt) < 0)
+                return -1;
+            break;
+        case 'b': opt->budget_ms  = atof (optarg); break;
+        case 'r': opt->fps        = atof (optarg); break;
+        case 'n': opt->num_slots  = atoi (optarg); break;
+        case 't': opt->duration_s = atof (optarg); break;
+        case 'W': opt->w          = atoi (optarg); break;
+        case 'H': opt->h          = atoi (optarg); break;
+        case 'i': opt->input_path = optarg;        break;
+        default:
+            return -1;
+        }
+    }
+
+    if (opt->w <= 0 || opt->h <= 0 || opt->duration_s <= 0 ||
+        opt->num_slots <= 0 || opt->num_slots > MAX_SLOTS)
+        return -1;
+    return 0;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    loadtest_opt_t opt;
+    void *slot_data[MAX_SLOTS];
+
+    if (parse_args (argc, argv, &opt) < 0)
+    {
+        usage (argv[0]);
+        return -1;
+    }
+
+    frame_source_t *src;
+    if (opt.input_path)
+        src = frame_source_create_file (opt.input_path, opt.w, opt.h, opt.fps);
+    else
+        src = frame_source_create_synthetic (opt.w, opt.h, opt.fps);
+    if (src == NULL)
+        return -1;
+
+    uint8_t *rgba = (uint8_t *)malloc (opt.w * opt.h * 4);
+    if (rgba == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    for (int i = 0; i < opt.num_slots; i ++)
+    {
+        loadtest_frame_t *f = &s_frames[i];
+        f->w    = opt.w;
+        f->h    = opt.h;
+        f->rgba = (uint8_t *)malloc (opt.w * opt.h * 4);
+        if (f->rgba == NULL)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            return -1;
+        }
+        slot_data[i] = f;
+    }
+
+    pipeline_t *pl = pipeline_create (slot_data, opt.num_slots);
+    if (pl == NULL)
+        return -1;
+
+    for (int i = 0; i < opt.num_stages; i ++)
+    {
+        stage_ctx_t *stage = &s_stage_ctx[i];
+        snprintf (stage->name, sizeof (stage->name), "stage%d", i);
+        stage->ms = opt.stage_ms[i];
+        pipeline_add_stage (pl, stage->name, stage_func, stage);
+    }
+    pipeline_set_latency_budget (pl, opt.budget_ms);
+    pipeline_start (pl);
+
+    /*
+     *  the main thread plays the render thread of the apps: one camera frame
+     *  per iteration, submitted when a slot is free, then the newest result.
+     */
+    int num_read = 0;
+    double end_ms = pmeter_get_time_ms () + opt.duration_s * 1000;
+    while (pmeter_get_time_ms () < end_ms)
+    {
+        double capture_ms;
+        if (frame_source_read (src, rgba, &capture_ms) < 0)
+            break;
+        num_read ++;
+
+        pipeline_frame_t *frame = pipeline_acquire (pl);
+        if (frame)
+        {
+            loadtest_frame_t *f = (loadtest_frame_t *)frame->data;
+            memcpy (f->rgba, rgba, opt.w * opt.h * 4);
+            pipeline_submit_at (pl, frame, capture_ms);
+        }
+
+        pipeline_frame_t *done = pipeline_fetch_latest (pl);
+        if (done)
+            pipeline_release (pl, done);
+    }
+
+    pipeline_stats_t stats;
+    pipeline_get_stats (pl, &stats);
+
+    printf ("stages   :");
+    for (int i = 0; i < opt.num_stages; i ++)
+        printf (" %.1f", opt.stage_ms[i]);
+    printf (" [ms], %d slots, %.0f fps, budget %.1f [ms]\n", opt.num_slots, opt.fps, opt.budget_ms);
+    printf ("frames   : read %d, submitted %llu, completed %llu, dropped %llu (",
+            num_read,
+            (unsigned long long)stats.num_submitted,
+            (unsigned long long)stats.num_completed,
+            (unsigned long long)stats.num_dropped);
+    for (int i = 0; i < opt.num_stages; i ++)
+        printf ("stage%d:%llu ", i, (unsigned long long)stats.num_dropped_stage[i]);
+    printf ("render:%llu", (unsigned long long)stats.num_dropped_stage[opt.num_stages]);
+    printf (")\n");
+    printf ("latency  : mean %.1f, p50 %.0f, p95 %.0f, p99 %.0f, max %.0f [ms]\n",
+            stats.latency_mean, stats.latency_p50, stats.latency_p95, stats.latency_p99,
+            stats.latency_max);
+
+    pipeline_destroy (pl);
+    frame_source_destroy (src);
+    for (int i = 0; i < opt.num_slots; i ++)
+        free (s_frames[i].rgba);
+    free (rgba);
+
+    return 0;
+}
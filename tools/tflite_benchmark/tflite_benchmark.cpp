@@ -0,0 +1,835 @@
+/* ------------------------------------------------ *
+ * The MIT License (MIT)
+ * Copyright (c) 2020 terryky1220@gmail.com
+ * ------------------------------------------------ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "util_tflite.h"
+#include "util_metrics.h"
+#include "util_pmeter.h"
+#include "util_debug.h"
+#include "custom_ops/max_pool_argmax.h"
+#include "custom_ops/max_unpooling.h"
+#include "custom_ops/transpose_conv_bias.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+
+#define MAX_INPUT_IMAGES    32
+
+/* value range of a float input */
+#define RANGE_0_1           0   /* [ 0.0, 1.0] */
+#define RANGE_M1_1          1   /* [-1.0, 1.0] */
+#define RANGE_0_255         2   /* [ 0.0, 255.0] */
+#define RANGE_M2_2          3   /* [-2.0, 2.0] */
+
+typedef struct _bench_opt_t
+{
+    const char          *model_path;
+    const char          *image_dir;     /* NULL: random input */
+    int                 range;
+    int                 warmup;
+    int                 iterations;
+    std::vector<int>    threads;
+    std::vector<std::string> backends;  /* "cpu" and/or "delegate" */
+    const char          *json_path;
+    const char          *golden_dir;    /* NULL: no output check */
+    int                 golden_update;  /* write the outputs as the new golden files */
+    double              tolerance;      /* max abs error against the golden outputs */
+    double              budget_ms;      /* p95 latency budget (0: none) */
+    const char          *dump_prefix;   /* TFLITE_DUMP_TENSORS (NULL: no dump) */
+} bench_opt_t;
+
+/* plain data: a configuration runs in a child process and sends this back */
+typedef struct _bench_result_t
+{
+    char                backend[32];
+    int                 threads;
+    metrics_timer_stats_t latency;
+    double              fps;
+    long                peak_rss_kb;
+    size_t              arena_bytes;
+    int                 golden;         /* GOLDEN_xxx */
+    double              max_error;      /* over every output of every image */
+    int                 over_budget;
+} bench_result_t;
+
+#define GOLDEN_NONE         0   /* not checked */
+#define GOLDEN_PASS         1
+#define GOLDEN_FAIL         2
+#define GOLDEN_UPDATED      3
+
+/* one prepared input (the bytes of every input tensor) */
+typedef struct _input_set_t
+{
+    std::string         name;           /* file name of the image, or "random" */
+    std::vector<std::vector<uint8_t>> tensors;
+} input_set_t;
+
+
+static void
+usage (const char *prog)
+{
+    fprintf (stderr,
+        "usage: %s -m model.tflite [options]\n"
+        "  -i dir      bind the images (jpg/png/bmp) of dir to the first input (default: random)\n"
+        "  -r range    value range of a float image input: 0_1, m1_1, m2_2, 0_255 (default: 0_1)\n"
+        "  -w N        warm-up iterations (default: 10)\n"
+        "  -n N        timed iterations (default: 100)\n"
+        "  -t N,N,..   thread counts (default: 1,2,4)\n"
+        "  -b B,B,..   backends: cpu, delegate (built-in delegate: %s) (default: cpu,delegate)\n"
+        "  -j file     write the results as JSON\n"
+        "  -g dir      compare the outputs with the golden files of dir (needs -i)\n"
+        "  -u          write the outputs into the -g dir as the new golden files\n"
+        "  -e err      max abs error allowed against the golden outputs (default: 1e-3)\n"
+        "  -B ms       fail when the p95 latency is over ms\n",
+        prog, tflite_get_delegate_name ());
+}
+
+static std::vector<std::string>
+split_list (const char *str)
+{
+    std::vector<std::string> list;
+    std::string s (str);
+    size_t pos = 0;
+
+    while (pos <= s.size ())
+    {
+        size_t next = s.find (',', pos);
+        if (next == std::string::npos)
+            next = s.size ();
+        if (next > pos)
+            list.push_back (s.substr (pos, next - pos));
+        pos = next + 1;
+    }
+    return list;
+}
+
+static int
+parse_args (int argc, char *argv[], bench_opt_t *opt)
+{
+    int c;
+
+    opt->model_path = NULL;
+    opt->image_dir  = NULL;
+    opt->range      = RANGE_0_1;
+    opt->warmup     = 10;
+    opt->iterations = 100;
+    opt->threads    = {1, 2, 4};
+    opt->backends   = {"cpu", "delegate"};
+    opt->json_path  = NULL;
+    opt->golden_dir = NULL;
+    opt->golden_update = 0;
+    opt->tolerance  = 1e-3;
+    opt->budget_ms  = 0;
+    opt->dump_prefix = getenv ("TFLITE_DUMP_TENSORS");
+
+    while ((c = getopt (argc, argv, "m:i:r:w:n:t:b:j:g:ue:B:h")) != -1)
+    {
+        switch (c)
+        {
+        case 'm': opt->model_path = optarg;         break;
+        case 'i': opt->image_dir  = optarg;         break;
+        case 'w': opt->warmup     = atoi (optarg);  break;
+        case 'n': opt->iterations = atoi (optarg);  break;
+        case 'j': opt->json_path  = optarg;         break;
+        case 'g': opt->golden_dir = optarg;         break;
+        case 'u': opt->golden_update = 1;           break;
+        case 'e': opt->tolerance  = atof (optarg);  break;
+        case 'B': opt->budget_ms  = atof (optarg);  break;
+        case 'r':
+            if      (strcmp (optarg, "0_1")   == 0) opt->range = RANGE_0_1;
+            else if (strcmp (optarg, "m1_1")  == 0) opt->range = RANGE_M1_1;
+            else if (strcmp (optarg, "m2_2")  == 0) opt->range = RANGE_M2_2;
+            else if (strcmp (optarg, "0_255") == 0) opt->range = RANGE_0_255;
+            else return -1;
+            break;
+        case 't':
+            opt->threads.clear ();
+            for (auto &s : split_list (optarg))
+                opt->threads.push_back (atoi (s.c_str ()));
+            break;
+        case 'b':
+            opt->backends = split_list (optarg);
+            for (auto &s : opt->backends)
+            {
+                if (s != "cpu" && s != "delegate")
+                    return -1;
+            }
+            break;
+        default:
+            return -1;
+        }
+    }
+
+    if (opt->model_path == NULL || opt->iterations <= 0 || opt->threads.empty ())
+        return -1;
+
+    /* random inputs are not reproducible across libc, so goldens need images */
+    if ((opt->golden_dir || opt->golden_update) && (opt->golden_dir == NULL || opt->image_dir == NULL))
+        return -1;
+    return 0;
+}
+
+
+/* -------------------------------------------------- *
+ *  inputs
+ * -------------------------------------------------- */
+static std::vector<std::string>
+list_images (const char *dir_path)
+{
+    std::vector<std::string> files;
+    DIR *dir = opendir (dir_path);
+    if (dir == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d): can't open %s\n", __FILE__, __LINE__, dir_path);
+        return files;
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir (dir)) != NULL)
+    {
+        const char *ext = strrchr (ent->d_name, '.');
+        if (ext && (strcasecmp (ext, ".jpg") == 0 || strcasecmp (ext, ".jpeg") == 0 ||
+                    strcasecmp (ext, ".png") == 0 || strcasecmp (ext, ".bmp")  == 0))
+        {
+            files.push_back (std::string (dir_path) + "/" + ent->d_name);
+        }
+    }
+    closedir (dir);
+
+    std::sort (files.begin (), files.end ());
+    if (files.size () > MAX_INPUT_IMAGES)
+        files.resize (MAX_INPUT_IMAGES);
+    return files;
+}
+
+static float
+to_range (int val, int range)
+{
+    switch (range)
+    {
+    case RANGE_M1_1:  return (val - 127.5f) / 127.5f;
+    case RANGE_M2_2:  return (val - 128.0f) / 64.0f;
+    case RANGE_0_255: return (float)val;
+    default:          return val / 255.0f;
+    }
+}
+
+/* resize (nearest) the image into the NHWC tensor and convert it to the tensor type. */
+static int
+fill_image (TfLiteTensor *tensor, const char *fname, int range, std::vector<uint8_t> &bytes)
+{
+    if (tensor->dims->size != 4)
+        return -1;
+
+    int h  = tensor->dims->data[1];
+    int w  = tensor->dims->data[2];
+    int ch = tensor->dims->data[3];
+    if (ch < 1 || ch > 4)
+        return -1;
+
+    int img_w, img_h, img_ch;
+    uint8_t *img = stbi_load (fname, &img_w, &img_h, &img_ch, ch);
+    if (img == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d): can't load %s\n", __FILE__, __LINE__, fname);
+        return -1;
+    }
+
+    bytes.resize (tensor->bytes);
+    for (int y = 0; y < h; y ++)
+    {
+        int sy = y * img_h / h;
+        for (int x = 0; x < w; x ++)
+        {
+            int sx = x * img_w / w;
+            const uint8_t *src = img + (sy * img_w + sx) * ch;
+            int dst_idx = (y * w + x) * ch;
+
+            for (int c = 0; c < ch; c ++)
+            {
+                switch (tensor->type)
+                {
+                case kTfLiteFloat32:
+                    ((float *)bytes.data ())[dst_idx + c] = to_range (src[c], range);
+                    break;
+                case kTfLiteUInt8:
+                    bytes[dst_idx + c] = src[c];
+                    break;
+                case kTfLiteInt8:
+                    bytes[dst_idx + c] = (uint8_t)(int8_t)(src[c] - 128);
+                    break;
+                default:
+                    stbi_image_free (img);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    stbi_image_free (img);
+    return 0;
+}
+
+static void
+fill_random (TfLiteTensor *tensor, int range, std::vector<uint8_t> &bytes)
+{
+    bytes.resize (tensor->bytes);
+
+    if (tensor->type == kTfLiteFloat32)
+    {
+        float *dst = (float *)bytes.data ();
+        for (size_t i = 0; i < tensor->bytes / sizeof (float); i ++)
+            dst[i] = to_range (rand () & 0xFF, range);
+    }
+    else
+    {
+        for (size_t i = 0; i < tensor->bytes; i ++)
+            bytes[i] = rand () & 0xFF;
+    }
+}
+
+static std::vector<input_set_t>
+prepare_inputs (std::unique_ptr<tflite::Interpreter> &interpreter, bench_opt_t *opt)
+{
+    std::vector<input_set_t> sets;
+    std::vector<std::string> images;
+    int num_inputs = interpreter->inputs ().size ();
+
+    if (opt->image_dir)
+        images = list_images (opt->image_dir);
+
+    int num_sets = images.empty () ? 1 : images.size ();
+    for (int s = 0; s < num_sets; s ++)
+    {
+        input_set_t set;
+        set.name = "random";
+        set.tensors.resize (num_inputs);
+        if (!images.empty ())
+        {
+            const char *slash = strrchr (images[s].c_str (), '/');
+            set.name = slash ? slash + 1 : images[s];
+        }
+
+        for (int i = 0; i < num_inputs; i ++)
+        {
+            TfLiteTensor *tensor = interpreter->tensor (interpreter->inputs ()[i]);
+            if (i == 0 && !images.empty () &&
+                fill_image (tensor, images[s].c_str (), opt->range, set.tensors[i]) == 0)
+                continue;
+
+            fill_random (tensor, opt->range, set.tensors[i]);
+        }
+        sets.push_back (set);
+    }
+
+    DBG_LOG ("inputs: %d set(s) from %s\n", num_sets, images.empty () ? "random data" : opt->image_dir);
+    return sets;
+}
+
+static void
+bind_inputs (std::unique_ptr<tflite::Interpreter> &interpreter, const input_set_t &set)
+{
+    for (size_t i = 0; i < set.tensors.size (); i ++)
+    {
+        TfLiteTensor *tensor = interpreter->tensor (interpreter->inputs ()[i]);
+        memcpy (tensor->data.raw, set.tensors[i].data (), tensor->bytes);
+    }
+}
+
+
+/* -------------------------------------------------- *
+ *  golden outputs
+ *    <golden_dir>/<image>.out<N>.raw: raw bytes of the N-th output tensor
+ * -------------------------------------------------- */
+static std::string
+golden_path (bench_opt_t *opt, const input_set_t &set, int out_idx)
+{
+    char suffix[32];
+    snprintf (suffix, sizeof (suffix), ".out%d.raw", out_idx);
+    return std::string (opt->golden_dir) + "/" + set.name + suffix;
+}
+
+/* element as a real value (quantized tensors are dequantized) */
+static double
+get_value (const TfLiteTensor *tensor, const void *data, size_t idx)
+{
+    float scale = tensor->params.scale;
+    int   zerop = tensor->params.zero_point;
+
+    switch (tensor->type)
+    {
+    case kTfLiteFloat32: return ((const float   *)data)[idx];
+    case kTfLiteInt32:   return ((const int32_t *)data)[idx];
+    case kTfLiteInt64:   return ((const int64_t *)data)[idx];
+    case kTfLiteUInt8:   return (((const uint8_t *)data)[idx] - zerop) * (double)scale;
+    case kTfLiteInt8:    return (((const int8_t  *)data)[idx] - zerop) * (double)scale;
+    default:             return ((const uint8_t *)data)[idx];
+    }
+}
+
+static size_t
+get_num_elements (const TfLiteTensor *tensor)
+{
+    size_t num = 1;
+    for (int i = 0; i < tensor->dims->size; i ++)
+        num *= tensor->dims->data[i];
+    return num;
+}
+
+/* returns the max abs error of the output, or -1 when there is no comparable golden file */
+static double
+compare_golden (const TfLiteTensor *tensor, const std::string &path)
+{
+    FILE *fp = fopen (path.c_str (), "rb");
+    if (fp == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d): no golden file %s\n", __FILE__, __LINE__, path.c_str ());
+        return -1;
+    }
+
+    std::vector<uint8_t> golden (tensor->bytes);
+    size_t len = fread (golden.data (), 1, golden.size (), fp);
+    int extra  = fgetc (fp);
+    fclose (fp);
+    if (len != tensor->bytes || extra != EOF)
+    {
+        DBG_LOGE ("ERR: %s(%d): %s: size mismatch\n", __FILE__, __LINE__, path.c_str ());
+        return -1;
+    }
+
+    double max_err = 0;
+    size_t num = get_num_elements (tensor);
+    for (size_t i = 0; i < num; i ++)
+    {
+        double err = fabs (get_value (tensor, tensor->data.raw, i) - get_value (tensor, golden.data (), i));
+        if (err > max_err)
+            max_err = err;
+    }
+    return max_err;
+}
+
+static int
+write_golden (const TfLiteTensor *tensor, const std::string &path)
+{
+    FILE *fp = fopen (path.c_str (), "wb");
+    if (fp == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d): can't open %s\n", __FILE__, __LINE__, path.c_str ());
+        return -1;
+    }
+
+    fwrite (tensor->data.raw, 1, tensor->bytes, fp);
+    fclose (fp);
+    return 0;
+}
+
+/*
+ *  run every input once more and check (or write) the outputs. with -u the
+ *  first configuration writes the golden files and the others are compared
+ *  with them, so CPU vs delegate and thread counts are checked too.
+ */
+static int s_golden_written = 0;
+
+static int
+check_golden (bench_opt_t *opt, std::unique_ptr<tflite::Interpreter> &interpreter,
+              std::vector<input_set_t> &inputs, bench_result_t *result)
+{
+    int update = opt->golden_update && !s_golden_written;
+
+    result->golden    = update ? GOLDEN_UPDATED : GOLDEN_PASS;
+    result->max_error = 0;
+
+    for (auto &set : inputs)
+    {
+        bind_inputs (interpreter, set);
+        if (interpreter->Invoke () != kTfLiteOk)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            result->golden = GOLDEN_FAIL;
+            return -1;
+        }
+
+        for (size_t i = 0; i < interpreter->outputs ().size (); i ++)
+        {
+            TfLiteTensor *tensor = interpreter->tensor (interpreter->outputs ()[i]);
+            std::string path = golden_path (opt, set, i);
+
+            if (update)
+            {
+                if (write_golden (tensor, path) < 0)
+                    result->golden = GOLDEN_FAIL;
+                continue;
+            }
+
+            double err = compare_golden (tensor, path);
+            if (err > result->max_error)
+                result->max_error = err;
+            if (err < 0 || err > opt->tolerance)
+            {
+                DBG_LOG ("golden: %s out%zu: max error %g (tolerance %g)\n",
+                         set.name.c_str (), i, err, opt->tolerance);
+                result->golden = GOLDEN_FAIL;
+            }
+        }
+    }
+
+    if (update)
+        s_golden_written = 1;
+    return (result->golden == GOLDEN_FAIL) ? -1 : 0;
+}
+
+
+/* -------------------------------------------------- *
+ *  benchmark
+ * -------------------------------------------------- */
+/* upper bound of the activation arena: the sum of the arena tensors (before reuse) */
+static size_t
+get_arena_bytes (std::unique_ptr<tflite::Interpreter> &interpreter)
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < interpreter->tensors_size (); i ++)
+    {
+        TfLiteTensor *tensor = interpreter->tensor (i);
+        if (tensor && tensor->allocation_type == kTfLiteArenaRw)
+            bytes += tensor->bytes;
+    }
+    return bytes;
+}
+
+
+/* -------------------------------------------------- *
+ *  tensor dump (TFLITE_DUMP_TENSORS=<prefix> in the environment)
+ *    <prefix>_<tensor name>_<dims without the batch>.raw: raw bytes of every
+ *    input and output tensor after the first Invoke() of the first input,
+ *    e.g. the recorded tensors of tools/microbench.
+ * -------------------------------------------------- */
+static int
+dump_tensor (const char *prefix, const TfLiteTensor *tensor)
+{
+    char path[512];
+    int len = snprintf (path, sizeof (path), "%s_", prefix);
+
+    /* "raw_outputs/box_encodings" --> "raw_outputs_box_encodings" */
+    for (const char *c = tensor->name ? tensor->name : "tensor"; *c && len < (int)sizeof (path) - 64; c ++)
+        path[len ++] = isalnum ((unsigned char)*c) ? *c : '_';
+
+    int first_dim = (tensor->dims->size > 1 && tensor->dims->data[0] == 1) ? 1 : 0;
+    for (int i = first_dim; i < tensor->dims->size; i ++)
+        len += snprintf (path + len, sizeof (path) - len, "%c%d", (i == first_dim) ? '_' : 'x', tensor->dims->data[i]);
+    snprintf (path + len, sizeof (path) - len, ".raw");
+
+    FILE *fp = fopen (path, "wb");
+    if (fp == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d): can't open %s\n", __FILE__, __LINE__, path);
+        return -1;
+    }
+
+    size_t written = fwrite (tensor->data.raw, 1, tensor->bytes, fp);
+    fclose (fp);
+    if (written != tensor->bytes)
+    {
+        DBG_LOGE ("ERR: %s(%d): %s\n", __FILE__, __LINE__, path);
+        return -1;
+    }
+
+    DBG_LOG ("dump: %s (%zu bytes)\n", path, tensor->bytes);
+    return 0;
+}
+
+static void
+dump_tensors (const char *prefix, std::unique_ptr<tflite::Interpreter> &interpreter)
+{
+    for (int idx : interpreter->inputs ())
+        dump_tensor (prefix, interpreter->tensor (idx));
+    for (int idx : interpreter->outputs ())
+        dump_tensor (prefix, interpreter->tensor (idx));
+}
+
+
+static int
+run_benchmark (bench_opt_t *opt, const std::string &backend, int num_threads,
+               std::vector<input_set_t> &inputs, bench_result_t *result)
+{
+    char env_threads[16];
+    sprintf (env_threads, "%d", num_threads);
+    setenv ("FORCE_TFLITE_NUM_THREADS", env_threads, 1);
+    if (backend == "cpu")
+        setenv ("FORCE_TFLITE_DELEGATE", "none", 1);
+    else
+        unsetenv ("FORCE_TFLITE_DELEGATE");
+
+    std::unique_ptr<tflite_interpreter_t> p (new tflite_interpreter_t);
+
+    /* custom ops of the hair segmentation model */
+    p->resolver.AddCustom ("MaxPoolingWithArgmax2D",
+            mediapipe::tflite_operations::RegisterMaxPoolingWithArgmax2D ());
+    p->resolver.AddCustom ("MaxUnpooling2D",
+            mediapipe::tflite_operations::RegisterMaxUnpooling2D ());
+    p->resolver.AddCustom ("Convolution2DTransposeBias",
+            mediapipe::tflite_operations::RegisterConvolution2DTransposeBias ());
+
+    if (tflite_create_interpreter_from_file (p.get (), opt->model_path) < 0)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (inputs.empty ())
+        inputs = prepare_inputs (p->interpreter, opt);
+
+    for (int i = 0; i < opt->warmup; i ++)
+    {
+        bind_inputs (p->interpreter, inputs[i % inputs.size ()]);
+        if (p->interpreter->Invoke () != kTfLiteOk)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            return -1;
+        }
+
+        if (i == 0 && opt->dump_prefix)
+            dump_tensors (opt->dump_prefix, p->interpreter);
+    }
+
+    char name[METRICS_NAME_LEN];
+    snprintf (name, sizeof (name), "%s/%d", backend.c_str (), num_threads);
+    int timer = metrics_timer_id (name);
+
+    double total_ms = 0;
+    for (int i = 0; i < opt->iterations; i ++)
+    {
+        bind_inputs (p->interpreter, inputs[i % inputs.size ()]);
+
+        double ttime0 = pmeter_get_time_ms ();
+        if (p->interpreter->Invoke () != kTfLiteOk)
+        {
+            DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+            return -1;
+        }
+        double ms = pmeter_get_time_ms () - ttime0;
+
+        metrics_record_ms (timer, ms);
+        total_ms += ms;
+    }
+
+    snprintf (result->backend, sizeof (result->backend), "%s",
+              (backend == "cpu") ? "CPU" : tflite_get_delegate_name ());
+    result->threads     = num_threads;
+    metrics_get_timer (timer, &result->latency);
+    result->fps         = (total_ms > 0) ? opt->iterations * 1000.0 / total_ms : 0;
+    result->peak_rss_kb = 0;    /* filled in by the parent */
+    result->arena_bytes = get_arena_bytes (p->interpreter);
+    result->over_budget = (opt->budget_ms > 0 && result->latency.p95_ms > opt->budget_ms);
+
+    result->golden    = GOLDEN_NONE;
+    result->max_error = 0;
+    if (opt->golden_dir)
+        check_golden (opt, p->interpreter, inputs, result);
+
+    return 0;
+}
+
+/*
+ *  ru_maxrss is the high-water mark of a process and never goes down, so
+ *  every configuration runs in a child of its own and the peak RSS is the
+ *  child's, read by wait4(). returns -1 when the configuration failed.
+ */
+static int
+run_benchmark_in_child (bench_opt_t *opt, const std::string &backend, int num_threads,
+                        bench_result_t *result)
+{
+    int fd[2];
+    if (pipe (fd) < 0)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        return -1;
+    }
+
+    fflush (stdout);
+    fflush (stderr);
+
+    pid_t pid = fork ();
+    if (pid < 0)
+    {
+        DBG_LOGE ("ERR: %s(%d)\n", __FILE__, __LINE__);
+        close (fd[0]);
+        close (fd[1]);
+        return -1;
+    }
+
+    if (pid == 0)
+    {
+        std::vector<input_set_t> inputs;
+        bench_result_t child_result;
+        int ret = run_benchmark (opt, backend, num_threads, inputs, &child_result);
+
+        close (fd[0]);
+        if (ret == 0)
+        {
+            ssize_t len = write (fd[1], &child_result, sizeof (child_result));
+            (void)len;
+        }
+        close (fd[1]);
+        fflush (stdout);
+        fflush (stderr);
+        _exit (ret == 0 ? 0 : 1);
+    }
+
+    close (fd[1]);
+    size_t got = 0;
+    while (got < sizeof (*result))
+    {
+        ssize_t len = read (fd[0], (char *)result + got, sizeof (*result) - got);
+        if (len <= 0)
+            break;
+        got += len;
+    }
+    close (fd[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4 (pid, &status, 0, &usage) < 0 || !WIFEXITED (status) || WEXITSTATUS (status) != 0 ||
+        got != sizeof (*result))
+    {
+        DBG_LOGE ("ERR: %s(%d): %s/%d failed\n", __FILE__, __LINE__, backend.c_str (), num_threads);
+        return -1;
+    }
+
+    result->peak_rss_kb = usage.ru_maxrss;
+
+    /* the next children compare with the golden files this one wrote */
+    if (result->golden == GOLDEN_UPDATED)
+        s_golden_written = 1;
+    return 0;
+}
+
+
+/* -------------------------------------------------- *
+ *  report
+ * -------------------------------------------------- */
+static const char *
+check_name (bench_result_t &r)
+{
+    if (r.golden == GOLDEN_FAIL) return "FAIL:out";
+    if (r.over_budget)           return "FAIL:p95";
+    if (r.golden == GOLDEN_PASS) return "ok";
+    if (r.golden == GOLDEN_UPDATED) return "updated";
+    return "-";
+}
+
+static int
+is_failed (bench_result_t &r)
+{
+    return r.golden == GOLDEN_FAIL || r.over_budget;
+}
+
+static void
+print_table (bench_opt_t *opt, std::vector<bench_result_t> &results)
+{
+    printf ("\nmodel: %s  (warm-up %d, iterations %d)\n", opt->model_path, opt->warmup, opt->iterations);
+    if (opt->golden_dir)
+        printf ("golden: %s  (tolerance %g)\n", opt->golden_dir, opt->tolerance);
+    if (opt->budget_ms > 0)
+        printf ("budget: p95 <= %.2f [ms]\n", opt->budget_ms);
+    printf ("--------------------------------------------------------------------------------------------------------\n");
+    printf (" backend          threads   mean    p50    p95    p99    max [ms]    fps  peakRSS  arena[MB]  check\n");
+    printf ("--------------------------------------------------------------------------------------------------------\n");
+    for (auto &r : results)
+    {
+        printf (" %-16s %7d %6.2f %6.2f %6.2f %6.2f %6.2f     %6.1f %7.1f %8.2f   %s\n",
+                r.backend, r.threads,
+                r.latency.mean_ms, r.latency.p50_ms, r.latency.p95_ms, r.latency.p99_ms, r.latency.max_ms,
+                r.fps, r.peak_rss_kb / 1024.0, r.arena_bytes / (1024.0 * 1024.0), check_name (r));
+    }
+    printf ("--------------------------------------------------------------------------------------------------------\n");
+}
+
+static int
+write_json (bench_opt_t *opt, std::vector<bench_result_t> &results)
+{
+    FILE *fp = fopen (opt->json_path, "w");
+    if (fp == NULL)
+    {
+        DBG_LOGE ("ERR: %s(%d): can't open %s\n", __FILE__, __LINE__, opt->json_path);
+        return -1;
+    }
+
+    fprintf (fp, "{\n  \"model\": \"%s\",\n  \"warmup\": %d,\n  \"iterations\": %d,\n  \"results\": [",
+             opt->model_path, opt->warmup, opt->iterations);
+    for (size_t i = 0; i < results.size (); i ++)
+    {
+        bench_result_t &r = results[i];
+        fprintf (fp, "%s\n    {\"backend\": \"%s\", \"threads\": %d, \"mean_ms\": %.3f, \"p50_ms\": %.3f, "
+                 "\"p95_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f, \"fps\": %.2f, "
+                 "\"peak_rss_kb\": %ld, \"arena_bytes\": %zu, \"check\": \"%s\", \"max_error\": %g}",
+                 i ? "," : "", r.backend, r.threads,
+                 r.latency.mean_ms, r.latency.p50_ms, r.latency.p95_ms, r.latency.p99_ms, r.latency.max_ms,
+                 r.fps, r.peak_rss_kb, r.arena_bytes, check_name (r), r.max_error);
+    }
+    fprintf (fp, "\n  ]\n}\n");
+    fclose (fp);
+    return 0;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    bench_opt_t opt;
+    std::vector<bench_result_t> results;
+
+    if (parse_args (argc, argv, &opt) < 0)
+    {
+        usage (argv[0]);
+        return -1;
+    }
+
+    for (auto &backend : opt.backends)
+    {
+        /* nothing to compare with when no delegate is built in */
+        if (backend == "delegate" && strcmp (tflite_get_delegate_name (), "CPU") == 0)
+            continue;
+
+        for (int num_threads : opt.threads)
+        {
+            bench_result_t result;
+            int ret = run_benchmark_in_child (&opt, backend, num_threads, &result);
+
+            /* the tensors are dumped by the first configuration only */
+            opt.dump_prefix = NULL;
+
+            if (ret < 0)
+                continue;
+            results.push_back (result);
+        }
+    }
+
+    print_table (&opt, results);
+
+    if (opt.json_path)
+        write_json (&opt, results);
+
+    if (results.empty ())
+        return -1;
+
+    /* non-zero exit for scripts when an output or the latency budget is off */
+    for (auto &r : results)
+    {
+        if (is_failed (r))
+            return 1;
+    }
+    return 0;
+}